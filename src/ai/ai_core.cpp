@@ -17,6 +17,7 @@
 #include "../network/network.h"
 #include "../window_func.h"
 #include "../framerate_type.h"
+#include "../script/script_thread.hpp"
 #include "ai_scanner.hpp"
 #include "ai_instance.hpp"
 #include "ai_config.hpp"
@@ -78,13 +79,25 @@
 
 	Backup<CompanyByte> cur_company(_current_company, FILE_LINE);
 	const Company *c;
-	FOR_ALL_COMPANIES(c) {
-		if (c->is_ai) {
-			PerformanceMeasurer framerate((PerformanceElement)(PFE_AI0 + c->index));
-			cur_company.Change(c->index);
-			c->ai_instance->GameLoop();
-		} else {
-			PerformanceMeasurer::SetInactive((PerformanceElement)(PFE_AI0 + c->index));
+	if (ScriptThreadedGameLoop::IsEnabled()) {
+		ScriptThreadedGameLoop loop;
+		FOR_ALL_COMPANIES(c) {
+			if (c->is_ai) {
+				loop.Add(c->ai_instance, c->index, (PerformanceElement)(PFE_AI0 + c->index));
+			} else {
+				PerformanceMeasurer::SetInactive((PerformanceElement)(PFE_AI0 + c->index));
+			}
+		}
+		loop.Run();
+	} else {
+		FOR_ALL_COMPANIES(c) {
+			if (c->is_ai) {
+				PerformanceMeasurer framerate((PerformanceElement)(PFE_AI0 + c->index));
+				cur_company.Change(c->index);
+				c->ai_instance->GameLoop();
+			} else {
+				PerformanceMeasurer::SetInactive((PerformanceElement)(PFE_AI0 + c->index));
+			}
 		}
 	}
 	cur_company.Restore();
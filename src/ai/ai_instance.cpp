@@ -213,17 +213,19 @@ void AIInstance::Died()
 {
 	ScriptInstance::Died();
 
+	const AIInfo *info = AIConfig::GetConfig(_current_company, AIConfig::SSS_FORCE_GAME)->GetInfo();
+	if (info != NULL && info->GetURL() != NULL) {
+		ScriptLog::Info("Please report the error to the following URL:");
+		ScriptLog::Info(info->GetURL());
+	}
+}
+
+void AIInstance::ShowDiedWindows()
+{
 	ShowAIDebugWindow(_current_company);
 
 	const AIInfo *info = AIConfig::GetConfig(_current_company, AIConfig::SSS_FORCE_GAME)->GetInfo();
-	if (info != NULL) {
-		ShowErrorMessage(STR_ERROR_AI_PLEASE_REPORT_CRASH, INVALID_STRING_ID, WL_WARNING);
-
-		if (info->GetURL() != NULL) {
-			ScriptLog::Info("Please report the error to the following URL:");
-			ScriptLog::Info(info->GetURL());
-		}
-	}
+	if (info != NULL) ShowErrorMessage(STR_ERROR_AI_PLEASE_REPORT_CRASH, INVALID_STRING_ID, WL_WARNING);
 }
 
 void AIInstance::LoadDummyScript()
@@ -31,6 +31,7 @@ public:
 private:
 	void RegisterAPI() override;
 	void Died() override;
+	void ShowDiedWindows() override;
 	CommandCallback *GetDoCommandCallback() override;
 	void LoadDummyScript() override;
 };
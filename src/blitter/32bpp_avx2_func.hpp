@@ -0,0 +1,341 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file 32bpp_avx2_func.hpp Functions related to the AVX2 32 bpp blitters. */
+
+#ifndef BLITTER_32BPP_AVX2_FUNC_HPP
+#define BLITTER_32BPP_AVX2_FUNC_HPP
+
+#if defined(WITH_SSE) && defined(WITH_AVX2)
+
+#include "32bpp_sse_func.hpp"
+
+/** The masks of the SSE blitters, duplicated for both 128 bits lanes of an AVX2 register. */
+struct AVX2BlitterMasks {
+	__m256i alpha_control; ///< Copies the alpha of each pixel to its colour channels, see #ALPHA_CONTROL_MASK.
+	__m256i pack_low;      ///< Packs the low pixels of a lane into its first half, see #PACK_LOW_CONTROL_MASK.
+	__m256i pack_high;     ///< Packs the high pixels of a lane into its second half, see #PACK_HIGH_CONTROL_MASK.
+	__m256i tr_nom_base;   ///< Nominator base for darkening pixels, see #TRANSPARENT_NOM_BASE.
+
+	AVX2BlitterMasks() :
+		alpha_control(_mm256_broadcastsi128_si256(ALPHA_CONTROL_MASK)),
+		pack_low(_mm256_broadcastsi128_si256(PACK_LOW_CONTROL_MASK)),
+		pack_high(_mm256_broadcastsi128_si256(PACK_HIGH_CONTROL_MASK)),
+		tr_nom_base(_mm256_broadcastsi128_si256(TRANSPARENT_NOM_BASE))
+	{
+	}
+};
+
+/**
+ * Get a mask selecting the first pixels of a block of eight.
+ * @param count The number of pixels to select, less than eight.
+ * @return A mask with all bits of the selected pixels set.
+ */
+static inline __m256i FirstPixelsMask(uint count)
+{
+	return _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+/**
+ * Alpha blend four pixels that have been unpacked to 16 bits per channel.
+ * Uses the same calculation as AlphaBlendTwoPixels, so both give the same result.
+ */
+static inline __m256i AlphaBlendUnpackedPixels(__m256i src, __m256i dst, const __m256i &alpha_control)
+{
+	__m256i alpha = _mm256_cmpgt_epi16(src, _mm256_setzero_si256()); // PCMPGTW
+	alpha = _mm256_srli_epi16(alpha, 15);
+	alpha = _mm256_add_epi16(alpha, src);
+	alpha = _mm256_shuffle_epi8(alpha, alpha_control); // PSHUFB, put alpha in front of each rgb
+	src = _mm256_sub_epi16(src, dst); // PSUBW,    (r - Cr)
+	src = _mm256_mullo_epi16(src, alpha); // PMULLW, a*(r - Cr)
+	src = _mm256_srli_epi16(src, 8); // PSRLW,     a*(r - Cr)/256
+	return _mm256_add_epi16(src, dst); // PADDW,   a*(r - Cr)/256 + Cr
+}
+
+static inline __m256i AlphaBlendEightPixels(__m256i src, __m256i dst, const AVX2BlitterMasks &masks)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i blended_lo = AlphaBlendUnpackedPixels(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(dst, zero), masks.alpha_control);
+	__m256i blended_hi = AlphaBlendUnpackedPixels(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(dst, zero), masks.alpha_control);
+	/* Unpacking works per lane, so packing the low and high halves back puts each pixel in its place again. */
+	return _mm256_or_si256(_mm256_shuffle_epi8(blended_lo, masks.pack_low), _mm256_shuffle_epi8(blended_hi, masks.pack_high));
+}
+
+/**
+ * Darken four pixels that have been unpacked to 16 bits per channel.
+ * Uses the same calculation as DarkenTwoPixels, so both give the same result.
+ */
+static inline __m256i DarkenUnpackedPixels(__m256i src, __m256i dst, const AVX2BlitterMasks &masks)
+{
+	__m256i alpha = _mm256_shuffle_epi8(src, masks.alpha_control);
+	alpha = _mm256_srli_epi16(alpha, 2);
+	__m256i nom = _mm256_sub_epi16(masks.tr_nom_base, alpha);
+	dst = _mm256_mullo_epi16(dst, nom);
+	return _mm256_srli_epi16(dst, 8);
+}
+
+static inline __m256i DarkenEightPixels(__m256i src, __m256i dst, const AVX2BlitterMasks &masks)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i darkened_lo = DarkenUnpackedPixels(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(dst, zero), masks);
+	__m256i darkened_hi = DarkenUnpackedPixels(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(dst, zero), masks);
+	return _mm256_packus_epi16(darkened_lo, darkened_hi);
+}
+
+/**
+ * Draw a line of a sprite without translucent pixels.
+ * @param dst The destination.
+ * @param src The pixels of the sprite.
+ * @param width The number of pixels to draw.
+ */
+static inline void DrawOpaqueLine(Colour *dst, const Colour *src, uint width)
+{
+	for (; width >= 8; width -= 8) {
+		__m256i srcABCD = _mm256_loadu_si256((const __m256i *) src);
+		__m256i dstABCD = _mm256_loadu_si256((const __m256i *) dst);
+		/* The sign bit of each pixel is the top bit of its alpha. */
+		_mm256_storeu_si256((__m256i *) dst, _mm256_blendv_epi8(dstABCD, srcABCD, _mm256_srai_epi32(srcABCD, 31)));
+		src += 8;
+		dst += 8;
+	}
+
+	if (width != 0) {
+		const __m256i mask = FirstPixelsMask(width);
+		__m256i srcABCD = _mm256_maskload_epi32((const int *) src, mask);
+		_mm256_maskstore_epi32((int *) dst, _mm256_and_si256(mask, srcABCD), srcABCD);
+	}
+}
+
+/**
+ * Alpha blend a line of a sprite.
+ * @param dst The destination.
+ * @param src The pixels of the sprite.
+ * @param width The number of pixels to draw.
+ * @param masks The masks to use.
+ */
+static inline void AlphaBlendLine(Colour *dst, const Colour *src, uint width, const AVX2BlitterMasks &masks)
+{
+	for (; width >= 8; width -= 8) {
+		__m256i srcABCD = _mm256_loadu_si256((const __m256i *) src);
+		__m256i dstABCD = _mm256_loadu_si256((const __m256i *) dst);
+		_mm256_storeu_si256((__m256i *) dst, AlphaBlendEightPixels(srcABCD, dstABCD, masks));
+		src += 8;
+		dst += 8;
+	}
+
+	if (width != 0) {
+		const __m256i mask = FirstPixelsMask(width);
+		__m256i srcABCD = _mm256_maskload_epi32((const int *) src, mask);
+		__m256i dstABCD = _mm256_maskload_epi32((const int *) dst, mask);
+		_mm256_maskstore_epi32((int *) dst, mask, AlphaBlendEightPixels(srcABCD, dstABCD, masks));
+	}
+}
+
+/**
+ * Make the destination a bit darker under a sprite, so the sprite looks transparent.
+ * @param dst The destination.
+ * @param src The pixels of the sprite.
+ * @param width The number of pixels to draw.
+ * @param masks The masks to use.
+ */
+static inline void DarkenLine(Colour *dst, const Colour *src, uint width, const AVX2BlitterMasks &masks)
+{
+	for (; width >= 8; width -= 8) {
+		__m256i srcABCD = _mm256_loadu_si256((const __m256i *) src);
+		__m256i dstABCD = _mm256_loadu_si256((const __m256i *) dst);
+		_mm256_storeu_si256((__m256i *) dst, DarkenEightPixels(srcABCD, dstABCD, masks));
+		src += 8;
+		dst += 8;
+	}
+
+	if (width != 0) {
+		const __m256i mask = FirstPixelsMask(width);
+		__m256i srcABCD = _mm256_maskload_epi32((const int *) src, mask);
+		__m256i dstABCD = _mm256_maskload_epi32((const int *) dst, mask);
+		_mm256_maskstore_epi32((int *) dst, mask, DarkenEightPixels(srcABCD, dstABCD, masks));
+	}
+}
+
+/**
+ * Remap a single pixel; written so the compiler uses CMOV.
+ * @param src The pixel of the sprite.
+ * @param m The remap index of the pixel.
+ * @param remap The remap table.
+ * @param palette The palette to look the remapped colour up in.
+ * @return The remapped pixel without brightness adjustment, or fully transparent if the remap table hides the pixel.
+ */
+static inline Colour RemapPixel(Colour src, uint m, const byte *remap, const Colour *palette)
+{
+	const uint r = remap[m];
+	const Colour cmap = (palette[r].data & 0x00FFFFFF) | (src.data & 0xFF000000);
+	const Colour remapped = r == 0 ? Colour(0) : cmap;
+	return m != 0 ? remapped : src;
+}
+
+/**
+ * Remap two pixels like the SSE4 blitter does.
+ * @param src The pixels of the sprite.
+ * @param mvX2 The map values of both pixels.
+ * @param remap The remap table.
+ * @param palette The palette to look the remapped colours up in.
+ * @return The remapped pixels in the low 64 bits.
+ */
+static inline __m128i RemapTwoPixels(const Colour *src, uint32 mvX2, const byte *remap, const Colour *palette)
+{
+	if (!(mvX2 & 0x00FF00FF)) return _mm_loadl_epi64((const __m128i *) src);
+
+	const Colour c0 = RemapPixel(src[0], (byte) mvX2, remap, palette);
+	const Colour c1 = RemapPixel(src[1], (byte) (mvX2 >> 16), remap, palette);
+	__m128i srcAB = _mm_insert_epi32(_mm_cvtsi32_si128(c0.data), c1.data, 1);
+	if ((mvX2 & 0xFF00FF00) != 0x80008000) srcAB = AdjustBrightnessOfTwoPixels(srcAB, mvX2);
+	return srcAB;
+}
+
+/**
+ * Draw a line of a sprite with its colours remapped.
+ * Blocks of eight pixels without any remapped pixel are blended directly. Remapped
+ * pixels are sparse in most sprites, so the palette lookups and brightness adjustments
+ * are done per pair, only where needed, like the SSE4 blitter does.
+ * @param dst The destination.
+ * @param src The pixels of the sprite.
+ * @param src_mv The map values of the sprite.
+ * @param width The number of pixels to draw.
+ * @param remap The remap table.
+ * @param palette The palette to look the remapped colours up in.
+ * @param masks The masks to use.
+ */
+static inline void RemapLine(Colour *dst, const Colour *src, const Blitter_32bppSSE_Base::MapValue *src_mv, uint width, const byte *remap, const Colour *palette, const AVX2BlitterMasks &masks)
+{
+	const __m128i m_mask = _mm_set1_epi32(0x00FF00FF);
+
+	for (; width >= 8; width -= 8) {
+		__m256i srcABCD = _mm256_loadu_si256((const __m256i *) src);
+		__m256i dstABCD = _mm256_loadu_si256((const __m256i *) dst);
+
+		/* Remap colours. */
+		if (!_mm_testz_si128(_mm_loadu_si128((const __m128i *) src_mv), m_mask)) {
+			const uint32 *mvX2 = (const uint32 *) src_mv;
+			__m128i srcAB = _mm_unpacklo_epi64(RemapTwoPixels(src, mvX2[0], remap, palette), RemapTwoPixels(src + 2, mvX2[1], remap, palette));
+			__m128i srcCD = _mm_unpacklo_epi64(RemapTwoPixels(src + 4, mvX2[2], remap, palette), RemapTwoPixels(src + 6, mvX2[3], remap, palette));
+			srcABCD = _mm256_inserti128_si256(_mm256_castsi128_si256(srcAB), srcCD, 1);
+		}
+
+		/* Blend colours. */
+		_mm256_storeu_si256((__m256i *) dst, AlphaBlendEightPixels(srcABCD, dstABCD, masks));
+		src += 8;
+		dst += 8;
+		src_mv += 8;
+	}
+
+	const __m128i a_cm = ALPHA_CONTROL_MASK;
+	const __m128i pack_low_cm = PACK_LOW_CONTROL_MASK;
+	for (; width >= 2; width -= 2) {
+		__m128i srcAB = RemapTwoPixels(src, *(const uint32 *) src_mv, remap, palette);
+		__m128i dstAB = _mm_loadl_epi64((const __m128i *) dst);
+		_mm_storel_epi64((__m128i *) dst, AlphaBlendTwoPixels(srcAB, dstAB, a_cm, pack_low_cm));
+		src += 2;
+		dst += 2;
+		src_mv += 2;
+	}
+
+	if (width != 0) {
+		/* In case the m-channel is zero, do not remap this pixel in any way. */
+		Colour colour = *src;
+		if (src_mv->m != 0) {
+			const uint r = remap[src_mv->m];
+			if (r == 0) return;
+			colour = AdjustBrightneSSE(palette[r], src_mv->v);
+			if (src->a != 255) colour.a = src->a;
+		}
+		if (src->a == 255) {
+			*dst = colour;
+		} else {
+			dst->data = _mm_cvtsi128_si32(AlphaBlendTwoPixels(_mm_cvtsi32_si128(colour.data), _mm_cvtsi32_si128(dst->data), a_cm, pack_low_cm));
+		}
+	}
+}
+
+/**
+ * Clear the animation buffer under the pixels of a sprite that are not fully transparent.
+ * @param anim The animation buffer.
+ * @param src The pixels of the sprite.
+ * @param width The number of pixels of the line.
+ */
+static inline void ClearAnimLine(uint16 *anim, const Colour *src, uint width)
+{
+	const __m256i alpha_mask = _mm256_set1_epi32((int) 0xFF000000);
+
+	for (; width >= 8; width -= 8) {
+		__m256i srcABCD = _mm256_loadu_si256((const __m256i *) src);
+		/* All bits set for the transparent pixels, whose animation value is kept. */
+		__m256i keep = _mm256_cmpeq_epi32(_mm256_and_si256(srcABCD, alpha_mask), _mm256_setzero_si256());
+		/* Packing works per lane, so move the second lane's half to the lower 128 bits. */
+		keep = _mm256_permute4x64_epi64(_mm256_packs_epi32(keep, keep), 0x08);
+		__m128i animABCD = _mm_loadu_si128((const __m128i *) anim);
+		_mm_storeu_si128((__m128i *) anim, _mm_and_si128(animABCD, _mm256_castsi256_si128(keep)));
+		src += 8;
+		anim += 8;
+	}
+
+	for (; width != 0; width--) {
+		if (src->a != 0) *anim = 0;
+		src++;
+		anim++;
+	}
+}
+
+/**
+ * Make a line of pixels darker, like MakeTransparent(colour, 154) does.
+ * @param dst The pixels to change.
+ * @param width The number of pixels.
+ */
+static inline void MakeTransparentLine(Colour *dst, uint width)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i nom = _mm256_set1_epi16(154);
+	const __m256i alpha_mask = _mm256_set1_epi32((int) 0xFF000000);
+
+	for (uint x = 0; x < width; x += 8) {
+		const __m256i mask = width - x >= 8 ? _mm256_set1_epi32(-1) : FirstPixelsMask(width - x);
+		__m256i colour = _mm256_maskload_epi32((const int *) (dst + x), mask);
+		__m256i colour_lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(colour, zero), nom), 8);
+		__m256i colour_hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(colour, zero), nom), 8);
+		colour = _mm256_or_si256(_mm256_packus_epi16(colour_lo, colour_hi), alpha_mask);
+		_mm256_maskstore_epi32((int *) (dst + x), mask, colour);
+	}
+}
+
+/**
+ * Make a line of pixels grey, like MakeGrey does.
+ * @param dst The pixels to change.
+ * @param width The number of pixels.
+ */
+static inline void MakeGreyLine(Colour *dst, uint width)
+{
+	const __m256i channel_mask = _mm256_set1_epi32(0xFF);
+	const __m256i alpha_mask = _mm256_set1_epi32((int) 0xFF000000);
+	const __m256i r_weight = _mm256_set1_epi32(19595);
+	const __m256i g_weight = _mm256_set1_epi32(38470);
+	const __m256i b_weight = _mm256_set1_epi32(7471);
+
+	for (uint x = 0; x < width; x += 8) {
+		const __m256i mask = width - x >= 8 ? _mm256_set1_epi32(-1) : FirstPixelsMask(width - x);
+		__m256i colour = _mm256_maskload_epi32((const int *) (dst + x), mask);
+		__m256i r = _mm256_and_si256(_mm256_srli_epi32(colour, 16), channel_mask);
+		__m256i g = _mm256_and_si256(_mm256_srli_epi32(colour, 8), channel_mask);
+		__m256i b = _mm256_and_si256(colour, channel_mask);
+		__m256i grey = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, r_weight), _mm256_mullo_epi32(g, g_weight)), _mm256_mullo_epi32(b, b_weight));
+		grey = _mm256_srli_epi32(grey, 16);
+		colour = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(grey, 16), _mm256_slli_epi32(grey, 8)), _mm256_or_si256(grey, alpha_mask));
+		_mm256_maskstore_epi32((int *) (dst + x), mask, colour);
+	}
+}
+
+#endif /* WITH_SSE && WITH_AVX2 */
+#endif /* BLITTER_32BPP_AVX2_FUNC_HPP */
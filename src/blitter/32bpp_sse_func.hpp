@@ -184,7 +184,8 @@ static inline __m128i AdjustBrightnessOfTwoPixels(__m128i from, uint32 brightnes
 #endif
 }
 
-#if FULL_ANIMATION == 0
+/* The AVX2 blitters only use the helpers above; they have their own drawing functions. */
+#if FULL_ANIMATION == 0 && SSE_VERSION <= 4
 /**
  * Draws a sprite to a (screen) buffer. It is templated to allow faster operation.
  *
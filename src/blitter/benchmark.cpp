@@ -0,0 +1,223 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file benchmark.cpp Microbenchmark of the sprite drawing of the 32bpp blitters. */
+
+#include "../stdafx.h"
+#include "../core/mem_func.hpp"
+#include "../console_func.h"
+#include "../gfx_func.h"
+#include "../settings_type.h"
+#include "../spritecache.h"
+#include "../video/video_driver.hpp"
+#include "../table/sprites.h"
+#include "factory.hpp"
+#include <chrono>
+#include <vector>
+
+#include "../safeguards.h"
+
+/** The blitters benchmarked when none are given; the first one is the reference the others are compared with. */
+static const char * const _benchmark_blitters[] = {
+	"32bpp-sse4",
+	"32bpp-optimized",
+	"32bpp-sse2",
+	"32bpp-ssse3",
+	"32bpp-avx2",
+	"32bpp-anim",
+	"32bpp-sse4-anim",
+	"32bpp-avx2-anim",
+};
+
+static const int BENCHMARK_SPRITE_WIDTH  = 61;  ///< Width of the benchmarked sprite; odd to include the partial blocks at the end of the lines.
+static const int BENCHMARK_SPRITE_HEIGHT = 64;  ///< Height of the benchmarked sprite.
+static const int BENCHMARK_BUFFER_WIDTH  = 128; ///< Width of the buffer the sprite is drawn to.
+static const int BENCHMARK_BUFFER_HEIGHT = 64;  ///< Height of the buffer the sprite is drawn to.
+
+/** Results of benchmarking a single blitter. */
+struct BlitterBenchmarkResult {
+	uint64 time[4];              ///< Time in microseconds for drawing normally, remapped, transparent and the colour mapping rectangles.
+	std::vector<uint32> pixels;  ///< The buffer after drawing everything once, for comparing the blitters.
+};
+
+static void *AllocateBenchmarkSprite(size_t size)
+{
+	return MallocT<byte>(size);
+}
+
+/**
+ * Create the sprite to benchmark with: a mix of transparent, translucent, opaque and remapped pixels.
+ * The pixels are pseudo random, but the same for every run.
+ * @param data The pixels to fill.
+ */
+static void FillBenchmarkSprite(SpriteLoader::CommonPixel *data)
+{
+	uint32 seed = 0x12345678;
+	for (int i = 0; i < BENCHMARK_SPRITE_WIDTH * BENCHMARK_SPRITE_HEIGHT; i++) {
+		/* Xorshift, so the sprite does not depend on the game's random state. */
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+
+		SpriteLoader::CommonPixel &p = data[i];
+		p.r = GB(seed, 0, 8);
+		p.g = GB(seed, 8, 8);
+		p.b = GB(seed, 16, 8);
+		switch (GB(seed, 24, 3)) {
+			case 0:
+			case 1: p.a = 0; break;
+			case 2: p.a = GB(seed, 3, 8); break;
+			default: p.a = 255; break;
+		}
+		/* Company colours, without palette animation. */
+		p.m = (p.a != 0 && GB(seed, 27, 2) == 0) ? 0xC6 + GB(seed, 29, 3) : 0;
+	}
+}
+
+/**
+ * Draw the benchmark sprite and colour mapping rectangles with a blitter.
+ * The caller must point #_screen to the buffer that is drawn to.
+ * @param blitter The blitter to benchmark.
+ * @param sprite The benchmark sprite for all zoom levels.
+ * @param remap The remap table to use for remapped drawing.
+ * @param iterations How often to draw everything.
+ * @param[out] result The timings and the pixels after one iteration.
+ */
+static void BenchmarkBlitter(Blitter *blitter, const SpriteLoader::Sprite *sprite, const byte *remap, uint iterations, BlitterBenchmarkResult &result)
+{
+	Sprite *encoded = blitter->Encode(sprite, &AllocateBenchmarkSprite);
+	ZoomLevel zoom = _settings_client.gui.zoom_min;
+
+	Blitter::BlitterParams bp;
+	bp.sprite = encoded->data;
+	bp.remap = remap;
+	bp.skip_left = 0;
+	bp.skip_top = 0;
+	bp.width = BENCHMARK_SPRITE_WIDTH;
+	bp.height = BENCHMARK_SPRITE_HEIGHT;
+	bp.sprite_width = BENCHMARK_SPRITE_WIDTH;
+	bp.sprite_height = BENCHMARK_SPRITE_HEIGHT;
+	bp.top = 0;
+	bp.dst = _screen.dst_ptr;
+	bp.pitch = _screen.pitch;
+
+	/* Start from the same background for every blitter. */
+	uint32 *buffer = (uint32 *)_screen.dst_ptr;
+	for (int i = 0; i < BENCHMARK_BUFFER_WIDTH * BENCHMARK_BUFFER_HEIGHT; i++) buffer[i] = 0xFF000000 | (i * 0x010203);
+
+	static const BlitterMode modes[] = { BM_NORMAL, BM_COLOUR_REMAP, BM_TRANSPARENT };
+	MemSetT(result.time, 0, lengthof(result.time));
+	for (uint i = 0; i <= iterations; i++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint j = 0; j < lengthof(modes); j++) {
+			/* Vary the alignment of the destination. */
+			bp.left = (i + j) % 8;
+			blitter->Draw(&bp, modes[j], zoom);
+
+			auto end = std::chrono::high_resolution_clock::now();
+			if (i != 0) result.time[j] += (uint64)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+			start = end;
+		}
+
+		blitter->DrawColourMappingRect(blitter->MoveTo(_screen.dst_ptr, 8, 0), BENCHMARK_SPRITE_WIDTH, BENCHMARK_SPRITE_HEIGHT, PALETTE_TO_TRANSPARENT);
+		blitter->DrawColourMappingRect(blitter->MoveTo(_screen.dst_ptr, 64, 0), BENCHMARK_SPRITE_WIDTH, BENCHMARK_SPRITE_HEIGHT, PALETTE_NEWSPAPER);
+		if (i != 0) result.time[3] += (uint64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+		/* The first round is not timed, but used to compare the result of the blitters. */
+		if (i == 0) result.pixels.assign(buffer, buffer + BENCHMARK_BUFFER_WIDTH * BENCHMARK_BUFFER_HEIGHT);
+	}
+
+	free(encoded);
+}
+
+/**
+ * Benchmark drawing sprites with the 32bpp blitters and print the results to the console.
+ * @param iterations How often to draw the sprite per blitter.
+ * @param names The blitters to benchmark, or NULL for all known 32bpp blitters.
+ * @param count The number of blitters in \a names.
+ */
+void ConBenchmarkBlitters(uint iterations, const char * const *names, uint count)
+{
+	if (names == NULL) {
+		names = _benchmark_blitters;
+		count = lengthof(_benchmark_blitters);
+	}
+
+	SpriteLoader::Sprite sprite[ZOOM_LVL_COUNT];
+	std::vector<SpriteLoader::CommonPixel> data(BENCHMARK_SPRITE_WIDTH * BENCHMARK_SPRITE_HEIGHT);
+	FillBenchmarkSprite(data.data());
+	/* Use the same pixels for every zoom level; only one of them is drawn. */
+	for (ZoomLevel zoom = ZOOM_LVL_BEGIN; zoom != ZOOM_LVL_END; zoom++) {
+		sprite[zoom].height = BENCHMARK_SPRITE_HEIGHT;
+		sprite[zoom].width = BENCHMARK_SPRITE_WIDTH;
+		sprite[zoom].x_offs = 0;
+		sprite[zoom].y_offs = 0;
+		sprite[zoom].type = ST_NORMAL;
+		sprite[zoom].data = data.data();
+	}
+
+	/* Move the company colours to other ones, and hide one of them. */
+	byte remap[256];
+	for (uint i = 0; i < lengthof(remap); i++) remap[i] = i;
+	for (uint i = 0xC6; i < 0xCE; i++) remap[i] = i - 0x40;
+	remap[0xCD] = 0;
+
+	IConsolePrintF(CC_DEFAULT, "Drawing a %dx%d sprite %u times; times in microseconds", BENCHMARK_SPRITE_WIDTH, BENCHMARK_SPRITE_HEIGHT, iterations);
+	IConsolePrintF(CC_DEFAULT, "%-16s %8s %8s %8s %8s  differing pixels", "blitter", "normal", "remap", "transp", "mapping");
+
+	std::vector<uint32> buffer(BENCHMARK_BUFFER_WIDTH * BENCHMARK_BUFFER_HEIGHT);
+	const char *reference_name = NULL;
+	std::vector<uint32> reference;
+	for (uint i = 0; i < count; i++) {
+		BlitterFactory *factory = BlitterFactory::GetBlitterFactory(names[i]);
+		if (factory == NULL) {
+			IConsolePrintF(CC_WARNING, "%-16s not available", names[i]);
+			continue;
+		}
+
+		Blitter *blitter = factory->CreateInstance();
+		if (blitter->GetScreenDepth() != 32) {
+			IConsolePrintF(CC_WARNING, "%-16s not a 32bpp blitter", names[i]);
+			delete blitter;
+			continue;
+		}
+
+		/* Draw to our own buffer, with the animation buffer of the blitter sized accordingly. */
+		VideoDriver::GetInstance()->AcquireBlitterLock();
+		DrawPixelInfo old_screen = _screen;
+		bool old_disable_anim = _screen_disable_anim;
+		_screen.dst_ptr = buffer.data();
+		_screen.width = BENCHMARK_BUFFER_WIDTH;
+		_screen.height = BENCHMARK_BUFFER_HEIGHT;
+		_screen.pitch = BENCHMARK_BUFFER_WIDTH;
+		_screen_disable_anim = false;
+		blitter->PostResize();
+
+		BlitterBenchmarkResult result;
+		BenchmarkBlitter(blitter, sprite, remap, iterations, result);
+		delete blitter;
+
+		_screen = old_screen;
+		_screen_disable_anim = old_disable_anim;
+		VideoDriver::GetInstance()->ReleaseBlitterLock();
+
+		if (reference_name == NULL) {
+			reference_name = names[i];
+			reference = result.pixels;
+		}
+		/* Only the colour matters; not all blitters keep the alpha channel of the screen. */
+		uint differences = 0;
+		for (size_t j = 0; j < reference.size(); j++) {
+			if (((reference[j] ^ result.pixels[j]) & 0x00FFFFFF) != 0) differences++;
+		}
+
+		IConsolePrintF(CC_DEFAULT, "%-16s %8u %8u %8u %8u  %u", names[i], (uint)result.time[0], (uint)result.time[1], (uint)result.time[2], (uint)result.time[3], differences);
+	}
+	if (reference_name != NULL) IConsolePrintF(CC_DEFAULT, "Differing pixels are counted against %s", reference_name);
+}
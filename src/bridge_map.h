@@ -14,6 +14,7 @@
 
 #include "road_map.h"
 #include "bridge.h"
+#include "pathfinder/water_regions.h"
 
 /**
  * Checks if this is a bridge, instead of a tunnel
@@ -128,6 +129,7 @@ static inline void SetBridgeMiddle(TileIndex t, Axis a)
  */
 static inline void MakeBridgeRamp(TileIndex t, Owner o, BridgeType bridgetype, DiagDirection d, TransportType tt, uint rt)
 {
+	InvalidateWaterRegion(t);
 	SetTileType(t, MP_TUNNELBRIDGE);
 	SetTileOwner(t, o);
 	_m[t].m2 = 0;
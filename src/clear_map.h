@@ -14,6 +14,7 @@
 
 #include "bridge_map.h"
 #include "industry_type.h"
+#include "pathfinder/water_regions.h"
 
 /**
  * Ground types. Valid densities in comments after the enum.
@@ -260,6 +261,7 @@ static inline void SetFence(TileIndex t, DiagDirection side, uint h)
  */
 static inline void MakeClear(TileIndex t, ClearGround g, uint density)
 {
+	InvalidateWaterRegion(t);
 	SetTileType(t, MP_CLEAR);
 	_m[t].m1 = 0;
 	SetTileOwner(t, OWNER_NONE);
@@ -1889,6 +1889,120 @@ DEF_CONSOLE_CMD(ConFramerate)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConSpriteCacheStats)
+{
+	extern void ConPrintSpriteCacheStats(); // spritecache.cpp
+
+	if (argc == 0) {
+		IConsoleHelp("Show hit rate, evictions and memory use of the sprite cache");
+		return true;
+	}
+
+	ConPrintSpriteCacheStats();
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConDirtyBlockStats)
+{
+	extern void ConPrintDirtyBlockStats(bool reset); // gfx.cpp
+
+	if (argc == 0) {
+		IConsoleHelp("Show how many rectangles and pixels were repainted for the dirty parts of the screen. Usage: 'dirty_block_stats [reset]'");
+		IConsoleHelp("  The overdraw ratio compares the repainted pixels with the pixels of the dirty blocks");
+		return true;
+	}
+
+	if (argc > 2 || (argc == 2 && strcmp(argv[1], "reset") != 0)) return false;
+
+	ConPrintDirtyBlockStats(argc == 2);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConNewGRFCallbackStats)
+{
+	extern void ConPrintNewGRFCallbackStats(bool reset); // newgrf.cpp
+	extern bool _newgrf_callback_timing;
+
+	if (argc == 0) {
+		IConsoleHelp("Show the number of callbacks, callback cache hits and time spent per NewGRF. Usage: 'newgrf_callback_stats [reset | timing]'");
+		IConsoleHelp("  'reset' clears the statistics, 'timing' toggles measuring the time spent in the callbacks");
+		return true;
+	}
+
+	if (argc == 1) {
+		ConPrintNewGRFCallbackStats(false);
+		return true;
+	}
+
+	if (strcmp(argv[1], "reset") == 0) {
+		ConPrintNewGRFCallbackStats(true);
+		return true;
+	}
+
+	if (strcmp(argv[1], "timing") == 0) {
+		_newgrf_callback_timing = !_newgrf_callback_timing;
+		IConsolePrintF(CC_DEFAULT, "Callback timing %s", _newgrf_callback_timing ? "enabled" : "disabled");
+		return true;
+	}
+
+	return false;
+}
+
+DEF_CONSOLE_CMD(ConSpriteSorterRecord)
+{
+	extern void ConStartSpriteSorterRecording(const char *filename, uint frames); // viewport.cpp
+
+	if (argc == 0) {
+		IConsoleHelp("Record the parent sprites sorted by the next viewport draws. Usage: 'sprite_sorter_record <file> [<draws>]'");
+		IConsoleHelp("  The recording can be used with 'sprite_sorter_benchmark'; by default 100 draws are recorded");
+		return true;
+	}
+
+	if (argc != 2 && argc != 3) return false;
+
+	uint frames = 100;
+	if (argc == 3 && (!GetArgumentInteger(&frames, argv[2]) || frames == 0)) return false;
+
+	ConStartSpriteSorterRecording(argv[1], frames);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConSpriteSorterBenchmark)
+{
+	extern void ConBenchmarkSpriteSorters(const char *filename); // viewport.cpp
+
+	if (argc == 0) {
+		IConsoleHelp("Run all parent sprite sorters on a recording of 'sprite_sorter_record'. Usage: 'sprite_sorter_benchmark <file>'");
+		return true;
+	}
+
+	if (argc != 2) return false;
+
+	ConBenchmarkSpriteSorters(argv[1]);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBlitterBenchmark)
+{
+	extern void ConBenchmarkBlitters(uint iterations, const char * const *names, uint count); // blitter/benchmark.cpp
+
+	if (argc == 0) {
+		IConsoleHelp("Benchmark drawing a sprite with the 32bpp blitters. Usage: 'blitter_benchmark [<iterations> [<blitter> ...]]'");
+		IConsoleHelp("  By default all 32bpp blitters draw 1000 times; the first blitter is the reference the others are compared with");
+		return true;
+	}
+
+	uint iterations = 1000;
+	if (argc >= 2 && (!GetArgumentInteger(&iterations, argv[1]) || iterations == 0)) return false;
+
+	if (argc > 2) {
+		ConBenchmarkBlitters(iterations, argv + 2, argc - 2);
+	} else {
+		ConBenchmarkBlitters(iterations, NULL, 0);
+	}
+	return true;
+}
+
 DEF_CONSOLE_CMD(ConFramerateWindow)
 {
 	extern void ShowFramerateWindow();
@@ -2038,6 +2152,12 @@ void IConsoleStdLibRegister()
 #endif
 	IConsoleCmdRegister("fps",     ConFramerate);
 	IConsoleCmdRegister("fps_wnd", ConFramerateWindow);
+	IConsoleCmdRegister("sprite_cache_stats", ConSpriteCacheStats);
+	IConsoleCmdRegister("dirty_block_stats", ConDirtyBlockStats);
+	IConsoleCmdRegister("newgrf_callback_stats", ConNewGRFCallbackStats);
+	IConsoleCmdRegister("sprite_sorter_record", ConSpriteSorterRecord);
+	IConsoleCmdRegister("sprite_sorter_benchmark", ConSpriteSorterBenchmark);
+	IConsoleCmdRegister("blitter_benchmark", ConBlitterBenchmark);
 
 	/* NewGRF development stuff */
 	IConsoleCmdRegister("reload_newgrfs",  ConNewGRFReload, ConHookNewGRFDeveloperTool);
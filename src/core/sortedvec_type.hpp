@@ -0,0 +1,196 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file sortedvec_type.hpp Sorted set of values stored in blocks of consecutive memory. */
+
+#ifndef SORTEDVEC_TYPE_HPP
+#define SORTEDVEC_TYPE_HPP
+
+#include <vector>
+#include <algorithm>
+
+/**
+ * Sorted set of unique values, stored in a list of sorted blocks of
+ * consecutive memory. Compared to a std::set this needs no allocation per
+ * value and walks through memory in order, while inserting and erasing only
+ * has to move the values of a single block instead of the whole set.
+ * Iterators are invalidated by every insertion and erasure.
+ * @tparam T The type of the values; it must be ordered by operator <.
+ */
+template <typename T>
+class SortedBlockVector {
+public:
+	static const size_t BLOCK_SIZE = 256; ///< Size blocks get split back to when they grow to twice this size.
+
+private:
+	typedef std::vector<T> Block;
+
+	std::vector<Block> blocks; ///< The blocks with values; none of them is empty.
+	size_t count;              ///< The number of values in all blocks.
+
+	/** Check whether the last value of a block comes before a value. */
+	static bool BlockBefore(const Block &block, const T &value) { return block.back() < value; }
+	/** Check whether a value comes before the last value of a block. */
+	static bool BlockAfter(const T &value, const Block &block) { return value < block.back(); }
+
+public:
+	/**
+	 * Iterator over the values, in order.
+	 * @tparam Tcontainer The (const) container type.
+	 * @tparam Tvalue The (const) value type.
+	 */
+	template <typename Tcontainer, typename Tvalue>
+	class IteratorT {
+		friend class SortedBlockVector;
+
+		Tcontainer *container; ///< The container we iterate over.
+		size_t block;          ///< The block of the current value.
+		size_t index;          ///< The index of the current value in its block.
+
+	public:
+		IteratorT(Tcontainer *container, size_t block, size_t index) : container(container), block(block), index(index) {}
+
+		Tvalue &operator *() const { return container->blocks[this->block][this->index]; }
+		Tvalue *operator ->() const { return &container->blocks[this->block][this->index]; }
+
+		IteratorT &operator ++()
+		{
+			if (++this->index == this->container->blocks[this->block].size()) {
+				this->block++;
+				this->index = 0;
+			}
+			return *this;
+		}
+
+		IteratorT &operator --()
+		{
+			if (this->index == 0) {
+				this->block--;
+				this->index = this->container->blocks[this->block].size();
+			}
+			this->index--;
+			return *this;
+		}
+
+		IteratorT operator ++(int) { IteratorT tmp = *this; ++*this; return tmp; }
+		IteratorT operator --(int) { IteratorT tmp = *this; --*this; return tmp; }
+
+		bool operator ==(const IteratorT &other) const { return this->block == other.block && this->index == other.index; }
+		bool operator !=(const IteratorT &other) const { return !(*this == other); }
+	};
+
+	typedef IteratorT<SortedBlockVector, T> iterator;
+	typedef IteratorT<const SortedBlockVector, const T> const_iterator;
+
+	SortedBlockVector() : count(0) {}
+
+	size_t size() const { return this->count; }
+	bool empty() const { return this->count == 0; }
+
+	iterator begin() { return iterator(this, 0, 0); }
+	iterator end() { return iterator(this, this->blocks.size(), 0); }
+	const_iterator begin() const { return const_iterator(this, 0, 0); }
+	const_iterator end() const { return const_iterator(this, this->blocks.size(), 0); }
+
+	/** Remove all values. */
+	void clear()
+	{
+		this->blocks.clear();
+		this->count = 0;
+	}
+
+	/**
+	 * Exchange the contents with another set.
+	 * @param other The set to exchange with.
+	 */
+	void swap(SortedBlockVector &other)
+	{
+		this->blocks.swap(other.blocks);
+		std::swap(this->count, other.count);
+	}
+
+	/**
+	 * Find the first value that does not come before a value.
+	 * @param value The value to look for.
+	 * @return The first value that is not less than \a value, or end().
+	 */
+	iterator lower_bound(const T &value)
+	{
+		size_t block = std::lower_bound(this->blocks.begin(), this->blocks.end(), value, BlockBefore) - this->blocks.begin();
+		if (block == this->blocks.size()) return this->end();
+		const Block &b = this->blocks[block];
+		return iterator(this, block, std::lower_bound(b.begin(), b.end(), value) - b.begin());
+	}
+
+	/**
+	 * Find the first value that comes after a value.
+	 * @param value The value to look for.
+	 * @return The first value that is greater than \a value, or end().
+	 */
+	iterator upper_bound(const T &value)
+	{
+		size_t block = std::upper_bound(this->blocks.begin(), this->blocks.end(), value, BlockAfter) - this->blocks.begin();
+		if (block == this->blocks.size()) return this->end();
+		const Block &b = this->blocks[block];
+		return iterator(this, block, std::upper_bound(b.begin(), b.end(), value) - b.begin());
+	}
+
+	/**
+	 * Insert a value, unless an equal value is already in the set.
+	 * @param value The value to insert.
+	 * @return True if the value has been inserted.
+	 */
+	bool insert(const T &value)
+	{
+		if (this->blocks.empty()) this->blocks.push_back(Block());
+
+		/* Values beyond the last block are appended to it. */
+		size_t block = std::lower_bound(this->blocks.begin(), this->blocks.end(), value, BlockBefore) - this->blocks.begin();
+		if (block == this->blocks.size()) block--;
+
+		Block &b = this->blocks[block];
+		typename Block::iterator pos = std::lower_bound(b.begin(), b.end(), value);
+		if (pos != b.end() && !(value < *pos)) return false;
+		b.insert(pos, value);
+		this->count++;
+
+		if (b.size() >= 2 * BLOCK_SIZE) {
+			Block second(b.begin() + BLOCK_SIZE, b.end());
+			b.resize(BLOCK_SIZE);
+			this->blocks.insert(this->blocks.begin() + block + 1, Block());
+			this->blocks[block + 1].swap(second);
+		}
+		return true;
+	}
+
+	/**
+	 * Erase a value.
+	 * @param it The value to erase.
+	 */
+	void erase(iterator it)
+	{
+		Block &b = this->blocks[it.block];
+		b.erase(b.begin() + it.index);
+		this->count--;
+
+		if (b.empty()) {
+			this->blocks.erase(this->blocks.begin() + it.block);
+			return;
+		}
+
+		/* Merge small blocks with the next one, so lots of erasures do not leave lots of tiny blocks. */
+		if (b.size() < BLOCK_SIZE / 2 && it.block + 1 < this->blocks.size() && b.size() + this->blocks[it.block + 1].size() <= BLOCK_SIZE) {
+			Block &next = this->blocks[it.block + 1];
+			b.insert(b.end(), next.begin(), next.end());
+			this->blocks.erase(this->blocks.begin() + it.block + 1);
+		}
+	}
+};
+
+#endif /* SORTEDVEC_TYPE_HPP */
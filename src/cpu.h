@@ -34,4 +34,10 @@ void ottd_cpuid(int info[4], int type);
  */
 bool HasCPUIDFlag(uint type, uint index, uint bit);
 
+/**
+ * Check whether the current CPU and OS support AVX2 instructions.
+ * @return True when AVX2 can be used, false when there is no CPUID or either lacks support.
+ */
+bool HasCPUAVX2Support();
+
 #endif /* CPU_H */
@@ -67,6 +67,9 @@
 #ifdef WITH_ZLIB
 # include <zlib.h>
 #endif
+#ifdef WITH_ZSTD
+#	include <zstd.h>
+#endif
 
 #include "safeguards.h"
 
@@ -275,6 +278,10 @@ char *CrashLog::LogLibraries(char *buffer, const char *last) const
 	buffer += seprintf(buffer, last, " Zlib:       %s\n", zlibVersion());
 #endif
 
+#ifdef WITH_ZSTD
+	buffer += seprintf(buffer, last, " Zstd:       %s\n", ZSTD_versionString());
+#endif
+
 	buffer += seprintf(buffer, last, "\n");
 	return buffer;
 }
@@ -47,13 +47,15 @@ struct Fio {
 	byte buffer_start[FIO_BUFFER_SIZE];    ///< local buffer when read from file
 	const char *filenames[MAX_FILE_SLOTS]; ///< array of filenames we (should) have open
 	char *shortnames[MAX_FILE_SLOTS];      ///< array of short names for spriteloader's use
+	Subdirectory subdirs[MAX_FILE_SLOTS];  ///< array of sub directories the files were found in
 #if defined(LIMITED_FDS)
 	uint open_handles;                     ///< current amount of open handles
 	uint usage_count[MAX_FILE_SLOTS];      ///< count how many times this file has been opened
 #endif /* LIMITED_FDS */
 };
 
-static Fio _fio; ///< #Fio instance.
+static Fio _main_fio;                       ///< #Fio instance of the main thread.
+static thread_local Fio *_fio = &_main_fio; ///< #Fio instance used by the current thread.
 
 /** Whether the working directory should be scanned. */
 static bool _do_scan_working_directory = true;
@@ -67,7 +69,7 @@ extern char *_highscore_file;
  */
 size_t FioGetPos()
 {
-	return _fio.pos + (_fio.buffer - _fio.buffer_end);
+	return _fio->pos + (_fio->buffer - _fio->buffer_end);
 }
 
 /**
@@ -77,7 +79,7 @@ size_t FioGetPos()
  */
 const char *FioGetFilename(uint8 slot)
 {
-	return _fio.shortnames[slot];
+	return _fio->shortnames[slot];
 }
 
 /**
@@ -88,10 +90,10 @@ const char *FioGetFilename(uint8 slot)
 void FioSeekTo(size_t pos, int mode)
 {
 	if (mode == SEEK_CUR) pos += FioGetPos();
-	_fio.buffer = _fio.buffer_end = _fio.buffer_start + FIO_BUFFER_SIZE;
-	_fio.pos = pos;
-	if (fseek(_fio.cur_fh, _fio.pos, SEEK_SET) < 0) {
-		DEBUG(misc, 0, "Seeking in %s failed", _fio.filename);
+	_fio->buffer = _fio->buffer_end = _fio->buffer_start + FIO_BUFFER_SIZE;
+	_fio->pos = pos;
+	if (fseek(_fio->cur_fh, _fio->pos, SEEK_SET) < 0) {
+		DEBUG(misc, 0, "Seeking in %s failed", _fio->filename);
 	}
 }
 
@@ -99,11 +101,11 @@ void FioSeekTo(size_t pos, int mode)
 static void FioRestoreFile(int slot)
 {
 	/* Do we still have the file open, or should we reopen it? */
-	if (_fio.handles[slot] == NULL) {
-		DEBUG(misc, 6, "Restoring file '%s' in slot '%d' from disk", _fio.filenames[slot], slot);
-		FioOpenFile(slot, _fio.filenames[slot]);
+	if (_fio->handles[slot] == NULL) {
+		DEBUG(misc, 6, "Restoring file '%s' in slot '%d' from disk", _fio->filenames[slot], slot);
+		FioOpenFile(slot, _fio->filenames[slot]);
 	}
-	_fio.usage_count[slot]++;
+	_fio->usage_count[slot]++;
 }
 #endif /* LIMITED_FDS */
 
@@ -115,14 +117,18 @@ static void FioRestoreFile(int slot)
 void FioSeekToFile(uint8 slot, size_t pos)
 {
 	FILE *f;
+	if (_fio != &_main_fio && _fio->handles[slot] == NULL) {
+		/* Private access; open the file the main thread has in this slot. */
+		FioOpenFile(slot, _main_fio.filenames[slot], _main_fio.subdirs[slot]);
+	}
 #if defined(LIMITED_FDS)
 	/* Make sure we have this file open */
 	FioRestoreFile(slot);
 #endif /* LIMITED_FDS */
-	f = _fio.handles[slot];
+	f = _fio->handles[slot];
 	assert(f != NULL);
-	_fio.cur_fh = f;
-	_fio.filename = _fio.filenames[slot];
+	_fio->cur_fh = f;
+	_fio->filename = _fio->filenames[slot];
 	FioSeekTo(pos, SEEK_SET);
 }
 
@@ -132,15 +138,15 @@ void FioSeekToFile(uint8 slot, size_t pos)
  */
 byte FioReadByte()
 {
-	if (_fio.buffer == _fio.buffer_end) {
-		_fio.buffer = _fio.buffer_start;
-		size_t size = fread(_fio.buffer, 1, FIO_BUFFER_SIZE, _fio.cur_fh);
-		_fio.pos += size;
-		_fio.buffer_end = _fio.buffer_start + size;
+	if (_fio->buffer == _fio->buffer_end) {
+		_fio->buffer = _fio->buffer_start;
+		size_t size = fread(_fio->buffer, 1, FIO_BUFFER_SIZE, _fio->cur_fh);
+		_fio->pos += size;
+		_fio->buffer_end = _fio->buffer_start + size;
 
 		if (size == 0) return 0;
 	}
-	return *_fio.buffer++;
+	return *_fio->buffer++;
 }
 
 /**
@@ -150,8 +156,8 @@ byte FioReadByte()
 void FioSkipBytes(int n)
 {
 	for (;;) {
-		int m = min(_fio.buffer_end - _fio.buffer, n);
-		_fio.buffer += m;
+		int m = min(_fio->buffer_end - _fio->buffer, n);
+		_fio->buffer += m;
 		n -= m;
 		if (n == 0) break;
 		FioReadByte();
@@ -187,7 +193,7 @@ uint32 FioReadDword()
 void FioReadBlock(void *ptr, size_t size)
 {
 	FioSeekTo(FioGetPos(), SEEK_SET);
-	_fio.pos += fread(ptr, 1, size, _fio.cur_fh);
+	_fio->pos += fread(ptr, 1, size, _fio->cur_fh);
 }
 
 /**
@@ -196,15 +202,15 @@ void FioReadBlock(void *ptr, size_t size)
  */
 static inline void FioCloseFile(int slot)
 {
-	if (_fio.handles[slot] != NULL) {
-		fclose(_fio.handles[slot]);
+	if (_fio->handles[slot] != NULL) {
+		fclose(_fio->handles[slot]);
 
-		free(_fio.shortnames[slot]);
-		_fio.shortnames[slot] = NULL;
+		free(_fio->shortnames[slot]);
+		_fio->shortnames[slot] = NULL;
 
-		_fio.handles[slot] = NULL;
+		_fio->handles[slot] = NULL;
 #if defined(LIMITED_FDS)
-		_fio.open_handles--;
+		_fio->open_handles--;
 #endif /* LIMITED_FDS */
 	}
 }
@@ -212,30 +218,63 @@ static inline void FioCloseFile(int slot)
 /** Close all slotted open files. */
 void FioCloseAll()
 {
-	for (int i = 0; i != lengthof(_fio.handles); i++) {
+	for (int i = 0; i != lengthof(_fio->handles); i++) {
 		FioCloseFile(i);
 	}
 }
 
+/**
+ * Give the current thread its own set of slotted files, so it can read from
+ * them while the main thread keeps using its own. The files are opened on
+ * first use with the names the main thread opened them with.
+ * @note The slotted files of the main thread must not change until #FioEndPrivateAccess.
+ */
+void FioBeginPrivateAccess()
+{
+	assert(_fio == &_main_fio);
+	_fio = CallocT<Fio>(1);
+}
+
+/**
+ * Close the private slotted files of the current thread and return to the
+ * files of the main thread.
+ */
+void FioEndPrivateAccess()
+{
+	assert(_fio != &_main_fio);
+	FioCloseAll();
+	free(_fio);
+	_fio = &_main_fio;
+}
+
+/**
+ * Check whether the current thread reads from its own set of slotted files.
+ * @return True between #FioBeginPrivateAccess and #FioEndPrivateAccess.
+ */
+bool FioHasPrivateAccess()
+{
+	return _fio != &_main_fio;
+}
+
 #if defined(LIMITED_FDS)
 static void FioFreeHandle()
 {
 	/* If we are about to open a file that will exceed the limit, close a file */
-	if (_fio.open_handles + 1 == LIMITED_FDS) {
+	if (_fio->open_handles + 1 == LIMITED_FDS) {
 		uint i, count;
 		int slot;
 
 		count = UINT_MAX;
 		slot = -1;
 		/* Find the file that is used the least */
-		for (i = 0; i < lengthof(_fio.handles); i++) {
-			if (_fio.handles[i] != NULL && _fio.usage_count[i] < count) {
-				count = _fio.usage_count[i];
+		for (i = 0; i < lengthof(_fio->handles); i++) {
+			if (_fio->handles[i] != NULL && _fio->usage_count[i] < count) {
+				count = _fio->usage_count[i];
 				slot  = i;
 			}
 		}
 		assert(slot != -1);
-		DEBUG(misc, 6, "Closing filehandler '%s' in slot '%d' because of fd-limit", _fio.filenames[slot], slot);
+		DEBUG(misc, 6, "Closing filehandler '%s' in slot '%d' because of fd-limit", _fio->filenames[slot], slot);
 		FioCloseFile(slot);
 	}
 }
@@ -260,19 +299,20 @@ void FioOpenFile(int slot, const char *filename, Subdirectory subdir)
 	if (pos < 0) usererror("Cannot read file '%s'", filename);
 
 	FioCloseFile(slot); // if file was opened before, close it
-	_fio.handles[slot] = f;
-	_fio.filenames[slot] = filename;
+	_fio->handles[slot] = f;
+	_fio->filenames[slot] = filename;
+	_fio->subdirs[slot] = subdir;
 
 	/* Store the filename without path and extension */
 	const char *t = strrchr(filename, PATHSEPCHAR);
-	_fio.shortnames[slot] = stredup(t == NULL ? filename : t);
-	char *t2 = strrchr(_fio.shortnames[slot], '.');
+	_fio->shortnames[slot] = stredup(t == NULL ? filename : t);
+	char *t2 = strrchr(_fio->shortnames[slot], '.');
 	if (t2 != NULL) *t2 = '\0';
-	strtolower(_fio.shortnames[slot]);
+	strtolower(_fio->shortnames[slot]);
 
 #if defined(LIMITED_FDS)
-	_fio.usage_count[slot] = 0;
-	_fio.open_handles++;
+	_fio->usage_count[slot] = 0;
+	_fio->open_handles++;
 #endif /* LIMITED_FDS */
 	FioSeekToFile(slot, (uint32)pos);
 }
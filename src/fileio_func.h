@@ -26,6 +26,9 @@ void FioCloseAll();
 void FioOpenFile(int slot, const char *filename, Subdirectory subdir);
 void FioReadBlock(void *ptr, size_t size);
 void FioSkipBytes(int n);
+void FioBeginPrivateAccess();
+void FioEndPrivateAccess();
+bool FioHasPrivateAccess();
 
 /**
  * The search paths OpenTTD could search through.
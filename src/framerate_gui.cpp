@@ -22,6 +22,8 @@
 #include "guitimer_func.h"
 #include "company_base.h"
 #include "ai/ai_info.hpp"
+#include "pathfinder/yapf/yapf_cache.h"
+#include "gfx_layout.h"
 
 #include "widgets/framerate_widget.h"
 #include "safeguards.h"
@@ -356,6 +358,8 @@ static const NWidgetPart _framerate_window_widgets[] = {
 			NWidget(WWT_TEXT, COLOUR_GREY, WID_FRW_RATE_GAMELOOP), SetDataTip(STR_FRAMERATE_RATE_GAMELOOP, STR_FRAMERATE_RATE_GAMELOOP_TOOLTIP),
 			NWidget(WWT_TEXT, COLOUR_GREY, WID_FRW_RATE_DRAWING),  SetDataTip(STR_FRAMERATE_RATE_BLITTER,  STR_FRAMERATE_RATE_BLITTER_TOOLTIP),
 			NWidget(WWT_TEXT, COLOUR_GREY, WID_FRW_RATE_FACTOR),   SetDataTip(STR_FRAMERATE_SPEED_FACTOR,  STR_FRAMERATE_SPEED_FACTOR_TOOLTIP),
+			NWidget(WWT_TEXT, COLOUR_GREY, WID_FRW_RATE_RAIL_PF_CACHE), SetDataTip(STR_FRAMERATE_RAIL_PF_CACHE, STR_FRAMERATE_RAIL_PF_CACHE_TOOLTIP),
+			NWidget(WWT_TEXT, COLOUR_GREY, WID_FRW_RATE_TEXT_CACHE),    SetDataTip(STR_FRAMERATE_TEXT_CACHE,    STR_FRAMERATE_TEXT_CACHE_TOOLTIP),
 		EndContainer(),
 	EndContainer(),
 	NWidget(NWID_HORIZONTAL),
@@ -497,6 +501,23 @@ struct FramerateWindow : Window {
 			case WID_FRW_RATE_FACTOR:
 				this->speed_gameloop.InsertDParams(0);
 				break;
+			case WID_FRW_RATE_RAIL_PF_CACHE: {
+				uint hits, misses;
+				YapfGetRailSegmentCacheStats(&hits, &misses);
+				SetDParam(0, hits + misses == 0 ? 0 : (uint64)hits * 100 / (hits + misses));
+				SetDParam(1, hits);
+				SetDParam(2, hits + misses);
+				break;
+			}
+			case WID_FRW_RATE_TEXT_CACHE: {
+				Layouter::LineCacheStats stats = Layouter::GetLineCacheStats();
+				SetDParam(0, stats.lookups == 0 ? 0 : (uint64)stats.hits * 100 / stats.lookups);
+				SetDParam(1, stats.hits);
+				SetDParam(2, stats.lookups);
+				SetDParam(3, stats.items);
+				SetDParam(4, stats.memory);
+				break;
+			}
 			case WID_FRW_INFO_DATA_POINTS:
 				SetDParam(0, NUM_FRAMERATE_POINTS);
 				break;
@@ -523,6 +544,20 @@ struct FramerateWindow : Window {
 				SetDParam(1, 2);
 				*size = GetStringBoundingBox(STR_FRAMERATE_SPEED_FACTOR);
 				break;
+			case WID_FRW_RATE_RAIL_PF_CACHE:
+				SetDParam(0, 100);
+				SetDParamMaxValue(1, 9999999);
+				SetDParamMaxValue(2, 9999999);
+				*size = GetStringBoundingBox(STR_FRAMERATE_RAIL_PF_CACHE);
+				break;
+			case WID_FRW_RATE_TEXT_CACHE:
+				SetDParam(0, 100);
+				SetDParamMaxValue(1, 99999);
+				SetDParamMaxValue(2, 99999);
+				SetDParamMaxValue(3, 99999);
+				SetDParam(4, 999 * 1024 * 1024);
+				*size = GetStringBoundingBox(STR_FRAMERATE_TEXT_CACHE);
+				break;
 
 			case WID_FRW_TIMES_NAMES: {
 				size->width = 0;
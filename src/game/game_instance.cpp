@@ -236,19 +236,20 @@ void GameInstance::Died()
 {
 	ScriptInstance::Died();
 
-	ShowAIDebugWindow(OWNER_DEITY);
-
 	const GameInfo *info = Game::GetInfo();
-	if (info != NULL) {
-		ShowErrorMessage(STR_ERROR_AI_PLEASE_REPORT_CRASH, INVALID_STRING_ID, WL_WARNING);
-
-		if (info->GetURL() != NULL) {
-			ScriptLog::Info("Please report the error to the following URL:");
-			ScriptLog::Info(info->GetURL());
-		}
+	if (info != NULL && info->GetURL() != NULL) {
+		ScriptLog::Info("Please report the error to the following URL:");
+		ScriptLog::Info(info->GetURL());
 	}
 }
 
+void GameInstance::ShowDiedWindows()
+{
+	ShowAIDebugWindow(OWNER_DEITY);
+
+	if (Game::GetInfo() != NULL) ShowErrorMessage(STR_ERROR_AI_PLEASE_REPORT_CRASH, INVALID_STRING_ID, WL_WARNING);
+}
+
 /**
  * DoCommand callback function for all commands executed by Game Scripts.
  * @param result The result of the command.
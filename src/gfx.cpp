@@ -21,6 +21,8 @@
 #include "network/network_func.h"
 #include "window_func.h"
 #include "newgrf_debug.h"
+#include "console_func.h"
+#include "core/mem_func.hpp"
 
 #include "table/palettes.h"
 #include "table/string_colours.h"
@@ -49,7 +51,7 @@ PauseModeByte _pause_mode;
 Palette _cur_palette;
 
 static byte _stringwidth_table[FS_END][224]; ///< Cache containing width of often used characters. @see GetCharacterWidth()
-DrawPixelInfo *_cur_dpi;
+thread_local DrawPixelInfo *_cur_dpi; ///< Area drawn to; per thread, as viewports are drawn by several threads.
 byte _colour_gradient[COLOUR_END][8];
 
 static void GfxMainBlitterViewport(const Sprite *sprite, int x, int y, BlitterMode mode, const SubSprite *sub = NULL, SpriteID sprite_id = SPR_CURSOR_MOUSE);
@@ -68,16 +70,38 @@ ZoomLevelByte _font_zoom; ///< Font Zoom level
  * @ingroup dirty
  */
 static Rect _invalid_rect;
-static const byte *_colour_remap_ptr;
-static byte _string_colourremap[3]; ///< Recoloursprite for stringdrawing. The grf loader ensures that #ST_FONT sprites only use colours 0 to 2.
+static thread_local const byte *_colour_remap_ptr;
+static thread_local byte _string_colourremap[3]; ///< Recoloursprite for stringdrawing. The grf loader ensures that #ST_FONT sprites only use colours 0 to 2.
 
-static const uint DIRTY_BLOCK_HEIGHT   = 8;
-static const uint DIRTY_BLOCK_WIDTH    = 64;
-
-static uint _dirty_bytes_per_line = 0;
-static byte *_dirty_blocks = NULL;
+/**
+ * The dirty blocks of the screen, one bit per block. Every row of blocks starts
+ * at a new word. The rows with dirty blocks are marked in a second, much smaller,
+ * bitmap so the clean parts of the screen are skipped quickly. The size of the
+ * blocks is taken from the settings when the screen size changes.
+ * @ingroup dirty
+ */
+static uint _dirty_block_width = 0;       ///< Width of a dirty block in pixels.
+static uint _dirty_block_height = 0;      ///< Height of a dirty block in pixels.
+static uint _dirty_block_columns = 0;     ///< Number of dirty blocks in a row.
+static uint _dirty_block_rows = 0;        ///< Number of rows of dirty blocks.
+static uint _dirty_words_per_row = 0;     ///< Number of words of #_dirty_blocks per row of blocks.
+static std::vector<uint64> _dirty_blocks; ///< Bitmap of the dirty blocks.
+static std::vector<uint64> _dirty_rows;   ///< Bitmap of the rows of #_dirty_blocks that have dirty blocks.
 extern uint _dirty_block_colour;
 
+static const uint DIRTY_MERGE_WINDOW = 16; ///< Number of following rectangles each rectangle is tried to be merged with.
+
+/** Statistics of repainting the dirty blocks. */
+struct DirtyBlockStats {
+	uint64 frames;        ///< Number of times something was repainted.
+	uint64 rects;         ///< Number of repainted rectangles.
+	uint64 merges;        ///< Number of times two rectangles were merged into one.
+	uint64 dirty_pixels;  ///< Number of pixels in the dirty blocks.
+	uint64 drawn_pixels;  ///< Number of repainted pixels, including those that were added by merging.
+};
+
+static DirtyBlockStats _dirty_block_stats; ///< Statistics of repainting the dirty blocks.
+
 void GfxScroll(int left, int top, int width, int height, int xo, int yo)
 {
 	Blitter *blitter = BlitterFactory::GetCurrentBlitter();
@@ -1188,8 +1212,13 @@ void GetBroadestDigit(uint *front, uint *next, FontSize size)
 
 void ScreenSizeChanged()
 {
-	_dirty_bytes_per_line = CeilDiv(_screen.width, DIRTY_BLOCK_WIDTH);
-	_dirty_blocks = ReallocT<byte>(_dirty_blocks, _dirty_bytes_per_line * CeilDiv(_screen.height, DIRTY_BLOCK_HEIGHT));
+	_dirty_block_width = max<uint>(_settings_client.gui.dirty_block_width, 1);
+	_dirty_block_height = max<uint>(_settings_client.gui.dirty_block_height, 1);
+	_dirty_block_columns = CeilDiv(max(_screen.width, 1), _dirty_block_width);
+	_dirty_block_rows = CeilDiv(max(_screen.height, 1), _dirty_block_height);
+	_dirty_words_per_row = CeilDiv(_dirty_block_columns, 64);
+	_dirty_blocks.assign(_dirty_words_per_row * _dirty_block_rows, 0);
+	_dirty_rows.assign(CeilDiv(_dirty_block_rows, 64), 0);
 
 	/* check the dirty rect */
 	if (_invalid_rect.right >= _screen.width) _invalid_rect.right = _screen.width;
@@ -1292,6 +1321,145 @@ void RedrawScreenRect(int left, int top, int right, int bottom)
 	VideoDriver::GetInstance()->MakeDirty(left, top, right - left, bottom - top);
 }
 
+/**
+ * Get the mask of a range of bits of a word of the dirty block bitmap.
+ * @param first The first bit.
+ * @param last One past the last bit.
+ * @return The mask.
+ */
+static inline uint64 GetDirtyBlockMask(uint first, uint last)
+{
+	assert(first < last && last <= 64);
+	uint64 mask = last == 64 ? ~(uint64)0 : ((uint64)1 << last) - 1;
+	return mask & ~(((uint64)1 << first) - 1);
+}
+
+/**
+ * Get the first set bit of a word of the dirty block bitmap.
+ * @param word The word.
+ * @return The index of the first set bit.
+ * @pre \a word is not 0.
+ */
+static inline uint FindFirstDirtyBlock(uint64 word)
+{
+	assert(word != 0);
+	return (uint32)word != 0 ? FindFirstBit((uint32)word) : 32 + FindFirstBit((uint32)(word >> 32));
+}
+
+/**
+ * Find the first column from a given one where the dirty state of a row of blocks is the given one.
+ * @param row The row of blocks.
+ * @param column The column to start at.
+ * @param dirty Whether to look for a dirty or a clean block.
+ * @return The column, or #_dirty_block_columns if there is none.
+ */
+static uint FindDirtyBlock(const uint64 *row, uint column, bool dirty)
+{
+	for (uint i = column / 64; i < _dirty_words_per_row; i++) {
+		uint64 word = dirty ? row[i] : ~row[i];
+		if (i == column / 64) word &= ~(((uint64)1 << (column % 64)) - 1);
+		if (word != 0) return min(i * 64 + FindFirstDirtyBlock(word), _dirty_block_columns);
+	}
+	return _dirty_block_columns;
+}
+
+/** Operations on a range of blocks of a row, see #ChangeDirtyBlocks. */
+enum DirtyBlockOperation {
+	DBO_SET,   ///< Mark the blocks dirty.
+	DBO_CLEAR, ///< Mark the blocks clean.
+	DBO_TEST,  ///< Test whether all blocks are dirty.
+};
+
+/**
+ * Mark, clear or test a range of blocks of a row.
+ * @param row The row of blocks.
+ * @param first The first column.
+ * @param last One past the last column.
+ * @param op What to do with the blocks.
+ * @return For #DBO_TEST whether all blocks are dirty, otherwise true.
+ */
+static bool ChangeDirtyBlocks(uint64 *row, uint first, uint last, DirtyBlockOperation op)
+{
+	for (uint i = first / 64; i <= (last - 1) / 64; i++) {
+		uint64 mask = GetDirtyBlockMask(i == first / 64 ? first % 64 : 0, i == (last - 1) / 64 ? (last - 1) % 64 + 1 : 64);
+		switch (op) {
+			case DBO_SET:   row[i] |= mask; break;
+			case DBO_CLEAR: row[i] &= ~mask; break;
+			case DBO_TEST:  if ((row[i] & mask) != mask) return false; break;
+		}
+	}
+	return true;
+}
+
+/**
+ * Take the dirty blocks as rectangles from the bitmap. Each rectangle takes a
+ * run of dirty blocks of a row, and the same run of the rows below as long as
+ * they are dirty too. The bitmap is empty afterwards.
+ * @param[out] rects The rectangles, in blocks, ordered by their top and left edges.
+ */
+static void TakeDirtyRects(std::vector<Rect> &rects)
+{
+	for (uint r = 0; r < _dirty_rows.size(); r++) {
+		while (_dirty_rows[r] != 0) {
+			uint y = r * 64 + FindFirstDirtyBlock(_dirty_rows[r]);
+			uint64 *row = &_dirty_blocks[y * _dirty_words_per_row];
+
+			uint x = FindDirtyBlock(row, 0, true);
+			while (x < _dirty_block_columns) {
+				uint right = FindDirtyBlock(row, x, false);
+				uint bottom = y + 1;
+				while (bottom < _dirty_block_rows && ChangeDirtyBlocks(&_dirty_blocks[bottom * _dirty_words_per_row], x, right, DBO_TEST)) {
+					ChangeDirtyBlocks(&_dirty_blocks[bottom * _dirty_words_per_row], x, right, DBO_CLEAR);
+					bottom++;
+				}
+
+				Rect rect = { (int)x, (int)y, (int)right, (int)bottom };
+				rects.push_back(rect);
+				x = right < _dirty_block_columns ? FindDirtyBlock(row, right, true) : _dirty_block_columns;
+			}
+
+			/* All dirty blocks of the row are part of a rectangle now. Rows below
+			 * that were emptied by these rectangles stay marked until their turn. */
+			MemSetT(row, 0, _dirty_words_per_row);
+			ClrBit(_dirty_rows[r], y % 64);
+		}
+	}
+}
+
+/**
+ * Merge rectangles that are close to each other, when repainting the blocks
+ * in between costs less than repainting the rectangles separately. Every
+ * repainted rectangle has a fixed cost, e.g. collecting the sprites of the
+ * viewports in it, which is expressed as a number of pixels by the
+ * gui.dirty_merge_cost setting.
+ * @param rects The rectangles, in blocks.
+ * @return The number of merges.
+ */
+static uint MergeDirtyRects(std::vector<Rect> &rects)
+{
+	const uint64 cost = CeilDiv(_settings_client.gui.dirty_merge_cost, _dirty_block_width * _dirty_block_height);
+	uint merges = 0;
+
+	for (uint i = 0; i < rects.size(); i++) {
+		Rect &a = rects[i];
+		for (uint j = i + 1; j < rects.size() && j <= i + DIRTY_MERGE_WINDOW; j++) {
+			const Rect &b = rects[j];
+			Rect u = { min(a.left, b.left), min(a.top, b.top), max(a.right, b.right), max(a.bottom, b.bottom) };
+
+			uint64 area = (uint64)(a.right - a.left) * (a.bottom - a.top) + (uint64)(b.right - b.left) * (b.bottom - b.top);
+			uint64 merged_area = (uint64)(u.right - u.left) * (u.bottom - u.top);
+			if (merged_area > area + cost) continue;
+
+			/* The merged rectangle might reach rectangles that it could not be merged with before. */
+			a = u;
+			rects.erase(rects.begin() + j);
+			j = i;
+			merges++;
+		}
+	}
+	return merges;
+}
+
 /**
  * Repaints the rectangle blocks which are marked as 'dirty'.
  *
@@ -1299,12 +1467,6 @@ void RedrawScreenRect(int left, int top, int right, int bottom)
  */
 void DrawDirtyBlocks()
 {
-	byte *b = _dirty_blocks;
-	const int w = Align(_screen.width,  DIRTY_BLOCK_WIDTH);
-	const int h = Align(_screen.height, DIRTY_BLOCK_HEIGHT);
-	int x;
-	int y;
-
 	if (HasModalProgress()) {
 		/* We are generating the world, so release our rights to the map and
 		 * painting while we are waiting a bit. */
@@ -1328,71 +1490,36 @@ void DrawDirtyBlocks()
 		if (_switch_mode != SM_NONE && !HasModalProgress()) return;
 	}
 
-	y = 0;
-	do {
-		x = 0;
-		do {
-			if (*b != 0) {
-				int left;
-				int top;
-				int right = x + DIRTY_BLOCK_WIDTH;
-				int bottom = y;
-				byte *p = b;
-				int h2;
-
-				/* First try coalescing downwards */
-				do {
-					*p = 0;
-					p += _dirty_bytes_per_line;
-					bottom += DIRTY_BLOCK_HEIGHT;
-				} while (bottom != h && *p != 0);
-
-				/* Try coalescing to the right too. */
-				h2 = (bottom - y) / DIRTY_BLOCK_HEIGHT;
-				assert(h2 > 0);
-				p = b;
-
-				while (right != w) {
-					byte *p2 = ++p;
-					int h = h2;
-					/* Check if a full line of dirty flags is set. */
-					do {
-						if (!*p2) goto no_more_coalesc;
-						p2 += _dirty_bytes_per_line;
-					} while (--h != 0);
-
-					/* Wohoo, can combine it one step to the right!
-					 * Do that, and clear the bits. */
-					right += DIRTY_BLOCK_WIDTH;
-
-					h = h2;
-					p2 = p;
-					do {
-						*p2 = 0;
-						p2 += _dirty_bytes_per_line;
-					} while (--h != 0);
-				}
-				no_more_coalesc:
-
-				left = x;
-				top = y;
+	static std::vector<Rect> rects;
+	rects.clear();
+	TakeDirtyRects(rects);
 
-				if (left   < _invalid_rect.left  ) left   = _invalid_rect.left;
-				if (top    < _invalid_rect.top   ) top    = _invalid_rect.top;
-				if (right  > _invalid_rect.right ) right  = _invalid_rect.right;
-				if (bottom > _invalid_rect.bottom) bottom = _invalid_rect.bottom;
+	if (!rects.empty()) {
+		for (const Rect &r : rects) {
+			uint width = min<uint>(r.right * _dirty_block_width, _screen.width) - r.left * _dirty_block_width;
+			uint height = min<uint>(r.bottom * _dirty_block_height, _screen.height) - r.top * _dirty_block_height;
+			_dirty_block_stats.dirty_pixels += (uint64)width * height;
+		}
+		_dirty_block_stats.merges += MergeDirtyRects(rects);
+		_dirty_block_stats.frames++;
+	}
 
-				if (left < right && top < bottom) {
-					RedrawScreenRect(left, top, right, bottom);
-				}
+	for (const Rect &r : rects) {
+		int left = max<int>(r.left * _dirty_block_width, _invalid_rect.left);
+		int top = max<int>(r.top * _dirty_block_height, _invalid_rect.top);
+		int right = min<int>(r.right * _dirty_block_width, _invalid_rect.right);
+		int bottom = min<int>(r.bottom * _dirty_block_height, _invalid_rect.bottom);
 
-			}
-		} while (b++, (x += DIRTY_BLOCK_WIDTH) != w);
-	} while (b += -(int)(w / DIRTY_BLOCK_WIDTH) + _dirty_bytes_per_line, (y += DIRTY_BLOCK_HEIGHT) != h);
+		if (left < right && top < bottom) {
+			RedrawScreenRect(left, top, right, bottom);
+			_dirty_block_stats.rects++;
+			_dirty_block_stats.drawn_pixels += (uint64)(right - left) * (bottom - top);
+		}
+	}
 
 	++_dirty_block_colour;
-	_invalid_rect.left = w;
-	_invalid_rect.top = h;
+	_invalid_rect.left = _screen.width;
+	_invalid_rect.top = _screen.height;
 	_invalid_rect.right = 0;
 	_invalid_rect.bottom = 0;
 }
@@ -1414,10 +1541,6 @@ void DrawDirtyBlocks()
  */
 void SetDirtyBlocks(int left, int top, int right, int bottom)
 {
-	byte *b;
-	int width;
-	int height;
-
 	if (left < 0) left = 0;
 	if (top < 0) top = 0;
 	if (right > _screen.width) right = _screen.width;
@@ -1430,23 +1553,34 @@ void SetDirtyBlocks(int left, int top, int right, int bottom)
 	if (right  > _invalid_rect.right ) _invalid_rect.right  = right;
 	if (bottom > _invalid_rect.bottom) _invalid_rect.bottom = bottom;
 
-	left /= DIRTY_BLOCK_WIDTH;
-	top  /= DIRTY_BLOCK_HEIGHT;
-
-	b = _dirty_blocks + top * _dirty_bytes_per_line + left;
-
-	width  = ((right  - 1) / DIRTY_BLOCK_WIDTH)  - left + 1;
-	height = ((bottom - 1) / DIRTY_BLOCK_HEIGHT) - top  + 1;
-
-	assert(width > 0 && height > 0);
-
-	do {
-		int i = width;
+	uint first = left / _dirty_block_width;
+	uint last = (right - 1) / _dirty_block_width + 1;
+	for (uint y = top / _dirty_block_height; y <= (uint)(bottom - 1) / _dirty_block_height; y++) {
+		ChangeDirtyBlocks(&_dirty_blocks[y * _dirty_words_per_row], first, last, DBO_SET);
+		SetBit(_dirty_rows[y / 64], y % 64);
+	}
+}
 
-		do b[--i] = 0xFF; while (i != 0);
+/**
+ * Print the statistics of repainting the dirty blocks to the console.
+ * @param reset Clear the statistics instead.
+ */
+void ConPrintDirtyBlockStats(bool reset)
+{
+	if (reset) {
+		MemSetT(&_dirty_block_stats, 0);
+		IConsolePrint(CC_DEFAULT, "Dirty block statistics cleared");
+		return;
+	}
 
-		b += _dirty_bytes_per_line;
-	} while (--height != 0);
+	const DirtyBlockStats &stats = _dirty_block_stats;
+	IConsolePrintF(CC_DEFAULT, "Dirty blocks of %ux%u pixels, merging when it costs less than %u pixels",
+			_dirty_block_width, _dirty_block_height, _settings_client.gui.dirty_merge_cost);
+	IConsolePrintF(CC_DEFAULT, "Repaints: " OTTD_PRINTF64 ", rectangles: " OTTD_PRINTF64 " (%.1f per repaint), merges: " OTTD_PRINTF64,
+			stats.frames, stats.rects, stats.frames == 0 ? 0.0 : (double)stats.rects / stats.frames, stats.merges);
+	IConsolePrintF(CC_DEFAULT, "Pixels: " OTTD_PRINTF64 " dirty, " OTTD_PRINTF64 " repainted (%.1f per repaint), overdraw ratio %.2f",
+			stats.dirty_pixels, stats.drawn_pixels, stats.frames == 0 ? 0.0 : (double)stats.drawn_pixels / stats.frames,
+			stats.dirty_pixels == 0 ? 1.0 : (double)stats.drawn_pixels / stats.dirty_pixels);
 }
 
 /**
@@ -34,6 +34,19 @@
 
 /** Cache of ParagraphLayout lines. */
 Layouter::LineCache *Layouter::linecache;
+Layouter::LineCacheItem *Layouter::lru_first = NULL;
+Layouter::LineCacheItem *Layouter::lru_last = NULL;
+size_t Layouter::linecache_memory = 0;
+uint64 Layouter::linecache_lookups = 0;
+uint64 Layouter::linecache_protect = 0;
+uint Layouter::live_layouters = 0;
+Layouter::LineCacheStats Layouter::frame_stats;
+Layouter::LineCacheStats Layouter::last_stats;
+
+/** Memory the linecache may use before the least recently used lines are thrown away. */
+static const size_t LINE_CACHE_BUDGET = 4 * 1024 * 1024;
+/** Rough guess of the memory the layout of a line uses per character, for the budget of the linecache. */
+static const size_t LINE_CACHE_LAYOUT_BYTES_PER_CHAR = 32;
 
 /** Cache of Font instances. */
 Layouter::FontColourMap Layouter::fonts[FS_END];
@@ -637,11 +650,19 @@ static inline void GetLayouter(Layouter::LineCacheItem &line, const char *&str,
 	/* Better safe than sorry. */
 	*buff = '\0';
 
+	/* The line may stay in the cache for a long time, so give back the unused part of the buffer. */
+	size_t length = buff - buff_begin;
+	buff_begin = ReallocT(buff_begin, length + 1);
+	buff = buff_begin + length;
+	line.buffer = buff_begin;
+
 	if (!fontMapping.Contains(buff - buff_begin)) {
 		fontMapping.Insert(buff - buff_begin, f);
 	}
 	line.layout = T::GetParagraphLayout(buff_begin, buff, fontMapping);
 	line.state_after = state;
+	line.memory = sizeof(line) + line.str.size() + (length + 1) * sizeof(typename T::CharType) +
+			fontMapping.size() * sizeof(*fontMapping.begin()) + length * LINE_CACHE_LAYOUT_BYTES_PER_CHAR;
 }
 
 /**
@@ -653,6 +674,9 @@ static inline void GetLayouter(Layouter::LineCacheItem &line, const char *&str,
  */
 Layouter::Layouter(const char *str, int maxw, TextColour colour, FontSize fontsize) : string(str)
 {
+	/* The lines of this layouter point into the cache items, so keep the items used from now on. */
+	if (Layouter::live_layouters++ == 0) Layouter::linecache_protect = Layouter::linecache_lookups;
+
 	FontState state(colour, fontsize);
 	WChar c = 0;
 
@@ -715,6 +739,8 @@ Layouter::Layouter(const char *str, int maxw, TextColour colour, FontSize fontsi
 			if (line.layout == NULL) {
 				GetLayouter<FallbackParagraphLayoutFactory>(line, str, state);
 			}
+
+			linecache_memory += line.memory;
 		}
 
 		/* Copy all lines into a local cache so we can reuse them later on more easily. */
@@ -726,6 +752,11 @@ Layouter::Layouter(const char *str, int maxw, TextColour colour, FontSize fontsi
 	} while (c != '\0');
 }
 
+Layouter::~Layouter()
+{
+	Layouter::live_layouters--;
+}
+
 /**
  * Get the boundaries of this paragraph.
  * @return The boundaries.
@@ -860,6 +891,38 @@ void Layouter::ResetFontCache(FontSize size)
 #endif
 }
 
+/**
+ * Compare two keys of the linecache.
+ * @param other The key to compare with.
+ * @return True if both keys refer to the same string and font state.
+ */
+bool Layouter::LineCacheKey::operator==(const LineCacheKey &other) const
+{
+	return this->len == other.len &&
+			this->state_before->fontsize == other.state_before->fontsize &&
+			this->state_before->cur_colour == other.state_before->cur_colour &&
+			this->state_before->colour_stack == other.state_before->colour_stack &&
+			memcmp(this->str, other.str, this->len) == 0;
+}
+
+/**
+ * Calculate the hash of a key of the linecache.
+ * @param key The key to hash.
+ * @return The hash.
+ */
+size_t Layouter::LineCacheHash::operator()(const LineCacheKey &key) const
+{
+	/* FNV-1a over the string, seeded with the font state. */
+	uint32 hash = 2166136261U;
+	hash = (hash ^ key.state_before->fontsize) * 16777619U;
+	hash = (hash ^ key.state_before->cur_colour) * 16777619U;
+	hash = (hash ^ (uint32)key.state_before->colour_stack.size()) * 16777619U;
+	for (size_t i = 0; i < key.len; i++) {
+		hash = (hash ^ (byte)key.str[i]) * 16777619U;
+	}
+	return hash;
+}
+
 /**
  * Get reference to cache item.
  * If the item does not exist yet, it is default constructed.
@@ -876,9 +939,87 @@ Layouter::LineCacheItem &Layouter::GetCachedParagraphLayout(const char *str, siz
 	}
 
 	LineCacheKey key;
-	key.state_before = state;
-	key.str.assign(str, len);
-	return (*linecache)[key];
+	key.state_before = &state;
+	key.str = str;
+	key.len = len;
+
+	frame_stats.lookups++;
+	LineCache::iterator it = linecache->find(key);
+	LineCacheItem *item;
+	if (it != linecache->end()) {
+		frame_stats.hits++;
+		item = &it->second;
+
+		/* Move the item to the front of the LRU list. */
+		if (item != lru_first) {
+			item->lru_prev->lru_next = item->lru_next;
+			if (item->lru_next != NULL) {
+				item->lru_next->lru_prev = item->lru_prev;
+			} else {
+				lru_last = item->lru_prev;
+			}
+			item->lru_prev = NULL;
+			item->lru_next = lru_first;
+			lru_first->lru_prev = item;
+			lru_first = item;
+		}
+	} else {
+		TrimLineCache(LINE_CACHE_BUDGET);
+
+		it = linecache->emplace(key, LineCacheItem()).first;
+		item = &it->second;
+		item->state_before = state;
+		item->str.assign(str, len);
+		/* Let the key refer to the copies of the item instead of the data of the caller. */
+		it->first.state_before = &item->state_before;
+		it->first.str = item->str.data();
+
+		item->lru_next = lru_first;
+		if (lru_first != NULL) lru_first->lru_prev = item;
+		lru_first = item;
+		if (lru_last == NULL) lru_last = item;
+	}
+
+	item->last_used = linecache_lookups++;
+	return *item;
+}
+
+/**
+ * Remove an item from the linecache.
+ * @param item The item to remove.
+ */
+void Layouter::RemoveLineCacheItem(LineCacheItem *item)
+{
+	if (item->lru_prev != NULL) {
+		item->lru_prev->lru_next = item->lru_next;
+	} else {
+		lru_first = item->lru_next;
+	}
+	if (item->lru_next != NULL) {
+		item->lru_next->lru_prev = item->lru_prev;
+	} else {
+		lru_last = item->lru_prev;
+	}
+	linecache_memory -= item->memory;
+
+	LineCacheKey key;
+	key.state_before = &item->state_before;
+	key.str = item->str.data();
+	key.len = item->str.size();
+	linecache->erase(key);
+}
+
+/**
+ * Throw away the least recently used lines until the linecache fits in the
+ * budget. Lines a Layouter might still refer to are kept in any case.
+ * @param budget The memory the linecache may use.
+ */
+void Layouter::TrimLineCache(size_t budget)
+{
+	while (linecache_memory > budget && lru_last != NULL) {
+		if (live_layouters != 0 && lru_last->last_used >= linecache_protect) break;
+		RemoveLineCacheItem(lru_last);
+	}
 }
 
 /**
@@ -887,6 +1028,9 @@ Layouter::LineCacheItem &Layouter::GetCachedParagraphLayout(const char *str, siz
 void Layouter::ResetLineCache()
 {
 	if (linecache != NULL) linecache->clear();
+	lru_first = NULL;
+	lru_last = NULL;
+	linecache_memory = 0;
 }
 
 /**
@@ -894,8 +1038,30 @@ void Layouter::ResetLineCache()
  */
 void Layouter::ReduceLineCache()
 {
-	if (linecache != NULL) {
-		/* TODO LRU cache would be fancy, but not exactly necessary */
-		if (linecache->size() > 4096) ResetLineCache();
-	}
+	if (linecache != NULL) TrimLineCache(LINE_CACHE_BUDGET);
+}
+
+/**
+ * Start collecting the statistics of the linecache for a new frame.
+ * Frames that did not draw any text do not replace the last statistics.
+ */
+void Layouter::UpdateLineCacheStats()
+{
+	if (frame_stats.lookups == 0) return;
+
+	last_stats = frame_stats;
+	frame_stats.hits = 0;
+	frame_stats.lookups = 0;
+}
+
+/**
+ * Get the statistics of the linecache.
+ * @return The hits and lookups of the last frame that drew text, and the current size of the cache.
+ */
+Layouter::LineCacheStats Layouter::GetLineCacheStats()
+{
+	LineCacheStats stats = last_stats;
+	stats.items = linecache == NULL ? 0 : (uint)linecache->size();
+	stats.memory = linecache_memory;
+	return stats;
 }
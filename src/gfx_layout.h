@@ -19,6 +19,7 @@
 #include <map>
 #include <string>
 #include <stack>
+#include <unordered_map>
 #include <vector>
 
 #ifdef WITH_ICU_LX
@@ -153,19 +154,22 @@ public:
 class Layouter : public AutoDeleteSmallVector<const ParagraphLayouter::Line *> {
 	const char *string; ///< Pointer to the original string.
 
-	/** Key into the linecache */
+	/**
+	 * Key into the linecache. It only refers to the string and font state, so
+	 * looking up a line does not need to copy them; the keys of the cache refer
+	 * to the copies owned by their item.
+	 */
 	struct LineCacheKey {
-		FontState state_before;  ///< Font state at the beginning of the line.
-		std::string str;         ///< Source string of the line (including colour and font size codes).
-
-		/** Comparison operator for std::map */
-		bool operator<(const LineCacheKey &other) const
-		{
-			if (this->state_before.fontsize != other.state_before.fontsize) return this->state_before.fontsize < other.state_before.fontsize;
-			if (this->state_before.cur_colour != other.state_before.cur_colour) return this->state_before.cur_colour < other.state_before.cur_colour;
-			if (this->state_before.colour_stack != other.state_before.colour_stack) return this->state_before.colour_stack < other.state_before.colour_stack;
-			return this->str < other.str;
-		}
+		mutable const FontState *state_before; ///< Font state at the beginning of the line.
+		mutable const char *str;               ///< Source string of the line (including colour and font size codes).
+		size_t len;                            ///< Length of #str in bytes.
+
+		bool operator==(const LineCacheKey &other) const;
+	};
+
+	/** Hash of a LineCacheKey. */
+	struct LineCacheHash {
+		size_t operator()(const LineCacheKey &key) const;
 	};
 public:
 	/** Item in the linecache */
@@ -177,14 +181,40 @@ public:
 		FontState state_after;     ///< Font state after the line.
 		ParagraphLayouter *layout; ///< Layout of the line.
 
-		LineCacheItem() : buffer(NULL), layout(NULL) {}
+		/* Cache administration */
+		FontState state_before;    ///< Font state at the beginning of the line, referred to by the key.
+		std::string str;           ///< Source string of the line, referred to by the key.
+		LineCacheItem *lru_prev;   ///< Item that was used more recently, or NULL.
+		LineCacheItem *lru_next;   ///< Item that was used less recently, or NULL.
+		uint64 last_used;          ///< Value of the lookup counter when the item was last used.
+		size_t memory;             ///< Estimated memory used by the item; only known after it has been laid out.
+
+		LineCacheItem() : buffer(NULL), layout(NULL), lru_prev(NULL), lru_next(NULL), last_used(0), memory(0) {}
 		~LineCacheItem() { delete layout; free(buffer); }
 	};
+
+	/** Statistics of the linecache. */
+	struct LineCacheStats {
+		uint hits;     ///< Number of lines that were found in the cache.
+		uint lookups;  ///< Number of lines that were looked up.
+		uint items;    ///< Number of lines in the cache.
+		size_t memory; ///< Estimated memory used by the cache.
+	};
 private:
-	typedef std::map<LineCacheKey, LineCacheItem> LineCache;
+	typedef std::unordered_map<LineCacheKey, LineCacheItem, LineCacheHash> LineCache;
 	static LineCache *linecache;
+	static LineCacheItem *lru_first;    ///< Most recently used item of the linecache.
+	static LineCacheItem *lru_last;     ///< Least recently used item of the linecache.
+	static size_t linecache_memory;     ///< Estimated memory used by the linecache.
+	static uint64 linecache_lookups;    ///< Number of lookups in the linecache, the clock of the LRU.
+	static uint64 linecache_protect;    ///< Items used since this lookup might be referenced by a live Layouter.
+	static uint live_layouters;         ///< Number of Layouter instances in existence.
+	static LineCacheStats frame_stats;  ///< Statistics of the current frame.
+	static LineCacheStats last_stats;   ///< Statistics of the last frame that drew text.
 
 	static LineCacheItem &GetCachedParagraphLayout(const char *str, size_t len, const FontState &state);
+	static void RemoveLineCacheItem(LineCacheItem *item);
+	static void TrimLineCache(size_t budget);
 
 	typedef SmallMap<TextColour, Font *> FontColourMap;
 	static FontColourMap fonts[FS_END];
@@ -192,6 +222,7 @@ public:
 	static Font *GetFont(FontSize size, TextColour colour);
 
 	Layouter(const char *str, int maxw = INT32_MAX, TextColour colour = TC_FROMSTRING, FontSize fontsize = FS_NORMAL);
+	~Layouter();
 	Dimension GetBounds();
 	Point GetCharPosition(const char *ch) const;
 	const char *GetCharAtPosition(int x) const;
@@ -199,6 +230,8 @@ public:
 	static void ResetFontCache(FontSize size);
 	static void ResetLineCache();
 	static void ReduceLineCache();
+	static void UpdateLineCacheStats();
+	static LineCacheStats GetLineCacheStats();
 };
 
 #endif /* GFX_LAYOUT_H */
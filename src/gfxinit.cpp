@@ -277,9 +277,15 @@ static bool SwitchNewGRFBlitter()
 		uint min_base_depth, max_base_depth, min_grf_depth, max_grf_depth;
 	} replacement_blitters[] = {
 #ifdef WITH_SSE
+#ifdef WITH_AVX2
+		{ "32bpp-avx2",      0, 32, 32,  8, 32 },
+#endif
 		{ "32bpp-sse4",      0, 32, 32,  8, 32 },
 		{ "32bpp-ssse3",     0, 32, 32,  8, 32 },
 		{ "32bpp-sse2",      0, 32, 32,  8, 32 },
+#ifdef WITH_AVX2
+		{ "32bpp-avx2-anim", 1, 32, 32,  8, 32 },
+#endif
 		{ "32bpp-sse4-anim", 1, 32, 32,  8, 32 },
 #endif
 		{ "8bpp-optimized",  2,  8,  8,  8,  8 },
@@ -310,6 +316,8 @@ static bool SwitchNewGRFBlitter()
 		if (BlitterFactory::GetBlitterFactory(repl_blitter) == NULL) continue;
 
 		DEBUG(misc, 1, "Switching blitter from '%s' to '%s'... ", cur_blitter, repl_blitter);
+		/* Sprites being decoded in the background use the current blitter. */
+		CancelSpritePrefetch();
 		Blitter *new_blitter = BlitterFactory::SelectBlitter(repl_blitter);
 		if (new_blitter == NULL) NOT_REACHED();
 		DEBUG(misc, 1, "Successfully switched to %s.", repl_blitter);
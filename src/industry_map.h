@@ -14,6 +14,7 @@
 
 #include "industrytype.h"
 #include "water_map.h"
+#include "pathfinder/water_regions.h"
 
 
 /**
@@ -279,6 +280,7 @@ static inline void SetIndustryTriggers(TileIndex tile, byte triggers)
  */
 static inline void MakeIndustry(TileIndex t, IndustryID index, IndustryGfx gfx, uint8 random, WaterClass wc)
 {
+	InvalidateWaterRegion(t);
 	SetTileType(t, MP_INDUSTRY);
 	_m[t].m1 = 0;
 	_m[t].m2 = index;
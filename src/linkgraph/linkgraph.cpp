@@ -36,16 +36,19 @@ inline void LinkGraph::BaseNode::Init(TileIndex xy, StationID st, uint demand)
 
 /**
  * Create an edge.
+ * @param dest_node Destination of the edge.
  */
-inline void LinkGraph::BaseEdge::Init()
+void LinkGraph::BaseEdge::Init(NodeID dest_node)
 {
 	this->capacity = 0;
 	this->usage = 0;
 	this->last_unrestricted_update = INVALID_DATE;
 	this->last_restricted_update = INVALID_DATE;
-	this->next_edge = INVALID_NODE;
+	this->dest_node = dest_node;
 }
 
+/* static */ const LinkGraph::BaseEdge LinkGraph::empty_edge = { 0, 0, INVALID_DATE, INVALID_DATE, INVALID_NODE };
+
 /**
  * Shift all dates by given interval.
  * This is useful if the date has been modified with the cheat menu.
@@ -57,10 +60,9 @@ void LinkGraph::ShiftDates(int interval)
 	for (NodeID node1 = 0; node1 < this->Size(); ++node1) {
 		BaseNode &source = this->nodes[node1];
 		if (source.last_update != INVALID_DATE) source.last_update += interval;
-		for (NodeID node2 = 0; node2 < this->Size(); ++node2) {
-			BaseEdge &edge = this->edges[node1][node2];
-			if (edge.last_unrestricted_update != INVALID_DATE) edge.last_unrestricted_update += interval;
-			if (edge.last_restricted_update != INVALID_DATE) edge.last_restricted_update += interval;
+		for (EdgeVector::iterator edge = this->edges[node1].begin(); edge != this->edges[node1].end(); ++edge) {
+			if (edge->last_unrestricted_update != INVALID_DATE) edge->last_unrestricted_update += interval;
+			if (edge->last_restricted_update != INVALID_DATE) edge->last_restricted_update += interval;
 		}
 	}
 }
@@ -70,11 +72,10 @@ void LinkGraph::Compress()
 	this->last_compression = (_date + this->last_compression) / 2;
 	for (NodeID node1 = 0; node1 < this->Size(); ++node1) {
 		this->nodes[node1].supply /= 2;
-		for (NodeID node2 = 0; node2 < this->Size(); ++node2) {
-			BaseEdge &edge = this->edges[node1][node2];
-			if (edge.capacity > 0) {
-				edge.capacity = max(1U, edge.capacity / 2);
-				edge.usage /= 2;
+		for (EdgeVector::iterator edge = this->edges[node1].begin(); edge != this->edges[node1].end(); ++edge) {
+			if (edge->capacity > 0) {
+				edge->capacity = max(1U, edge->capacity / 2);
+				edge->usage /= 2;
 			}
 		}
 	}
@@ -95,21 +96,15 @@ void LinkGraph::Merge(LinkGraph *other)
 		this->nodes[new_node].supply = LinkGraph::Scale(other->nodes[node1].supply, age, other_age);
 		st->goods[this->cargo].link_graph = this->index;
 		st->goods[this->cargo].node = new_node;
-		for (NodeID node2 = 0; node2 < node1; ++node2) {
-			BaseEdge &forward = this->edges[new_node][first + node2];
-			BaseEdge &backward = this->edges[first + node2][new_node];
-			forward = other->edges[node1][node2];
-			backward = other->edges[node2][node1];
-			forward.capacity = LinkGraph::Scale(forward.capacity, age, other_age);
-			forward.usage = LinkGraph::Scale(forward.usage, age, other_age);
-			if (forward.next_edge != INVALID_NODE) forward.next_edge += first;
-			backward.capacity = LinkGraph::Scale(backward.capacity, age, other_age);
-			backward.usage = LinkGraph::Scale(backward.usage, age, other_age);
-			if (backward.next_edge != INVALID_NODE) backward.next_edge += first;
+
+		/* All nodes are shifted by the same offset, so the list stays sorted. */
+		EdgeVector &new_edges = this->edges[new_node];
+		new_edges.swap(other->edges[node1]);
+		for (EdgeVector::iterator edge = new_edges.begin(); edge != new_edges.end(); ++edge) {
+			edge->dest_node += first;
+			edge->capacity = LinkGraph::Scale(edge->capacity, age, other_age);
+			edge->usage = LinkGraph::Scale(edge->usage, age, other_age);
 		}
-		BaseEdge &new_start = this->edges[new_node][new_node];
-		new_start = other->edges[node1][node1];
-		if (new_start.next_edge != INVALID_NODE) new_start.next_edge += first;
 	}
 	delete other;
 }
@@ -125,35 +120,27 @@ void LinkGraph::RemoveNode(NodeID id)
 	NodeID last_node = this->Size() - 1;
 	for (NodeID i = 0; i <= last_node; ++i) {
 		(*this)[i].RemoveEdge(id);
-		BaseEdge *node_edges = this->edges[i];
-		NodeID prev = i;
-		NodeID next = node_edges[i].next_edge;
-		while (next != INVALID_NODE) {
-			if (next == last_node) {
-				node_edges[prev].next_edge = id;
-				break;
-			}
-			prev = next;
-			next = node_edges[prev].next_edge;
-		}
-		node_edges[id] = node_edges[last_node];
+		EdgeVector &node_edges = this->edges[i];
+		/* The edge to the last node, if any, is the last one in the list. Give
+		 * it its new destination and move it to the right place. */
+		if (node_edges.empty() || node_edges.back().dest_node != last_node) continue;
+		BaseEdge edge = node_edges.back();
+		edge.dest_node = id;
+		node_edges.pop_back();
+		node_edges.insert(node_edges.begin() + LinkGraph::FindEdge(node_edges, id), edge);
 	}
 	Station::Get(this->nodes[last_node].station)->goods[this->cargo].node = id;
 	/* Erase node by swapping with the last element. Node index is referenced
 	 * directly from station goods entries so the order and position must remain. */
 	this->nodes[id] = this->nodes.back();
 	this->nodes.pop_back();
-	this->edges.EraseColumn(id);
-	/* Not doing EraseRow here, as having the extra invalid row doesn't hurt
-	 * and removing it would trigger a lot of memmove. The data has already
-	 * been copied around in the loop above. */
+	this->edges[id].swap(this->edges.back());
+	this->edges.pop_back();
 }
 
 /**
- * Add a node to the component and create empty edges associated with it. Set
- * the station's last_component to this component. Calculate the distances to all
- * other nodes. The distances to _all_ nodes are important as the demand
- * calculator relies on their availability.
+ * Add a node to the component, without any edges. Set the station's
+ * last_component to this component.
  * @param st New node's station.
  * @return New node's ID.
  */
@@ -163,23 +150,11 @@ NodeID LinkGraph::AddNode(const Station *st)
 
 	NodeID new_node = this->Size();
 	this->nodes.emplace_back();
-	/* Avoid reducing the height of the matrix as that is expensive and we
-	 * most likely will increase it again later which is again expensive. */
-	this->edges.Resize(new_node + 1U,
-			max(new_node + 1U, this->edges.Height()));
+	this->edges.emplace_back();
 
 	this->nodes[new_node].Init(st->xy, st->index,
 			HasBit(good.status, GoodsEntry::GES_ACCEPTANCE));
 
-	BaseEdge *new_edges = this->edges[new_node];
-
-	/* Reset the first edge starting at the new node */
-	new_edges[new_node].next_edge = INVALID_NODE;
-
-	for (NodeID i = 0; i <= new_node; ++i) {
-		new_edges[i].Init();
-		this->edges[i][new_node].Init();
-	}
 	return new_node;
 }
 
@@ -194,12 +169,12 @@ NodeID LinkGraph::AddNode(const Station *st)
 void LinkGraph::Node::AddEdge(NodeID to, uint capacity, uint usage, EdgeUpdateMode mode)
 {
 	assert(this->index != to);
-	BaseEdge &edge = this->edges[to];
-	BaseEdge &first = this->edges[this->index];
+	uint pos = LinkGraph::FindEdge(this->edges, to);
+	assert(!LinkGraph::IsEdgeAt(this->edges, pos, to));
+	BaseEdge &edge = *this->edges.emplace(this->edges.begin() + pos);
+	edge.Init(to);
 	edge.capacity = capacity;
 	edge.usage = usage;
-	edge.next_edge = first.next_edge;
-	first.next_edge = to;
 	if (mode & EUM_UNRESTRICTED)  edge.last_unrestricted_update = _date;
 	if (mode & EUM_RESTRICTED) edge.last_restricted_update = _date;
 }
@@ -215,10 +190,11 @@ void LinkGraph::Node::UpdateEdge(NodeID to, uint capacity, uint usage, EdgeUpdat
 {
 	assert(capacity > 0);
 	assert(usage <= capacity);
-	if (this->edges[to].capacity == 0) {
+	uint pos = LinkGraph::FindEdge(this->edges, to);
+	if (!LinkGraph::IsEdgeAt(this->edges, pos, to)) {
 		this->AddEdge(to, capacity, usage, mode);
 	} else {
-		(*this)[to].Update(capacity, usage, mode);
+		Edge(this->edges[pos]).Update(capacity, usage, mode);
 	}
 }
 
@@ -228,26 +204,8 @@ void LinkGraph::Node::UpdateEdge(NodeID to, uint capacity, uint usage, EdgeUpdat
  */
 void LinkGraph::Node::RemoveEdge(NodeID to)
 {
-	if (this->index == to) return;
-	BaseEdge &edge = this->edges[to];
-	edge.capacity = 0;
-	edge.last_unrestricted_update = INVALID_DATE;
-	edge.last_restricted_update = INVALID_DATE;
-	edge.usage = 0;
-
-	NodeID prev = this->index;
-	NodeID next = this->edges[this->index].next_edge;
-	while (next != INVALID_NODE) {
-		if (next == to) {
-			/* Will be removed, skip it. */
-			this->edges[prev].next_edge = edge.next_edge;
-			edge.next_edge = INVALID_NODE;
-			break;
-		} else {
-			prev = next;
-			next = this->edges[next].next_edge;
-		}
-	}
+	uint pos = LinkGraph::FindEdge(this->edges, to);
+	if (LinkGraph::IsEdgeAt(this->edges, pos, to)) this->edges.erase(this->edges.begin() + pos);
 }
 
 /**
@@ -276,19 +234,15 @@ void LinkGraph::Edge::Update(uint capacity, uint usage, EdgeUpdateMode mode)
 }
 
 /**
- * Resize the component and fill it with empty nodes and edges. Used when
+ * Resize the component and fill it with empty nodes without edges. Used when
  * loading from save games. The component is expected to be empty before.
  * @param size New size of the component.
  */
 void LinkGraph::Init(uint size)
 {
 	assert(this->Size() == 0);
-	this->edges.Resize(size, size);
+	this->edges.resize(size);
 	this->nodes.resize(size);
 
-	for (uint i = 0; i < size; ++i) {
-		this->nodes[i].Init();
-		BaseEdge *column = this->edges[i];
-		for (uint j = 0; j < size; ++j) column[j].Init();
-	}
+	for (uint i = 0; i < size; ++i) this->nodes[i].Init();
 }
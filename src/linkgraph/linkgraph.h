@@ -14,7 +14,6 @@
 
 #include "../core/pool_type.hpp"
 #include "../core/smallmap_type.hpp"
-#include "../core/smallmatrix_type.hpp"
 #include "../station_base.h"
 #include "../cargotype.h"
 #include "../date_func.h"
@@ -55,20 +54,56 @@ public:
 	};
 
 	/**
-	 * An edge in the link graph. Corresponds to a link between two stations or at
-	 * least the distance between them. Edges from one node to itself contain the
-	 * ID of the opposite Node of the first active edge (i.e. not just distance) in
-	 * the column as next_edge.
+	 * An edge in the link graph. Corresponds to a link between two stations.
+	 * Only existing links are stored, in a list per source node that is sorted
+	 * by destination.
 	 */
 	struct BaseEdge {
 		uint capacity;                 ///< Capacity of the link.
 		uint usage;                    ///< Usage of the link.
 		Date last_unrestricted_update; ///< When the unrestricted part of the link was last updated.
 		Date last_restricted_update;   ///< When the restricted part of the link was last updated.
-		NodeID next_edge;              ///< Destination of next valid edge starting at the same source node.
-		void Init();
+		NodeID dest_node;              ///< Destination of the edge.
+		void Init(NodeID dest_node = INVALID_NODE);
 	};
 
+	/** Outgoing edges of a node, sorted by destination. */
+	typedef std::vector<BaseEdge> EdgeVector;
+
+	/**
+	 * Find the position of the edge to a node in an edge list, or the position
+	 * where such an edge would have to be inserted.
+	 * @param edges Edge list sorted by destination.
+	 * @param to Destination of the edge.
+	 * @return Index of the first edge with a destination not less than \a to.
+	 */
+	static inline uint FindEdge(const EdgeVector &edges, NodeID to)
+	{
+		uint first = 0;
+		uint last = (uint)edges.size();
+		while (first < last) {
+			uint middle = (first + last) / 2;
+			if (edges[middle].dest_node < to) {
+				first = middle + 1;
+			} else {
+				last = middle;
+			}
+		}
+		return first;
+	}
+
+	/**
+	 * Check whether an edge list contains an edge to the given node.
+	 * @param edges Edge list sorted by destination.
+	 * @param pos Position of the edge as returned by FindEdge.
+	 * @param to Destination of the edge.
+	 * @return If the edge at \a pos leads to \a to.
+	 */
+	static inline bool IsEdgeAt(const EdgeVector &edges, uint pos, NodeID to)
+	{
+		return pos < edges.size() && edges[pos].dest_node == to;
+	}
+
 	/**
 	 * Wrapper for an edge (const or not) allowing retrieval, but no modification.
 	 * @tparam Tedge Actual edge class, may be "const BaseEdge" or just "BaseEdge".
@@ -119,15 +154,15 @@ public:
 
 	/**
 	 * Wrapper for a node (const or not) allowing retrieval, but no modification.
-	 * @tparam Tedge Actual node class, may be "const BaseNode" or just "BaseNode".
-	 * @tparam Tedge Actual edge class, may be "const BaseEdge" or just "BaseEdge".
+	 * @tparam Tnode Actual node class, may be "const BaseNode" or just "BaseNode".
+	 * @tparam Tedges Actual edge list class, may be "const EdgeVector" or just "EdgeVector".
 	 */
-	template<typename Tnode, typename Tedge>
+	template<typename Tnode, typename Tedges>
 	class NodeWrapper {
 	protected:
-		Tnode &node;  ///< Node being wrapped.
-		Tedge *edges; ///< Outgoing edges for wrapped node.
-		NodeID index; ///< ID of wrapped node.
+		Tnode &node;   ///< Node being wrapped.
+		Tedges &edges; ///< Outgoing edges for wrapped node.
+		NodeID index;  ///< ID of wrapped node.
 
 	public:
 
@@ -137,7 +172,7 @@ public:
 		 * @param edges Outgoing edges for node to be wrapped.
 		 * @param index ID of node to be wrapped.
 		 */
-		NodeWrapper(Tnode &node, Tedge *edges, NodeID index) : node(node),
+		NodeWrapper(Tnode &node, Tedges &edges, NodeID index) : node(node),
 			edges(edges), index(index) {}
 
 		/**
@@ -169,20 +204,34 @@ public:
 		 * @return Location of the station.
 		 */
 		TileIndex XY() const { return this->node.xy; }
+
+		/**
+		 * Check if there is an edge from the wrapped node to the given one.
+		 * @param to ID of the destination node.
+		 * @return If the edge exists.
+		 */
+		bool HasEdgeTo(NodeID to) const
+		{
+			return LinkGraph::IsEdgeAt(this->edges, LinkGraph::FindEdge(this->edges, to), to);
+		}
+
+		/**
+		 * Get the number of outgoing edges of the wrapped node.
+		 * @return Number of edges.
+		 */
+		uint NumEdges() const { return (uint)this->edges.size(); }
 	};
 
 	/**
-	 * Base class for iterating across outgoing edges of a node. Only the real
-	 * edges (those with capacity) are iterated. The ones with only distance
-	 * information are skipped.
+	 * Base class for iterating across outgoing edges of a node, in order of
+	 * their destinations.
 	 * @tparam Tedge Actual edge class. May be "BaseEdge" or "const BaseEdge".
 	 * @tparam Titer Actual iterator class.
 	 */
 	template <class Tedge, class Tedge_wrapper, class Titer>
 	class BaseEdgeIterator {
 	protected:
-		Tedge *base;    ///< Array of edges being iterated.
-		NodeID current; ///< Current offset in edges array.
+		Tedge *current; ///< Current edge in the node's edge list.
 
 		/**
 		 * A "fake" pointer to enable operator-> on temporaries. As the objects
@@ -209,13 +258,9 @@ public:
 	public:
 		/**
 		 * Constructor.
-		 * @param base Array of edges to be iterated.
-		 * @param current ID of current node (to locate the first edge).
+		 * @param current Edge to start at.
 		 */
-		BaseEdgeIterator (Tedge *base, NodeID current) :
-			base(base),
-			current(current == INVALID_NODE ? current : base[current].next_edge)
-		{}
+		BaseEdgeIterator (Tedge *current) : current(current) {}
 
 		/**
 		 * Prefix-increment.
@@ -223,7 +268,7 @@ public:
 		 */
 		Titer &operator++()
 		{
-			this->current = this->base[this->current].next_edge;
+			this->current++;
 			return static_cast<Titer &>(*this);
 		}
 
@@ -234,7 +279,7 @@ public:
 		Titer operator++(int)
 		{
 			Titer ret(static_cast<Titer &>(*this));
-			this->current = this->base[this->current].next_edge;
+			this->current++;
 			return ret;
 		}
 
@@ -243,12 +288,12 @@ public:
 		 * child class.
 		 * @tparam Tother Class of other iterator.
 		 * @param other Instance of other iterator.
-		 * @return If the iterators have the same edge array and current node.
+		 * @return If the iterators point to the same edge.
 		 */
 		template<class Tother>
 		bool operator==(const Tother &other)
 		{
-			return this->base == other.base && this->current == other.current;
+			return this->current == other.current;
 		}
 
 		/**
@@ -256,12 +301,12 @@ public:
 		 * may be of a child class.
 		 * @tparam Tother Class of other iterator.
 		 * @param other Instance of other iterator.
-		 * @return If either the edge arrays or the current nodes differ.
+		 * @return If the iterators point to different edges.
 		 */
 		template<class Tother>
 		bool operator!=(const Tother &other)
 		{
-			return this->base != other.base || this->current != other.current;
+			return this->current != other.current;
 		}
 
 		/**
@@ -270,7 +315,7 @@ public:
 		 */
 		SmallPair<NodeID, Tedge_wrapper> operator*() const
 		{
-			return SmallPair<NodeID, Tedge_wrapper>(this->current, Tedge_wrapper(this->base[this->current]));
+			return SmallPair<NodeID, Tedge_wrapper>(this->current->dest_node, Tedge_wrapper(*this->current));
 		}
 
 		/**
@@ -310,11 +355,10 @@ public:
 	public:
 		/**
 		 * Constructor.
-		 * @param edges Array of edges to be iterated over.
-		 * @param current ID of current edge's end node.
+		 * @param current Edge to start at.
 		 */
-		ConstEdgeIterator(const BaseEdge *edges, NodeID current) :
-			BaseEdgeIterator<const BaseEdge, ConstEdge, ConstEdgeIterator>(edges, current) {}
+		ConstEdgeIterator(const BaseEdge *current) :
+			BaseEdgeIterator<const BaseEdge, ConstEdge, ConstEdgeIterator>(current) {}
 	};
 
 	/**
@@ -325,18 +369,17 @@ public:
 	public:
 		/**
 		 * Constructor.
-		 * @param edges Array of edges to be iterated over.
-		 * @param current ID of current edge's end node.
+		 * @param current Edge to start at.
 		 */
-		EdgeIterator(BaseEdge *edges, NodeID current) :
-			BaseEdgeIterator<BaseEdge, Edge, EdgeIterator>(edges, current) {}
+		EdgeIterator(BaseEdge *current) :
+			BaseEdgeIterator<BaseEdge, Edge, EdgeIterator>(current) {}
 	};
 
 	/**
 	 * Constant node class. Only retrieval operations are allowed on both the
 	 * node itself and its edges.
 	 */
-	class ConstNode : public NodeWrapper<const BaseNode, const BaseEdge> {
+	class ConstNode : public NodeWrapper<const BaseNode, const EdgeVector> {
 	public:
 		/**
 		 * Constructor.
@@ -344,34 +387,39 @@ public:
 		 * @param node ID of the node.
 		 */
 		ConstNode(const LinkGraph *lg, NodeID node) :
-			NodeWrapper<const BaseNode, const BaseEdge>(lg->nodes[node], lg->edges[node], node)
+			NodeWrapper<const BaseNode, const EdgeVector>(lg->nodes[node], lg->edges[node], node)
 		{}
 
 		/**
 		 * Get a ConstEdge. This is not a reference as the wrapper objects are
-		 * not actually persistent.
+		 * not actually persistent. If there is no such edge an empty one,
+		 * without capacity and updates, is returned.
 		 * @param to ID of end node of edge.
 		 * @return Constant edge wrapper.
 		 */
-		ConstEdge operator[](NodeID to) const { return ConstEdge(this->edges[to]); }
+		ConstEdge operator[](NodeID to) const
+		{
+			uint pos = LinkGraph::FindEdge(this->edges, to);
+			return ConstEdge(LinkGraph::IsEdgeAt(this->edges, pos, to) ? this->edges[pos] : LinkGraph::empty_edge);
+		}
 
 		/**
-		 * Get an iterator pointing to the start of the edges array.
+		 * Get an iterator pointing to the first edge.
 		 * @return Constant edge iterator.
 		 */
-		ConstEdgeIterator Begin() const { return ConstEdgeIterator(this->edges, this->index); }
+		ConstEdgeIterator Begin() const { return ConstEdgeIterator(this->edges.data()); }
 
 		/**
-		 * Get an iterator pointing beyond the end of the edges array.
+		 * Get an iterator pointing beyond the last edge.
 		 * @return Constant edge iterator.
 		 */
-		ConstEdgeIterator End() const { return ConstEdgeIterator(this->edges, INVALID_NODE); }
+		ConstEdgeIterator End() const { return ConstEdgeIterator(this->edges.data() + this->edges.size()); }
 	};
 
 	/**
 	 * Updatable node class. The node itself as well as its edges can be modified.
 	 */
-	class Node : public NodeWrapper<BaseNode, BaseEdge> {
+	class Node : public NodeWrapper<BaseNode, EdgeVector> {
 	public:
 		/**
 		 * Constructor.
@@ -379,28 +427,34 @@ public:
 		 * @param node ID of the node.
 		 */
 		Node(LinkGraph *lg, NodeID node) :
-			NodeWrapper<BaseNode, BaseEdge>(lg->nodes[node], lg->edges[node], node)
+			NodeWrapper<BaseNode, EdgeVector>(lg->nodes[node], lg->edges[node], node)
 		{}
 
 		/**
 		 * Get an Edge. This is not a reference as the wrapper objects are not
-		 * actually persistent.
+		 * actually persistent. The edge has to exist. Adding edges to the node
+		 * invalidates the wrapper.
 		 * @param to ID of end node of edge.
 		 * @return Edge wrapper.
 		 */
-		Edge operator[](NodeID to) { return Edge(this->edges[to]); }
+		Edge operator[](NodeID to)
+		{
+			uint pos = LinkGraph::FindEdge(this->edges, to);
+			assert(LinkGraph::IsEdgeAt(this->edges, pos, to));
+			return Edge(this->edges[pos]);
+		}
 
 		/**
-		 * Get an iterator pointing to the start of the edges array.
+		 * Get an iterator pointing to the first edge.
 		 * @return Edge iterator.
 		 */
-		EdgeIterator Begin() { return EdgeIterator(this->edges, this->index); }
+		EdgeIterator Begin() { return EdgeIterator(this->edges.data()); }
 
 		/**
-		 * Get an iterator pointing beyond the end of the edges array.
-		 * @return Constant edge iterator.
+		 * Get an iterator pointing beyond the last edge.
+		 * @return Edge iterator.
 		 */
-		EdgeIterator End() { return EdgeIterator(this->edges, INVALID_NODE); }
+		EdgeIterator End() { return EdgeIterator(this->edges.data() + this->edges.size()); }
 
 		/**
 		 * Update the node's supply and set last_update to the current date.
@@ -436,7 +490,7 @@ public:
 	};
 
 	typedef std::vector<BaseNode> NodeVector;
-	typedef SmallMatrix<BaseEdge> EdgeMatrix;
+	typedef std::vector<EdgeVector> EdgeVectorVector;
 
 	/** Minimum effective distance for timeout calculation. */
 	static const uint MIN_TIMEOUT_DISTANCE = 32;
@@ -530,10 +584,12 @@ protected:
 	friend const SaveLoad *GetLinkGraphJobDesc();
 	friend void SaveLoad_LinkGraph(LinkGraph &lg);
 
-	CargoID cargo;         ///< Cargo of this component's link graph.
-	Date last_compression; ///< Last time the capacities and supplies were compressed.
-	NodeVector nodes;      ///< Nodes in the component.
-	EdgeMatrix edges;      ///< Edges in the component.
+	static const BaseEdge empty_edge; ///< Edge returned for lookups of non-existing edges.
+
+	CargoID cargo;          ///< Cargo of this component's link graph.
+	Date last_compression;  ///< Last time the capacities and supplies were compressed.
+	NodeVector nodes;       ///< Nodes in the component.
+	EdgeVectorVector edges; ///< Outgoing edges of each node in the component.
 };
 
 #define FOR_ALL_LINK_GRAPHS(var) FOR_ALL_ITEMS_FROM(LinkGraph, link_graph_index, var, 0)
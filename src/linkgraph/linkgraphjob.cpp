@@ -39,7 +39,6 @@ LinkGraphJob::LinkGraphJob(const LinkGraph &orig) :
 		 * This is on purpose. */
 		link_graph(orig),
 		settings(_settings_game.linkgraph),
-		thread(NULL),
 		join_date(_date + _settings_game.linkgraph.recalc_time)
 {
 }
@@ -56,34 +55,28 @@ void LinkGraphJob::EraseFlows(NodeID from)
 }
 
 /**
- * Spawn a thread if possible and run the link graph job in the thread. If
- * that's not possible run the job right now in the current thread.
+ * Queue the link graph job in the worker pool. If the pool has no threads the
+ * job is run right now in the current thread.
  */
 void LinkGraphJob::SpawnThread()
 {
-	if (!ThreadObject::New(&(LinkGraphSchedule::Run), this, &this->thread, "ottd:linkgraph")) {
-		this->thread = NULL;
-		/* Of course this will hang a bit.
-		 * On the other hand, if you want to play games which make this hang noticably
-		 * on a platform without threads then you'll probably get other problems first.
-		 * OK:
-		 * If someone comes and tells me that this hangs for him/her, I'll implement a
-		 * smaller grained "Step" method for all handlers and add some more ticks where
-		 * "Step" is called. No problem in principle. */
-		LinkGraphSchedule::Run(this);
-	}
+	/* Of course this will hang a bit if there are no worker threads.
+	 * On the other hand, if you want to play games which make this hang noticably
+	 * on a platform without threads then you'll probably get other problems first.
+	 * OK:
+	 * If someone comes and tells me that this hangs for him/her, I'll implement a
+	 * smaller grained "Step" method for all handlers and add some more ticks where
+	 * "Step" is called. No problem in principle. */
+	_worker_pool.Submit(&(LinkGraphSchedule::Run), this, &this->ticket);
 }
 
 /**
- * Join the calling thread with this job's thread if threading is enabled.
+ * Wait for the job to finish. If it hasn't been started by a worker yet, it
+ * is run in the calling thread.
  */
 void LinkGraphJob::JoinThread()
 {
-	if (this->thread != NULL) {
-		this->thread->Join();
-		delete this->thread;
-		this->thread = NULL;
-	}
+	_worker_pool.Wait(&this->ticket);
 }
 
 /**
@@ -119,11 +112,11 @@ LinkGraphJob::~LinkGraphJob()
 			continue;
 		}
 
-		LinkGraph *lg = LinkGraph::Get(ge.link_graph);
+		const LinkGraph *lg = LinkGraph::Get(ge.link_graph);
 		FlowStatMap &flows = from.Flows();
 
 		for (EdgeIterator it(from.Begin()); it != from.End(); ++it) {
-			if (from[it->first].Flow() == 0) continue;
+			if (it->second.Flow() == 0) continue;
 			StationID to = (*this)[it->first].Station();
 			Station *st2 = Station::GetIfValid(to);
 			if (st2 == NULL || st2->goods[this->Cargo()].link_graph != this->link_graph.index ||
@@ -172,22 +165,31 @@ LinkGraphJob::~LinkGraphJob()
 }
 
 /**
- * Initialize the link graph job: Resize nodes and edges and populate them.
- * This is done after the constructor so that we can do it in the calculation
- * thread without delaying the main game.
+ * Initialize the link graph job: Resize nodes, edges and demands and populate
+ * them. This is done after the constructor so that we can do it in the
+ * calculation thread without delaying the main game.
  */
 void LinkGraphJob::Init()
 {
 	uint size = this->Size();
 	this->nodes.resize(size);
-	this->edges.Resize(size, size);
+	this->first_edge.resize(size + 1);
+	this->demands.Resize(size, size);
+	uint num_edges = 0;
 	for (uint i = 0; i < size; ++i) {
 		this->nodes[i].Init(this->link_graph[i].Supply());
-		EdgeAnnotation *node_edges = this->edges[i];
+		this->first_edge[i] = num_edges;
+		num_edges += this->link_graph[i].NumEdges();
+		DemandAnnotation *node_demands = this->demands[i];
 		for (uint j = 0; j < size; ++j) {
-			node_edges[j].Init();
+			node_demands[j].Init();
 		}
 	}
+	this->first_edge[size] = num_edges;
+	this->edges.resize(num_edges);
+	for (uint i = 0; i < num_edges; ++i) {
+		this->edges[i].Init();
+	}
 }
 
 /**
@@ -195,8 +197,15 @@ void LinkGraphJob::Init()
  */
 void LinkGraphJob::EdgeAnnotation::Init()
 {
-	this->demand = 0;
 	this->flow = 0;
+}
+
+/**
+ * Initialize the demand between two nodes.
+ */
+void LinkGraphJob::DemandAnnotation::Init()
+{
+	this->demand = 0;
 	this->unsatisfied_demand = 0;
 }
 
@@ -12,7 +12,8 @@
 #ifndef LINKGRAPHJOB_H
 #define LINKGRAPHJOB_H
 
-#include "../thread/thread.h"
+#include "../core/smallmatrix_type.hpp"
+#include "../thread/worker_pool.h"
 #include "linkgraph.h"
 #include <list>
 
@@ -34,12 +35,19 @@ private:
 	 * Annotation for a link graph edge.
 	 */
 	struct EdgeAnnotation {
-		uint demand;             ///< Transport demand between the nodes.
-		uint unsatisfied_demand; ///< Demand over this edge that hasn't been satisfied yet.
 		uint flow;               ///< Planned flow over this edge.
 		void Init();
 	};
 
+	/**
+	 * Annotation for a pair of nodes, whether they are connected or not.
+	 */
+	struct DemandAnnotation {
+		uint demand;             ///< Transport demand between the nodes.
+		uint unsatisfied_demand; ///< Demand between the nodes that hasn't been satisfied yet.
+		void Init();
+	};
+
 	/**
 	 * Annotation for a link graph node.
 	 */
@@ -51,7 +59,8 @@ private:
 	};
 
 	typedef std::vector<NodeAnnotation> NodeAnnotationVector;
-	typedef SmallMatrix<EdgeAnnotation> EdgeAnnotationMatrix;
+	typedef std::vector<EdgeAnnotation> EdgeAnnotationVector;
+	typedef SmallMatrix<DemandAnnotation> DemandAnnotationMatrix;
 
 	friend const SaveLoad *GetLinkGraphJobDesc();
 	friend class LinkGraphSchedule;
@@ -59,10 +68,12 @@ private:
 protected:
 	const LinkGraph link_graph;       ///< Link graph to by analyzed. Is copied when job is started and mustn't be modified later.
 	const LinkGraphSettings settings; ///< Copy of _settings_game.linkgraph at spawn time.
-	ThreadObject *thread;             ///< Thread the job is running in or NULL if it's running in the main thread.
+	WorkerJobTicket ticket;           ///< Ticket of the job in the worker pool.
 	Date join_date;                   ///< Date when the job is to be joined.
 	NodeAnnotationVector nodes;       ///< Extra node data necessary for link graph calculation.
-	EdgeAnnotationMatrix edges;       ///< Extra edge data necessary for link graph calculation.
+	EdgeAnnotationVector edges;       ///< Extra edge data necessary for link graph calculation, for the edges of all nodes one after another.
+	std::vector<uint> first_edge;     ///< Index of the first annotation in #edges for each node.
+	DemandAnnotationMatrix demands;   ///< Demands between all pairs of nodes.
 
 	void EraseFlows(NodeID from);
 	void JoinThread();
@@ -72,7 +83,8 @@ public:
 
 	/**
 	 * A job edge. Wraps a link graph edge and an edge annotation. The
-	 * annotation can be modified, the edge is constant.
+	 * annotation can be modified, the edge is constant. Demands are kept
+	 * per pair of nodes, see LinkGraphJob::Node.
 	 */
 	class Edge : public LinkGraph::ConstEdge {
 	private:
@@ -86,18 +98,6 @@ public:
 		Edge(const LinkGraph::BaseEdge &edge, EdgeAnnotation &anno) :
 				LinkGraph::ConstEdge(edge), anno(anno) {}
 
-		/**
-		 * Get the transport demand between end the points of the edge.
-		 * @return Demand.
-		 */
-		uint Demand() const { return this->anno.demand; }
-
-		/**
-		 * Get the transport demand that hasn't been satisfied by flows, yet.
-		 * @return Unsatisfied demand.
-		 */
-		uint UnsatisfiedDemand() const { return this->anno.unsatisfied_demand; }
-
 		/**
 		 * Get the total flow on the edge.
 		 * @return Flow.
@@ -119,43 +119,24 @@ public:
 			assert(flow <= this->anno.flow);
 			this->anno.flow -= flow;
 		}
-
-		/**
-		 * Add some (not yet satisfied) demand.
-		 * @param demand Demand to be added.
-		 */
-		void AddDemand(uint demand)
-		{
-			this->anno.demand += demand;
-			this->anno.unsatisfied_demand += demand;
-		}
-
-		/**
-		 * Satisfy some demand.
-		 * @param demand Demand to be satisfied.
-		 */
-		void SatisfyDemand(uint demand)
-		{
-			assert(demand <= this->anno.unsatisfied_demand);
-			this->anno.unsatisfied_demand -= demand;
-		}
 	};
 
 	/**
 	 * Iterator for job edges.
 	 */
 	class EdgeIterator : public LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator> {
-		EdgeAnnotation *base_anno; ///< Array of annotations to be (indirectly) iterated.
+		const LinkGraph::BaseEdge *base; ///< First edge of the node.
+		EdgeAnnotation *base_anno;       ///< Annotation of the first edge of the node.
 	public:
 		/**
 		 * Constructor.
-		 * @param base Array of edges to be iterated.
-		 * @param base_anno Array of annotations to be iterated.
-		 * @param current Start offset of iteration.
+		 * @param base First edge of the node.
+		 * @param base_anno Annotation of the first edge of the node.
+		 * @param current Edge to start at.
 		 */
-		EdgeIterator(const LinkGraph::BaseEdge *base, EdgeAnnotation *base_anno, NodeID current) :
-				LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator>(base, current),
-				base_anno(base_anno) {}
+		EdgeIterator(const LinkGraph::BaseEdge *base, EdgeAnnotation *base_anno, const LinkGraph::BaseEdge *current) :
+				LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator>(current),
+				base(base), base_anno(base_anno) {}
 
 		/**
 		 * Dereference.
@@ -164,7 +145,7 @@ public:
 		 */
 		SmallPair<NodeID, Edge> operator*() const
 		{
-			return SmallPair<NodeID, Edge>(this->current, Edge(this->base[this->current], this->base_anno[this->current]));
+			return SmallPair<NodeID, Edge>(this->current->dest_node, Edge(*this->current, this->base_anno[this->current - this->base]));
 		}
 
 		/**
@@ -185,6 +166,7 @@ public:
 	private:
 		NodeAnnotation &node_anno;  ///< Annotation being wrapped.
 		EdgeAnnotation *edge_annos; ///< Edge annotations belonging to this node.
+		DemandAnnotation *demands;  ///< Demands from this node to all others.
 	public:
 
 		/**
@@ -194,30 +176,60 @@ public:
 		 */
 		Node (LinkGraphJob *lgj, NodeID node) :
 			LinkGraph::ConstNode(&lgj->link_graph, node),
-			node_anno(lgj->nodes[node]), edge_annos(lgj->edges[node])
+			node_anno(lgj->nodes[node]), edge_annos(lgj->edges.data() + lgj->first_edge[node]),
+			demands(lgj->demands[node])
 		{}
 
 		/**
 		 * Retrieve an edge starting at this node. Mind that this returns an
-		 * object, not a reference.
+		 * object, not a reference. The edge has to exist.
 		 * @param to Remote end of the edge.
 		 * @return Edge between this node and "to".
 		 */
-		Edge operator[](NodeID to) const { return Edge(this->edges[to], this->edge_annos[to]); }
+		Edge operator[](NodeID to) const
+		{
+			uint pos = LinkGraph::FindEdge(this->edges, to);
+			assert(LinkGraph::IsEdgeAt(this->edges, pos, to));
+			return Edge(this->edges[pos], this->edge_annos[pos]);
+		}
 
 		/**
-		 * Iterator for the "begin" of the edge array. Only edges with capacity
-		 * are iterated. The others are skipped.
+		 * Iterator for the first edge of the node.
 		 * @return Iterator pointing to the first edge.
 		 */
-		EdgeIterator Begin() const { return EdgeIterator(this->edges, this->edge_annos, index); }
+		EdgeIterator Begin() const { return EdgeIterator(this->edges.data(), this->edge_annos, this->edges.data()); }
 
 		/**
-		 * Iterator for the "end" of the edge array. Only edges with capacity
-		 * are iterated. The others are skipped.
+		 * Iterator for the end of the node's edges.
 		 * @return Iterator pointing beyond the last edge.
 		 */
-		EdgeIterator End() const { return EdgeIterator(this->edges, this->edge_annos, INVALID_NODE); }
+		EdgeIterator End() const { return EdgeIterator(this->edges.data(), this->edge_annos, this->edges.data() + this->edges.size()); }
+
+		/**
+		 * Get the transport demand from this node to another one.
+		 * @param to Remote node.
+		 * @return Demand.
+		 */
+		uint DemandTo(NodeID to) const { return this->demands[to].demand; }
+
+		/**
+		 * Get the transport demand from this node to another one that hasn't
+		 * been satisfied by flows, yet.
+		 * @param to Remote node.
+		 * @return Unsatisfied demand.
+		 */
+		uint UnsatisfiedDemandTo(NodeID to) const { return this->demands[to].unsatisfied_demand; }
+
+		/**
+		 * Satisfy some demand from this node to another one.
+		 * @param to Remote node.
+		 * @param demand Demand to be satisfied.
+		 */
+		void SatisfyDemandTo(NodeID to, uint demand)
+		{
+			assert(demand <= this->demands[to].unsatisfied_demand);
+			this->demands[to].unsatisfied_demand -= demand;
+		}
 
 		/**
 		 * Get amount of supply that hasn't been delivered, yet.
@@ -251,14 +263,16 @@ public:
 		const PathList &Paths() const { return this->node_anno.paths; }
 
 		/**
-		 * Deliver some supply, adding demand to the respective edge.
+		 * Deliver some supply, adding (not yet satisfied) demand to the
+		 * respective pair of nodes.
 		 * @param to Destination for supply.
 		 * @param amount Amount of supply to be delivered.
 		 */
 		void DeliverSupply(NodeID to, uint amount)
 		{
 			this->node_anno.undelivered_supply -= amount;
-			(*this)[to].AddDemand(amount);
+			this->demands[to].demand += amount;
+			this->demands[to].unsatisfied_demand += amount;
 		}
 	};
 
@@ -266,8 +280,7 @@ public:
 	 * Bare constructor, only for save/load. link_graph, join_date and actually
 	 * settings have to be brutally const-casted in order to populate them.
 	 */
-	LinkGraphJob() : settings(_settings_game.linkgraph), thread(NULL),
-			join_date(INVALID_DATE) {}
+	LinkGraphJob() : settings(_settings_game.linkgraph), join_date(INVALID_DATE) {}
 
 	LinkGraphJob(const LinkGraph &orig);
 	~LinkGraphJob();
@@ -16,6 +16,7 @@
 #include "mcf.h"
 #include "flowmapper.h"
 #include "../framerate_type.h"
+#include "../debug.h"
 
 #include "../safeguards.h"
 
@@ -60,7 +61,8 @@ void LinkGraphSchedule::JoinNext()
 	if (!next->IsFinished()) return;
 	this->running.pop_front();
 	LinkGraphID id = next->LinkGraphIndex();
-	delete next; // implicitly joins the thread
+	if (!next->ticket.IsDone()) DEBUG(misc, 1, "Link graph job %u is not finished in time, the game has to wait for it", next->index);
+	delete next; // implicitly joins the job
 	if (LinkGraph::IsValidID(id)) {
 		LinkGraph *lg = LinkGraph::Get(id);
 		this->Unqueue(lg); // Unqueue to avoid double-queueing recycled IDs.
@@ -70,7 +72,7 @@ void LinkGraphSchedule::JoinNext()
 
 /**
  * Run all handlers for the given Job. This method is tailored to
- * ThreadObject::New.
+ * WorkerPool::Submit.
  * @param j Pointer to a link graph job.
  */
 /* static */ void LinkGraphSchedule::Run(void *j)
@@ -82,8 +84,8 @@ void LinkGraphSchedule::JoinNext()
 }
 
 /**
- * Start all threads in the running list. This is only useful for save/load.
- * Usually threads are started when the job is created.
+ * Queue all jobs in the running list in the worker pool. This is only useful
+ * for save/load. Usually jobs are queued when they are created.
  */
 void LinkGraphSchedule::SpawnAll()
 {
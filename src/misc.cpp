@@ -31,6 +31,8 @@
 #include "station_kdtree.h"
 #include "town_kdtree.h"
 #include "viewport_kdtree.h"
+#include "pathfinder/water_regions.h"
+#include "pathfinder/yapf/yapf_road_cache.h"
 
 #include "safeguards.h"
 
@@ -62,6 +64,8 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settin
 	UnInitWindowSystem();
 
 	AllocateMap(size_x, size_y);
+	InitializeWaterRegions();
+	InitializeRoadRouteCache();
 
 	_pause_mode = PM_UNPAUSED;
 	_fast_forward = 0;
@@ -61,6 +61,7 @@ enum PacketAdminType {
 	ADMIN_PACKET_SERVER_GAMESCRIPT,      ///< The server gives the admin information from the GameScript in JSON.
 	ADMIN_PACKET_SERVER_RCON_END,        ///< The server indicates that the remote console command has completed.
 	ADMIN_PACKET_SERVER_PONG,            ///< The server replies to a ping request from the admin.
+	ADMIN_PACKET_SERVER_COMPANY_DELTA,   ///< The server gives the admin the changed economy and statistics of companies.
 
 	INVALID_ADMIN_PACKET = 0xFF,         ///< An invalid marker for admin packets.
 };
@@ -84,6 +85,7 @@ enum AdminUpdateType {
 	ADMIN_UPDATE_CMD_NAMES,       ///< The admin would like a list of all DoCommand names.
 	ADMIN_UPDATE_CMD_LOGGING,     ///< The admin would like to have DoCommand information.
 	ADMIN_UPDATE_GAMESCRIPT,      ///< The admin would like to have gamescript messages.
+	ADMIN_UPDATE_COMPANY_DELTA,   ///< Updates about the changed economy and statistics of companies.
 	ADMIN_UPDATE_END,             ///< Must ALWAYS be on the end of this list!! (period)
 };
 
@@ -99,6 +101,20 @@ enum AdminUpdateFrequency {
 };
 DECLARE_ENUM_AS_BIT_SET(AdminUpdateFrequency)
 
+/** Fields of a company in #ADMIN_PACKET_SERVER_COMPANY_DELTA; the bits of its field mask. */
+enum AdminCompanyDeltaField {
+	ADMIN_CDF_MONEY,           ///< uint64 Money.
+	ADMIN_CDF_LOAN,            ///< uint64 Loan.
+	ADMIN_CDF_INCOME,          ///< int64 Income.
+	ADMIN_CDF_DELIVERED_CARGO, ///< uint16 Delivered cargo (this quarter).
+	ADMIN_CDF_VALUE,           ///< uint64 Company value (last quarter).
+	ADMIN_CDF_PERFORMANCE,     ///< uint16 Performance (last quarter).
+	ADMIN_CDF_VEHICLES,        ///< 5x uint16 Number of trains, lorries, busses, planes and ships.
+	ADMIN_CDF_STATIONS,        ///< 5x uint16 Number of train stations, lorry stations, bus stops, airports and harbours.
+
+	ADMIN_CDF_END,             ///< Sentinel for end.
+};
+
 /** Reasons for removing a company - communicated to admins. */
 enum AdminCompanyRemoveReason {
 	ADMIN_CRR_MANUAL,    ///< The company is manually removed.
@@ -479,6 +495,22 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_SERVER_RCON_END(Packet *p);
 
+	/**
+	 * Changed economy and statistics of the companies since the previous
+	 * update of the same frequency:
+	 * bool    Whether this is a complete update; companies not in it do not exist.
+	 * Then for every company that changed:
+	 * bool    Data to follow.
+	 * uint8   ID of the company.
+	 * uint16  Mask of the fields that follow (see #AdminCompanyDeltaField), 0 if the company was removed.
+	 * ...     The new value of every field in the mask, in the order of the bits.
+	 * Finally:
+	 * bool    No more data.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_COMPANY_DELTA(Packet *p);
+
 	NetworkRecvStatus HandlePacket(Packet *p);
 public:
 	NetworkRecvStatus CloseConnection(bool error = true) override;
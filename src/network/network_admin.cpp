@@ -54,10 +54,92 @@ static const AdminUpdateFrequency _admin_update_type_frequencies[] = {
 	ADMIN_FREQUENCY_POLL,                                                                                                                                  ///< ADMIN_UPDATE_CMD_NAMES
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_CMD_LOGGING
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_GAMESCRIPT
+	ADMIN_FREQUENCY_POLL | ADMIN_FREQUENCY_DAILY | ADMIN_FREQUENCY_WEEKLY | ADMIN_FREQUENCY_MONTHLY | ADMIN_FREQUENCY_QUARTERLY | ADMIN_FREQUENCY_ANUALLY, ///< ADMIN_UPDATE_COMPANY_DELTA
 };
 /** Sanity check. */
 assert_compile(lengthof(_admin_update_type_frequencies) == ADMIN_UPDATE_END);
 
+/**
+ * Packets that are serialised once and then queued for any number of admins,
+ * so an update going to several admins is only built once.
+ */
+class AdminPacketBatch {
+	std::vector<Packet *> packets; ///< The packets, in the order they are sent.
+
+public:
+	AdminPacketBatch() {}
+	AdminPacketBatch(const AdminPacketBatch &) = delete;
+	AdminPacketBatch &operator=(const AdminPacketBatch &) = delete;
+
+	~AdminPacketBatch()
+	{
+		for (Packet *p : this->packets) delete p;
+	}
+
+	/**
+	 * Whether no packets have been added to the batch.
+	 * @return True if the batch is empty.
+	 */
+	inline bool IsEmpty() const
+	{
+		return this->packets.empty();
+	}
+
+	/**
+	 * Add a packet to the batch; the batch becomes its owner.
+	 * @param p The packet to add.
+	 */
+	inline void Add(Packet *p)
+	{
+		this->packets.push_back(p);
+	}
+
+	void SendTo(ServerNetworkAdminSocketHandler *as) const;
+};
+
+/**
+ * Queue copies of the packets of the batch for an admin.
+ * @param as The admin to send the packets to.
+ */
+void AdminPacketBatch::SendTo(ServerNetworkAdminSocketHandler *as) const
+{
+	for (const Packet *p : this->packets) {
+		Packet *copy = new Packet((PacketType)p->buffer[sizeof(PacketSize)]);
+		memcpy(copy->buffer, p->buffer, p->size);
+		copy->size = p->size;
+		as->SendPacket(copy);
+	}
+}
+
+/** The economy and statistics of a company as sent in ADMIN_PACKET_SERVER_COMPANY_DELTA. */
+struct AdminCompanyState {
+	bool valid;                          ///< Whether the company exists.
+	uint64 money;                        ///< #ADMIN_CDF_MONEY
+	uint64 loan;                         ///< #ADMIN_CDF_LOAN
+	int64 income;                        ///< #ADMIN_CDF_INCOME
+	uint16 delivered_cargo;              ///< #ADMIN_CDF_DELIVERED_CARGO
+	uint64 value;                        ///< #ADMIN_CDF_VALUE
+	uint16 performance;                  ///< #ADMIN_CDF_PERFORMANCE
+	uint16 num_vehicle[NETWORK_VEH_END]; ///< #ADMIN_CDF_VEHICLES
+	uint16 num_station[NETWORK_VEH_END]; ///< #ADMIN_CDF_STATIONS
+};
+
+/** Number of frequencies the company delta can be sent at, daily up to annually. */
+static const uint ADMIN_DELTA_FREQUENCIES = 5;
+
+/** Largest size of a single company in ADMIN_PACKET_SERVER_COMPANY_DELTA. */
+static const uint ADMIN_COMPANY_DELTA_SIZE = 1 + 1 + 2 + 8 + 8 + 8 + 2 + 8 + 2 + 2 * NETWORK_VEH_END * sizeof(uint16);
+/** The company delta of all companies always fits in one packet. */
+assert_compile(sizeof(PacketSize) + 1 + 1 + MAX_COMPANIES * ADMIN_COMPANY_DELTA_SIZE + 1 <= SEND_MTU);
+
+/** The state of the companies the admins know per frequency of the company delta. */
+static AdminCompanyState _admin_company_delta_base[ADMIN_DELTA_FREQUENCIES][MAX_COMPANIES];
+
+/** Companies of which an update has to be sent to the admins. */
+static CompanyMask _admin_company_update_pending = 0;
+
+static void NetworkAdminFlushCompanyUpdates();
+
 /**
  * Create a new socket for the server side of the admin network.
  * @param s The socket to connect with.
@@ -67,6 +149,7 @@ ServerNetworkAdminSocketHandler::ServerNetworkAdminSocketHandler(SOCKET s) : Net
 	_network_admins_connected++;
 	this->status = ADMIN_STATUS_INACTIVE;
 	this->realtime_connect = _realtime_tick;
+	this->company_delta_full = true;
 }
 
 /**
@@ -96,6 +179,8 @@ ServerNetworkAdminSocketHandler::~ServerNetworkAdminSocketHandler()
 /** Send the packets for the server sockets. */
 /* static */ void ServerNetworkAdminSocketHandler::Send()
 {
+	NetworkAdminFlushCompanyUpdates();
+
 	ServerNetworkAdminSocketHandler *as;
 	FOR_ALL_ADMIN_SOCKETS(as) {
 		if (as->status == ADMIN_STATUS_INACTIVE && as->realtime_connect + ADMIN_AUTHORISATION_TIMEOUT < _realtime_tick) {
@@ -182,6 +267,9 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendWelcome()
 
 	this->SendPacket(p);
 
+	/* This might be a new game, so whatever the admin knows about the companies is void. */
+	this->company_delta_full = true;
+
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
@@ -201,41 +289,60 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendShutdown()
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
-/** Tell the admin the date. */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendDate()
+/**
+ * Create the packet telling the date.
+ * @return The packet.
+ */
+static Packet *MakeDatePacket()
 {
 	Packet *p = new Packet(ADMIN_PACKET_SERVER_DATE);
 
 	p->Send_uint32(_date);
-	this->SendPacket(p);
+
+	return p;
+}
+
+/** Tell the admin the date. */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendDate()
+{
+	this->SendPacket(MakeDatePacket());
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
 /**
- * Tell the admin that a client joined.
+ * Create the packet telling that a client joined.
  * @param client_id The client that joined.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientJoin(ClientID client_id)
+static Packet *MakeClientJoinPacket(ClientID client_id)
 {
 	Packet *p = new Packet(ADMIN_PACKET_SERVER_CLIENT_JOIN);
 
 	p->Send_uint32(client_id);
-	this->SendPacket(p);
+
+	return p;
+}
+
+/**
+ * Tell the admin that a client joined.
+ * @param client_id The client that joined.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientJoin(ClientID client_id)
+{
+	this->SendPacket(MakeClientJoinPacket(client_id));
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
 /**
- * Send an initial set of data from some client's information.
+ * Create the packet with an initial set of data from some client's information.
  * @param cs The socket of the client.
  * @param ci The information about the client.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientInfo(const NetworkClientSocket *cs, const NetworkClientInfo *ci)
+static Packet *MakeClientInfoPacket(const NetworkClientSocket *cs, const NetworkClientInfo *ci)
 {
-	/* Only send data when we're a proper client, not just someone trying to query the server. */
-	if (ci == NULL) return NETWORK_RECV_STATUS_OKAY;
-
 	Packet *p = new Packet(ADMIN_PACKET_SERVER_CLIENT_INFO);
 
 	p->Send_uint32(ci->client_id);
@@ -245,17 +352,31 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientInfo(const NetworkC
 	p->Send_uint32(ci->join_date);
 	p->Send_uint8 (ci->client_playas);
 
-	this->SendPacket(p);
+	return p;
+}
+
+/**
+ * Send an initial set of data from some client's information.
+ * @param cs The socket of the client.
+ * @param ci The information about the client.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientInfo(const NetworkClientSocket *cs, const NetworkClientInfo *ci)
+{
+	/* Only send data when we're a proper client, not just someone trying to query the server. */
+	if (ci == NULL) return NETWORK_RECV_STATUS_OKAY;
+
+	this->SendPacket(MakeClientInfoPacket(cs, ci));
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
 
 /**
- * Send an update for some client's information.
+ * Create the packet with an update for some client's information.
  * @param ci The information about a client.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientUpdate(const NetworkClientInfo *ci)
+static Packet *MakeClientUpdatePacket(const NetworkClientInfo *ci)
 {
 	Packet *p = new Packet(ADMIN_PACKET_SERVER_CLIENT_UPDATE);
 
@@ -263,60 +384,103 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientUpdate(const Networ
 	p->Send_string(ci->client_name);
 	p->Send_uint8 (ci->client_playas);
 
-	this->SendPacket(p);
+	return p;
+}
+
+/**
+ * Send an update for some client's information.
+ * @param ci The information about a client.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientUpdate(const NetworkClientInfo *ci)
+{
+	this->SendPacket(MakeClientUpdatePacket(ci));
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
 /**
- * Tell the admin that a client quit.
+ * Create the packet telling that a client quit.
  * @param client_id The client that quit.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientQuit(ClientID client_id)
+static Packet *MakeClientQuitPacket(ClientID client_id)
 {
 	Packet *p = new Packet(ADMIN_PACKET_SERVER_CLIENT_QUIT);
 
 	p->Send_uint32(client_id);
-	this->SendPacket(p);
+
+	return p;
+}
+
+/**
+ * Tell the admin that a client quit.
+ * @param client_id The client that quit.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientQuit(ClientID client_id)
+{
+	this->SendPacket(MakeClientQuitPacket(client_id));
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
 /**
- * Tell the admin that a client made an error.
+ * Create the packet telling that a client made an error.
  * @param client_id The client that made the error.
  * @param error The error that was made.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientError(ClientID client_id, NetworkErrorCode error)
+static Packet *MakeClientErrorPacket(ClientID client_id, NetworkErrorCode error)
 {
 	Packet *p = new Packet(ADMIN_PACKET_SERVER_CLIENT_ERROR);
 
 	p->Send_uint32(client_id);
 	p->Send_uint8 (error);
-	this->SendPacket(p);
+
+	return p;
+}
+
+/**
+ * Tell the admin that a client made an error.
+ * @param client_id The client that made the error.
+ * @param error The error that was made.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendClientError(ClientID client_id, NetworkErrorCode error)
+{
+	this->SendPacket(MakeClientErrorPacket(client_id, error));
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
 /**
- * Tell the admin that a new company was founded.
+ * Create the packet telling that a new company was founded.
  * @param company_id The company that was founded.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyNew(CompanyID company_id)
+static Packet *MakeCompanyNewPacket(CompanyID company_id)
 {
 	Packet *p = new Packet(ADMIN_PACKET_SERVER_COMPANY_NEW);
 	p->Send_uint8(company_id);
 
-	this->SendPacket(p);
+	return p;
+}
+
+/**
+ * Tell the admin that a new company was founded.
+ * @param company_id The company that was founded.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyNew(CompanyID company_id)
+{
+	this->SendPacket(MakeCompanyNewPacket(company_id));
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
 /**
- * Send the admin some information about a company.
+ * Create the packet with some information about a company.
  * @param c The company to send the information about.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyInfo(const Company *c)
+static Packet *MakeCompanyInfoPacket(const Company *c)
 {
 	char company_name[NETWORK_COMPANY_NAME_LENGTH];
 	char manager_name[NETWORK_COMPANY_NAME_LENGTH];
@@ -342,17 +506,27 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyInfo(const Company
 		p->Send_uint8(c->share_owners[i]);
 	}
 
-	this->SendPacket(p);
+	return p;
+}
+
+/**
+ * Send the admin some information about a company.
+ * @param c The company to send the information about.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyInfo(const Company *c)
+{
+	this->SendPacket(MakeCompanyInfoPacket(c));
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
 
 /**
- * Send an update about a company.
+ * Create the packet with an update about a company.
  * @param c The company to send the update of.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyUpdate(const Company *c)
+static Packet *MakeCompanyUpdatePacket(const Company *c)
 {
 	char company_name[NETWORK_COMPANY_NAME_LENGTH];
 	char manager_name[NETWORK_COMPANY_NAME_LENGTH];
@@ -376,38 +550,72 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyUpdate(const Compa
 		p->Send_uint8(c->share_owners[i]);
 	}
 
-	this->SendPacket(p);
+	return p;
+}
+
+/**
+ * Send an update about a company.
+ * @param c The company to send the update of.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyUpdate(const Company *c)
+{
+	this->SendPacket(MakeCompanyUpdatePacket(c));
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
 /**
- * Tell the admin that a company got removed.
+ * Create the packet telling that a company got removed.
  * @param company_id The company that got removed.
  * @param acrr The reason for removal, e.g. bankruptcy or merger.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyRemove(CompanyID company_id, AdminCompanyRemoveReason acrr)
+static Packet *MakeCompanyRemovePacket(CompanyID company_id, AdminCompanyRemoveReason acrr)
 {
 	Packet *p = new Packet(ADMIN_PACKET_SERVER_COMPANY_REMOVE);
 
 	p->Send_uint8(company_id);
 	p->Send_uint8(acrr);
 
-	this->SendPacket(p);
+	return p;
+}
+
+/**
+ * Tell the admin that a company got removed.
+ * @param company_id The company that got removed.
+ * @param acrr The reason for removal, e.g. bankruptcy or merger.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyRemove(CompanyID company_id, AdminCompanyRemoveReason acrr)
+{
+	this->SendPacket(MakeCompanyRemovePacket(company_id, acrr));
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
-/** Send economic information of all companies. */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyEconomy()
+/**
+ * Get the income of a company in the current year.
+ * @param c The company to get the income of.
+ * @return The income.
+ */
+static Money GetCompanyIncome(const Company *c)
+{
+	Money income = 0;
+	for (uint i = 0; i < lengthof(c->yearly_expenses[0]); i++) {
+		income -= c->yearly_expenses[0][i];
+	}
+	return income;
+}
+
+/**
+ * Create the packets with economic information of all companies.
+ * @param batch The batch to add the packets to.
+ */
+static void MakeCompanyEconomyPackets(AdminPacketBatch &batch)
 {
 	const Company *company;
 	FOR_ALL_COMPANIES(company) {
 		/* Get the income. */
-		Money income = 0;
-		for (uint i = 0; i < lengthof(company->yearly_expenses[0]); i++) {
-			income -= company->yearly_expenses[0][i];
-		}
+		Money income = GetCompanyIncome(company);
 
 		Packet *p = new Packet(ADMIN_PACKET_SERVER_COMPANY_ECONOMY);
 
@@ -426,20 +634,27 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyEconomy()
 			p->Send_uint16(min(UINT16_MAX, company->old_economy[i].delivered_cargo.GetSum<OverflowSafeInt64>()));
 		}
 
-		this->SendPacket(p);
+		batch.Add(p);
 	}
+}
 
+/** Send economic information of all companies. */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyEconomy()
+{
+	AdminPacketBatch batch;
+	MakeCompanyEconomyPackets(batch);
+	batch.SendTo(this);
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
-/** Send statistics about the companies. */
-NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyStats()
+/**
+ * Create the packets with statistics about the companies.
+ * @param batch The batch to add the packets to.
+ * @param company_stats The statistics of all companies.
+ */
+static void MakeCompanyStatsPackets(AdminPacketBatch &batch, const NetworkCompanyStats *company_stats)
 {
-	/* Fetch the latest version of the stats. */
-	NetworkCompanyStats company_stats[MAX_COMPANIES];
-	NetworkPopulateCompanyStats(company_stats);
-
 	const Company *company;
 
 	/* Go through all the companies. */
@@ -457,8 +672,123 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyStats()
 			p->Send_uint16(company_stats[company->index].num_station[i]);
 		}
 
-		this->SendPacket(p);
+		batch.Add(p);
 	}
+}
+
+/** Send statistics about the companies. */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyStats()
+{
+	/* Fetch the latest version of the stats. */
+	NetworkCompanyStats company_stats[MAX_COMPANIES];
+	NetworkPopulateCompanyStats(company_stats);
+
+	AdminPacketBatch batch;
+	MakeCompanyStatsPackets(batch, company_stats);
+	batch.SendTo(this);
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
+/**
+ * Get the current state of all companies as sent in ADMIN_PACKET_SERVER_COMPANY_DELTA.
+ * @param states Output array with the state of each company ID.
+ * @param company_stats The statistics of all companies.
+ */
+static void GetAdminCompanyStates(AdminCompanyState *states, const NetworkCompanyStats *company_stats)
+{
+	memset(states, 0, sizeof(*states) * MAX_COMPANIES);
+
+	const Company *company;
+	FOR_ALL_COMPANIES(company) {
+		AdminCompanyState &state = states[company->index];
+		state.valid = true;
+		state.money = company->money;
+		state.loan = company->current_loan;
+		state.income = GetCompanyIncome(company);
+		state.delivered_cargo = min(UINT16_MAX, company->cur_economy.delivered_cargo.GetSum<OverflowSafeInt64>());
+		state.value = company->old_economy[0].company_value;
+		state.performance = company->old_economy[0].performance_history;
+		MemCpyT(state.num_vehicle, company_stats[company->index].num_vehicle, NETWORK_VEH_END);
+		MemCpyT(state.num_station, company_stats[company->index].num_station, NETWORK_VEH_END);
+	}
+}
+
+/**
+ * Create the packet with the changed fields of the companies.
+ * @param cur The current state of the companies.
+ * @param base The state of the companies the admins already know, or NULL to send everything.
+ * @return The packet, or NULL when nothing changed.
+ */
+static Packet *MakeCompanyDeltaPacket(const AdminCompanyState *cur, const AdminCompanyState *base)
+{
+	Packet *p = new Packet(ADMIN_PACKET_SERVER_COMPANY_DELTA);
+	p->Send_bool(base == NULL);
+
+	bool changed = base == NULL;
+	for (uint c = 0; c < MAX_COMPANIES; c++) {
+		const AdminCompanyState &s = cur[c];
+		uint16 fields = 0;
+		if (base == NULL || !base[c].valid) {
+			if (!s.valid) continue;
+			fields = (1 << ADMIN_CDF_END) - 1;
+		} else if (s.valid) {
+			const AdminCompanyState &b = base[c];
+			if (s.money != b.money) SetBit(fields, ADMIN_CDF_MONEY);
+			if (s.loan != b.loan) SetBit(fields, ADMIN_CDF_LOAN);
+			if (s.income != b.income) SetBit(fields, ADMIN_CDF_INCOME);
+			if (s.delivered_cargo != b.delivered_cargo) SetBit(fields, ADMIN_CDF_DELIVERED_CARGO);
+			if (s.value != b.value) SetBit(fields, ADMIN_CDF_VALUE);
+			if (s.performance != b.performance) SetBit(fields, ADMIN_CDF_PERFORMANCE);
+			if (memcmp(s.num_vehicle, b.num_vehicle, sizeof(s.num_vehicle)) != 0) SetBit(fields, ADMIN_CDF_VEHICLES);
+			if (memcmp(s.num_station, b.num_station, sizeof(s.num_station)) != 0) SetBit(fields, ADMIN_CDF_STATIONS);
+			if (fields == 0) continue;
+		}
+		/* A company that has been removed is sent with an empty field mask. */
+
+		changed = true;
+		p->Send_bool  (true);
+		p->Send_uint8 (c);
+		p->Send_uint16(fields);
+		if (HasBit(fields, ADMIN_CDF_MONEY)) p->Send_uint64(s.money);
+		if (HasBit(fields, ADMIN_CDF_LOAN)) p->Send_uint64(s.loan);
+		if (HasBit(fields, ADMIN_CDF_INCOME)) p->Send_uint64(s.income);
+		if (HasBit(fields, ADMIN_CDF_DELIVERED_CARGO)) p->Send_uint16(s.delivered_cargo);
+		if (HasBit(fields, ADMIN_CDF_VALUE)) p->Send_uint64(s.value);
+		if (HasBit(fields, ADMIN_CDF_PERFORMANCE)) p->Send_uint16(s.performance);
+		if (HasBit(fields, ADMIN_CDF_VEHICLES)) {
+			for (uint i = 0; i < NETWORK_VEH_END; i++) p->Send_uint16(s.num_vehicle[i]);
+		}
+		if (HasBit(fields, ADMIN_CDF_STATIONS)) {
+			for (uint i = 0; i < NETWORK_VEH_END; i++) p->Send_uint16(s.num_station[i]);
+		}
+	}
+
+	if (!changed) {
+		delete p;
+		return NULL;
+	}
+
+	p->Send_bool(false);
+	return p;
+}
+
+/**
+ * Send the complete economy and statistics of the companies in the format
+ * of the company delta. As the admin might now know values that are newer
+ * than those of the other admins at its frequency, its next periodic update
+ * is a complete one as well.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCompanyDeltaFull()
+{
+	NetworkCompanyStats company_stats[MAX_COMPANIES];
+	NetworkPopulateCompanyStats(company_stats);
+
+	AdminCompanyState states[MAX_COMPANIES];
+	GetAdminCompanyStates(states, company_stats);
+
+	this->SendPacket(MakeCompanyDeltaPacket(states, NULL));
+	this->company_delta_full = true;
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
@@ -712,6 +1042,15 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_UPDATE_FREQUENC
 		return this->SendError(NETWORK_ERROR_ILLEGAL_PACKET);
 	}
 
+	if (type == ADMIN_UPDATE_COMPANY_DELTA) {
+		/* The delta is relative to the previous update of the same frequency, so only one can be tracked. */
+		if (CountBits(freq & ~ADMIN_FREQUENCY_POLL) > 1) {
+			DEBUG(net, 3, "[admin] Not supported update frequency %d (%d) from '%s' (%s).", type, freq, this->admin_name, this->admin_version);
+			return this->SendError(NETWORK_ERROR_ILLEGAL_PACKET);
+		}
+		this->company_delta_full = true;
+	}
+
 	this->update_frequency[type] = freq;
 
 	return NETWORK_RECV_STATUS_OKAY;
@@ -771,6 +1110,11 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_POLL(Packet *p)
 			this->SendCompanyStats();
 			break;
 
+		case ADMIN_UPDATE_COMPANY_DELTA:
+			/* The admin is requesting all economy and statistics of the companies. */
+			this->SendCompanyDeltaFull();
+			break;
+
 		case ADMIN_UPDATE_CMD_NAMES:
 			/* The admin is requesting the names of DoCommands. */
 			this->SendCmdNames();
@@ -823,13 +1167,16 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_CHAT(Packet *p)
  */
 void NetworkAdminClientInfo(const NetworkClientSocket *cs, bool new_client)
 {
+	AdminPacketBatch batch;
 	ServerNetworkAdminSocketHandler *as;
 	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
 		if (as->update_frequency[ADMIN_UPDATE_CLIENT_INFO] & ADMIN_FREQUENCY_AUTOMATIC) {
-			as->SendClientInfo(cs, cs->GetInfo());
-			if (new_client) {
-				as->SendClientJoin(cs->client_id);
+			if (batch.IsEmpty()) {
+				if (cs->GetInfo() != NULL) batch.Add(MakeClientInfoPacket(cs, cs->GetInfo()));
+				if (new_client) batch.Add(MakeClientJoinPacket(cs->client_id));
+				if (batch.IsEmpty()) return;
 			}
+			batch.SendTo(as);
 		}
 	}
 }
@@ -840,10 +1187,12 @@ void NetworkAdminClientInfo(const NetworkClientSocket *cs, bool new_client)
  */
 void NetworkAdminClientUpdate(const NetworkClientInfo *ci)
 {
+	AdminPacketBatch batch;
 	ServerNetworkAdminSocketHandler *as;
 	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
 		if (as->update_frequency[ADMIN_UPDATE_CLIENT_INFO] & ADMIN_FREQUENCY_AUTOMATIC) {
-			as->SendClientUpdate(ci);
+			if (batch.IsEmpty()) batch.Add(MakeClientUpdatePacket(ci));
+			batch.SendTo(as);
 		}
 	}
 }
@@ -854,10 +1203,12 @@ void NetworkAdminClientUpdate(const NetworkClientInfo *ci)
  */
 void NetworkAdminClientQuit(ClientID client_id)
 {
+	AdminPacketBatch batch;
 	ServerNetworkAdminSocketHandler *as;
 	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
 		if (as->update_frequency[ADMIN_UPDATE_CLIENT_INFO] & ADMIN_FREQUENCY_AUTOMATIC) {
-			as->SendClientQuit(client_id);
+			if (batch.IsEmpty()) batch.Add(MakeClientQuitPacket(client_id));
+			batch.SendTo(as);
 		}
 	}
 }
@@ -869,12 +1220,41 @@ void NetworkAdminClientQuit(ClientID client_id)
  */
 void NetworkAdminClientError(ClientID client_id, NetworkErrorCode error_code)
 {
+	AdminPacketBatch batch;
 	ServerNetworkAdminSocketHandler *as;
 	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
 		if (as->update_frequency[ADMIN_UPDATE_CLIENT_INFO] & ADMIN_FREQUENCY_AUTOMATIC) {
-			as->SendClientError(client_id, error_code);
+			if (batch.IsEmpty()) batch.Add(MakeClientErrorPacket(client_id, error_code));
+			batch.SendTo(as);
+		}
+	}
+}
+
+/**
+ * Send the company updates that have been collected since the last time.
+ * Several changes to a company within the same tick result in one update.
+ */
+static void NetworkAdminFlushCompanyUpdates()
+{
+	if (_admin_company_update_pending == 0) return;
+
+	AdminPacketBatch batch;
+	ServerNetworkAdminSocketHandler *as;
+	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
+		if (as->update_frequency[ADMIN_UPDATE_COMPANY_INFO] != ADMIN_FREQUENCY_AUTOMATIC) continue;
+
+		if (batch.IsEmpty()) {
+			uint company_id;
+			FOR_EACH_SET_BIT(company_id, _admin_company_update_pending) {
+				const Company *c = Company::GetIfValid(company_id);
+				if (c != NULL) batch.Add(MakeCompanyUpdatePacket(c));
+			}
+			if (batch.IsEmpty()) break;
 		}
+		batch.SendTo(as);
 	}
+
+	_admin_company_update_pending = 0;
 }
 
 /**
@@ -889,31 +1269,31 @@ void NetworkAdminCompanyInfo(const Company *company, bool new_company)
 		return;
 	}
 
+	NetworkAdminFlushCompanyUpdates();
+
+	AdminPacketBatch batch;
 	ServerNetworkAdminSocketHandler *as;
 	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
 		if (as->update_frequency[ADMIN_UPDATE_COMPANY_INFO] != ADMIN_FREQUENCY_AUTOMATIC) continue;
 
-		as->SendCompanyInfo(company);
-		if (new_company) {
-			as->SendCompanyNew(company->index);
+		if (batch.IsEmpty()) {
+			batch.Add(MakeCompanyInfoPacket(company));
+			if (new_company) batch.Add(MakeCompanyNewPacket(company->index));
 		}
+		batch.SendTo(as);
 	}
 }
 
 /**
- * Notify the admin network of company updates.
+ * Notify the admin network of company updates. The update is sent once the
+ * current tick is done, so a burst of changes only results in one update.
  * @param company company of which updates are going to be sent into the admin network.
  */
 void NetworkAdminCompanyUpdate(const Company *company)
 {
 	if (company == NULL) return;
 
-	ServerNetworkAdminSocketHandler *as;
-	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
-		if (as->update_frequency[ADMIN_UPDATE_COMPANY_INFO] != ADMIN_FREQUENCY_AUTOMATIC) continue;
-
-		as->SendCompanyUpdate(company);
-	}
+	SetBit(_admin_company_update_pending, company->index);
 }
 
 /**
@@ -923,9 +1303,13 @@ void NetworkAdminCompanyUpdate(const Company *company)
  */
 void NetworkAdminCompanyRemove(CompanyID company_id, AdminCompanyRemoveReason bcrr)
 {
+	NetworkAdminFlushCompanyUpdates();
+
+	AdminPacketBatch batch;
 	ServerNetworkAdminSocketHandler *as;
 	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
-		as->SendCompanyRemove(company_id, bcrr);
+		if (batch.IsEmpty()) batch.Add(MakeCompanyRemovePacket(company_id, bcrr));
+		batch.SendTo(as);
 	}
 }
 
@@ -1015,26 +1399,65 @@ void ServerNetworkAdminSocketHandler::WelcomeAll()
 
 /**
  * Send (push) updates to the admin network as they have registered for these updates.
+ * Every update is only built once and then queued for all admins that want it.
  * @param freq the frequency to be processed.
  */
 void NetworkAdminUpdate(AdminUpdateFrequency freq)
 {
+	assert(CountBits(freq) == 1 && freq >= ADMIN_FREQUENCY_DAILY && freq <= ADMIN_FREQUENCY_ANUALLY);
+
+	/* Find out which updates have to be built at all. */
+	uint32 types = 0;
 	ServerNetworkAdminSocketHandler *as;
+	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
+		for (int i = 0; i < ADMIN_UPDATE_END; i++) {
+			if (as->update_frequency[i] & freq) SetBit(types, i);
+		}
+	}
+	if (types == 0) return;
+
+	NetworkCompanyStats company_stats[MAX_COMPANIES];
+	if (HasBit(types, ADMIN_UPDATE_COMPANY_STATS) || HasBit(types, ADMIN_UPDATE_COMPANY_DELTA)) {
+		NetworkPopulateCompanyStats(company_stats);
+	}
+
+	AdminPacketBatch batches[ADMIN_UPDATE_END];
+	if (HasBit(types, ADMIN_UPDATE_DATE)) batches[ADMIN_UPDATE_DATE].Add(MakeDatePacket());
+	if (HasBit(types, ADMIN_UPDATE_COMPANY_ECONOMY)) MakeCompanyEconomyPackets(batches[ADMIN_UPDATE_COMPANY_ECONOMY]);
+	if (HasBit(types, ADMIN_UPDATE_COMPANY_STATS)) MakeCompanyStatsPackets(batches[ADMIN_UPDATE_COMPANY_STATS], company_stats);
+
+	/* The delta is relative to what the admins at this frequency got last time; admins
+	 * that just registered or polled get everything, everybody else only the changes. */
+	AdminPacketBatch delta_full;
+	if (HasBit(types, ADMIN_UPDATE_COMPANY_DELTA)) {
+		AdminCompanyState *base = _admin_company_delta_base[FindFirstBit(freq) - FindFirstBit(ADMIN_FREQUENCY_DAILY)];
+		AdminCompanyState states[MAX_COMPANIES];
+		GetAdminCompanyStates(states, company_stats);
+
+		Packet *p = MakeCompanyDeltaPacket(states, base);
+		if (p != NULL) batches[ADMIN_UPDATE_COMPANY_DELTA].Add(p);
+		delta_full.Add(MakeCompanyDeltaPacket(states, NULL));
+		MemCpyT(base, states, MAX_COMPANIES);
+	}
+
 	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
 		for (int i = 0; i < ADMIN_UPDATE_END; i++) {
 			if (as->update_frequency[i] & freq) {
 				/* Update the admin for the required details */
 				switch (i) {
 					case ADMIN_UPDATE_DATE:
-						as->SendDate();
-						break;
-
 					case ADMIN_UPDATE_COMPANY_ECONOMY:
-						as->SendCompanyEconomy();
+					case ADMIN_UPDATE_COMPANY_STATS:
+						batches[i].SendTo(as);
 						break;
 
-					case ADMIN_UPDATE_COMPANY_STATS:
-						as->SendCompanyStats();
+					case ADMIN_UPDATE_COMPANY_DELTA:
+						if (as->company_delta_full) {
+							delta_full.SendTo(as);
+							as->company_delta_full = false;
+						} else {
+							batches[i].SendTo(as);
+						}
 						break;
 
 					default: NOT_REACHED();
@@ -30,6 +30,8 @@
 #include "../core/pool_func.hpp"
 #include "../core/random_func.hpp"
 #include "../rev.h"
+#include "../gfx_func.h"
+#include <deque>
 
 #include "../safeguards.h"
 
@@ -52,164 +54,208 @@ INSTANTIATE_POOL_METHODS(NetworkClientSocket)
 /** Instantiate the listen sockets. */
 template SocketList TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::sockets;
 
-/** Writing a savegame directly to a number of packets. */
-struct PacketWriter : SaveFilter {
-	ServerNetworkGameSocketHandler *cs; ///< Socket we are associated with.
-	Packet *current;                    ///< The packet we're currently writing to.
-	size_t total_size;                  ///< Total size of the compressed savegame.
-	Packet *packets;                    ///< Packet queue of the savegame; send these "slowly" to the client.
-	ThreadMutex *mutex;                 ///< Mutex for making threaded saving safe.
+/**
+ * The compressed savegame that is sent to all clients that start downloading
+ * the map at the same time. It is filled by the savegame thread while the
+ * clients are already sending it. Packets are freed as soon as every client
+ * has sent them.
+ */
+struct NetworkMapSnapshot {
+	ThreadMutex *mutex;           ///< Mutex for making threaded saving safe; the one of the savegame thread, so it can wait for the clients.
+	std::deque<Packet *> packets; ///< Packets of the savegame that have not been sent to every client.
+	uint first_packet;            ///< Number of the first packet in #packets.
+	size_t buffered;              ///< Amount of savegame data in #packets.
+	size_t max_buffered;          ///< Amount of savegame data in #packets at which the saving waits for the clients.
+	size_t total_size;            ///< Total size of the compressed savegame, once finished.
+	bool finished;                ///< Whether the whole savegame has been written.
+	uint clients;                 ///< Number of clients still downloading the snapshot.
+	uint refs;                    ///< Number of clients and writers using the snapshot.
 
 	/**
-	 * Create the packet writer.
-	 * @param cs The socket handler we're making the packets for.
+	 * Create the snapshot.
+	 * @param max_buffered Amount of savegame data at which the saving waits for the clients.
 	 */
-	PacketWriter(ServerNetworkGameSocketHandler *cs) : SaveFilter(NULL), cs(cs), current(NULL), total_size(0), packets(NULL)
+	NetworkMapSnapshot(size_t max_buffered) : first_packet(0), buffered(0), max_buffered(max_buffered), total_size(0), finished(false), clients(0), refs(0)
 	{
-		this->mutex = ThreadMutex::New();
+		this->mutex = GetSaveThreadMutex();
 	}
 
 	/** Make sure everything is cleaned up. */
-	~PacketWriter()
+	~NetworkMapSnapshot()
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
+		for (std::deque<Packet *>::iterator it = this->packets.begin(); it != this->packets.end(); ++it) delete *it;
+	}
 
-		if (this->cs != NULL && this->mutex != NULL) {
-			this->mutex->WaitForSignal();
-		}
+	/** Start using the snapshot. */
+	void AddRef()
+	{
+		ThreadMutexLocker lock(this->mutex);
+		this->refs++;
+	}
 
-		/* This must all wait until the Destroy function is called. */
+	/** Stop using the snapshot; the last one to stop frees it. */
+	void Release()
+	{
+		this->mutex->BeginCritical();
+		bool last = --this->refs == 0;
+		this->mutex->EndCritical();
 
-		while (this->packets != NULL) {
-			Packet *p = this->packets->next;
-			delete this->packets;
-			this->packets = p;
-		}
+		if (last) delete this;
+	}
 
-		delete this->current;
+	/** Add a client downloading the snapshot. */
+	void AddClient()
+	{
+		ThreadMutexLocker lock(this->mutex);
+		this->clients++;
+		this->refs++;
+	}
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
+	/** Remove a client that finished or stopped downloading the snapshot. */
+	void RemoveClient()
+	{
+		this->mutex->BeginCritical();
+		this->clients--;
+		this->mutex->SendSignal();
+		this->mutex->EndCritical();
 
-		delete this->mutex;
-		this->mutex = NULL;
+		this->Release();
 	}
 
 	/**
-	 * Begin the destruction of this packet writer. It can happen in two ways:
-	 * in the first case the client disconnected while saving the map. In this
-	 * case the saving has not finished and killed this PacketWriter. In that
-	 * case we simply set cs to NULL, triggering the appending to fail due to
-	 * the connection problem and eventually triggering the destructor. In the
-	 * second case the destructor is already called, and it is waiting for our
-	 * signal which we will send. Only then the packets will be removed by the
-	 * destructor.
+	 * Get the size of the savegame.
+	 * @param[out] size The size of the savegame, if known.
+	 * @return Whether the savegame has been written completely.
 	 */
-	void Destroy()
+	bool GetTotalSize(size_t *size)
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
-
-		this->cs = NULL;
-
-		if (this->mutex != NULL) this->mutex->SendSignal();
-
-		if (this->mutex != NULL) this->mutex->EndCritical();
+		ThreadMutexLocker lock(this->mutex);
+		*size = this->total_size;
+		return this->finished;
+	}
 
-		/* Make sure the saving is completely cancelled. Yes,
-		 * we need to handle the save finish as well as the
-		 * next connection might just be requesting a map. */
-		WaitTillSaved();
-		ProcessAsyncSaveFinish();
+	/**
+	 * Check whether a packet has been written already.
+	 * @param n Number of the packet.
+	 * @return True if the packet can be sent.
+	 */
+	bool HasPacket(uint n)
+	{
+		ThreadMutexLocker lock(this->mutex);
+		assert(n >= this->first_packet);
+		return n - this->first_packet < this->packets.size();
 	}
 
 	/**
-	 * Checks whether there are packets.
-	 * It's not 100% threading safe, but this is only asked for when checking
-	 * whether there still is something to send. Then another call will be made
-	 * to actually get the Packet, which will be the only one popping packets
-	 * and thus eventually setting this on false.
+	 * Make a copy of a packet to send to a client.
+	 * @param n Number of the packet; it must have been written already.
+	 * @return The copy.
 	 */
-	bool HasPackets()
+	Packet *CopyPacket(uint n)
 	{
-		return this->packets != NULL;
+		ThreadMutexLocker lock(this->mutex);
+		assert(n >= this->first_packet && n - this->first_packet < this->packets.size());
+
+		const Packet *packet = this->packets[n - this->first_packet];
+		Packet *p = new Packet(PACKET_SERVER_MAP_DATA);
+		memcpy(p->buffer, packet->buffer, packet->size);
+		p->size = packet->size;
+		return p;
 	}
 
 	/**
-	 * Pop a single created packet from the queue with packets.
+	 * Free the packets that every client has sent.
+	 * @param n Number of the first packet that has not been sent to every client.
 	 */
-	Packet *PopPacket()
+	void FreePackets(uint n)
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
+		ThreadMutexLocker lock(this->mutex);
+		while (this->first_packet < n && !this->packets.empty()) {
+			this->buffered -= this->packets.front()->size;
+			delete this->packets.front();
+			this->packets.pop_front();
+			this->first_packet++;
+		}
+		this->mutex->SendSignal();
+	}
+};
 
-		Packet *p = this->packets;
-		this->packets = p->next;
-		p->next = NULL;
+/** Writing a savegame directly to a number of packets. */
+struct PacketWriter : SaveFilter {
+	NetworkMapSnapshot *snapshot; ///< Snapshot we are writing the packets for.
+	Packet *current;              ///< The packet we're currently writing to.
+	size_t total_size;            ///< Total size of the compressed savegame.
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
+	/**
+	 * Create the packet writer.
+	 * @param snapshot The snapshot we're making the packets for.
+	 */
+	PacketWriter(NetworkMapSnapshot *snapshot) : SaveFilter(NULL), snapshot(snapshot), current(NULL), total_size(0)
+	{
+		this->snapshot->AddRef();
+	}
 
-		return p;
+	/** Make sure everything is cleaned up. */
+	~PacketWriter()
+	{
+		delete this->current;
+		this->snapshot->Release();
 	}
 
-	/** Append the current packet to the queue. */
+	/**
+	 * Append the current packet to the snapshot. When the clients are too far
+	 * behind wait for them, unless the main thread is waiting for us.
+	 */
 	void AppendQueue()
 	{
 		if (this->current == NULL) return;
 
-		Packet **p = &this->packets;
-		while (*p != NULL) {
-			p = &(*p)->next;
+		NetworkMapSnapshot *snapshot = this->snapshot;
+		snapshot->mutex->BeginCritical();
+		while (snapshot->clients != 0 && snapshot->buffered >= snapshot->max_buffered && !IsWaitingTillSaved()) {
+			snapshot->mutex->WaitForSignal();
 		}
-		*p = this->current;
 
-		this->current = NULL;
+		bool lost = snapshot->clients == 0;
+		if (!lost) {
+			snapshot->packets.push_back(this->current);
+			snapshot->buffered += this->current->size;
+			this->current = NULL;
+		}
+		snapshot->mutex->EndCritical();
+
+		/* We want to abort the saving when nobody wants the map anymore. */
+		if (lost) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 	}
 
 	void Write(byte *buf, size_t size) override
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == NULL) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
-
-		if (this->current == NULL) this->current = new Packet(PACKET_SERVER_MAP_DATA);
-
-		if (this->mutex != NULL) this->mutex->BeginCritical();
-
 		byte *bufe = buf + size;
 		while (buf != bufe) {
+			if (this->current == NULL) this->current = new Packet(PACKET_SERVER_MAP_DATA);
+
 			size_t to_write = min(SEND_MTU - this->current->size, bufe - buf);
 			memcpy(this->current->buffer + this->current->size, buf, to_write);
 			this->current->size += (PacketSize)to_write;
 			buf += to_write;
 
-			if (this->current->size == SEND_MTU) {
-				this->AppendQueue();
-				if (buf != bufe) this->current = new Packet(PACKET_SERVER_MAP_DATA);
-			}
+			if (this->current->size == SEND_MTU) this->AppendQueue();
 		}
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
-
 		this->total_size += size;
 	}
 
 	void Finish() override
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == NULL) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
-
-		if (this->mutex != NULL) this->mutex->BeginCritical();
-
 		/* Make sure the last packet is flushed. */
 		this->AppendQueue();
 
-		/* Add a packet stating that this is the end to the queue. */
-		this->current = new Packet(PACKET_SERVER_MAP_DONE);
-		this->AppendQueue();
-
-		/* Fast-track the size to the client. */
-		Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
-		p->Send_uint32((uint32)this->total_size);
-		this->cs->NetworkTCPSocketHandler::SendPacket(p);
-
-		if (this->mutex != NULL) this->mutex->EndCritical();
+		/* Add a packet stating that this is the end to the queue; together with
+		 * the size, so the size can always be sent before the end. */
+		ThreadMutexLocker lock(this->snapshot->mutex);
+		this->snapshot->packets.push_back(new Packet(PACKET_SERVER_MAP_DONE));
+		this->snapshot->total_size = this->total_size;
+		this->snapshot->finished = true;
 	}
 };
 
@@ -238,10 +284,7 @@ ServerNetworkGameSocketHandler::~ServerNetworkGameSocketHandler()
 	if (_redirect_console_to_client == this->client_id) _redirect_console_to_client = INVALID_CLIENT_ID;
 	OrderBackup::ResetUser(this->client_id);
 
-	if (this->savegame != NULL) {
-		this->savegame->Destroy();
-		this->savegame = NULL;
-	}
+	if (this->map_snapshot != NULL) this->EndMapTransfer();
 }
 
 Packet *ServerNetworkGameSocketHandler::ReceivePacket()
@@ -570,44 +613,90 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendWait()
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/**
+ * Start sending a snapshot of the map to the client.
+ * @param snapshot The snapshot to send.
+ */
+void ServerNetworkGameSocketHandler::StartMapTransfer(NetworkMapSnapshot *snapshot)
+{
+	this->map_snapshot = snapshot;
+	this->map_snapshot->AddClient();
+	this->map_packet = 0;
+	this->map_size_sent = false;
+	this->map_sent_packets = 4; // We start with trying 4 packets
+
+	/* Now send the _frame_counter and how many packets are coming */
+	Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
+	p->Send_uint32(_frame_counter);
+	this->SendPacket(p);
+
+	NetworkSyncCommandQueue(this);
+	this->status = STATUS_MAP;
+	/* Mark the start of download */
+	this->last_frame = _frame_counter;
+	this->last_frame_server = _frame_counter;
+}
+
+/** Stop sending the map to the client. */
+void ServerNetworkGameSocketHandler::EndMapTransfer()
+{
+	this->map_snapshot->RemoveClient();
+	this->map_snapshot = NULL;
+}
+
+/** Fast-track the size of the map to the client. */
+void ServerNetworkGameSocketHandler::SendMapSize()
+{
+	size_t total_size;
+	if (this->map_size_sent || !this->map_snapshot->GetTotalSize(&total_size)) return;
+
+	Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
+	p->Send_uint32((uint32)total_size);
+	this->SendPacket(p);
+	this->map_size_sent = true;
+}
+
 /** This sends the map to the client */
 NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 {
-	static uint sent_packets; // How many packets we did send successfully last time
-
 	if (this->status < STATUS_AUTHORIZED) {
 		/* Illegal call, return error and ignore the packet */
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
 	if (this->status == STATUS_AUTHORIZED) {
-		this->savegame = new PacketWriter(this);
-
-		/* Now send the _frame_counter and how many packets are coming */
-		Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
-		p->Send_uint32(_frame_counter);
-		this->SendPacket(p);
-
-		NetworkSyncCommandQueue(this);
-		this->status = STATUS_MAP;
-		/* Mark the start of download */
-		this->last_frame = _frame_counter;
-		this->last_frame_server = _frame_counter;
+		/* Make sure the saving of a previous snapshot is completely done. */
+		WaitTillSaved();
 
-		sent_packets = 4; // We start with trying 4 packets
+		/* Everybody that is waiting for the map gets the same snapshot. */
+		NetworkMapSnapshot *snapshot = new NetworkMapSnapshot((size_t)_settings_client.network.max_map_buffer << 20);
+		NetworkClientSocket *new_cs;
+		FOR_ALL_CLIENT_SOCKETS(new_cs) {
+			if (new_cs == this || new_cs->status == STATUS_MAP_WAIT) new_cs->StartMapTransfer(snapshot);
+		}
 
 		/* Make a dump of the current game */
-		if (SaveWithFilter(this->savegame, true) != SL_OK) usererror("network savedump failed");
+		if (SaveWithFilter(new PacketWriter(snapshot), true) != SL_OK) usererror("network savedump failed");
 	}
 
 	if (this->status == STATUS_MAP) {
+		NetworkMapSnapshot *snapshot = this->map_snapshot;
 		bool last_packet = false;
 		bool has_packets = false;
 
-		for (uint i = 0; (has_packets = this->savegame->HasPackets()) && i < sent_packets; i++) {
-			Packet *p = this->savegame->PopPacket();
+		this->SendMapSize();
+
+		for (uint i = 0; (has_packets = snapshot->HasPacket(this->map_packet)) && i < this->map_sent_packets; i++) {
+			Packet *p = snapshot->CopyPacket(this->map_packet++);
 			last_packet = p->buffer[2] == PACKET_SERVER_MAP_DONE;
 
+			if (this->map_packet == 1) {
+				this->map_first_byte_time = _realtime_tick - this->map_request_time;
+				DEBUG(net, 1, "Map transfer to client #%d: first byte after %u ms", this->client_id, this->map_first_byte_time);
+			}
+
+			/* The size is known when the end has been written; make sure it arrives before the end. */
+			if (last_packet) this->SendMapSize();
 			this->SendPacket(p);
 
 			if (last_packet) {
@@ -616,19 +705,35 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 			}
 		}
 
+		/* Free the packets every client of the snapshot has sent. */
+		uint first_unsent = this->map_packet;
+		NetworkClientSocket *new_cs;
+		FOR_ALL_CLIENT_SOCKETS(new_cs) {
+			if (new_cs->map_snapshot == snapshot) first_unsent = min(first_unsent, new_cs->map_packet);
+		}
+		snapshot->FreePackets(first_unsent);
+
 		if (last_packet) {
-			/* Done reading, make sure saving is done as well */
-			this->savegame->Destroy();
-			this->savegame = NULL;
+			size_t total_size;
+			snapshot->GetTotalSize(&total_size);
+			this->map_transfer_time = _realtime_tick - this->map_request_time;
+			DEBUG(net, 1, "Map transfer to client #%d: " PRINTF_SIZE " bytes in %u ms", this->client_id, total_size, this->map_transfer_time);
+
+			/* Done reading, the snapshot is not needed anymore */
+			this->EndMapTransfer();
 
 			/* Set the status to DONE_MAP, no we will wait for the client
 			 *  to send it is ready (maybe that happens like never ;)) */
 			this->status = STATUS_DONE_MAP;
 
-			/* Find the best candidate for joining, i.e. the first joiner. */
-			NetworkClientSocket *new_cs;
+			/* Find the best candidate for joining, i.e. the first joiner,
+			 * unless someone is still downloading the current snapshot. */
 			NetworkClientSocket *best = NULL;
 			FOR_ALL_CLIENT_SOCKETS(new_cs) {
+				if (new_cs->status == STATUS_MAP) {
+					best = NULL;
+					break;
+				}
 				if (new_cs->status == STATUS_MAP_WAIT) {
 					if (best == NULL || best->GetInfo()->join_date > new_cs->GetInfo()->join_date || (best->GetInfo()->join_date == new_cs->GetInfo()->join_date && best->client_id > new_cs->client_id)) {
 						best = new_cs;
@@ -636,16 +741,10 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 				}
 			}
 
-			/* Is there someone else to join? */
+			/* Is there someone else to join? Everybody else waiting joins along. */
 			if (best != NULL) {
-				/* Let the first start joining. */
 				best->status = STATUS_AUTHORIZED;
 				best->SendMap();
-
-				/* And update the rest. */
-				FOR_ALL_CLIENT_SOCKETS(new_cs) {
-					if (new_cs->status == STATUS_MAP_WAIT) new_cs->SendWait();
-				}
 			}
 		}
 
@@ -655,7 +754,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 			case SPS_ALL_SENT:
 				/* All are sent, increase the sent_packets */
-				if (has_packets) sent_packets *= 2;
+				if (has_packets) this->map_sent_packets *= 2;
 				break;
 
 			case SPS_PARTLY_SENT:
@@ -664,7 +763,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 			case SPS_NONE_SENT:
 				/* Not everything is sent, decrease the sent_packets */
-				if (sent_packets > 1) sent_packets /= 2;
+				if (this->map_sent_packets > 1) this->map_sent_packets /= 2;
 				break;
 		}
 	}
@@ -1022,6 +1121,9 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_GETMAP(Packet *
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
+	/* For the time to the first byte of the map. */
+	this->map_request_time = _realtime_tick;
+
 	/* Check if someone else is receiving the map */
 	FOR_ALL_CLIENT_SOCKETS(new_cs) {
 		if (new_cs->status == STATUS_MAP) {
@@ -1985,6 +2087,9 @@ void NetworkServerShowStatusToConsole()
 			cs->client_id, ci->client_name, status, lag,
 			ci->client_playas + (Company::IsValidID(ci->client_playas) ? 1 : 0),
 			cs->GetClientIP());
+		if (cs->status >= NetworkClientSocket::STATUS_DONE_MAP) {
+			IConsolePrintF(CC_INFO, "Client #%1d  map: first byte after %u ms  transferred in %u ms", cs->client_id, cs->map_first_byte_time, cs->map_transfer_time);
+		}
 	}
 }
 
@@ -73,7 +73,13 @@ public:
 	CommandQueue outgoing_queue; ///< The command-queue awaiting delivery
 	int receive_limit;           ///< Amount of bytes that we can receive at this moment
 
-	struct PacketWriter *savegame; ///< Writer used to write the savegame.
+	struct NetworkMapSnapshot *map_snapshot; ///< Snapshot of the map the client is downloading.
+	uint map_packet;                         ///< Number of the next packet of the snapshot to send.
+	uint map_sent_packets;                   ///< How many packets of the snapshot we may try to send at once.
+	bool map_size_sent;                      ///< Whether the size of the snapshot has been sent.
+	uint32 map_request_time;                 ///< Real time at which the client requested the map.
+	uint32 map_first_byte_time;              ///< Milliseconds from the map request to sending the first byte of the map.
+	uint32 map_transfer_time;                ///< Milliseconds from the map request to sending the whole map.
 	NetworkAddress client_address; ///< IP-address of the client (so he can be banned)
 
 	ServerNetworkGameSocketHandler(SOCKET s);
@@ -83,6 +89,9 @@ public:
 	NetworkRecvStatus CloseConnection(NetworkRecvStatus status) override;
 	void GetClientName(char *client_name, const char *last) const;
 
+	void StartMapTransfer(struct NetworkMapSnapshot *snapshot);
+	void EndMapTransfer();
+	void SendMapSize();
 	NetworkRecvStatus SendMap();
 	NetworkRecvStatus SendErrorQuit(ClientID client_id, NetworkErrorCode errorno);
 	NetworkRecvStatus SendQuit(ClientID client_id);
@@ -49,6 +49,7 @@
 #include "vehicle_func.h"
 #include "language.h"
 #include "vehicle_base.h"
+#include "console_func.h"
 
 #include "table/strings.h"
 #include "table/build_industry.h"
@@ -4883,6 +4884,8 @@ static void NewSpriteGroup(ByteReader *buf)
 				group->ranges = MallocT<DeterministicSpriteGroupRange>(group->num_ranges);
 				MemCpyT(group->ranges, &optimised.front(), group->num_ranges);
 			}
+
+			group->Compile();
 			break;
 		}
 
@@ -8251,6 +8254,29 @@ static void ResetNewGRFErrors()
 	}
 }
 
+/**
+ * Print the callback statistics of the loaded NewGRFs to the console, or reset them.
+ * @param reset Reset the statistics instead of printing them.
+ */
+void ConPrintNewGRFCallbackStats(bool reset)
+{
+	extern bool _newgrf_callback_timing;
+
+	for (GRFFile * const file : _grf_files) {
+		GRFCallbackStats &stats = file->callback_stats;
+		if (reset) {
+			MemSetT(&stats, 0);
+			continue;
+		}
+		if (stats.calls == 0) continue;
+
+		IConsolePrintF(CC_DEFAULT, "%08X %s: " OTTD_PRINTF64 " callbacks, " OTTD_PRINTF64 " cacheable, " OTTD_PRINTF64 " cache hits (%u%%), " OTTD_PRINTF64 " ms",
+				BSWAP32(file->grfid), file->filename, stats.calls, stats.cacheable, stats.cache_hits,
+				stats.cacheable == 0 ? 0 : (uint)(stats.cache_hits * 100 / stats.cacheable), stats.time / 1000000);
+	}
+	if (!reset && !_newgrf_callback_timing) IConsolePrint(CC_DEFAULT, "Timing is disabled; enable it with 'newgrf_callback_stats timing'");
+}
+
 /**
  * Reset all NewGRF loaded data
  */
@@ -8342,6 +8368,7 @@ void ResetNewGRFData()
 
 	InitializeSoundPool();
 	_spritegroup_pool.CleanPool();
+	ClearCallbackResultCache();
 }
 
 /**
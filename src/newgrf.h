@@ -100,6 +100,14 @@ struct GRFLabel {
 	struct GRFLabel *next;
 };
 
+/** Statistics of the callbacks resolved for a NewGRF. */
+struct GRFCallbackStats {
+	uint64 calls;      ///< Number of callbacks resolved.
+	uint64 cacheable;  ///< Number of callbacks that could be looked up in the callback result cache.
+	uint64 cache_hits; ///< Number of callbacks answered by the callback result cache.
+	uint64 time;       ///< Time spent resolving callbacks in nanoseconds, while timing is enabled.
+};
+
 /** Dynamic data of a loaded NewGRF */
 struct GRFFile : ZeroedMemoryAllocator {
 	char *filename;
@@ -138,6 +146,8 @@ struct GRFFile : ZeroedMemoryAllocator {
 	uint32 grf_features;                     ///< Bitset of GrfSpecFeature the grf uses
 	PriceMultipliers price_base_multipliers; ///< Price base multipliers as set by the grf.
 
+	mutable GRFCallbackStats callback_stats; ///< Statistics of the callbacks resolved for the grf.
+
 	GRFFile(const struct GRFConfig *config);
 	~GRFFile();
 
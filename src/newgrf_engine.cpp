@@ -915,6 +915,21 @@ static uint32 VehicleGetVariable(Vehicle *v, const VehicleScopeResolver *object,
 }
 
 
+/* virtual */ bool VehicleResolverObject::GetCacheIdentity(uint64 identity[3]) const
+{
+	const Vehicle *v = this->self_scope.v;
+	identity[0] = (uint64)this->self_scope.self_type << 32 | (v != NULL ? v->index : INVALID_VEHICLE);
+	if (v != NULL) {
+		/* The refit and build windows change the cargo of a vehicle temporarily to query the callbacks. */
+		identity[1] = (uint64)v->cargo_type | (uint64)v->cargo_subtype << 8;
+	} else {
+		/* Without a vehicle the variables of the purchase list depend on the current company. */
+		identity[1] = _current_company;
+	}
+	identity[2] = this->self_scope.info_view;
+	return true;
+}
+
 /* virtual */ const SpriteGroup *VehicleResolverObject::ResolveReal(const RealSpriteGroup *group) const
 {
 	const Vehicle *v = this->self_scope.v;
@@ -64,6 +64,15 @@ HouseResolverObject::HouseResolverObject(HouseID house_id, TileIndex tile, Town
 	this->root_spritegroup = HouseSpec::Get(house_id)->grf_prop.spritegroup[0];
 }
 
+/* virtual */ bool HouseResolverObject::GetCacheIdentity(uint64 identity[3]) const
+{
+	const HouseScopeResolver &hs = this->house_scope;
+	identity[0] = (uint64)hs.tile << 32 | hs.house_id;
+	identity[1] = (uint64)hs.initial_random_bits << 32 | (uint64)hs.not_yet_constructed << 16 | (hs.town != NULL ? hs.town->index : INVALID_TOWN);
+	identity[2] = hs.watched_cargo_triggers;
+	return true;
+}
+
 HouseClassID AllocateHouseClassID(byte grf_class_id, uint32 grfid)
 {
 	/* Start from 1 because 0 means that no class has been assigned. */
@@ -66,6 +66,8 @@ struct HouseResolverObject : public ResolverObject {
 			default: return ResolverObject::GetScope(scope, relative);
 		}
 	}
+
+	bool GetCacheIdentity(uint64 identity[3]) const override;
 };
 
 /**
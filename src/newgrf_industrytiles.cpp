@@ -146,6 +146,13 @@ IndustryTileResolverObject::IndustryTileResolverObject(IndustryGfx gfx, TileInde
 	this->root_spritegroup = GetIndustryTileSpec(gfx)->grf_prop.spritegroup[0];
 }
 
+/* virtual */ bool IndustryTileResolverObject::GetCacheIdentity(uint64 identity[3]) const
+{
+	identity[0] = (uint64)this->indtile_scope.tile << 32 | this->indtile_scope.industry->index;
+	identity[1] = (uint64)this->ind_scope.random_bits << 32 | this->ind_scope.type;
+	return true;
+}
+
 static void IndustryDrawTileLayout(const TileInfo *ti, const TileLayoutSpriteGroup *group, byte rnd_colour, byte stage, IndustryGfx gfx)
 {
 	const DrawTileSprites *dts = group->ProcessRegisters(&stage);
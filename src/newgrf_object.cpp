@@ -367,6 +367,16 @@ ObjectResolverObject::~ObjectResolverObject()
 	delete this->town_scope;
 }
 
+/* virtual */ bool ObjectResolverObject::GetCacheIdentity(uint64 identity[3]) const
+{
+	const ObjectScopeResolver &os = this->object_scope;
+	identity[0] = (uint64)os.tile << 32 | (os.obj != NULL ? os.obj->index : INVALID_OBJECT);
+	identity[1] = os.view;
+	/* Without an object the variables of the build window depend on the current company. */
+	if (os.obj == NULL) identity[2] = _current_company;
+	return true;
+}
+
 /**
  * Get the town resolver scope that belongs to this object resolver.
  * On the first call, the town scope is created (if possible).
@@ -146,6 +146,8 @@ struct ObjectResolverObject : public ResolverObject {
 		}
 	}
 
+	bool GetCacheIdentity(uint64 identity[3]) const override;
+
 private:
 	TownScopeResolver *GetTown();
 };
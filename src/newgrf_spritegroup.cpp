@@ -13,7 +13,11 @@
 #include <algorithm>
 #include "debug.h"
 #include "newgrf_spritegroup.h"
+#include "settings_type.h"
+#include "newgrf_storage.h"
 #include "core/pool_func.hpp"
+#include <chrono>
+#include <unordered_map>
 
 #include "safeguards.h"
 
@@ -22,6 +26,9 @@ INSTANTIATE_POOL_METHODS(SpriteGroup)
 
 TemporaryStorageArray<int32, 0x110> _temp_store;
 
+/** Whether the resolving of the current callback wrote to a storage, so its result must not be cached. */
+static bool _callback_wrote_storage = false;
+
 
 /**
  * ResolverObject (re)entry point.
@@ -84,6 +91,110 @@ static inline uint32 GetVariable(const ResolverObject &object, ScopeResolver *sc
 	}
 }
 
+/** Key of the callback result cache. */
+struct CallbackCacheKey {
+	const SpriteGroup *root; ///< Sprite group the callback is resolved with.
+	CallbackID callback;     ///< The callback.
+	uint32 param1;           ///< First parameter of the callback.
+	uint32 param2;           ///< Second parameter of the callback.
+	uint64 identity[3];      ///< Identity of the resolved object, see ResolverObject::GetCacheIdentity.
+
+	bool operator ==(const CallbackCacheKey &other) const
+	{
+		return this->root == other.root && this->callback == other.callback && this->param1 == other.param1 && this->param2 == other.param2 &&
+				this->identity[0] == other.identity[0] && this->identity[1] == other.identity[1] && this->identity[2] == other.identity[2];
+	}
+};
+
+/** Hash of a CallbackCacheKey. */
+struct CallbackCacheKeyHash {
+	size_t operator()(const CallbackCacheKey &key) const
+	{
+		uint64 hash = (uint64)(size_t)key.root;
+		hash = hash * 0x100000001B3ULL ^ key.callback;
+		hash = hash * 0x100000001B3ULL ^ ((uint64)key.param1 << 32 | key.param2);
+		for (uint i = 0; i < lengthof(key.identity); i++) hash = hash * 0x100000001B3ULL ^ key.identity[i];
+		return (size_t)(hash ^ (hash >> 32));
+	}
+};
+
+/** Maximum number of results in the callback result cache; it is cleared when it gets full. */
+static const size_t CALLBACK_CACHE_MAX_RESULTS = 1 << 16;
+
+/**
+ * Results of the callbacks resolved while the game state cannot change, i.e.
+ * for drawing and the GUI. Those are often resolved several times with the
+ * same input, e.g. for every redraw of a station or a refit list.
+ */
+static std::unordered_map<CallbackCacheKey, uint16, CallbackCacheKeyHash> _callback_cache;
+
+/** Whether the time spent resolving callbacks is measured per NewGRF. */
+bool _newgrf_callback_timing = false;
+
+/**
+ * Forget all cached callback results. Called whenever the game state might change.
+ */
+void ClearCallbackResultCache()
+{
+	if (!_callback_cache.empty()) _callback_cache.clear();
+}
+
+/**
+ * Resolve callback.
+ * While the game state cannot change, the results are cached if enabled.
+ * @return Callback result.
+ */
+uint16 ResolverObject::ResolveCallback()
+{
+	GRFCallbackStats *stats = this->grffile != NULL ? &this->grffile->callback_stats : NULL;
+	if (stats != NULL) stats->calls++;
+
+	CallbackCacheKey key;
+	bool cacheable = false;
+	if (_settings_client.gui.newgrf_callback_cache && this->root_spritegroup != NULL && !BasePersistentStorageArray::CanGameStateChange()) {
+		MemSetT(key.identity, 0, lengthof(key.identity));
+		cacheable = this->GetCacheIdentity(key.identity);
+	}
+
+	if (cacheable) {
+		key.root = this->root_spritegroup;
+		key.callback = this->callback;
+		key.param1 = this->callback_param1;
+		key.param2 = this->callback_param2;
+		if (stats != NULL) stats->cacheable++;
+
+		std::unordered_map<CallbackCacheKey, uint16, CallbackCacheKeyHash>::const_iterator it = _callback_cache.find(key);
+		if (it != _callback_cache.end()) {
+			if (stats != NULL) stats->cache_hits++;
+			/* Resolving would have cleared the registers as well. */
+			_temp_store.ClearChanges();
+			return it->second;
+		}
+	}
+
+	uint64 start = 0;
+	if (_newgrf_callback_timing) start = (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+
+	bool outer_wrote_storage = _callback_wrote_storage;
+	_callback_wrote_storage = false;
+
+	const SpriteGroup *result = this->Resolve();
+	uint16 value = result != NULL ? result->GetCallbackResult() : CALLBACK_FAILED;
+
+	/* Callers might read the registers the callback wrote, so those results cannot be reused. */
+	if (cacheable && !_callback_wrote_storage) {
+		if (_callback_cache.size() >= CALLBACK_CACHE_MAX_RESULTS) _callback_cache.clear();
+		_callback_cache[key] = value;
+	}
+	_callback_wrote_storage |= outer_wrote_storage;
+
+	if (_newgrf_callback_timing && stats != NULL) {
+		stats->time += (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count() - start;
+	}
+
+	return value;
+}
+
 /**
  * Get a few random bits. Default implementation has no random bits.
  * @return Random bits.
@@ -144,21 +255,28 @@ static inline uint32 GetVariable(const ResolverObject &object, ScopeResolver *sc
 	return &this->default_scope;
 }
 
-/* Evaluate an adjustment for a variable of the given size.
+/* Shift, mask and divide the value of an adjustment for a variable of the given size.
  * U is the unsigned type and S is the signed type to use. */
 template <typename U, typename S>
-static U EvalAdjustT(const DeterministicSpriteGroupAdjust *adjust, ScopeResolver *scope, U last_value, uint32 value)
+static inline uint32 EvalAdjustValueT(DeterministicSpriteGroupAdjustType type, byte shift_num, uint32 and_mask, uint32 add_val, uint32 divmod_val, uint32 value)
 {
-	value >>= adjust->shift_num;
-	value  &= adjust->and_mask;
+	value >>= shift_num;
+	value  &= and_mask;
 
-	switch (adjust->type) {
-		case DSGA_TYPE_DIV:  value = ((S)value + (S)adjust->add_val) / (S)adjust->divmod_val; break;
-		case DSGA_TYPE_MOD:  value = ((S)value + (S)adjust->add_val) % (S)adjust->divmod_val; break;
+	switch (type) {
+		case DSGA_TYPE_DIV:  value = ((S)value + (S)add_val) / (S)divmod_val; break;
+		case DSGA_TYPE_MOD:  value = ((S)value + (S)add_val) % (S)divmod_val; break;
 		case DSGA_TYPE_NONE: break;
 	}
+	return value;
+}
 
-	switch (adjust->operation) {
+/* Combine the last value with the value of an adjustment for a variable of the given size.
+ * U is the unsigned type and S is the signed type to use. */
+template <typename U, typename S>
+static inline U EvalOperationT(DeterministicSpriteGroupAdjustOperation operation, ScopeResolver *scope, U last_value, uint32 value)
+{
+	switch (operation) {
 		case DSGA_OP_ADD:  return last_value + value;
 		case DSGA_OP_SUB:  return last_value - value;
 		case DSGA_OP_SMIN: return min((S)last_value, (S)value);
@@ -173,9 +291,9 @@ static U EvalAdjustT(const DeterministicSpriteGroupAdjust *adjust, ScopeResolver
 		case DSGA_OP_AND:  return last_value & value;
 		case DSGA_OP_OR:   return last_value | value;
 		case DSGA_OP_XOR:  return last_value ^ value;
-		case DSGA_OP_STO:  _temp_store.StoreValue((U)value, (S)last_value); return last_value;
+		case DSGA_OP_STO:  _temp_store.StoreValue((U)value, (S)last_value); _callback_wrote_storage = true; return last_value;
 		case DSGA_OP_RST:  return value;
-		case DSGA_OP_STOP: scope->StorePSA((U)value, (S)last_value); return last_value;
+		case DSGA_OP_STOP: scope->StorePSA((U)value, (S)last_value); _callback_wrote_storage = true; return last_value;
 		case DSGA_OP_ROR:  return ROR<uint32>((U)last_value, (U)value & 0x1F); // mask 'value' to 5 bits, which should behave the same on all architectures.
 		case DSGA_OP_SCMP: return ((S)last_value == (S)value) ? 1 : ((S)last_value < (S)value ? 0 : 2);
 		case DSGA_OP_UCMP: return ((U)last_value == (U)value) ? 1 : ((U)last_value < (U)value ? 0 : 2);
@@ -186,14 +304,253 @@ static U EvalAdjustT(const DeterministicSpriteGroupAdjust *adjust, ScopeResolver
 	}
 }
 
+/* Evaluate an adjustment for a variable of the given size.
+ * U is the unsigned type and S is the signed type to use. */
+template <typename U, typename S>
+static U EvalAdjustT(const DeterministicSpriteGroupAdjust *adjust, ScopeResolver *scope, U last_value, uint32 value)
+{
+	value = EvalAdjustValueT<U, S>(adjust->type, adjust->shift_num, adjust->and_mask, adjust->add_val, adjust->divmod_val, value);
+	return EvalOperationT<U, S>(adjust->operation, scope, last_value, value);
+}
 
 static bool RangeHighComparator(const DeterministicSpriteGroupRange& range, uint32 value)
 {
 	return range.high < value;
 }
 
+/**
+ * Get where the value of a variable comes from, as GetVariable would read it.
+ * @param variable The variable.
+ * @return The source of the variable.
+ */
+static DeterministicSpriteGroupSource GetVariableSource(byte variable)
+{
+	switch (variable) {
+		case 0x0C: return DSGS_CALLBACK;
+		case 0x10: return DSGS_CALLBACK_PARAM1;
+		case 0x18: return DSGS_CALLBACK_PARAM2;
+		case 0x1C: return DSGS_LAST_VALUE;
+		case 0x5F: return DSGS_RANDOM_TRIGGERS;
+		case 0x7D: return DSGS_TEMP_STORE;
+		case 0x7F: return DSGS_GRF_PARAM;
+
+		/* Global variables that do not change while the game runs. */
+		case 0x1A: // always -1
+		case 0x1B: // display options
+		case 0x1D: // TTD platform
+		case 0x21: // OpenTTD version
+		case 0x22: // difficulty level
+			return DSGS_CONSTANT;
+
+		default:
+			return variable < 0x40 ? DSGS_GLOBAL : DSGS_SCOPE;
+	}
+}
+
+/**
+ * Check whether an instruction only changes the last value, and cannot fail.
+ * @param in The instruction.
+ * @return True if removing the instruction only affects the last value.
+ */
+static bool IsPureInstruction(const DeterministicSpriteGroupInstruction &in)
+{
+	if (in.operation == DSGA_OP_STO || in.operation == DSGA_OP_STOP) return false;
+	return in.source != DSGS_GLOBAL && in.source != DSGS_SCOPE && in.source != DSGS_SUBROUTINE;
+}
+
+/**
+ * Compile the adjusts for faster resolving. Adjusts whose effect is overwritten
+ * by a later #DSGA_OP_RST are removed, constant values are evaluated, leading
+ * constant adjusts are folded into #initial_value and the ranges the result can
+ * never reach are cut off. The variables are bound to the place they are read
+ * from. Resolving the compiled adjusts gives the same result as interpreting
+ * the original adjusts, which remain the reference.
+ */
+void DeterministicSpriteGroup::Compile()
+{
+	this->code.clear();
+
+	for (uint i = 0; i < this->num_adjusts; i++) {
+		const DeterministicSpriteGroupAdjust &adjust = this->adjusts[i];
+
+		DeterministicSpriteGroupInstruction in;
+		in.operation  = adjust.operation;
+		in.type       = adjust.type;
+		in.indirect   = adjust.variable == 0x7B;
+		in.plain      = adjust.shift_num == 0 && adjust.and_mask == UINT32_MAX && adjust.type == DSGA_TYPE_NONE;
+		in.variable   = in.indirect ? adjust.parameter : adjust.variable;
+		in.parameter  = adjust.parameter;
+		in.shift_num  = adjust.shift_num;
+		in.and_mask   = adjust.and_mask;
+		in.add_val    = adjust.add_val;
+		in.divmod_val = adjust.divmod_val;
+		in.value      = 0;
+		in.subroutine = NULL;
+
+		if (adjust.variable == 0x7E) {
+			in.source = DSGS_SUBROUTINE;
+			in.subroutine = adjust.subroutine;
+		} else {
+			in.source = GetVariableSource(in.variable);
+		}
+
+		if (in.source == DSGS_CONSTANT) {
+			uint32 value;
+			bool known = GetGlobalVariable(in.variable, &value, NULL);
+			assert(known);
+			switch (this->size) {
+				case DSG_SIZE_BYTE:  value = EvalAdjustValueT<uint8,  int8> (in.type, in.shift_num, in.and_mask, in.add_val, in.divmod_val, value); break;
+				case DSG_SIZE_WORD:  value = EvalAdjustValueT<uint16, int16>(in.type, in.shift_num, in.and_mask, in.add_val, in.divmod_val, value); break;
+				case DSG_SIZE_DWORD: value = EvalAdjustValueT<uint32, int32>(in.type, in.shift_num, in.and_mask, in.add_val, in.divmod_val, value); break;
+				default: NOT_REACHED();
+			}
+			in.value = value;
+			in.plain = true;
+		}
+
+		/* Replacing the last value makes the preceding adjusts that only changed it useless. */
+		if (in.operation == DSGA_OP_RST && !in.indirect) {
+			while (!this->code.empty() && IsPureInstruction(this->code.back())) this->code.pop_back();
+		}
+
+		this->code.push_back(in);
+	}
+
+	/* Fold the leading constant adjusts. */
+	uint32 last_value = 0;
+	uint folded = 0;
+	for (; folded < this->code.size(); folded++) {
+		const DeterministicSpriteGroupInstruction &in = this->code[folded];
+		if (in.source != DSGS_CONSTANT || !IsPureInstruction(in)) break;
+
+		switch (this->size) {
+			case DSG_SIZE_BYTE:  last_value = EvalOperationT<uint8,  int8> (in.operation, NULL, last_value, in.value); break;
+			case DSG_SIZE_WORD:  last_value = EvalOperationT<uint16, int16>(in.operation, NULL, last_value, in.value); break;
+			case DSG_SIZE_DWORD: last_value = EvalOperationT<uint32, int32>(in.operation, NULL, last_value, in.value); break;
+			default: NOT_REACHED();
+		}
+	}
+	this->code.erase(this->code.begin(), this->code.begin() + folded);
+	this->initial_value = last_value;
+
+	/* Determine the largest possible result, so unreachable ranges can be skipped. */
+	uint32 max_result;
+	switch (this->size) {
+		case DSG_SIZE_BYTE:  max_result = UINT8_MAX;  break;
+		case DSG_SIZE_WORD:  max_result = UINT16_MAX; break;
+		case DSG_SIZE_DWORD: max_result = UINT32_MAX; break;
+		default: NOT_REACHED();
+	}
+	if (this->code.empty()) {
+		max_result = this->initial_value;
+	} else {
+		const DeterministicSpriteGroupInstruction &in = this->code.back();
+		if (in.operation == DSGA_OP_RST || in.operation == DSGA_OP_AND) {
+			if (in.source == DSGS_CONSTANT) {
+				max_result = min(max_result, in.value);
+			} else if (in.type == DSGA_TYPE_NONE) {
+				max_result = min(max_result, in.and_mask);
+			}
+		}
+	}
+
+	this->num_reachable_ranges = 0;
+	while (this->num_reachable_ranges < this->num_ranges && this->ranges[this->num_reachable_ranges].low <= max_result) this->num_reachable_ranges++;
+}
+
+/**
+ * Resolve the group using the adjusts compiled by #Compile.
+ * U is the unsigned type and S is the signed type of the variable size.
+ * @param object The object to resolve for.
+ * @return The resolved group.
+ */
+template <typename U, typename S>
+const SpriteGroup *DeterministicSpriteGroup::ResolveCompiled(ResolverObject &object) const
+{
+	uint32 last_value = this->initial_value;
+
+	ScopeResolver *scope = object.GetScope(this->var_scope);
+
+	for (const DeterministicSpriteGroupInstruction &in : this->code) {
+		uint32 value;
+		if (in.source == DSGS_CONSTANT) {
+			value = in.value;
+		} else {
+			bool available = true;
+			uint32 parameter = in.indirect ? last_value : in.parameter;
+
+			switch (in.source) {
+				case DSGS_CALLBACK:        value = object.callback; break;
+				case DSGS_CALLBACK_PARAM1: value = object.callback_param1; break;
+				case DSGS_CALLBACK_PARAM2: value = object.callback_param2; break;
+				case DSGS_LAST_VALUE:      value = object.last_value; break;
+				case DSGS_RANDOM_TRIGGERS: value = (scope->GetRandomBits() << 8) | scope->GetTriggers(); break;
+				case DSGS_TEMP_STORE:      value = _temp_store.GetValue(parameter); break;
+				case DSGS_GRF_PARAM:       value = object.grffile == NULL ? 0 : object.grffile->GetParam(parameter); break;
+
+				case DSGS_GLOBAL:
+					if (GetGlobalVariable(in.variable, &value, object.grffile)) break;
+					FALLTHROUGH;
+
+				case DSGS_SCOPE:
+					value = scope->GetVariable(in.variable, parameter, &available);
+					break;
+
+				case DSGS_SUBROUTINE: {
+					const SpriteGroup *subgroup = SpriteGroup::Resolve(in.subroutine, object, false);
+					value = subgroup == NULL ? CALLBACK_FAILED : subgroup->GetCallbackResult();
+					break;
+				}
+
+				default: NOT_REACHED();
+			}
+
+			if (!available) return SpriteGroup::Resolve(this->error_group, object, false);
+
+			if (!in.plain) value = EvalAdjustValueT<U, S>(in.type, in.shift_num, in.and_mask, in.add_val, in.divmod_val, value);
+		}
+
+		last_value = EvalOperationT<U, S>(in.operation, scope, last_value, value);
+	}
+
+	object.last_value = last_value;
+
+	if (this->calculated_result) {
+		/* nvar == 0 is a special case -- we turn our value into a callback result */
+		uint32 value = last_value;
+		if (value != CALLBACK_FAILED) value = GB(value, 0, 15);
+		static CallbackResultSpriteGroup nvarzero(0, true);
+		nvarzero.result = value;
+		return &nvarzero;
+	}
+
+	if (this->num_reachable_ranges > 4) {
+		DeterministicSpriteGroupRange *end = this->ranges + this->num_reachable_ranges;
+		DeterministicSpriteGroupRange *lower = std::lower_bound(this->ranges + 0, end, last_value, RangeHighComparator);
+		if (lower != end && lower->low <= last_value) return SpriteGroup::Resolve(lower->group, object, false);
+	} else {
+		for (uint i = 0; i < this->num_reachable_ranges; i++) {
+			if (this->ranges[i].low <= last_value && last_value <= this->ranges[i].high) {
+				return SpriteGroup::Resolve(this->ranges[i].group, object, false);
+			}
+		}
+	}
+
+	return SpriteGroup::Resolve(this->default_group, object, false);
+}
+
 const SpriteGroup *DeterministicSpriteGroup::Resolve(ResolverObject &object) const
 {
+	if (_settings_client.gui.newgrf_compile_varaction2) {
+		switch (this->size) {
+			case DSG_SIZE_BYTE:  return this->ResolveCompiled<uint8,  int8> (object);
+			case DSG_SIZE_WORD:  return this->ResolveCompiled<uint16, int16>(object);
+			case DSG_SIZE_DWORD: return this->ResolveCompiled<uint32, int32>(object);
+			default: NOT_REACHED();
+		}
+	}
+
+	/* The interpreter of the original adjusts, the reference for the compiled ones. */
 	uint32 last_value = 0;
 	uint32 value = 0;
 	uint i;
@@ -168,6 +168,38 @@ struct DeterministicSpriteGroupRange {
 };
 
 
+/** Where a compiled adjust of a deterministic sprite group gets its value from. */
+enum DeterministicSpriteGroupSource {
+	DSGS_CONSTANT,        ///< Known at compile time; the value is already shifted, masked and divided.
+	DSGS_CALLBACK,        ///< Variable 0x0C, the callback.
+	DSGS_CALLBACK_PARAM1, ///< Variable 0x10, the first callback parameter.
+	DSGS_CALLBACK_PARAM2, ///< Variable 0x18, the second callback parameter.
+	DSGS_LAST_VALUE,      ///< Variable 0x1C, the result of the last resolved deterministic group.
+	DSGS_RANDOM_TRIGGERS, ///< Variable 0x5F, random bits and triggers of the scope.
+	DSGS_TEMP_STORE,      ///< Variable 0x7D, the temporary storage.
+	DSGS_GRF_PARAM,       ///< Variable 0x7F, a parameter of the NewGRF.
+	DSGS_GLOBAL,          ///< Variable common with action 7/9/D, or else a variable of the scope.
+	DSGS_SCOPE,           ///< Feature specific variable of the scope.
+	DSGS_SUBROUTINE,      ///< Variable 0x7E, the result of a procedure.
+};
+
+/** A DeterministicSpriteGroupAdjust compiled by DeterministicSpriteGroup::Compile. */
+struct DeterministicSpriteGroupInstruction {
+	DeterministicSpriteGroupSource source;             ///< Where to get the value from.
+	DeterministicSpriteGroupAdjustOperation operation; ///< Operation to combine the last value with the value.
+	DeterministicSpriteGroupAdjustType type;           ///< Division or modulo of the value.
+	bool indirect;                                     ///< Whether the parameter is the last value (variable 0x7B).
+	bool plain;                                        ///< Whether the value is used as is, i.e. not shifted, masked or divided.
+	byte variable;                                     ///< Variable to read.
+	byte parameter;                                    ///< Parameter of the variable.
+	byte shift_num;                                    ///< Shift of the value.
+	uint32 and_mask;                                   ///< Mask of the value.
+	uint32 add_val;                                    ///< Addition before the division or modulo.
+	uint32 divmod_val;                                 ///< Divisor of the division or modulo.
+	uint32 value;                                      ///< The value for #DSGS_CONSTANT.
+	const SpriteGroup *subroutine; ///< The procedure for #DSGS_SUBROUTINE.
+};
+
 struct DeterministicSpriteGroup : SpriteGroup {
 	DeterministicSpriteGroup() : SpriteGroup(SGT_DETERMINISTIC) {}
 	~DeterministicSpriteGroup();
@@ -185,8 +217,18 @@ struct DeterministicSpriteGroup : SpriteGroup {
 
 	const SpriteGroup *error_group; // was first range, before sorting ranges
 
+	std::vector<DeterministicSpriteGroupInstruction> code; ///< The adjusts that remain after compiling.
+	uint32 initial_value;      ///< Last value after the adjusts folded at compile time.
+	uint num_reachable_ranges; ///< Number of ranges the result can fall in; the others are beyond the maximum result.
+
+	void Compile();
+
 protected:
 	const SpriteGroup *Resolve(ResolverObject &object) const;
+
+private:
+	template <typename U, typename S>
+	const SpriteGroup *ResolveCompiled(ResolverObject &object) const;
 };
 
 enum RandomizedSpriteGroupCompareMode {
@@ -353,18 +395,20 @@ struct ResolverObject {
 		return SpriteGroup::Resolve(this->root_spritegroup, *this);
 	}
 
-	/**
-	 * Resolve callback.
-	 * @return Callback result.
-	 */
-	uint16 ResolveCallback()
-	{
-		const SpriteGroup *result = Resolve();
-		return result != NULL ? result->GetCallbackResult() : CALLBACK_FAILED;
-	}
+	uint16 ResolveCallback();
 
 	virtual const SpriteGroup *ResolveReal(const RealSpriteGroup *group) const;
 
+	/**
+	 * Get the identity of the resolved object for the callback result cache.
+	 * Everything the scopes of the resolver are constructed from has to be
+	 * part of it; the resolved sprite group and callback parameters are added
+	 * by the cache itself.
+	 * @param[out] identity The identity, zeroed beforehand.
+	 * @return False if the results of this resolver must not be cached.
+	 */
+	virtual bool GetCacheIdentity(uint64 identity[3]) const { return false; }
+
 	virtual ScopeResolver *GetScope(VarSpriteGroupScope scope = VSG_SCOPE_SELF, byte relative = 0);
 
 	/**
@@ -402,4 +446,6 @@ struct ResolverObject {
 	}
 };
 
+void ClearCallbackResultCache();
+
 #endif /* NEWGRF_SPRITEGROUP_H */
@@ -573,6 +573,17 @@ StationResolverObject::StationResolverObject(const StationSpec *statspec, BaseSt
 	this->root_spritegroup = this->station_scope.statspec->grf_prop.spritegroup[this->station_scope.cargo_type];
 }
 
+/* virtual */ bool StationResolverObject::GetCacheIdentity(uint64 identity[3]) const
+{
+	const StationScopeResolver &ss = this->station_scope;
+	identity[0] = (uint64)(size_t)ss.statspec;
+	identity[1] = (uint64)ss.tile << 32 | (ss.st != NULL ? ss.st->index : INVALID_STATION);
+	identity[2] = (uint64)ss.cargo_type | (uint64)ss.axis << 8;
+	/* Without a station the variables of the build window depend on the current company. */
+	if (ss.st == NULL) identity[2] |= (uint64)_current_company << 16;
+	return true;
+}
+
 StationResolverObject::~StationResolverObject()
 {
 	delete this->town_scope;
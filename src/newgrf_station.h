@@ -77,6 +77,7 @@ struct StationResolverObject : public ResolverObject {
 	}
 
 	const SpriteGroup *ResolveReal(const RealSpriteGroup *group) const override;
+	bool GetCacheIdentity(uint64 identity[3]) const override;
 };
 
 enum StationClassID {
@@ -11,6 +11,7 @@
 
 #include "stdafx.h"
 #include "newgrf_storage.h"
+#include "newgrf_spritegroup.h"
 #include "core/pool_func.hpp"
 #include "core/endian_func.hpp"
 #include "debug.h"
@@ -92,6 +93,9 @@ void AddChangedPersistentStorage(BasePersistentStorageArray *storage)
 		default: NOT_REACHED();
 	}
 
+	/* Cached callback results are only valid while the game state does not change. */
+	ClearCallbackResultCache();
+
 	/* Discard all temporary changes */
 	for (std::set<BasePersistentStorageArray*>::iterator it = _changed_storage_arrays->begin(); it != _changed_storage_arrays->end(); it++) {
 		DEBUG(desync, 1, "Discarding persistent storage changes: Feature %d, GrfID %08X, Tile %d", (*it)->feature, BSWAP32((*it)->grfid), (*it)->tile);
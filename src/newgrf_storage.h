@@ -40,6 +40,12 @@ struct BasePersistentStorageArray {
 
 	static void SwitchMode(PersistentStorageMode mode, bool ignore_prev_mode = false);
 
+	/**
+	 * Check whether the game state can change at the moment, i.e. whether the
+	 * gameloop, a command or a command test is running.
+	 */
+	static bool CanGameStateChange() { return gameloop || command || testmode; }
+
 protected:
 	/**
 	 * Discard temporary changes.
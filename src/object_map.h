@@ -14,6 +14,7 @@
 
 #include "water_map.h"
 #include "object_type.h"
+#include "pathfinder/water_regions.h"
 
 ObjectType GetObjectType(TileIndex t);
 
@@ -75,6 +76,7 @@ static inline byte GetObjectRandomBits(TileIndex t)
  */
 static inline void MakeObject(TileIndex t, Owner o, ObjectID index, WaterClass wc, byte random)
 {
+	InvalidateWaterRegion(t);
 	SetTileType(t, MP_OBJECT);
 	SetTileOwner(t, o);
 	SetWaterClass(t, wc);
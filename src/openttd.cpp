@@ -64,6 +64,7 @@
 #include "gfx_layout.h"
 #include "viewport_sprite_sorter.h"
 #include "framerate_type.h"
+#include "thread/worker_pool.h"
 
 #include "linkgraph/linkgraphschedule.h"
 
@@ -301,6 +302,7 @@ static void ShutdownGame()
 	free(_config_file);
 
 	LinkGraphSchedule::Clear();
+	ShutdownWorkerPool();
 	PoolBase::Clean(PT_ALL);
 
 	/* No NewGRFs were loaded when it was still bootstrapping. */
@@ -698,6 +700,9 @@ int openttd_main(int argc, char *argv[])
 
 	LoadFromConfig(true);
 
+	/* Start the worker threads now the number of threads to use is known. */
+	InitializeWorkerPool();
+
 	if (resolution.width != 0) _cur_resolution = resolution;
 
 	/*
@@ -1441,7 +1446,6 @@ void GameLoop()
 		_switch_mode = SM_NONE;
 	}
 
-	IncreaseSpriteLRU();
 	InteractiveRandom();
 
 	/* Check for UDP stuff */
@@ -0,0 +1,360 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file water_regions.cpp Handling of the water regions that guide ships over long distances.
+ *
+ * The map is divided into square water regions. Within each region the
+ * water is split into patches: sets of tiles a ship can move between
+ * without leaving the region. For each side of a region the positions where
+ * ships can cross into the neighbouring region are kept, as well as the
+ * aqueducts that lead out of the region. Together these form a much smaller
+ * graph than the tiles, in which a route over the whole map is found quickly.
+ *
+ * The regions are only computed when a ship needs them, and are marked as
+ * outdated when a tile in or next to them changes in a way that can affect
+ * ships. For that the map helpers that make tiles ships may use, or that
+ * replace such tiles, call #InvalidateWaterRegion themselves.
+ */
+
+#include "../stdafx.h"
+#include "../core/mem_func.hpp"
+#include "../ship.h"
+#include "../tunnelbridge_map.h"
+#include "follow_track.hpp"
+#include "water_regions.h"
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+#include "../safeguards.h"
+
+/** The water in a single water region. */
+struct WaterRegion {
+	bool initialized;                                                  ///< Whether the labels and edges are up to date.
+	byte number_of_patches;                                            ///< Number of patches in the region.
+	uint16 edge_traversability_bits[DIAGDIR_END];                      ///< For each side, the positions along the side where ships can leave the region.
+	std::vector<std::pair<TileIndex, TileIndex> > aqueducts;           ///< Aqueduct ramps in the region, with the ramp at the other end in another region.
+	WaterRegionPatchLabel tile_patch_labels[WATER_REGION_NUMBER_OF_TILES]; ///< Label of the patch of each tile of the region.
+
+	WaterRegion() : initialized(false) {}
+};
+
+static std::vector<WaterRegion> _water_regions; ///< All water regions, row by row.
+static uint _water_regions_x;                   ///< Number of water regions in the X direction.
+static uint _water_regions_y;                   ///< Number of water regions in the Y direction.
+
+/**
+ * Get the position of a tile within its water region.
+ * @param tile The tile.
+ * @return Index of the tile in WaterRegion::tile_patch_labels.
+ */
+static inline uint GetLocalTileIndex(TileIndex tile)
+{
+	return (TileY(tile) % WATER_REGION_EDGE_LENGTH) * WATER_REGION_EDGE_LENGTH + TileX(tile) % WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * Get a tile on a side of a water region.
+ * @param x X coordinate of the region, in regions.
+ * @param y Y coordinate of the region, in regions.
+ * @param side The side of the region.
+ * @param pos The position along the side.
+ * @return The tile.
+ */
+static inline TileIndex GetWaterRegionEdgeTile(uint x, uint y, DiagDirection side, uint pos)
+{
+	uint tx = x * WATER_REGION_EDGE_LENGTH;
+	uint ty = y * WATER_REGION_EDGE_LENGTH;
+	switch (side) {
+		case DIAGDIR_NE: return TileXY(tx, ty + pos);
+		case DIAGDIR_SE: return TileXY(tx + pos, ty + WATER_REGION_EDGE_LENGTH - 1);
+		case DIAGDIR_SW: return TileXY(tx + WATER_REGION_EDGE_LENGTH - 1, ty + pos);
+		case DIAGDIR_NW: return TileXY(tx + pos, ty);
+		default: NOT_REACHED();
+	}
+}
+
+/**
+ * Get the trackdirs ships can use on a tile.
+ * @param tile The tile.
+ * @return The trackdirs.
+ */
+static inline TrackdirBits GetWaterTrackdirs(TileIndex tile)
+{
+	return TrackStatusToTrackdirBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0));
+}
+
+/**
+ * Label the patches of a water region and find where ships can leave it.
+ * @param region The region.
+ * @param x X coordinate of the region, in regions.
+ * @param y Y coordinate of the region, in regions.
+ */
+static void UpdateWaterRegion(WaterRegion &region, uint x, uint y)
+{
+	const uint min_x = x * WATER_REGION_EDGE_LENGTH;
+	const uint min_y = y * WATER_REGION_EDGE_LENGTH;
+
+	region.number_of_patches = 0;
+	MemSetT(region.edge_traversability_bits, 0, lengthof(region.edge_traversability_bits));
+	MemSetT(region.tile_patch_labels, INVALID_WATER_REGION_PATCH, lengthof(region.tile_patch_labels));
+	region.aqueducts.clear();
+
+	std::vector<TileIndex> stack;
+	for (uint i = 0; i < WATER_REGION_NUMBER_OF_TILES; i++) {
+		TileIndex start = TileXY(min_x + i % WATER_REGION_EDGE_LENGTH, min_y + i / WATER_REGION_EDGE_LENGTH);
+		if (region.tile_patch_labels[i] != INVALID_WATER_REGION_PATCH || GetWaterTrackdirs(start) == TRACKDIR_BIT_NONE) continue;
+
+		/* Flood fill the patch with the moves a ship can make. */
+		WaterRegionPatchLabel label = ++region.number_of_patches;
+		region.tile_patch_labels[i] = label;
+		stack.push_back(start);
+		while (!stack.empty()) {
+			TileIndex tile = stack.back();
+			stack.pop_back();
+
+			TrackdirBits trackdirs = GetWaterTrackdirs(tile);
+			while (trackdirs != TRACKDIR_BIT_NONE) {
+				Trackdir td = RemoveFirstTrackdir(&trackdirs);
+				CFollowTrackWater ft;
+				if (!ft.Follow(tile, td)) continue;
+
+				TileIndex next = ft.m_new_tile;
+				if (IsInsideBS(TileX(next), min_x, WATER_REGION_EDGE_LENGTH) && IsInsideBS(TileY(next), min_y, WATER_REGION_EDGE_LENGTH)) {
+					WaterRegionPatchLabel &next_label = region.tile_patch_labels[GetLocalTileIndex(next)];
+					if (next_label == INVALID_WATER_REGION_PATCH) {
+						next_label = label;
+						stack.push_back(next);
+					}
+				} else if (DistanceManhattan(tile, next) > 1) {
+					/* An aqueduct to another region. */
+					std::pair<TileIndex, TileIndex> aqueduct(tile, next);
+					if (std::find(region.aqueducts.begin(), region.aqueducts.end(), aqueduct) == region.aqueducts.end()) region.aqueducts.push_back(aqueduct);
+				} else {
+					DiagDirection side = ft.m_exitdir;
+					uint pos = DiagDirToAxis(side) == AXIS_X ? TileY(tile) - min_y : TileX(tile) - min_x;
+					SetBit(region.edge_traversability_bits[side], pos);
+				}
+			}
+		}
+	}
+
+	region.initialized = true;
+}
+
+/**
+ * Get a water region, and make sure it is up to date.
+ * @param x X coordinate of the region, in regions.
+ * @param y Y coordinate of the region, in regions.
+ * @return The region.
+ */
+static const WaterRegion &GetUpdatedWaterRegion(uint x, uint y)
+{
+	assert(x < _water_regions_x && y < _water_regions_y);
+	WaterRegion &region = _water_regions[y * _water_regions_x + x];
+	if (!region.initialized) UpdateWaterRegion(region, x, y);
+	return region;
+}
+
+/** Throw away all water regions and size them for the current map. */
+void InitializeWaterRegions()
+{
+	_water_regions_x = MapSizeX() / WATER_REGION_EDGE_LENGTH;
+	_water_regions_y = MapSizeY() / WATER_REGION_EDGE_LENGTH;
+	_water_regions.clear();
+	_water_regions.resize(_water_regions_x * _water_regions_y);
+}
+
+/**
+ * Mark the water regions that depend on a tile as outdated. This has to be
+ * called whenever a tile changes in a way that changes where ships can go;
+ * the Make* functions of the map accessors do this.
+ * @param tile The changed tile.
+ */
+void InvalidateWaterRegion(TileIndex tile)
+{
+	if (_water_regions.empty()) return;
+
+	uint x = TileX(tile) / WATER_REGION_EDGE_LENGTH;
+	uint y = TileY(tile) / WATER_REGION_EDGE_LENGTH;
+	/* While loading a game the regions are still sized for the previous map; they are reset afterwards. */
+	if (x >= _water_regions_x || y >= _water_regions_y) return;
+	_water_regions[y * _water_regions_x + x].initialized = false;
+
+	/* Where ships can cross a side depends on the tiles on both sides of it. */
+	uint local_x = TileX(tile) % WATER_REGION_EDGE_LENGTH;
+	uint local_y = TileY(tile) % WATER_REGION_EDGE_LENGTH;
+	if (local_x == 0 && x > 0) _water_regions[y * _water_regions_x + x - 1].initialized = false;
+	if (local_x == WATER_REGION_EDGE_LENGTH - 1 && x + 1 < _water_regions_x) _water_regions[y * _water_regions_x + x + 1].initialized = false;
+	if (local_y == 0 && y > 0) _water_regions[(y - 1) * _water_regions_x + x].initialized = false;
+	if (local_y == WATER_REGION_EDGE_LENGTH - 1 && y + 1 < _water_regions_y) _water_regions[(y + 1) * _water_regions_x + x].initialized = false;
+}
+
+/**
+ * Get the water region patch a tile belongs to.
+ * @param tile The tile.
+ * @return The patch; its label is #INVALID_WATER_REGION_PATCH when ships cannot use the tile.
+ */
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile)
+{
+	WaterRegionPatchDesc desc;
+	desc.x = TileX(tile) / WATER_REGION_EDGE_LENGTH;
+	desc.y = TileY(tile) / WATER_REGION_EDGE_LENGTH;
+	desc.label = GetUpdatedWaterRegion(desc.x, desc.y).tile_patch_labels[GetLocalTileIndex(tile)];
+	return desc;
+}
+
+/**
+ * Get the water region patches a ship can move to directly from a patch.
+ * @param patch The patch to start from.
+ * @param[out] neighbours The patches next to \a patch, in a fixed order.
+ */
+void GetWaterRegionPatchNeighbours(const WaterRegionPatchDesc &patch, std::vector<WaterRegionPatchDesc> &neighbours)
+{
+	neighbours.clear();
+	const WaterRegion &region = GetUpdatedWaterRegion(patch.x, patch.y);
+
+	for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+		uint bits = region.edge_traversability_bits[side];
+		if (bits == 0) continue;
+
+		TileIndexDiffC offset = TileIndexDiffCByDiagDir(side);
+		WaterRegionPatchDesc neighbour;
+		neighbour.x = patch.x + offset.x;
+		neighbour.y = patch.y + offset.y;
+		const WaterRegion &neighbour_region = GetUpdatedWaterRegion(neighbour.x, neighbour.y);
+
+		uint pos;
+		FOR_EACH_SET_BIT(pos, bits) {
+			TileIndex tile = GetWaterRegionEdgeTile(patch.x, patch.y, side, pos);
+			if (region.tile_patch_labels[GetLocalTileIndex(tile)] != patch.label) continue;
+
+			neighbour.label = neighbour_region.tile_patch_labels[GetLocalTileIndex(TileAddByDiagDir(tile, side))];
+			if (neighbour.label == INVALID_WATER_REGION_PATCH) continue;
+			if (std::find(neighbours.begin(), neighbours.end(), neighbour) == neighbours.end()) neighbours.push_back(neighbour);
+		}
+	}
+
+	for (std::vector<std::pair<TileIndex, TileIndex> >::const_iterator it = region.aqueducts.begin(); it != region.aqueducts.end(); ++it) {
+		if (region.tile_patch_labels[GetLocalTileIndex(it->first)] != patch.label) continue;
+
+		WaterRegionPatchDesc neighbour = GetWaterRegionPatchInfo(it->second);
+		if (neighbour.label == INVALID_WATER_REGION_PATCH) continue;
+		if (std::find(neighbours.begin(), neighbours.end(), neighbour) == neighbours.end()) neighbours.push_back(neighbour);
+	}
+}
+
+/**
+ * Get the key of a water region patch for the search.
+ * @param patch The patch.
+ * @return The key.
+ */
+static inline uint32 GetWaterRegionPatchKey(const WaterRegionPatchDesc &patch)
+{
+	return ((patch.y * _water_regions_x + patch.x) << 8) | patch.label;
+}
+
+/**
+ * Get the water region patch of a search key.
+ * @param key The key.
+ * @return The patch.
+ */
+static inline WaterRegionPatchDesc GetWaterRegionPatchFromKey(uint32 key)
+{
+	WaterRegionPatchDesc patch;
+	patch.x = (key >> 8) % _water_regions_x;
+	patch.y = (key >> 8) / _water_regions_x;
+	patch.label = GB(key, 0, 8);
+	return patch;
+}
+
+/**
+ * Get the distance between two water region patches, in regions.
+ * @param a The first patch.
+ * @param b The second patch.
+ * @return The Manhattan distance between their regions.
+ */
+static inline uint GetWaterRegionDistance(const WaterRegionPatchDesc &a, const WaterRegionPatchDesc &b)
+{
+	return Delta(a.x, b.x) + Delta(a.y, b.y);
+}
+
+/**
+ * Find the water region patches a ship passes through on the way between two tiles.
+ * The search is an A* over the patches; the cost of a step is the distance
+ * between the regions. Ties are broken on the key of the patch, so the
+ * result does not depend on the platform.
+ * @param from The tile the ship starts at.
+ * @param to The destination tile.
+ * @param max_nodes Maximum number of patches to visit before giving up.
+ * @param[out] path The patches from the one of \a from up to the one of \a to.
+ * @return Whether a path was found.
+ */
+bool FindWaterRegionPath(TileIndex from, TileIndex to, uint max_nodes, std::vector<WaterRegionPatchDesc> &path)
+{
+	path.clear();
+
+	WaterRegionPatchDesc start = GetWaterRegionPatchInfo(from);
+	WaterRegionPatchDesc end = GetWaterRegionPatchInfo(to);
+	if (start.label == INVALID_WATER_REGION_PATCH || end.label == INVALID_WATER_REGION_PATCH) return false;
+
+	/** A visited patch: its best cost from the start and where it was reached from. */
+	struct Node {
+		uint32 parent; ///< Key of the patch this patch is reached from.
+		uint cost;     ///< Distance from the start.
+	};
+	typedef std::pair<uint, uint32> OpenItem; ///< Estimated total distance and key of a patch to visit.
+
+	std::unordered_map<uint32, Node> nodes;
+	std::priority_queue<OpenItem, std::vector<OpenItem>, std::greater<OpenItem> > open;
+	std::vector<WaterRegionPatchDesc> neighbours;
+
+	uint32 start_key = GetWaterRegionPatchKey(start);
+	Node start_node = { start_key, 0 };
+	nodes[start_key] = start_node;
+	open.push(OpenItem(GetWaterRegionDistance(start, end), start_key));
+
+	uint visited = 0;
+	while (!open.empty()) {
+		OpenItem item = open.top();
+		open.pop();
+
+		WaterRegionPatchDesc patch = GetWaterRegionPatchFromKey(item.second);
+		const Node node = nodes[item.second];
+		/* Skip entries for patches that were reached with a lower cost afterwards. */
+		if (item.first != node.cost + GetWaterRegionDistance(patch, end)) continue;
+
+		if (patch == end) {
+			for (uint32 key = item.second; key != start_key; key = nodes[key].parent) {
+				path.push_back(GetWaterRegionPatchFromKey(key));
+			}
+			path.push_back(start);
+			std::reverse(path.begin(), path.end());
+			return true;
+		}
+
+		if (++visited > max_nodes) break;
+
+		GetWaterRegionPatchNeighbours(patch, neighbours);
+		for (std::vector<WaterRegionPatchDesc>::const_iterator it = neighbours.begin(); it != neighbours.end(); ++it) {
+			uint32 key = GetWaterRegionPatchKey(*it);
+			uint cost = node.cost + GetWaterRegionDistance(patch, *it);
+
+			std::unordered_map<uint32, Node>::iterator found = nodes.find(key);
+			if (found != nodes.end() && found->second.cost <= cost) continue;
+
+			Node next = { item.second, cost };
+			nodes[key] = next;
+			open.push(OpenItem(cost + GetWaterRegionDistance(*it, end), key));
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,45 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.h Handling of the water regions that guide ships over long distances. */
+
+#ifndef WATER_REGIONS_H
+#define WATER_REGIONS_H
+
+#include "../tile_type.h"
+#include <vector>
+
+typedef byte WaterRegionPatchLabel; ///< Label of a connected part of the water within a water region.
+
+static const uint WATER_REGION_EDGE_LENGTH = 16; ///< Width and height of a water region in tiles.
+static const uint WATER_REGION_NUMBER_OF_TILES = WATER_REGION_EDGE_LENGTH * WATER_REGION_EDGE_LENGTH; ///< Number of tiles in a water region.
+static const WaterRegionPatchLabel INVALID_WATER_REGION_PATCH = 0; ///< Label of the tiles that ships cannot use.
+
+/**
+ * Describes a patch of a water region: a part of the water within the
+ * region where every tile can be reached from every other tile without
+ * leaving the region.
+ */
+struct WaterRegionPatchDesc {
+	uint x;                      ///< X coordinate of the region, in regions.
+	uint y;                      ///< Y coordinate of the region, in regions.
+	WaterRegionPatchLabel label; ///< Label of the patch within the region.
+
+	bool operator ==(const WaterRegionPatchDesc &other) const { return this->x == other.x && this->y == other.y && this->label == other.label; }
+	bool operator !=(const WaterRegionPatchDesc &other) const { return !(*this == other); }
+};
+
+void InitializeWaterRegions();
+void InvalidateWaterRegion(TileIndex tile);
+
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile);
+void GetWaterRegionPatchNeighbours(const WaterRegionPatchDesc &patch, std::vector<WaterRegionPatchDesc> &neighbours);
+bool FindWaterRegionPath(TileIndex from, TileIndex to, uint max_nodes, std::vector<WaterRegionPatchDesc> &path);
+
+#endif /* WATER_REGIONS_H */
@@ -13,6 +13,7 @@
 #define YAPF_CACHE_H
 
 #include "../../track_type.h"
+#include "../../station_type.h"
 
 /**
  * Use this function to notify YAPF that track layout (or signal configuration) has change.
@@ -21,4 +22,18 @@
  */
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track);
 
+void YapfGetRailSegmentCacheStats(uint *hits, uint *misses);
+
+/**
+ * Use this function to notify YAPF that the roads on a tile have changed.
+ * @param tile the tile that is changed
+ */
+void YapfNotifyRoadLayoutChange(TileIndex tile);
+
+/**
+ * Use this function to notify YAPF that road stops of a station were built or removed.
+ * @param station the station that is changed
+ */
+void YapfNotifyRoadStopChange(StationID station);
+
 #endif /* YAPF_CACHE_H */
@@ -13,6 +13,10 @@
 #define YAPF_COSTCACHE_HPP
 
 #include "../../date_func.h"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <vector>
 
 /**
  * CYapfSegmentCostCacheNoneT - the formal only yapf cost cache provider that implements
@@ -42,6 +46,14 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/**
+	 * Called by the cost calculation after the segment cost of a node has been calculated.
+	 *  Without segment cost caching there is nothing to remember.
+	 */
+	inline void PfNodeCacheRegisterTiles(Node &n, const std::vector<TileIndex> &tiles)
+	{
+	}
 };
 
 
@@ -89,24 +101,45 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/**
+	 * Called by the cost calculation after the segment cost of a node has been calculated.
+	 *  Local data is thrown away after the path finder run, so nothing has to be remembered.
+	 */
+	inline void PfNodeCacheRegisterTiles(Node &n, const std::vector<TileIndex> &tiles)
+	{
+	}
 };
 
 
 /**
- * Base class for segment cost cache providers. Contains global counter
- *  of track layout changes and static notification function called whenever
- *  the track layout changes. It is implemented as base class because it needs
- *  to be shared between all rail YAPF types (one shared counter, one notification
- *  function.
+ * Base class for segment cost cache providers. Keeps track of all existing caches
+ *  and contains the static notification function called whenever the track layout
+ *  changes. It is implemented as base class because it needs to be shared between
+ *  all rail YAPF types (one cache statistics, one notification function).
  */
 struct CSegmentCostCacheBase
 {
-	static int   s_rail_change_counter;
+	/* The counters are atomic, so they stay correct when paths are searched outside of the main thread. */
+	static std::atomic<uint32> s_hits;          ///< Number of segments found in the caches today.
+	static std::atomic<uint32> s_misses;        ///< Number of segments not found in the caches today.
+	static std::atomic<uint32> s_invalidations; ///< Number of cached segments dropped due to track layout changes today.
+	static uint32 s_last_hits;                  ///< Number of segments found in the caches on the previous day.
+	static uint32 s_last_misses;                ///< Number of segments not found in the caches on the previous day.
 
-	static void NotifyTrackLayoutChange(TileIndex tile, Track track)
-	{
-		s_rail_change_counter++;
-	}
+	virtual ~CSegmentCostCacheBase() {}
+
+	/** flush (clear) the cache */
+	virtual void Flush() = 0;
+
+	/** drop all cached segments passing the given tile */
+	virtual void InvalidateTile(TileIndex tile) = 0;
+
+	static void NotifyTrackLayoutChange(TileIndex tile, Track track);
+	static void UpdateStatistics();
+
+protected:
+	static std::vector<CSegmentCostCacheBase *> &GetCaches();
 };
 
 
@@ -119,6 +152,12 @@ struct CSegmentCostCacheBase
  *  of the segment (origin tile and exit-dir from this tile).
  *  Different CYapfCachedCostT types can share the same type of CSegmentCostCacheT.
  *  Look at CYapfRailSegment (yapf_node_rail.hpp) for the segment example
+ *
+ *  Every calculated segment is registered at the tiles it passes, so a track
+ *  layout change only drops the segments around the changed tile. Dropped
+ *  segments stay in the heap (nodes may still point to them) and their slots
+ *  are reused later on. The registrations of a dropped segment at all of its
+ *  tiles are removed together with the segment.
  */
 template <class Tsegment>
 struct CSegmentCostCacheT : public CSegmentCostCacheBase {
@@ -127,17 +166,34 @@ struct CSegmentCostCacheT : public CSegmentCostCacheBase {
 	typedef CHashTableT<Tsegment, C_HASH_BITS> HashTable;
 	typedef SmallArray<Tsegment> Heap;
 	typedef typename Tsegment::Key Key;    ///< key to hash table
+	typedef std::map<TileIndex, std::vector<Key> > TileMap;
+	typedef std::map<const Tsegment *, std::vector<TileIndex> > SegmentTileMap;
 
 	HashTable    m_map;
 	Heap         m_heap;
+	std::vector<Tsegment *> m_free;        ///< dropped segments whose storage can be reused
+	TileMap      m_tiles;                  ///< keys of the segments passing each tile
+	SegmentTileMap m_segment_tiles;        ///< tiles each registered segment passes
 
-	inline CSegmentCostCacheT() {}
+	inline CSegmentCostCacheT()
+	{
+		GetCaches().push_back(this);
+	}
+
+	~CSegmentCostCacheT()
+	{
+		std::vector<CSegmentCostCacheBase *> &caches = GetCaches();
+		caches.erase(std::find(caches.begin(), caches.end(), this));
+	}
 
 	/** flush (clear) the cache */
-	inline void Flush()
+	void Flush() override
 	{
 		m_map.Clear();
 		m_heap.Clear();
+		m_free.clear();
+		m_tiles.clear();
+		m_segment_tiles.clear();
 	}
 
 	inline Tsegment& Get(Key &key, bool *found)
@@ -145,13 +201,77 @@ struct CSegmentCostCacheT : public CSegmentCostCacheBase {
 		Tsegment *item = m_map.Find(key);
 		if (item == NULL) {
 			*found = false;
-			item = new (m_heap.Append()) Tsegment(key);
+			s_misses++;
+			if (m_free.empty()) {
+				item = new (m_heap.Append()) Tsegment(key);
+			} else {
+				item = new (m_free.back()) Tsegment(key);
+				m_free.pop_back();
+			}
 			m_map.Push(*item);
 		} else {
 			*found = true;
+			s_hits++;
 		}
 		return *item;
 	}
+
+	/**
+	 * Check whether the given segment is stored in this cache.
+	 * @param segment the segment to look for
+	 * @return true if the segment is cached here
+	 */
+	inline bool Contains(const Tsegment &segment)
+	{
+		return m_map.Find(segment.GetKey()) == &segment;
+	}
+
+	/**
+	 * Remember the tiles a calculated segment passes.
+	 * @param segment the segment
+	 * @param tiles   the tiles of the segment
+	 */
+	void RegisterTiles(const Tsegment &segment, const std::vector<TileIndex> &tiles)
+	{
+		for (std::vector<TileIndex>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+			m_tiles[*it].push_back(segment.GetKey());
+		}
+		std::vector<TileIndex> &segment_tiles = m_segment_tiles[&segment];
+		segment_tiles.insert(segment_tiles.end(), tiles.begin(), tiles.end());
+	}
+
+	/**
+	 * Forget the tiles a dropped segment passes.
+	 * @param segment the segment
+	 */
+	void UnregisterTiles(const Tsegment &segment)
+	{
+		typename SegmentTileMap::iterator it = m_segment_tiles.find(&segment);
+		if (it == m_segment_tiles.end()) return;
+		for (std::vector<TileIndex>::const_iterator tile = it->second.begin(); tile != it->second.end(); ++tile) {
+			typename TileMap::iterator keys = m_tiles.find(*tile);
+			if (keys == m_tiles.end()) continue;
+			typename std::vector<Key>::iterator key = std::find(keys->second.begin(), keys->second.end(), segment.GetKey());
+			if (key != keys->second.end()) keys->second.erase(key);
+			if (keys->second.empty()) m_tiles.erase(keys);
+		}
+		m_segment_tiles.erase(it);
+	}
+
+	void InvalidateTile(TileIndex tile) override
+	{
+		typename TileMap::const_iterator it = m_tiles.find(tile);
+		if (it == m_tiles.end()) return;
+		/* Dropping a segment removes its keys from this tile as well, so work on a copy. */
+		std::vector<Key> keys(it->second);
+		for (typename std::vector<Key>::const_iterator key = keys.begin(); key != keys.end(); ++key) {
+			Tsegment *item = m_map.TryPop(*key);
+			if (item == NULL) continue;
+			UnregisterTiles(*item);
+			m_free.push_back(item);
+			s_invalidations++;
+		}
+	}
 };
 
 /**
@@ -183,22 +303,11 @@ protected:
 
 	inline static Cache& stGetGlobalCache()
 	{
-		static int last_rail_change_counter = 0;
-		static Date last_date = 0;
 		static Cache C;
 
 		/* some statistics */
-		if (last_date != _date) {
-			last_date = _date;
-			DEBUG(yapf, 2, "Pf time today: %5d ms", _total_pf_time_us / 1000);
-			_total_pf_time_us = 0;
-		}
+		Cache::UpdateStatistics();
 
-		/* delete the cache sometimes... */
-		if (last_rail_change_counter != Cache::s_rail_change_counter) {
-			last_rail_change_counter = Cache::s_rail_change_counter;
-			C.Flush();
-		}
 		return C;
 	}
 
@@ -226,6 +335,17 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/**
+	 * Called by the cost calculation after the segment cost of a node has been calculated.
+	 *  Remembers the tiles of globally cached segments, so they can be dropped when the
+	 *  track layout of one of them changes.
+	 */
+	inline void PfNodeCacheRegisterTiles(Node &n, const std::vector<TileIndex> &tiles)
+	{
+		if (!m_global_cache.Contains(*n.m_segment)) return;
+		m_global_cache.RegisterTiles(*n.m_segment, tiles);
+	}
 };
 
 #endif /* YAPF_COSTCACHE_HPP */
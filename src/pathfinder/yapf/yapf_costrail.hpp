@@ -65,6 +65,7 @@ protected:
 	int           m_max_cost;
 	CBlobT<int>   m_sig_look_ahead_costs;
 	bool          m_disable_cache;
+	std::vector<TileIndex> m_segment_tiles; ///< tiles of the segment being calculated, for invalidating the segment cost cache
 
 public:
 	bool          m_stopped_on_first_two_way_signal;
@@ -290,6 +291,7 @@ public:
 		/* Do we already have a cached segment? */
 		CachedData &segment = *n.m_segment;
 		bool is_cached_segment = (segment.m_cost >= 0);
+		m_segment_tiles.clear();
 
 		int parent_cost = has_parent ? n.m_parent->m_cost : 0;
 
@@ -381,6 +383,12 @@ public:
 
 no_entry_cost: // jump here at the beginning if the node has no parent (it is the first node)
 
+			/* Remember the tiles of the segment, including the skipped ones of stations, tunnels and bridges. */
+			m_segment_tiles.push_back(cur.tile);
+			for (int i = 1; i <= tf->m_tiles_skipped; i++) {
+				m_segment_tiles.push_back(cur.tile - i * TileOffsByDiagDir(TrackdirToExitdir(cur.td)));
+			}
+
 			/* All other tile costs will be calculated here. */
 			segment_cost += Yapf().OneTileCost(cur.tile, cur.td);
 
@@ -581,6 +589,8 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 			segment.m_end_segment_reason = end_segment_reason & ESRB_CACHED_MASK;
 			/* Save end of segment back to the node. */
 			n.SetLastTileTrackdir(cur.tile, cur.td);
+			/* Allow the cache to drop the segment when one of its tiles changes. */
+			Yapf().PfNodeCacheRegisterTiles(n, m_segment_tiles);
 		}
 
 		/* Do we have an excuse why not to continue pathfinding in this direction? */
@@ -71,6 +71,13 @@ private:
 		return true;
 	}
 
+	/** Drop the cached segments passing a reserved tile. */
+	bool InvalidateSegmentCostCacheProc(TileIndex tile, Trackdir td)
+	{
+		YapfNotifyTrackLayoutChange(tile, TrackdirToTrack(td));
+		return tile != m_res_dest || td != m_res_dest_td;
+	}
+
 	/** Reserve a railway platform. Tile contains the failed tile on abort. */
 	bool ReserveRailStationPlatform(TileIndex &tile, DiagDirection dir)
 	{
@@ -182,7 +189,9 @@ public:
 		if (target != NULL) target->okay = true;
 
 		if (Yapf().CanUseGlobalCache(*m_res_node)) {
-			YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+			for (Node *node = m_res_node; node->m_parent != NULL; node = node->m_parent) {
+				node->IterateTiles(Yapf().GetVehicle(), Yapf(), *this, &CYapfReserveTrack<Types>::InvalidateSegmentCostCacheProc);
+			}
 		}
 
 		return true;
@@ -638,10 +647,73 @@ bool YapfTrainFindNearestSafeTile(const Train *v, TileIndex tile, Trackdir td, b
 	return pfnFindNearestSafeTile(v, tile, td, override_railtype);
 }
 
-/** if any track changes, this counter is incremented - that will invalidate segment cost cache */
-int CSegmentCostCacheBase::s_rail_change_counter = 0;
+std::atomic<uint32> CSegmentCostCacheBase::s_hits(0);
+std::atomic<uint32> CSegmentCostCacheBase::s_misses(0);
+std::atomic<uint32> CSegmentCostCacheBase::s_invalidations(0);
+uint32 CSegmentCostCacheBase::s_last_hits = 0;
+uint32 CSegmentCostCacheBase::s_last_misses = 0;
+
+/**
+ * Get all segment cost caches, so they can be notified about track layout changes.
+ * @return the list of caches
+ */
+/* static */ std::vector<CSegmentCostCacheBase *> &CSegmentCostCacheBase::GetCaches()
+{
+	static std::vector<CSegmentCostCacheBase *> caches;
+	return caches;
+}
+
+/**
+ * Drop the cached segments that may be affected by a change of the given tile. Segments
+ *  look at the tile following their last one as well, so the neighbouring tiles are included.
+ * @param tile  the changed tile, or INVALID_TILE to flush all caches
+ * @param track the changed track
+ */
+/* static */ void CSegmentCostCacheBase::NotifyTrackLayoutChange(TileIndex tile, Track track)
+{
+	std::vector<CSegmentCostCacheBase *> &caches = GetCaches();
+	for (std::vector<CSegmentCostCacheBase *>::iterator it = caches.begin(); it != caches.end(); ++it) {
+		if (tile == INVALID_TILE) {
+			(*it)->Flush();
+			continue;
+		}
+		(*it)->InvalidateTile(tile);
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+			TileIndex neighbour = TileAddWrap(tile, diff.x, diff.y);
+			if (neighbour != INVALID_TILE) (*it)->InvalidateTile(neighbour);
+		}
+	}
+}
+
+/**
+ * Log the path finder statistics of the previous day when the date changes.
+ */
+/* static */ void CSegmentCostCacheBase::UpdateStatistics()
+{
+	static Date last_date = 0;
+	if (last_date == _date) return;
+	last_date = _date;
+
+	DEBUG(yapf, 2, "Pf time today: %5d ms", _total_pf_time_us / 1000);
+	s_last_hits = s_hits.exchange(0);
+	s_last_misses = s_misses.exchange(0);
+	DEBUG(yapf, 2, "Segment cache today: %u hits, %u misses, %u segments invalidated", s_last_hits, s_last_misses, s_invalidations.exchange(0));
+	_total_pf_time_us = 0;
+}
 
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track)
 {
 	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, track);
 }
+
+/**
+ * Get the statistics of the rail segment cost caches of the previous day.
+ * @param[out] hits   number of segments found in the caches
+ * @param[out] misses number of segments that had to be calculated
+ */
+void YapfGetRailSegmentCacheStats(uint *hits, uint *misses)
+{
+	*hits = CSegmentCostCacheBase::s_last_hits;
+	*misses = CSegmentCostCacheBase::s_last_misses;
+}
@@ -12,10 +12,166 @@
 #include "../../stdafx.h"
 #include "yapf.hpp"
 #include "yapf_node_road.hpp"
+#include "yapf_cache.h"
+#include "yapf_road_cache.h"
 #include "../../roadstop_base.h"
+#include "../../date_func.h"
 
 #include "../../safeguards.h"
 
+RoadRouteCache _road_route_cache;                     ///< The routes shared between road vehicles.
+std::vector<uint32> _road_route_cache_region_serials; ///< For each region, the value of #_road_route_cache_serial after the last road change in it.
+uint32 _road_route_cache_serial;                      ///< Number of road changes counted so far.
+
+static uint _road_route_cache_hits;        ///< Number of searches avoided by the route cache today.
+static uint _road_route_cache_misses;      ///< Number of searches done despite the route cache today.
+static uint _road_route_cache_outdated;    ///< Number of routes dropped today because the roads changed.
+static uint _road_route_cache_expired;     ///< Number of routes dropped today because they were too old.
+
+/** Throw away all shared road vehicle routes, and size the road change counters for the current map. */
+void InitializeRoadRouteCache()
+{
+	_road_route_cache.clear();
+	_road_route_cache_region_serials.assign((MapSizeX() / ROAD_ROUTE_CACHE_REGION_SIZE) * (MapSizeY() / ROAD_ROUTE_CACHE_REGION_SIZE), 0);
+	_road_route_cache_serial = 0;
+}
+
+void YapfNotifyRoadLayoutChange(TileIndex tile)
+{
+	if (_road_route_cache_region_serials.empty()) return;
+
+	uint index = (TileY(tile) / ROAD_ROUTE_CACHE_REGION_SIZE) * (MapSizeX() / ROAD_ROUTE_CACHE_REGION_SIZE) + TileX(tile) / ROAD_ROUTE_CACHE_REGION_SIZE;
+	_road_route_cache_region_serials[index] = ++_road_route_cache_serial;
+}
+
+void YapfNotifyRoadStopChange(StationID station)
+{
+	/* The new or removed stop may be outside of the area the searches to the station looked at. */
+	for (RoadRouteCache::iterator it = _road_route_cache.begin(); it != _road_route_cache.end();) {
+		if (it->first.dest_station == station) {
+			_road_route_cache.erase(it++);
+		} else {
+			++it;
+		}
+	}
+}
+
+/**
+ * Get the current time for the age of the shared road vehicle routes.
+ * @return The number of ticks since the start of the calendar.
+ */
+static inline int64 GetRoadRouteCacheTime()
+{
+	return (int64)_date * DAY_TICKS + _date_fract;
+}
+
+/**
+ * Check whether a shared road vehicle route is too old to be used.
+ * @param entry The route.
+ * @return True if the route has to be searched again.
+ */
+static inline bool IsRoadRouteCacheEntryExpired(const RoadRouteCacheEntry &entry)
+{
+	int64 age = GetRoadRouteCacheTime() - entry.time;
+	return age < 0 || age > _settings_game.pf.yapf.road_route_cache_age;
+}
+
+/**
+ * Check whether the roads the search of a shared road vehicle route looked at are unchanged.
+ * @param entry The route.
+ * @return True if no road changed in the regions of the search.
+ */
+static bool IsRoadRouteCacheEntryCurrent(const RoadRouteCacheEntry &entry)
+{
+	uint regions_x = MapSizeX() / ROAD_ROUTE_CACHE_REGION_SIZE;
+	for (uint y = entry.min_y; y <= entry.max_y; y++) {
+		for (uint x = entry.min_x; x <= entry.max_x; x++) {
+			if (_road_route_cache_region_serials[y * regions_x + x] > entry.serial) return false;
+		}
+	}
+	return true;
+}
+
+/** Log the statistics of the road route cache of the previous day when the date changes. */
+static void UpdateRoadRouteCacheStatistics()
+{
+	static Date last_date = 0;
+	if (last_date == _date) return;
+	last_date = _date;
+
+	DEBUG(yapf, 2, "Road route cache today: %u searches avoided, %u searches done, %u routes outdated, %u routes expired, %u routes cached",
+			_road_route_cache_hits, _road_route_cache_misses, _road_route_cache_outdated, _road_route_cache_expired, (uint)_road_route_cache.size());
+	_road_route_cache_hits = 0;
+	_road_route_cache_misses = 0;
+	_road_route_cache_outdated = 0;
+	_road_route_cache_expired = 0;
+}
+
+/**
+ * Find a usable shared route for a road vehicle route search.
+ * Routes that cannot be used anymore are dropped.
+ * @param key The search.
+ * @return The route, or \c NULL when the search has to be done.
+ */
+static const RoadRouteCacheEntry *FindRoadRouteCacheEntry(const RoadRouteCacheKey &key)
+{
+	UpdateRoadRouteCacheStatistics();
+
+	RoadRouteCache::iterator it = _road_route_cache.find(key);
+	if (it != _road_route_cache.end()) {
+		if (IsRoadRouteCacheEntryExpired(it->second)) {
+			_road_route_cache_expired++;
+			_road_route_cache.erase(it);
+		} else if (!IsRoadRouteCacheEntryCurrent(it->second)) {
+			_road_route_cache_outdated++;
+			_road_route_cache.erase(it);
+		} else {
+			_road_route_cache_hits++;
+			return &it->second;
+		}
+	}
+
+	_road_route_cache_misses++;
+	return NULL;
+}
+
+/**
+ * Share the result of a road vehicle route search with the vehicles that do the same search.
+ * @param key The search.
+ * @param next_trackdir The trackdir to take on the entered tile.
+ * @param path The path cache after the search.
+ * @param min_x Westmost X coordinate of the tiles the search looked at.
+ * @param min_y Northmost Y coordinate of the tiles the search looked at.
+ * @param max_x Eastmost X coordinate of the tiles the search looked at.
+ * @param max_y Southmost Y coordinate of the tiles the search looked at.
+ */
+static void StoreRoadRouteCacheEntry(const RoadRouteCacheKey &key, Trackdir next_trackdir, const RoadVehPathCache &path, uint min_x, uint min_y, uint max_x, uint max_y)
+{
+	if (_road_route_cache.size() >= ROAD_ROUTE_CACHE_MAX_ENTRIES && _road_route_cache.find(key) == _road_route_cache.end()) {
+		/* Make room by dropping the old routes, or all of them when that is not enough. */
+		for (RoadRouteCache::iterator it = _road_route_cache.begin(); it != _road_route_cache.end();) {
+			if (IsRoadRouteCacheEntryExpired(it->second)) {
+				_road_route_cache_expired++;
+				it = _road_route_cache.erase(it);
+			} else {
+				++it;
+			}
+		}
+		if (_road_route_cache.size() >= ROAD_ROUTE_CACHE_MAX_ENTRIES) _road_route_cache.clear();
+	}
+
+	RoadRouteCacheEntry &entry = _road_route_cache[key];
+	entry.serial = _road_route_cache_serial;
+	entry.time = GetRoadRouteCacheTime();
+	/* New roads next to the searched tiles can connect to them, so include those as well. */
+	entry.min_x = (max(min_x, 1U) - 1) / ROAD_ROUTE_CACHE_REGION_SIZE;
+	entry.min_y = (max(min_y, 1U) - 1) / ROAD_ROUTE_CACHE_REGION_SIZE;
+	entry.max_x = min(max_x + 1, MapMaxX()) / ROAD_ROUTE_CACHE_REGION_SIZE;
+	entry.max_y = min(max_y + 1, MapMaxY()) / ROAD_ROUTE_CACHE_REGION_SIZE;
+	entry.next_trackdir = next_trackdir;
+	entry.path = path;
+}
+
 
 template <class Types>
 class CYapfCostRoadT
@@ -81,11 +237,15 @@ protected:
 							/* When we're the first road stop in a 'queue' of them we increase
 							 * cost based on the fill percentage of the whole queue. */
 							const RoadStop::Entry *entry = rs->GetEntry(dir);
-							cost += entry->GetOccupied() * Yapf().PfGetSettings().road_stop_occupied_penalty / entry->GetLength();
+							int penalty = entry->GetOccupied() * Yapf().PfGetSettings().road_stop_occupied_penalty / entry->GetLength();
+							if (penalty != 0) Yapf().AddOccupiedRoadStop();
+							cost += penalty;
 						}
 					} else {
 						/* Increase cost for filled road stops */
-						cost += Yapf().PfGetSettings().road_stop_bay_occupied_penalty * (!rs->IsFreeBay(0) + !rs->IsFreeBay(1)) / 2;
+						int penalty = Yapf().PfGetSettings().road_stop_bay_occupied_penalty * (!rs->IsFreeBay(0) + !rs->IsFreeBay(1)) / 2;
+						if (penalty != 0) Yapf().AddOccupiedRoadStop();
+						cost += penalty;
 					}
 					break;
 				}
@@ -121,6 +281,8 @@ public:
 		int parent_cost = (n.m_parent != NULL) ? n.m_parent->m_cost : 0;
 
 		for (;;) {
+			Yapf().AddToSearchArea(tile);
+
 			/* base tile cost depending on distance between edges */
 			segment_cost += Yapf().OneTileCost(tile, trackdir);
 
@@ -143,6 +305,7 @@ public:
 			/* if there are no reachable trackdirs on new tile, we have end of road */
 			TrackFollower F(Yapf().GetVehicle());
 			if (!F.Follow(tile, trackdir)) break;
+			Yapf().AddToSearchArea(F.m_new_tile);
 
 			/* if there are more trackdirs available & reachable, we are at the end of segment */
 			if (KillFirstBit(F.m_new_td_bits) != TRACKDIR_BIT_NONE) break;
@@ -321,6 +484,14 @@ public:
 	typedef typename Node::Key Key;                      ///< key to hash tables
 
 protected:
+	uint m_search_min_x; ///< westmost X coordinate of the tiles the search looked at
+	uint m_search_min_y; ///< northmost Y coordinate of the tiles the search looked at
+	uint m_search_max_x; ///< eastmost X coordinate of the tiles the search looked at
+	uint m_search_max_y; ///< southmost Y coordinate of the tiles the search looked at
+	bool m_search_saw_occupied_stop; ///< whether the search added a penalty for an occupied road stop
+
+	CYapfFollowRoadT() : m_search_min_x(UINT_MAX), m_search_min_y(UINT_MAX), m_search_max_x(0), m_search_max_y(0), m_search_saw_occupied_stop(false) {}
+
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
 	{
@@ -328,6 +499,22 @@ protected:
 	}
 
 public:
+	/** Called by the cost provider for every tile the search looks at. */
+	inline void AddToSearchArea(TileIndex tile)
+	{
+		uint x = TileX(tile);
+		uint y = TileY(tile);
+		m_search_min_x = min(m_search_min_x, x);
+		m_search_min_y = min(m_search_min_y, y);
+		m_search_max_x = max(m_search_max_x, x);
+		m_search_max_y = max(m_search_max_y, y);
+	}
+
+	/** Called by the cost provider when it adds a penalty for an occupied road stop. */
+	inline void AddOccupiedRoadStop()
+	{
+		m_search_saw_occupied_stop = true;
+	}
 
 	/**
 	 * Called by YAPF to move from the given node to the next tile. For each
@@ -371,6 +558,27 @@ public:
 		/* select reachable trackdirs only */
 		src_trackdirs &= DiagdirReachesTrackdirs(enterdir);
 
+		/* vehicles doing the same search share the route for a while */
+		bool use_route_cache = _settings_game.pf.yapf.road_route_cache_age != 0;
+		RoadRouteCacheKey key;
+		if (use_route_cache) {
+			key.tile = tile;
+			key.dest_tile = v->dest_tile;
+			key.dest_station = v->current_order.IsType(OT_GOTO_STATION) ? v->current_order.GetDestination() : INVALID_STATION;
+			key.enterdir = enterdir;
+			key.flags = (v->IsBus() ? RRCF_BUS : 0) | (v->HasArticulatedPart() ? 0 : RRCF_NON_ARTICULATED) |
+					(_settings_game.pf.yapf.disable_node_optimization ? RRCF_TRACKDIR_NODES : 0);
+			key.roadtypes = v->compatible_roadtypes;
+			key.max_speed = v->GetDisplayMaxSpeed();
+
+			const RoadRouteCacheEntry *entry = FindRoadRouteCacheEntry(key);
+			if (entry != NULL) {
+				path_found = true;
+				path_cache = entry->path;
+				return (Trackdir)entry->next_trackdir;
+			}
+		}
+
 		/* set origin and destination nodes */
 		Yapf().SetOrigin(src_tile, src_trackdirs);
 		Yapf().SetDestination(v);
@@ -406,6 +614,8 @@ public:
 				path_cache.td.pop_back();
 				path_cache.tile.pop_back();
 			}
+			/* The occupation of road stops changes all the time, so such routes are not shared. */
+			if (use_route_cache && path_found && !m_search_saw_occupied_stop) StoreRoadRouteCacheEntry(key, next_trackdir, path_cache, m_search_min_x, m_search_min_y, m_search_max_x, m_search_max_y);
 		}
 		return next_trackdir;
 	}
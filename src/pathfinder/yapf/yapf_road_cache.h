@@ -0,0 +1,71 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_road_cache.h Routes of road vehicles shared between vehicles with the same destination. */
+
+#ifndef YAPF_ROAD_CACHE_H
+#define YAPF_ROAD_CACHE_H
+
+#include "../../roadveh.h"
+#include <map>
+#include <vector>
+
+static const uint ROAD_ROUTE_CACHE_REGION_SIZE = 32;   ///< Width and height in tiles of the regions in which road changes are counted.
+static const uint ROAD_ROUTE_CACHE_MAX_ENTRIES = 4096; ///< Maximum number of routes in the cache.
+
+/** Flags of the road vehicle route search that are part of the key of the route cache. */
+enum RoadRouteCacheFlags {
+	RRCF_BUS             = 1 << 0, ///< The vehicle is a bus.
+	RRCF_NON_ARTICULATED = 1 << 1, ///< The vehicle has no articulated parts.
+	RRCF_TRACKDIR_NODES  = 1 << 2, ///< The search uses trackdirs instead of exit directions as node keys.
+};
+
+/** Everything a route search of a road vehicle depends on besides the roads. */
+struct RoadRouteCacheKey {
+	TileIndex tile;         ///< The tile the vehicle is about to enter.
+	TileIndex dest_tile;    ///< The destination tile of the vehicle.
+	StationID dest_station; ///< The destination station, or #INVALID_STATION when going to a tile.
+	byte enterdir;          ///< The direction the vehicle enters #tile in.
+	byte flags;             ///< The #RoadRouteCacheFlags.
+	byte roadtypes;         ///< The road types the vehicle can drive on.
+	uint16 max_speed;       ///< The maximum speed of the vehicle, which affects the cost of speed limits.
+
+	bool operator <(const RoadRouteCacheKey &other) const
+	{
+		if (this->tile != other.tile) return this->tile < other.tile;
+		if (this->dest_tile != other.dest_tile) return this->dest_tile < other.dest_tile;
+		if (this->dest_station != other.dest_station) return this->dest_station < other.dest_station;
+		if (this->enterdir != other.enterdir) return this->enterdir < other.enterdir;
+		if (this->flags != other.flags) return this->flags < other.flags;
+		if (this->roadtypes != other.roadtypes) return this->roadtypes < other.roadtypes;
+		return this->max_speed < other.max_speed;
+	}
+};
+
+/** The result of a route search of a road vehicle, and the area the search looked at. */
+struct RoadRouteCacheEntry {
+	uint32 serial;            ///< Value of #_road_route_cache_serial when the route was searched.
+	int64 time;               ///< Tick at which the route was searched.
+	uint16 min_x;             ///< Westmost X coordinate of the regions the search looked at.
+	uint16 min_y;             ///< Northmost Y coordinate of the regions the search looked at.
+	uint16 max_x;             ///< Eastmost X coordinate of the regions the search looked at.
+	uint16 max_y;             ///< Southmost Y coordinate of the regions the search looked at.
+	byte next_trackdir;       ///< The trackdir to take on the entered tile.
+	RoadVehPathCache path;    ///< The path cache of the vehicle after the search.
+};
+
+typedef std::map<RoadRouteCacheKey, RoadRouteCacheEntry> RoadRouteCache;
+
+extern RoadRouteCache _road_route_cache;
+extern std::vector<uint32> _road_route_cache_region_serials;
+extern uint32 _road_route_cache_serial;
+
+void InitializeRoadRouteCache();
+
+#endif /* YAPF_ROAD_CACHE_H */
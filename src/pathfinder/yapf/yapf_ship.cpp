@@ -14,6 +14,7 @@
 
 #include "yapf.hpp"
 #include "yapf_node_ship.hpp"
+#include "../water_regions.h"
 
 #include "../../safeguards.h"
 
@@ -28,6 +29,8 @@ public:
 	typedef typename Node::Key Key;                      ///< key to hash tables
 
 protected:
+	std::vector<WaterRegionPatchDesc> m_corridor; ///< The water region patches the search may use; empty to use all water.
+
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
 	{
@@ -35,6 +38,16 @@ protected:
 	}
 
 public:
+	/**
+	 * Limit the search to a number of water region patches.
+	 * @param begin The first patch.
+	 * @param end The end of the patches.
+	 */
+	void SetCorridor(std::vector<WaterRegionPatchDesc>::const_iterator begin, std::vector<WaterRegionPatchDesc>::const_iterator end)
+	{
+		m_corridor.assign(begin, end);
+	}
+
 	/**
 	 * Called by YAPF to move from the given node to the next tile. For each
 	 *  reachable trackdir on the new tile creates new node, initializes it
@@ -44,6 +57,7 @@ public:
 	{
 		TrackFollower F(Yapf().GetVehicle());
 		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td)) {
+			if (!m_corridor.empty() && std::find(m_corridor.begin(), m_corridor.end(), GetWaterRegionPatchInfo(F.m_new_tile)) == m_corridor.end()) return;
 			Yapf().AddMultipleNodes(&old_node, F);
 		}
 	}
@@ -54,35 +68,18 @@ public:
 		return 'w';
 	}
 
-	static Trackdir ChooseShipTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, ShipPathCache &path_cache)
+	/**
+	 * Run the search of a pathfinder and fill the path cache from its result.
+	 * @param pf The pathfinder with its origin and destination set.
+	 * @param v The ship.
+	 * @param tile The tile the ship is about to enter.
+	 * @param[out] path_found Whether the destination of \a pf was reached.
+	 * @param[out] path_cache The trackdirs after the returned one.
+	 * @param final_destination Whether the destination of \a pf is the destination of the ship.
+	 * @return The trackdir to take on \a tile, or #INVALID_TRACKDIR when no way was found.
+	 */
+	static Trackdir FindShipPath(Tpf &pf, const Ship *v, TileIndex tile, bool &path_found, ShipPathCache &path_cache, bool final_destination)
 	{
-		/* handle special case - when next tile is destination tile */
-		if (tile == v->dest_tile) {
-			/* convert tracks to trackdirs */
-			TrackdirBits trackdirs = TrackBitsToTrackdirBits(tracks);
-			/* limit to trackdirs reachable from enterdir */
-			trackdirs &= DiagdirReachesTrackdirs(enterdir);
-
-			/* use vehicle's current direction if that's possible, otherwise use first usable one. */
-			Trackdir veh_dir = v->GetVehicleTrackdir();
-			return (HasTrackdir(trackdirs, veh_dir)) ? veh_dir : (Trackdir)FindFirstBit2x64(trackdirs);
-		}
-
-		/* move back to the old tile/trackdir (where ship is coming from) */
-		TileIndex src_tile = TileAddByDiagDir(tile, ReverseDiagDir(enterdir));
-		Trackdir trackdir = v->GetVehicleTrackdir();
-		assert(IsValidTrackdir(trackdir));
-
-		/* convert origin trackdir to TrackdirBits */
-		TrackdirBits trackdirs = TrackdirToTrackdirBits(trackdir);
-		/* get available trackdirs on the destination tile */
-		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
-
-		/* create pathfinder instance */
-		Tpf pf;
-		/* set origin and destination nodes */
-		pf.SetOrigin(src_tile, trackdirs);
-		pf.SetDestination(v->dest_tile, dest_trackdirs);
 		/* find best path */
 		path_found = pf.FindPath(v);
 
@@ -110,11 +107,83 @@ public:
 			assert(best_next_node.GetTile() == tile);
 			next_trackdir = best_next_node.GetTrackdir();
 			/* remove last element for the special case when tile == dest_tile */
-			if (path_found && !path_cache.empty()) path_cache.pop_back();
+			if (final_destination && path_found && !path_cache.empty()) path_cache.pop_back();
 		}
 		return next_trackdir;
 	}
 
+	static Trackdir ChooseShipTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, ShipPathCache &path_cache)
+	{
+		/* handle special case - when next tile is destination tile */
+		if (tile == v->dest_tile) {
+			/* convert tracks to trackdirs */
+			TrackdirBits trackdirs = TrackBitsToTrackdirBits(tracks);
+			/* limit to trackdirs reachable from enterdir */
+			trackdirs &= DiagdirReachesTrackdirs(enterdir);
+
+			/* use vehicle's current direction if that's possible, otherwise use first usable one. */
+			Trackdir veh_dir = v->GetVehicleTrackdir();
+			return (HasTrackdir(trackdirs, veh_dir)) ? veh_dir : (Trackdir)FindFirstBit2x64(trackdirs);
+		}
+
+		/* move back to the old tile/trackdir (where ship is coming from) */
+		TileIndex src_tile = TileAddByDiagDir(tile, ReverseDiagDir(enterdir));
+		Trackdir trackdir = v->GetVehicleTrackdir();
+		assert(IsValidTrackdir(trackdir));
+
+		/* convert origin trackdir to TrackdirBits */
+		TrackdirBits trackdirs = TrackdirToTrackdirBits(trackdir);
+		/* get available trackdirs on the destination tile */
+		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
+
+		uint8 water_regions = _settings_game.pf.yapf.ship_water_regions;
+		bool region_path_found = false;
+		bool guided = false;
+		Trackdir next_trackdir = INVALID_TRACKDIR;
+
+		if (water_regions != 0) {
+			/* Find the water region patches to the destination first, and only search the tiles of the next few of them. */
+			std::vector<WaterRegionPatchDesc> region_path;
+			region_path_found = FindWaterRegionPath(tile, v->dest_tile, _settings_game.pf.yapf.max_search_nodes, region_path);
+			if (region_path_found) {
+				bool final_destination = region_path.size() <= YAPF_SHIP_REGION_LOOKAHEAD + 1;
+				size_t corridor = final_destination ? region_path.size() : YAPF_SHIP_REGION_LOOKAHEAD + 1;
+
+				Tpf pf;
+				pf.SetOrigin(src_tile, trackdirs);
+				pf.SetDestination(v->dest_tile, dest_trackdirs);
+				pf.SetCorridor(region_path.begin(), region_path.begin() + corridor);
+				if (!final_destination) pf.SetDestinationPatch(region_path[corridor - 1]);
+				next_trackdir = FindShipPath(pf, v, tile, guided, path_cache, final_destination);
+				if (!guided) path_cache.clear();
+			}
+		}
+
+		if (!guided || water_regions == 2) {
+			/* Search all water, either because the water regions did not lead anywhere or to check them. */
+			ShipPathCache plain_path_cache;
+			bool plain_path_found;
+			Tpf pf;
+			pf.SetOrigin(src_tile, trackdirs);
+			pf.SetDestination(v->dest_tile, dest_trackdirs);
+			Trackdir plain_trackdir = FindShipPath(pf, v, tile, plain_path_found, plain_path_cache, true);
+
+			if (water_regions == 2 && plain_path_found != region_path_found) {
+				DEBUG(yapf, 0, "Ship %u from tile 0x%X to tile 0x%X: the water regions %s a path, but the tiles %s", v->unitnumber, tile, v->dest_tile,
+						region_path_found ? "have" : "have no", plain_path_found ? "have one" : "have none");
+			}
+
+			if (!guided) {
+				path_found = plain_path_found;
+				path_cache.swap(plain_path_cache);
+				return plain_trackdir;
+			}
+		}
+
+		path_found = true;
+		return next_trackdir;
+	}
+
 	/**
 	 * Check whether a ship should reverse to reach its destination.
 	 * Called when leaving depot.
@@ -152,6 +221,72 @@ public:
 	}
 };
 
+/**
+ * Destination module of YAPF for ships. Besides the destination tile this can be
+ *  any tile of a water region patch on the way to the destination tile.
+ */
+template <class Types>
+class CYapfDestinationShipT : public CYapfDestinationTileT<Types>
+{
+public:
+	typedef CYapfDestinationTileT<Types> Base;    ///< the destination tile module
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+
+protected:
+	bool                 m_has_dest_patch; ///< whether the destination is a water region patch
+	WaterRegionPatchDesc m_dest_patch;     ///< the destination water region patch
+
+public:
+	CYapfDestinationShipT() : m_has_dest_patch(false) {}
+
+	/** set a water region patch as the destination instead of the destination tile */
+	void SetDestinationPatch(const WaterRegionPatchDesc &patch)
+	{
+		m_has_dest_patch = true;
+		m_dest_patch = patch;
+	}
+
+	/** Called by YAPF to detect if node ends in the desired destination */
+	inline bool PfDetectDestination(Node &n)
+	{
+		if (!m_has_dest_patch) return Base::PfDetectDestination(n);
+		return GetWaterRegionPatchInfo(n.GetTile()) == m_dest_patch;
+	}
+
+	/**
+	 * Called by YAPF to calculate cost estimate. For a water region patch it is
+	 *  the distance to the nearest tile of its region.
+	 */
+	inline bool PfCalcEstimate(Node &n)
+	{
+		if (!m_has_dest_patch) return Base::PfCalcEstimate(n);
+
+		static const int dg_dir_to_x_offs[] = {-1, 0, 1, 0};
+		static const int dg_dir_to_y_offs[] = {0, 1, 0, -1};
+		if (PfDetectDestination(n)) {
+			n.m_estimate = n.m_cost;
+			return true;
+		}
+
+		TileIndex tile = n.GetTile();
+		DiagDirection exitdir = TrackdirToExitdir(n.GetTrackdir());
+		int x1 = 2 * TileX(tile) + dg_dir_to_x_offs[(int)exitdir];
+		int y1 = 2 * TileY(tile) + dg_dir_to_y_offs[(int)exitdir];
+		int min_x = 2 * m_dest_patch.x * WATER_REGION_EDGE_LENGTH;
+		int min_y = 2 * m_dest_patch.y * WATER_REGION_EDGE_LENGTH;
+		int max_x = min_x + 2 * (WATER_REGION_EDGE_LENGTH - 1);
+		int max_y = min_y + 2 * (WATER_REGION_EDGE_LENGTH - 1);
+		int dx = x1 < min_x ? min_x - x1 : (x1 > max_x ? x1 - max_x : 0);
+		int dy = y1 < min_y ? min_y - y1 : (y1 > max_y ? y1 - max_y : 0);
+		int dmin = min(dx, dy);
+		int dxy = abs(dx - dy);
+		int d = max(dmin * YAPF_TILE_CORNER_LENGTH + (dxy - 1) * (YAPF_TILE_LENGTH / 2), 0);
+		n.m_estimate = n.m_cost + d;
+		assert(n.m_estimate >= n.m_parent->m_estimate);
+		return true;
+	}
+};
+
 /** Cost Provider module of YAPF for ships */
 template <class Types>
 class CYapfCostShipT
@@ -232,7 +367,7 @@ struct CYapfShip_TypesT
 	typedef CYapfBaseT<Types>                 PfBase;        // base pathfinder class
 	typedef CYapfFollowShipT<Types>           PfFollow;      // node follower
 	typedef CYapfOriginTileT<Types>           PfOrigin;      // origin provider
-	typedef CYapfDestinationTileT<Types>      PfDestination; // destination/distance provider
+	typedef CYapfDestinationShipT<Types>      PfDestination; // destination/distance provider
 	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;       // segment cost cache provider
 	typedef CYapfCostShipT<Types>             PfCost;        // cost provider
 };
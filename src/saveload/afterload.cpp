@@ -32,6 +32,8 @@
 #include "../roadstop_base.h"
 #include "../tunnelbridge_map.h"
 #include "../pathfinder/yapf/yapf_cache.h"
+#include "../pathfinder/yapf/yapf_road_cache.h"
+#include "../pathfinder/water_regions.h"
 #include "../elrail_func.h"
 #include "../signs_func.h"
 #include "../aircraft.h"
@@ -3135,6 +3137,13 @@ bool AfterLoadGame()
 	AfterLoadLabelMaps();
 	AfterLoadCompanyStats();
 	AfterLoadStoryBook();
+	InitializeWaterRegions();
+
+	/* Routes shared between road vehicles are only valid together with the counters of the road changes. */
+	if (IsSavegameVersionBefore(SLV_ROAD_ROUTE_CACHE) ||
+			_road_route_cache_region_serials.size() != (MapSizeX() / ROAD_ROUTE_CACHE_REGION_SIZE) * (MapSizeY() / ROAD_ROUTE_CACHE_REGION_SIZE)) {
+		InitializeRoadRouteCache();
+	}
 
 	GamelogPrintDebug(1);
 
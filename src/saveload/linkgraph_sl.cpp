@@ -15,6 +15,7 @@
 #include "../linkgraph/linkgraphschedule.h"
 #include "../settings_internal.h"
 #include "saveload.h"
+#include <algorithm>
 
 #include "../safeguards.h"
 
@@ -24,6 +25,8 @@ typedef LinkGraph::BaseEdge Edge;
 const SettingDesc *GetSettingDescription(uint index);
 
 static uint16 _num_nodes;
+static uint16 _num_edges;
+static NodeID _next_edge;
 
 /**
  * Get a SaveLoad array for a link graph.
@@ -114,6 +117,7 @@ static const SaveLoad _node_desc[] = {
 	    SLE_VAR(Node, demand,      SLE_UINT32),
 	    SLE_VAR(Node, station,     SLE_UINT16),
 	    SLE_VAR(Node, last_update, SLE_INT32),
+	SLEG_CONDVAR(_num_edges,       SLE_UINT16, SLV_LINKGRAPH_EDGES, SL_MAX_VERSION),
 	    SLE_END()
 };
 
@@ -126,10 +130,22 @@ static const SaveLoad _edge_desc[] = {
 	     SLE_VAR(Edge, usage,                    SLE_UINT32),
 	     SLE_VAR(Edge, last_unrestricted_update, SLE_INT32),
 	 SLE_CONDVAR(Edge, last_restricted_update,   SLE_INT32, SLV_187, SL_MAX_VERSION),
-	     SLE_VAR(Edge, next_edge,                SLE_UINT16),
+	SLEG_CONDVAR(_next_edge,                     SLE_UINT16, SL_MIN_VERSION, SLV_LINKGRAPH_EDGES),
+	 SLE_CONDVAR(Edge, dest_node,                SLE_UINT16, SLV_LINKGRAPH_EDGES, SL_MAX_VERSION),
 	     SLE_END()
 };
 
+/**
+ * Compare edges by their destination.
+ * @param a First edge.
+ * @param b Second edge.
+ * @return If \a a leads to a node with a lower ID than \a b.
+ */
+static bool EdgeDestinationSorter(const Edge &a, const Edge &b)
+{
+	return a.dest_node < b.dest_node;
+}
+
 /**
  * Save/load a link graph.
  * @param lg Link graph to be saved or loaded.
@@ -139,16 +155,40 @@ void SaveLoad_LinkGraph(LinkGraph &lg)
 	uint size = lg.Size();
 	for (NodeID from = 0; from < size; ++from) {
 		Node *node = &lg.nodes[from];
+		LinkGraph::EdgeVector &edges = lg.edges[from];
+		_num_edges = (uint16)edges.size();
 		SlObject(node, _node_desc);
 		if (IsSavegameVersionBefore(SLV_191)) {
-			/* We used to save the full matrix ... */
+			/* We used to save the full matrix, with the edges of a node chained
+			 * by next_edge starting at the edge to itself ... */
+			std::vector<Edge> row(size);
+			std::vector<NodeID> next(size);
 			for (NodeID to = 0; to < size; ++to) {
-				SlObject(&lg.edges[from][to], _edge_desc);
+				row[to].Init();
+				SlObject(&row[to], _edge_desc);
+				next[to] = _next_edge;
+			}
+			for (NodeID to = next[from]; to != INVALID_NODE; to = next[to]) {
+				row[to].dest_node = to;
+				edges.push_back(row[to]);
+			}
+			std::sort(edges.begin(), edges.end(), EdgeDestinationSorter);
+		} else if (IsSavegameVersionBefore(SLV_LINKGRAPH_EDGES)) {
+			/* ... then only the chain itself ... */
+			for (NodeID to = from; to != INVALID_NODE; to = _next_edge) {
+				Edge edge;
+				edge.Init();
+				SlObject(&edge, _edge_desc);
+				if (to == from) continue;
+				edge.dest_node = to;
+				edges.push_back(edge);
 			}
+			std::sort(edges.begin(), edges.end(), EdgeDestinationSorter);
 		} else {
-			/* ... but as that wasted a lot of space we save a sparse matrix now. */
-			for (NodeID to = from; to != INVALID_NODE; to = lg.edges[from][to].next_edge) {
-				SlObject(&lg.edges[from][to], _edge_desc);
+			/* ... and now the sorted edge list, including the destinations. */
+			edges.resize(_num_edges);
+			for (LinkGraph::EdgeVector::iterator edge = edges.begin(); edge != edges.end(); ++edge) {
+				SlObject(&*edge, _edge_desc);
 			}
 		}
 	}
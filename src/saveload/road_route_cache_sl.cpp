@@ -0,0 +1,95 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file road_route_cache_sl.cpp Code handling saving and loading of the routes shared between road vehicles. */
+
+#include "../stdafx.h"
+#include "../pathfinder/yapf/yapf_road_cache.h"
+
+#include "saveload.h"
+
+#include "../safeguards.h"
+
+/** Temporary storage of a shared route for loading or saving it. */
+struct TempRoadRoute {
+	RoadRouteCacheKey key;
+	RoadRouteCacheEntry entry;
+};
+
+/** Description of the #TempRoadRoute structure for the purpose of load and save. */
+static const SaveLoad _road_route_desc[] = {
+	    SLE_VAR(TempRoadRoute, key.tile,            SLE_UINT32),
+	    SLE_VAR(TempRoadRoute, key.dest_tile,       SLE_UINT32),
+	    SLE_VAR(TempRoadRoute, key.dest_station,    SLE_UINT16),
+	    SLE_VAR(TempRoadRoute, key.enterdir,        SLE_UINT8),
+	    SLE_VAR(TempRoadRoute, key.flags,           SLE_UINT8),
+	    SLE_VAR(TempRoadRoute, key.roadtypes,       SLE_UINT8),
+	    SLE_VAR(TempRoadRoute, key.max_speed,       SLE_UINT16),
+	    SLE_VAR(TempRoadRoute, entry.serial,        SLE_UINT32),
+	    SLE_VAR(TempRoadRoute, entry.time,          SLE_INT64),
+	    SLE_VAR(TempRoadRoute, entry.min_x,         SLE_UINT16),
+	    SLE_VAR(TempRoadRoute, entry.min_y,         SLE_UINT16),
+	    SLE_VAR(TempRoadRoute, entry.max_x,         SLE_UINT16),
+	    SLE_VAR(TempRoadRoute, entry.max_y,         SLE_UINT16),
+	    SLE_VAR(TempRoadRoute, entry.next_trackdir, SLE_UINT8),
+	SLE_CONDDEQUE(TempRoadRoute, entry.path.td,     SLE_UINT8,  SLV_ROAD_ROUTE_CACHE, SL_MAX_VERSION),
+	SLE_CONDDEQUE(TempRoadRoute, entry.path.tile,   SLE_UINT32, SLV_ROAD_ROUTE_CACHE, SL_MAX_VERSION),
+	SLE_END()
+};
+
+/** Save the shared routes of road vehicles. */
+static void Save_RVRC()
+{
+	TempRoadRoute route;
+
+	int i = 0;
+	for (RoadRouteCache::const_iterator it = _road_route_cache.begin(); it != _road_route_cache.end(); ++it) {
+		route.key = it->first;
+		route.entry = it->second;
+
+		SlSetArrayIndex(i++);
+		SlObject(&route, _road_route_desc);
+	}
+}
+
+/** Load the shared routes of road vehicles. */
+static void Load_RVRC()
+{
+	TempRoadRoute route;
+
+	_road_route_cache.clear();
+	while (SlIterateArray() != -1) {
+		route.entry.path.clear();
+		SlObject(&route, _road_route_desc);
+		_road_route_cache[route.key] = route.entry;
+	}
+}
+
+/** Save the counters of the road changes. */
+static void Save_RVRS()
+{
+	SlSetLength((1 + _road_route_cache_region_serials.size()) * sizeof(uint32));
+	SlArray(&_road_route_cache_serial, 1, SLE_UINT32);
+	SlArray(_road_route_cache_region_serials.data(), _road_route_cache_region_serials.size(), SLE_UINT32);
+}
+
+/** Load the counters of the road changes. */
+static void Load_RVRS()
+{
+	size_t count = SlGetFieldLength() / sizeof(uint32) - 1;
+	SlArray(&_road_route_cache_serial, 1, SLE_UINT32);
+	_road_route_cache_region_serials.resize(count);
+	SlArray(_road_route_cache_region_serials.data(), count, SLE_UINT32);
+}
+
+/** Chunk definition of the routes shared between road vehicles. */
+extern const ChunkHandler _road_route_cache_chunk_handlers[] = {
+	{ 'RVRC', Save_RVRC, Load_RVRC, NULL, NULL, CH_ARRAY},
+	{ 'RVRS', Save_RVRS, Load_RVRS, NULL, NULL, CH_RIFF | CH_LAST},
+};
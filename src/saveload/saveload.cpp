@@ -45,6 +45,7 @@
 #include "../string_func.h"
 #include "../fios.h"
 #include "../error.h"
+#include "../thread/worker_pool.h"
 
 #include "table/strings.h"
 
@@ -61,7 +62,7 @@ FileToSaveLoad _file_to_saveload; ///< File to save or load in the openttd loop.
 uint32 _ttdp_version;        ///< version of TTDP savegame (if applicable)
 SaveLoadVersion _sl_version; ///< the major savegame version identifier
 byte   _sl_minor_version;    ///< the minor savegame version, DO NOT USE!
-char _savegame_format[8];    ///< how to compress savegames
+char _savegame_format[16];   ///< how to compress savegames
 bool _do_autosave;           ///< are we doing an autosave at the moment?
 
 /** What are we currently doing? */
@@ -238,6 +239,7 @@ extern const ChunkHandler _linkgraph_chunk_handlers[];
 extern const ChunkHandler _airport_chunk_handlers[];
 extern const ChunkHandler _object_chunk_handlers[];
 extern const ChunkHandler _persistent_storage_chunk_handlers[];
+extern const ChunkHandler _road_route_cache_chunk_handlers[];
 
 /** Array of all chunks in a savegame, \c NULL terminated. */
 static const ChunkHandler * const _chunk_handlers[] = {
@@ -274,6 +276,7 @@ static const ChunkHandler * const _chunk_handlers[] = {
 	_airport_chunk_handlers,
 	_object_chunk_handlers,
 	_persistent_storage_chunk_handlers,
+	_road_route_cache_chunk_handlers,
 	NULL,
 };
 
@@ -373,6 +376,21 @@ void NORETURN SlErrorCorruptFmt(const char *format, ...)
 typedef void (*AsyncSaveFinishProc)();                ///< Callback for when the savegame loading is finished.
 static AsyncSaveFinishProc _async_save_finish = NULL; ///< Callback to call when the savegame loading is finished.
 static ThreadObject *_save_thread;                    ///< The thread we're using to compress and write a savegame
+static ThreadMutex *_save_thread_mutex = NULL;        ///< Mutex for the savegame thread to wait for the main thread with.
+static bool _waiting_till_saved = false;              ///< Whether the main thread is waiting for the savegame thread to finish.
+
+/**
+ * Get the mutex for the savegame thread to wait for the main thread with.
+ * The main thread signals it when it handled the finish of a previous save,
+ * and when it starts waiting for the savegame thread to finish. Filters of
+ * the savegame that wait for the main thread use it as well.
+ * @return The mutex.
+ */
+ThreadMutex *GetSaveThreadMutex()
+{
+	if (_save_thread_mutex == NULL) _save_thread_mutex = ThreadMutex::New();
+	return _save_thread_mutex;
+}
 
 /**
  * Called by save thread to tell we finished saving.
@@ -381,7 +399,9 @@ static ThreadObject *_save_thread;                    ///< The thread we're usin
 static void SetAsyncSaveFinish(AsyncSaveFinishProc proc)
 {
 	if (_exit_game) return;
-	while (_async_save_finish != NULL) CSleep(10);
+
+	ThreadMutexLocker lock(_save_thread_mutex);
+	while (_async_save_finish != NULL) _save_thread_mutex->WaitForSignal();
 
 	_async_save_finish = proc;
 }
@@ -395,7 +415,10 @@ void ProcessAsyncSaveFinish()
 
 	_async_save_finish();
 
+	_save_thread_mutex->BeginCritical();
 	_async_save_finish = NULL;
+	_save_thread_mutex->SendSignal();
+	_save_thread_mutex->EndCritical();
 
 	if (_save_thread != NULL) {
 		_save_thread->Join();
@@ -2268,6 +2291,395 @@ struct LZMASaveFilter : SaveFilter {
 
 #endif /* WITH_LIBLZMA */
 
+/********************************************
+ ********** START OF ZSTD CODE **************
+ ********************************************/
+
+#if defined(WITH_ZSTD)
+#include <zstd.h>
+
+/** Filter using Zstandard compression. */
+struct ZstdLoadFilter : LoadFilter {
+	ZSTD_DStream *zstd;                ///< Stream state we are reading from.
+	ZSTD_inBuffer input;               ///< Part of the read buffer that still has to be decompressed.
+	byte fread_buf[MEMORY_CHUNK_SIZE]; ///< Buffer for reading from the file.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain The next filter in this chain.
+	 */
+	ZstdLoadFilter(LoadFilter *chain) : LoadFilter(chain), zstd(ZSTD_createDStream())
+	{
+		this->input.src = this->fread_buf;
+		this->input.size = 0;
+		this->input.pos = 0;
+		if (this->zstd == NULL || ZSTD_isError(ZSTD_initDStream(this->zstd))) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize decompressor");
+	}
+
+	/** Clean everything up. */
+	~ZstdLoadFilter()
+	{
+		ZSTD_freeDStream(this->zstd);
+	}
+
+	size_t Read(byte *buf, size_t size) override
+	{
+		ZSTD_outBuffer output = { buf, size, 0 };
+
+		do {
+			/* read more bytes from the file? */
+			if (this->input.pos == this->input.size) {
+				this->input.size = this->chain->Read(this->fread_buf, sizeof(this->fread_buf));
+				this->input.pos = 0;
+				if (this->input.size == 0) break;
+			}
+
+			/* inflate the data */
+			size_t r = ZSTD_decompressStream(this->zstd, &output, &this->input);
+			if (ZSTD_isError(r)) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "libzstd returned error code");
+			if (r == 0) break;
+		} while (output.pos != output.size);
+
+		return output.pos;
+	}
+};
+
+/** Filter using Zstandard compression. */
+struct ZstdSaveFilter : SaveFilter {
+	ZSTD_CStream *zstd; ///< Stream state that we are writing to.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain             The next filter in this chain.
+	 * @param compression_level The requested level of compression.
+	 */
+	ZstdSaveFilter(SaveFilter *chain, byte compression_level) : SaveFilter(chain), zstd(ZSTD_createCStream())
+	{
+		if (this->zstd == NULL || ZSTD_isError(ZSTD_initCStream(this->zstd, compression_level))) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize compressor");
+	}
+
+	/** Clean up what we allocated. */
+	~ZstdSaveFilter()
+	{
+		ZSTD_freeCStream(this->zstd);
+	}
+
+	void Write(byte *buf, size_t size) override
+	{
+		byte out[MEMORY_CHUNK_SIZE]; // output buffer
+		ZSTD_inBuffer input = { buf, size, 0 };
+
+		while (input.pos != input.size) {
+			ZSTD_outBuffer output = { out, sizeof(out), 0 };
+			size_t r = ZSTD_compressStream(this->zstd, &output, &input);
+			if (ZSTD_isError(r)) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "libzstd returned error code");
+
+			/* bytes were emitted? */
+			if (output.pos != 0) this->chain->Write(out, output.pos);
+		}
+	}
+
+	void Finish() override
+	{
+		byte out[MEMORY_CHUNK_SIZE]; // output buffer
+		size_t r;
+
+		do {
+			ZSTD_outBuffer output = { out, sizeof(out), 0 };
+			r = ZSTD_endStream(this->zstd, &output);
+			if (ZSTD_isError(r)) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "libzstd returned error code");
+
+			/* bytes were emitted? */
+			if (output.pos != 0) this->chain->Write(out, output.pos);
+		} while (r != 0);
+
+		this->chain->Finish();
+	}
+};
+
+#endif /* WITH_ZSTD */
+
+/*********************************************
+ ******** START OF BLOCK CONTAINER CODE ******
+ *********************************************/
+
+/*
+ * The block container splits the savegame into blocks that are compressed
+ * independently of each other, so the worker pool can (de)compress several
+ * blocks at the same time. Every block starts with the big endian size of its
+ * compressed and of its uncompressed data; a block with an uncompressed size
+ * of 0 ends the savegame. Checking the integrity of the data is left to the
+ * compression library.
+ */
+
+/** Maximum amount of uncompressed data in a single block of the block container. */
+static const size_t SAVE_BLOCK_SIZE = 1024 * 1024;
+
+/**
+ * Compress a block of the block container.
+ * @param in                Data to compress.
+ * @param in_size           Amount of data to compress.
+ * @param out               Buffer to store the compressed data in; it is resized as needed.
+ * @param compression_level The requested level of compression.
+ * @return Whether compressing succeeded.
+ * @note Called from the worker threads, so this must not call SlError.
+ */
+typedef bool BlockCompressProc(const byte *in, size_t in_size, std::vector<byte> &out, byte compression_level);
+
+/**
+ * Decompress a block of the block container.
+ * @param in       Data to decompress.
+ * @param in_size  Amount of data to decompress.
+ * @param out      Buffer to store the decompressed data in.
+ * @param out_size Expected amount of decompressed data.
+ * @return Whether decompressing succeeded and resulted in exactly \a out_size bytes.
+ * @note Called from the worker threads, so this must not call SlError.
+ */
+typedef bool BlockDecompressProc(const byte *in, size_t in_size, byte *out, size_t out_size);
+
+/** A block of the block container, while being (de)compressed. */
+struct SaveLoadBlock {
+	std::vector<byte> data;   ///< Uncompressed data.
+	std::vector<byte> packed; ///< Compressed data.
+	byte compression_level;   ///< Level of compression to use when saving.
+	bool ok;                  ///< Whether (de)compressing succeeded.
+	WorkerJobTicket ticket;   ///< Ticket of the (de)compression job.
+
+	SaveLoadBlock() : compression_level(0), ok(false) {}
+};
+
+/**
+ * Get the number of blocks that may be (de)compressed at the same time. A few
+ * blocks per thread keep everybody busy, while limiting the memory use.
+ * @return The maximum number of pending blocks.
+ */
+static inline size_t GetMaxPendingSaveLoadBlocks()
+{
+	return 2 * (_worker_pool.GetWorkerCount() + 1);
+}
+
+/** Filter reading the block container. */
+template <BlockDecompressProc *Tdecompress>
+struct BlockLoadFilter : LoadFilter {
+	std::deque<SaveLoadBlock *> pending; ///< Blocks that have been read, in savegame order.
+	size_t pos;                          ///< Amount of data of the first pending block that has been returned already.
+	bool end;                            ///< Whether the last block has been read.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain The next filter in this chain.
+	 */
+	BlockLoadFilter(LoadFilter *chain) : LoadFilter(chain), pos(0), end(false)
+	{
+	}
+
+	/** Clean everything up. */
+	~BlockLoadFilter()
+	{
+		/* The jobs are still using the blocks. */
+		for (std::deque<SaveLoadBlock *>::iterator it = this->pending.begin(); it != this->pending.end(); ++it) {
+			_worker_pool.Wait(&(*it)->ticket);
+			delete *it;
+		}
+	}
+
+	/**
+	 * Job decompressing a single block.
+	 * @param block The SaveLoadBlock to decompress.
+	 */
+	static void DecompressBlock(void *block)
+	{
+		SaveLoadBlock *b = (SaveLoadBlock *)block;
+		b->ok = Tdecompress(b->packed.data(), b->packed.size(), b->data.data(), b->data.size());
+	}
+
+	/** Read the next block and queue it for decompression. */
+	void ReadBlock()
+	{
+		uint32 hdr[2];
+		if (this->chain->Read((byte*)hdr, sizeof(hdr)) != sizeof(hdr)) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE, "File read failed");
+
+		uint32 packed_size = FROM_BE32(hdr[0]);
+		uint32 size = FROM_BE32(hdr[1]);
+		if (size == 0) {
+			this->end = true;
+			return;
+		}
+		/* Compressing never makes data much larger; anything else is garbage. */
+		if (size > SAVE_BLOCK_SIZE || packed_size > 2 * SAVE_BLOCK_SIZE) SlErrorCorrupt("Inconsistent block size");
+
+		SaveLoadBlock *block = new SaveLoadBlock();
+		this->pending.push_back(block);
+		block->packed.resize(packed_size);
+		block->data.resize(size);
+		if (this->chain->Read(block->packed.data(), packed_size) != packed_size) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+
+		_worker_pool.Submit(&DecompressBlock, block, &block->ticket);
+	}
+
+	size_t Read(byte *buf, size_t size) override
+	{
+		size_t read = 0;
+		while (read < size) {
+			while (!this->end && this->pending.size() < GetMaxPendingSaveLoadBlocks()) this->ReadBlock();
+			if (this->pending.empty()) break;
+
+			SaveLoadBlock *block = this->pending.front();
+			_worker_pool.Wait(&block->ticket);
+			if (!block->ok) SlErrorCorrupt("Cannot decompress block");
+
+			size_t len = min(size - read, block->data.size() - this->pos);
+			memcpy(buf + read, block->data.data() + this->pos, len);
+			read += len;
+			this->pos += len;
+
+			if (this->pos == block->data.size()) {
+				this->pending.pop_front();
+				delete block;
+				this->pos = 0;
+			}
+		}
+		return read;
+	}
+};
+
+/** Filter writing the block container. */
+template <BlockCompressProc *Tcompress>
+struct BlockSaveFilter : SaveFilter {
+	byte compression_level;              ///< The requested level of compression.
+	SaveLoadBlock *current;              ///< Block that is being filled.
+	std::deque<SaveLoadBlock *> pending; ///< Blocks that are being compressed, in savegame order.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain             The next filter in this chain.
+	 * @param compression_level The requested level of compression.
+	 */
+	BlockSaveFilter(SaveFilter *chain, byte compression_level) : SaveFilter(chain), compression_level(compression_level), current(NULL)
+	{
+	}
+
+	/** Clean up what we allocated. */
+	~BlockSaveFilter()
+	{
+		/* The jobs are still using the blocks. */
+		for (std::deque<SaveLoadBlock *>::iterator it = this->pending.begin(); it != this->pending.end(); ++it) {
+			_worker_pool.Wait(&(*it)->ticket);
+			delete *it;
+		}
+		delete this->current;
+	}
+
+	/**
+	 * Job compressing a single block.
+	 * @param block The SaveLoadBlock to compress.
+	 */
+	static void CompressBlock(void *block)
+	{
+		SaveLoadBlock *b = (SaveLoadBlock *)block;
+		b->ok = Tcompress(b->data.data(), b->data.size(), b->packed, b->compression_level);
+	}
+
+	/** Wait for the oldest pending block and write it to the next filter. */
+	void WriteBlock()
+	{
+		SaveLoadBlock *block = this->pending.front();
+		_worker_pool.Wait(&block->ticket);
+		if (!block->ok) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot compress block");
+
+		uint32 hdr[2] = { TO_BE32((uint32)block->packed.size()), TO_BE32((uint32)block->data.size()) };
+		this->chain->Write((byte*)hdr, sizeof(hdr));
+		this->chain->Write(block->packed.data(), block->packed.size());
+
+		this->pending.pop_front();
+		delete block;
+	}
+
+	/** Queue the block that is being filled for compression. */
+	void SubmitBlock()
+	{
+		while (this->pending.size() >= GetMaxPendingSaveLoadBlocks()) this->WriteBlock();
+
+		SaveLoadBlock *block = this->current;
+		this->pending.push_back(block);
+		this->current = NULL;
+		_worker_pool.Submit(&CompressBlock, block, &block->ticket);
+
+		/* Pass on the blocks that are done already, so e.g. a map transfer can start early. */
+		while (!this->pending.empty() && this->pending.front()->ticket.IsDone()) this->WriteBlock();
+	}
+
+	void Write(byte *buf, size_t size) override
+	{
+		while (size > 0) {
+			if (this->current == NULL) {
+				this->current = new SaveLoadBlock();
+				this->current->compression_level = this->compression_level;
+				this->current->data.reserve(SAVE_BLOCK_SIZE);
+			}
+
+			size_t len = min(size, SAVE_BLOCK_SIZE - this->current->data.size());
+			this->current->data.insert(this->current->data.end(), buf, buf + len);
+			buf += len;
+			size -= len;
+
+			if (this->current->data.size() == SAVE_BLOCK_SIZE) this->SubmitBlock();
+		}
+	}
+
+	void Finish() override
+	{
+		if (this->current != NULL) this->SubmitBlock();
+		while (!this->pending.empty()) this->WriteBlock();
+
+		uint32 end[2] = { 0, 0 };
+		this->chain->Write((byte*)end, sizeof(end));
+		this->chain->Finish();
+	}
+};
+
+#if defined(WITH_ZLIB)
+/** Compress a block of the block container with zlib. @see BlockCompressProc */
+static bool ZlibCompressBlock(const byte *in, size_t in_size, std::vector<byte> &out, byte compression_level)
+{
+	uLongf out_size = compressBound((uLong)in_size);
+	out.resize(out_size);
+	if (compress2(out.data(), &out_size, in, (uLong)in_size, compression_level) != Z_OK) return false;
+	out.resize(out_size);
+	return true;
+}
+
+/** Decompress a block of the block container with zlib. @see BlockDecompressProc */
+static bool ZlibDecompressBlock(const byte *in, size_t in_size, byte *out, size_t out_size)
+{
+	uLongf len = (uLongf)out_size;
+	return uncompress(out, &len, in, (uLong)in_size) == Z_OK && len == out_size;
+}
+#endif /* WITH_ZLIB */
+
+#if defined(WITH_LIBLZMA)
+/** Compress a block of the block container with LZMA. @see BlockCompressProc */
+static bool LZMACompressBlock(const byte *in, size_t in_size, std::vector<byte> &out, byte compression_level)
+{
+	size_t out_size = 0;
+	out.resize(lzma_stream_buffer_bound(in_size));
+	if (lzma_easy_buffer_encode(compression_level, LZMA_CHECK_CRC32, NULL, in, in_size, out.data(), &out_size, out.size()) != LZMA_OK) return false;
+	out.resize(out_size);
+	return true;
+}
+
+/** Decompress a block of the block container with LZMA. @see BlockDecompressProc */
+static bool LZMADecompressBlock(const byte *in, size_t in_size, byte *out, size_t out_size)
+{
+	/* Same limit as for the streamed format; a block is a lot smaller anyway. */
+	uint64_t memlimit = 1 << 28;
+	size_t in_pos = 0;
+	size_t out_pos = 0;
+	if (lzma_stream_buffer_decode(&memlimit, 0, NULL, in, &in_pos, in_size, out, &out_pos, out_size) != LZMA_OK) return false;
+	return in_pos == in_size && out_pos == out_size;
+}
+#endif /* WITH_LIBLZMA */
+
 /*******************************************
  ************* END OF CODE *****************
  *******************************************/
@@ -2302,6 +2714,28 @@ static const SaveLoadFormat _saveload_formats[] = {
 	{"zlib",   TO_BE32X('OTTZ'), CreateLoadFilter<ZlibLoadFilter>,   CreateSaveFilter<ZlibSaveFilter>,   0, 6, 9},
 #else
 	{"zlib",   TO_BE32X('OTTZ'), NULL,                               NULL,                               0, 0, 0},
+#endif
+	/* The block variants compress blocks of 1 MiB in parallel using the worker pool. As the blocks don't share their history,
+	 * savegames become a few percent larger than with the streamed variants. The last available format is the default, so
+	 * these are listed before the streamed lzma format and only used when chosen with the savegame_format setting. */
+#if defined(WITH_ZLIB)
+	{"zlib-mt", TO_BE32X('OTBZ'), CreateLoadFilter<BlockLoadFilter<ZlibDecompressBlock> >, CreateSaveFilter<BlockSaveFilter<ZlibCompressBlock> >, 0, 6, 9},
+#else
+	{"zlib-mt", TO_BE32X('OTBZ'), NULL,                                                   NULL,                                                  0, 0, 0},
+#endif
+#if defined(WITH_LIBLZMA)
+	{"lzma-mt", TO_BE32X('OTBX'), CreateLoadFilter<BlockLoadFilter<LZMADecompressBlock> >, CreateSaveFilter<BlockSaveFilter<LZMACompressBlock> >, 0, 2, 9},
+#else
+	{"lzma-mt", TO_BE32X('OTBX'), NULL,                                                   NULL,                                                  0, 0, 0},
+#endif
+#if defined(WITH_ZSTD)
+	/* Level 3 compresses about as well as zlib level 6 in a fraction of the time, and decompresses several times faster than
+	 * both zlib and lzma, which makes joining servers quicker. Higher levels approach lzma level 2 savegame sizes, but don't
+	 * affect the decompression speed. Levels above 19 need a lot more memory and are therefore not offered. It is listed
+	 * before lzma so it is only used when chosen with the savegame_format setting and lzma stays the default. */
+	{"zstd",   TO_BE32X('OTTS'), CreateLoadFilter<ZstdLoadFilter>,   CreateSaveFilter<ZstdSaveFilter>,   1, 3, 19},
+#else
+	{"zstd",   TO_BE32X('OTTS'), NULL,                               NULL,                               0, 0, 0},
 #endif
 #if defined(WITH_LIBLZMA)
 	/* Level 2 compression is speed wise as fast as zlib level 6 compression (old default), but results in ~10% smaller saves.
@@ -2492,13 +2926,31 @@ static void SaveFileToDiskThread(void *arg)
 	SaveFileToDisk(true);
 }
 
+/**
+ * Check whether the main thread is waiting for the savegame thread to finish,
+ * or is saving itself. Filters that wait for the main thread, e.g. to limit
+ * their memory use, must stop waiting then. On the savegame thread this must
+ * be called while holding the mutex of #GetSaveThreadMutex.
+ * @return True if the main thread is waiting.
+ */
+bool IsWaitingTillSaved()
+{
+	return _waiting_till_saved;
+}
+
 void WaitTillSaved()
 {
 	if (_save_thread == NULL) return;
 
+	_save_thread_mutex->BeginCritical();
+	_waiting_till_saved = true;
+	_save_thread_mutex->SendSignal();
+	_save_thread_mutex->EndCritical();
+
 	_save_thread->Join();
 	delete _save_thread;
 	_save_thread = NULL;
+	_waiting_till_saved = false;
 
 	/* Make sure every other state is handled properly as well. */
 	ProcessAsyncSaveFinish();
@@ -2525,10 +2977,14 @@ static SaveOrLoadResult DoSave(SaveFilter *writer, bool threaded)
 	SlSaveChunks();
 
 	SaveFileStart();
+	GetSaveThreadMutex();
 	if (!threaded || !ThreadObject::New(&SaveFileToDiskThread, NULL, &_save_thread, "ottd:savegame")) {
 		if (threaded) DEBUG(sl, 1, "Cannot create savegame thread, reverting to single-threaded mode...");
 
+		/* Nothing else is going to happen on the main thread while it is saving. */
+		_waiting_till_saved = true;
 		SaveOrLoadResult result = SaveFileToDisk(false);
+		_waiting_till_saved = false;
 		SaveFileDone();
 
 		return result;
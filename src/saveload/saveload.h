@@ -15,6 +15,8 @@
 #include "../fileio_type.h"
 #include "../strings_type.h"
 
+class ThreadMutex;
+
 /** SaveLoad versions
  * Previous savegame versions, the trunk revision where they were
  * introduced and the released version that had that particular
@@ -298,6 +300,9 @@ enum SaveLoadVersion : uint16 {
 	SLV_ROADVEH_PATH_CACHE,                 ///< 211  PR#7261 Add path cache for road vehicles.
 	SLV_REMOVE_OPF,                         ///< 212  PR#7245 Remove OPF.
 	SLV_TREES_WATER_CLASS,                  ///< 213  PR#7405 WaterClass update for tree tiles.
+	SLV_LINKGRAPH_EDGES,                    ///< 214  Link graph edges saved as sorted lists with their destinations.
+	SLV_SHIP_WATER_REGIONS,                 ///< 215  Ships guided by water regions.
+	SLV_ROAD_ROUTE_CACHE,                   ///< 216  Routes shared between road vehicles.
 
 	SL_MAX_VERSION,                         ///< Highest possible saveload version
 };
@@ -340,6 +345,8 @@ void SetSaveLoadError(StringID str);
 const char *GetSaveLoadErrorString();
 SaveOrLoadResult SaveOrLoad(const char *filename, SaveLoadOperation fop, DetailedFileType dft, Subdirectory sb, bool threaded = true);
 void WaitTillSaved();
+bool IsWaitingTillSaved();
+ThreadMutex *GetSaveThreadMutex();
 void ProcessAsyncSaveFinish();
 void DoExitSave();
 
@@ -847,7 +854,7 @@ void NORETURN SlErrorCorruptFmt(const char *format, ...);
 
 bool SaveloadCrashWithMissingNewGRFs();
 
-extern char _savegame_format[8];
+extern char _savegame_format[16];
 extern bool _do_autosave;
 
 #endif /* SAVELOAD_H */
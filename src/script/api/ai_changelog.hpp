@@ -27,6 +27,10 @@
  * \li AIVehicle::BuildVehicleWithRefit
  * \li AIVehicle::GetBuildWithRefitCapacity
  *
+ * Other changes:
+ * \li AIList::Valuate runs the common getters of AITile, AIIndustry, AIStation
+ *     and AIEngine over the whole list at once, which is faster and mostly costs fewer opcodes.
+ *
  * \b 1.9.0
  *
  * API additions:
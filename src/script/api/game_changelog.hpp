@@ -23,6 +23,10 @@
  * \li GSVehicle::BuildVehicleWithRefit
  * \li GSVehicle::GetBuildWithRefitCapacity
  *
+ * Other changes:
+ * \li GSList::Valuate runs the common getters of GSTile, GSIndustry, GSStation
+ *     and GSEngine over the whole list at once, which is faster and mostly costs fewer opcodes.
+ *
  * \b 1.9.0
  *
  * API additions:
@@ -12,104 +12,112 @@
 #include "../../stdafx.h"
 #include "script_list.hpp"
 #include "script_controller.hpp"
+#include "script_engine.hpp"
+#include "script_industry.hpp"
+#include "script_station.hpp"
+#include "script_tile.hpp"
 #include "../../debug.h"
 #include "../../script/squirrel.hpp"
+#include "../../script/script_thread.hpp"
 
 #include "../../safeguards.h"
 
+/**
+ * Find an item in a list.
+ * @param items The items of the list.
+ * @param item The item to find.
+ * @return The item with its value, or items.end() if the item is not in the list.
+ */
+static ScriptList::ScriptListMap::iterator FindItem(ScriptList::ScriptListMap &items, int64 item)
+{
+	ScriptList::ScriptListMap::iterator iter = items.lower_bound(std::make_pair(item, INT64_MIN));
+	if (iter != items.end() && iter->first != item) return items.end();
+	return iter;
+}
+
+/**
+ * Remove all items of a list whose value matches a condition.
+ * The items are removed in the order of the items, like a loop over the items would.
+ * @param list The list to remove the items from.
+ * @param condition The condition on the value of the items to remove.
+ */
+template <typename Tcondition>
+static void RemoveValuesIf(ScriptList *list, Tcondition condition)
+{
+	std::vector<int64> remove;
+	for (ScriptList::ScriptListMap::iterator iter = list->items.begin(); iter != list->items.end(); iter++) {
+		if (condition((*iter).second)) remove.push_back((*iter).first);
+	}
+	for (std::vector<int64>::iterator iter = remove.begin(); iter != remove.end(); iter++) {
+		list->RemoveItem(*iter);
+	}
+}
+
 /**
  * Base class for any ScriptList sorter.
+ * The sorters do not keep iterators, as those are invalidated by any change
+ * of the list. Instead they remember the next item, which is always in the
+ * list: when it gets removed or its value gets changed, the sorter moves on
+ * to the item after it first.
  */
 class ScriptListSorter {
 protected:
 	ScriptList *list;       ///< The list that's being sorted.
 	bool has_no_more_items; ///< Whether we have more items to iterate over.
+	bool has_item_next;     ///< Whether item_next is valid, i.e. whether we did not run off the end of the list.
 	int64 item_next;        ///< The next item we will show.
 
-public:
 	/**
-	 * Virtual dtor, needed to mute warnings.
+	 * Get the first item of the list in the order of this sorter.
+	 * @pre The list is not empty.
 	 */
-	virtual ~ScriptListSorter() { }
+	virtual int64 GetFirst() = 0;
 
 	/**
-	 * Get the first item of the sorter.
+	 * Get the item that comes after an item in the order of this sorter.
+	 * @param item The item, which must be in the list.
+	 * @param[out] next The item after it.
+	 * @return False if \a item is the last item.
 	 */
-	virtual int64 Begin() = 0;
-
-	/**
-	 * Stop iterating a sorter.
-	 */
-	virtual void End() = 0;
-
-	/**
-	 * Get the next item of the sorter.
-	 */
-	virtual int64 Next() = 0;
+	virtual bool GetFollowing(int64 item, int64 *next) = 0;
 
+public:
 	/**
-	 * See if the sorter has reached the end.
+	 * Create a new sorter.
+	 * @param list The list to sort.
 	 */
-	bool IsEnd()
+	ScriptListSorter(ScriptList *list) : list(list)
 	{
-		return this->list->buckets.empty() || this->has_no_more_items;
+		this->End();
 	}
 
 	/**
-	 * Callback from the list if an item gets removed.
-	 */
-	virtual void Remove(int item) = 0;
-
-	/**
-	 * Attach the sorter to a new list. This assumes the content of the old list has been moved to
-	 * the new list, too, so that we don't have to invalidate any iterators. Note that std::swap
-	 * doesn't invalidate iterators on lists and maps, so that should be safe.
-	 * @param target New list to attach to.
+	 * Virtual dtor, needed to mute warnings.
 	 */
-	virtual void Retarget(ScriptList *new_list)
-	{
-		this->list = new_list;
-	}
-};
-
-/**
- * Sort by value, ascending.
- */
-class ScriptListSorterValueAscending : public ScriptListSorter {
-private:
-	ScriptList::ScriptListBucket::iterator bucket_iter;    ///< The iterator over the list to find the buckets.
-	ScriptList::ScriptItemList *bucket_list;               ///< The current bucket list we're iterator over.
-	ScriptList::ScriptItemList::iterator bucket_list_iter; ///< The iterator over the bucket list.
+	virtual ~ScriptListSorter() { }
 
-public:
 	/**
-	 * Create a new sorter.
-	 * @param list The list to sort.
+	 * Get the first item of the sorter.
 	 */
-	ScriptListSorterValueAscending(ScriptList *list)
-	{
-		this->list = list;
-		this->End();
-	}
-
 	int64 Begin()
 	{
-		if (this->list->buckets.empty()) return 0;
+		if (this->list->items.empty()) return 0;
 		this->has_no_more_items = false;
+		this->has_item_next = true;
 
-		this->bucket_iter = this->list->buckets.begin();
-		this->bucket_list = &(*this->bucket_iter).second;
-		this->bucket_list_iter = this->bucket_list->begin();
-		this->item_next = *this->bucket_list_iter;
+		this->item_next = this->GetFirst();
 
 		int64 item_current = this->item_next;
 		FindNext();
 		return item_current;
 	}
 
+	/**
+	 * Stop iterating a sorter.
+	 */
 	void End()
 	{
-		this->bucket_list = NULL;
+		this->has_item_next = false;
 		this->has_no_more_items = true;
 		this->item_next = 0;
 	}
@@ -119,24 +127,17 @@ public:
 	 */
 	void FindNext()
 	{
-		if (this->bucket_list == NULL) {
+		if (!this->has_item_next) {
 			this->has_no_more_items = true;
 			return;
 		}
 
-		this->bucket_list_iter++;
-		if (this->bucket_list_iter == this->bucket_list->end()) {
-			this->bucket_iter++;
-			if (this->bucket_iter == this->list->buckets.end()) {
-				this->bucket_list = NULL;
-				return;
-			}
-			this->bucket_list = &(*this->bucket_iter).second;
-			this->bucket_list_iter = this->bucket_list->begin();
-		}
-		this->item_next = *this->bucket_list_iter;
+		this->has_item_next = this->GetFollowing(this->item_next, &this->item_next);
 	}
 
+	/**
+	 * Get the next item of the sorter.
+	 */
 	int64 Next()
 	{
 		if (this->IsEnd()) return 0;
@@ -146,7 +147,19 @@ public:
 		return item_current;
 	}
 
-	void Remove(int item)
+	/**
+	 * See if the sorter has reached the end.
+	 */
+	bool IsEnd()
+	{
+		return this->list->items.empty() || this->has_no_more_items;
+	}
+
+	/**
+	 * Callback from the list if an item gets removed, or before its value gets changed.
+	 * @param item The item, which is still in the list with its old value.
+	 */
+	void Remove(int64 item)
 	{
 		if (this->IsEnd()) return;
 
@@ -156,102 +169,67 @@ public:
 			return;
 		}
 	}
+
+	/**
+	 * Attach the sorter to a new list. This assumes the content of the old list has been moved to
+	 * the new list, too, so that we don't have to invalidate the next item.
+	 * @param target New list to attach to.
+	 */
+	void Retarget(ScriptList *new_list)
+	{
+		this->list = new_list;
+	}
 };
 
 /**
- * Sort by value, descending.
+ * Sort by value, ascending.
  */
-class ScriptListSorterValueDescending : public ScriptListSorter {
-private:
-	/* Note: We cannot use reverse_iterator.
-	 *       The iterators must only be invalidated when the element they are pointing to is removed.
-	 *       This only holds for forward iterators. */
-	ScriptList::ScriptListBucket::iterator bucket_iter;    ///< The iterator over the list to find the buckets.
-	ScriptList::ScriptItemList *bucket_list;               ///< The current bucket list we're iterator over.
-	ScriptList::ScriptItemList::iterator bucket_list_iter; ///< The iterator over the bucket list.
-
+class ScriptListSorterValueAscending : public ScriptListSorter {
 public:
 	/**
 	 * Create a new sorter.
 	 * @param list The list to sort.
 	 */
-	ScriptListSorterValueDescending(ScriptList *list)
-	{
-		this->list = list;
-		this->End();
-	}
+	ScriptListSorterValueAscending(ScriptList *list) : ScriptListSorter(list) {}
 
-	int64 Begin()
+protected:
+	int64 GetFirst()
 	{
-		if (this->list->buckets.empty()) return 0;
-		this->has_no_more_items = false;
-
-		/* Go to the end of the bucket-list */
-		this->bucket_iter = this->list->buckets.end();
-		--this->bucket_iter;
-		this->bucket_list = &(*this->bucket_iter).second;
-
-		/* Go to the end of the items in the bucket */
-		this->bucket_list_iter = this->bucket_list->end();
-		--this->bucket_list_iter;
-		this->item_next = *this->bucket_list_iter;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
+		return (*this->list->buckets.begin()).second;
 	}
 
-	void End()
+	bool GetFollowing(int64 item, int64 *next)
 	{
-		this->bucket_list = NULL;
-		this->has_no_more_items = true;
-		this->item_next = 0;
+		ScriptList::ScriptListBucket::iterator iter = this->list->buckets.upper_bound(std::make_pair(this->list->GetValue(item), item));
+		if (iter == this->list->buckets.end()) return false;
+		*next = (*iter).second;
+		return true;
 	}
+};
 
+/**
+ * Sort by value, descending.
+ */
+class ScriptListSorterValueDescending : public ScriptListSorter {
+public:
 	/**
-	 * Find the next item, and store that information.
+	 * Create a new sorter.
+	 * @param list The list to sort.
 	 */
-	void FindNext()
-	{
-		if (this->bucket_list == NULL) {
-			this->has_no_more_items = true;
-			return;
-		}
-
-		if (this->bucket_list_iter == this->bucket_list->begin()) {
-			if (this->bucket_iter == this->list->buckets.begin()) {
-				this->bucket_list = NULL;
-				return;
-			}
-			this->bucket_iter--;
-			this->bucket_list = &(*this->bucket_iter).second;
-			/* Go to the end of the items in the bucket */
-			this->bucket_list_iter = this->bucket_list->end();
-			--this->bucket_list_iter;
-		} else {
-			this->bucket_list_iter--;
-		}
-		this->item_next = *this->bucket_list_iter;
-	}
+	ScriptListSorterValueDescending(ScriptList *list) : ScriptListSorter(list) {}
 
-	int64 Next()
+protected:
+	int64 GetFirst()
 	{
-		if (this->IsEnd()) return 0;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
+		return (*--this->list->buckets.end()).second;
 	}
 
-	void Remove(int item)
+	bool GetFollowing(int64 item, int64 *next)
 	{
-		if (this->IsEnd()) return;
-
-		/* If we remove the 'next' item, skip to the next */
-		if (item == this->item_next) {
-			FindNext();
-			return;
-		}
+		ScriptList::ScriptListBucket::iterator iter = this->list->buckets.lower_bound(std::make_pair(this->list->GetValue(item), item));
+		if (iter == this->list->buckets.begin()) return false;
+		*next = (*--iter).second;
+		return true;
 	}
 };
 
@@ -259,69 +237,25 @@ public:
  * Sort by item, ascending.
  */
 class ScriptListSorterItemAscending : public ScriptListSorter {
-private:
-	ScriptList::ScriptListMap::iterator item_iter; ///< The iterator over the items in the map.
-
 public:
 	/**
 	 * Create a new sorter.
 	 * @param list The list to sort.
 	 */
-	ScriptListSorterItemAscending(ScriptList *list)
-	{
-		this->list = list;
-		this->End();
-	}
+	ScriptListSorterItemAscending(ScriptList *list) : ScriptListSorter(list) {}
 
-	int64 Begin()
-	{
-		if (this->list->items.empty()) return 0;
-		this->has_no_more_items = false;
-
-		this->item_iter = this->list->items.begin();
-		this->item_next = (*this->item_iter).first;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
-	}
-
-	void End()
-	{
-		this->has_no_more_items = true;
-	}
-
-	/**
-	 * Find the next item, and store that information.
-	 */
-	void FindNext()
-	{
-		if (this->item_iter == this->list->items.end()) {
-			this->has_no_more_items = true;
-			return;
-		}
-		this->item_iter++;
-		if (this->item_iter != this->list->items.end()) item_next = (*this->item_iter).first;
-	}
-
-	int64 Next()
+protected:
+	int64 GetFirst()
 	{
-		if (this->IsEnd()) return 0;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
+		return (*this->list->items.begin()).first;
 	}
 
-	void Remove(int item)
+	bool GetFollowing(int64 item, int64 *next)
 	{
-		if (this->IsEnd()) return;
-
-		/* If we remove the 'next' item, skip to the next */
-		if (item == this->item_next) {
-			FindNext();
-			return;
-		}
+		ScriptList::ScriptListMap::iterator iter = this->list->items.upper_bound(std::make_pair(item, INT64_MAX));
+		if (iter == this->list->items.end()) return false;
+		*next = (*iter).first;
+		return true;
 	}
 };
 
@@ -329,78 +263,25 @@ public:
  * Sort by item, descending.
  */
 class ScriptListSorterItemDescending : public ScriptListSorter {
-private:
-	/* Note: We cannot use reverse_iterator.
-	 *       The iterators must only be invalidated when the element they are pointing to is removed.
-	 *       This only holds for forward iterators. */
-	ScriptList::ScriptListMap::iterator item_iter; ///< The iterator over the items in the map.
-
 public:
 	/**
 	 * Create a new sorter.
 	 * @param list The list to sort.
 	 */
-	ScriptListSorterItemDescending(ScriptList *list)
-	{
-		this->list = list;
-		this->End();
-	}
+	ScriptListSorterItemDescending(ScriptList *list) : ScriptListSorter(list) {}
 
-	int64 Begin()
-	{
-		if (this->list->items.empty()) return 0;
-		this->has_no_more_items = false;
-
-		this->item_iter = this->list->items.end();
-		--this->item_iter;
-		this->item_next = (*this->item_iter).first;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
-	}
-
-	void End()
-	{
-		this->has_no_more_items = true;
-	}
-
-	/**
-	 * Find the next item, and store that information.
-	 */
-	void FindNext()
-	{
-		if (this->item_iter == this->list->items.end()) {
-			this->has_no_more_items = true;
-			return;
-		}
-		if (this->item_iter == this->list->items.begin()) {
-			/* Use 'end' as marker for 'beyond begin' */
-			this->item_iter = this->list->items.end();
-		} else {
-			this->item_iter--;
-		}
-		if (this->item_iter != this->list->items.end()) item_next = (*this->item_iter).first;
-	}
-
-	int64 Next()
+protected:
+	int64 GetFirst()
 	{
-		if (this->IsEnd()) return 0;
-
-		int64 item_current = this->item_next;
-		FindNext();
-		return item_current;
+		return (*--this->list->items.end()).first;
 	}
 
-	void Remove(int item)
+	bool GetFollowing(int64 item, int64 *next)
 	{
-		if (this->IsEnd()) return;
-
-		/* If we remove the 'next' item, skip to the next */
-		if (item == this->item_next) {
-			FindNext();
-			return;
-		}
+		ScriptList::ScriptListMap::iterator iter = this->list->items.lower_bound(std::make_pair(item, INT64_MIN));
+		if (iter == this->list->items.begin()) return false;
+		*next = (*--iter).first;
+		return true;
 	}
 };
 
@@ -423,7 +304,7 @@ ScriptList::~ScriptList()
 
 bool ScriptList::HasItem(int64 item)
 {
-	return this->items.count(item) == 1;
+	return FindItem(this->items, item) != this->items.end();
 }
 
 void ScriptList::Clear()
@@ -439,26 +320,24 @@ void ScriptList::AddItem(int64 item, int64 value)
 {
 	this->modifications++;
 
-	if (this->HasItem(item)) return;
+	if (!this->items.insert(std::make_pair(item, value))) return;
 
-	this->items[item] = value;
-	this->buckets[value].insert(item);
+	this->buckets.insert(std::make_pair(value, item));
 }
 
 void ScriptList::RemoveItem(int64 item)
 {
 	this->modifications++;
 
-	ScriptListMap::iterator item_iter = this->items.find(item);
+	ScriptListMap::iterator item_iter = FindItem(this->items, item);
 	if (item_iter == this->items.end()) return;
 
 	int64 value = item_iter->second;
 
 	this->sorter->Remove(item);
-	ScriptListBucket::iterator bucket_iter = this->buckets.find(value);
-	assert(bucket_iter != this->buckets.end());
-	bucket_iter->second.erase(item);
-	if (bucket_iter->second.empty()) this->buckets.erase(bucket_iter);
+	ScriptListBucket::iterator bucket_iter = this->buckets.lower_bound(std::make_pair(value, item));
+	assert(bucket_iter != this->buckets.end() && bucket_iter->second == item);
+	this->buckets.erase(bucket_iter);
 	this->items.erase(item_iter);
 }
 
@@ -498,7 +377,7 @@ int32 ScriptList::Count()
 
 int64 ScriptList::GetValue(int64 item)
 {
-	ScriptListMap::const_iterator item_iter = this->items.find(item);
+	ScriptListMap::iterator item_iter = FindItem(this->items, item);
 	return item_iter == this->items.end() ? 0 : item_iter->second;
 }
 
@@ -506,19 +385,19 @@ bool ScriptList::SetValue(int64 item, int64 value)
 {
 	this->modifications++;
 
-	ScriptListMap::iterator item_iter = this->items.find(item);
+	ScriptListMap::iterator item_iter = FindItem(this->items, item);
 	if (item_iter == this->items.end()) return false;
 
 	int64 value_old = item_iter->second;
 	if (value_old == value) return true;
 
 	this->sorter->Remove(item);
-	ScriptListBucket::iterator bucket_iter = this->buckets.find(value_old);
-	assert(bucket_iter != this->buckets.end());
-	bucket_iter->second.erase(item);
-	if (bucket_iter->second.empty()) this->buckets.erase(bucket_iter);
+	/* The item keeps its place, as the items are sorted by item only. */
 	item_iter->second = value;
-	this->buckets[value].insert(item);
+	ScriptListBucket::iterator bucket_iter = this->buckets.lower_bound(std::make_pair(value_old, item));
+	assert(bucket_iter != this->buckets.end() && bucket_iter->second == item);
+	this->buckets.erase(bucket_iter);
+	this->buckets.insert(std::make_pair(value, item));
 
 	return true;
 }
@@ -585,40 +464,28 @@ void ScriptList::RemoveAboveValue(int64 value)
 {
 	this->modifications++;
 
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second > value) this->RemoveItem((*iter).first);
-	}
+	RemoveValuesIf(this, [value](int64 v) { return v > value; });
 }
 
 void ScriptList::RemoveBelowValue(int64 value)
 {
 	this->modifications++;
 
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second < value) this->RemoveItem((*iter).first);
-	}
+	RemoveValuesIf(this, [value](int64 v) { return v < value; });
 }
 
 void ScriptList::RemoveBetweenValue(int64 start, int64 end)
 {
 	this->modifications++;
 
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second > start && (*iter).second < end) this->RemoveItem((*iter).first);
-	}
+	RemoveValuesIf(this, [start, end](int64 v) { return v > start && v < end; });
 }
 
 void ScriptList::RemoveValue(int64 value)
 {
 	this->modifications++;
 
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second == value) this->RemoveItem((*iter).first);
-	}
+	RemoveValuesIf(this, [value](int64 v) { return v == value; });
 }
 
 void ScriptList::RemoveTop(int32 count)
@@ -635,24 +502,16 @@ void ScriptList::RemoveTop(int32 count)
 	switch (this->sorter_type) {
 		default: NOT_REACHED();
 		case SORT_BY_VALUE:
-			for (ScriptListBucket::iterator iter = this->buckets.begin(); iter != this->buckets.end(); iter = this->buckets.begin()) {
-				ScriptItemList *items = &(*iter).second;
-				size_t size = items->size();
-				for (ScriptItemList::iterator iter = items->begin(); iter != items->end(); iter = items->begin()) {
-					if (--count < 0) return;
-					this->RemoveItem(*iter);
-					/* When the last item is removed from the bucket, the bucket itself is removed.
-					 * This means that the iterators can be invalid after a call to RemoveItem.
-					 */
-					if (--size == 0) break;
-				}
+			while (!this->buckets.empty()) {
+				if (--count < 0) return;
+				this->RemoveItem((*this->buckets.begin()).second);
 			}
 			break;
 
 		case SORT_BY_ITEM:
-			for (ScriptListMap::iterator iter = this->items.begin(); iter != this->items.end(); iter = this->items.begin()) {
+			while (!this->items.empty()) {
 				if (--count < 0) return;
-				this->RemoveItem((*iter).first);
+				this->RemoveItem((*this->items.begin()).first);
 			}
 			break;
 	}
@@ -672,24 +531,16 @@ void ScriptList::RemoveBottom(int32 count)
 	switch (this->sorter_type) {
 		default: NOT_REACHED();
 		case SORT_BY_VALUE:
-			for (ScriptListBucket::reverse_iterator iter = this->buckets.rbegin(); iter != this->buckets.rend(); iter = this->buckets.rbegin()) {
-				ScriptItemList *items = &(*iter).second;
-				size_t size = items->size();
-				for (ScriptItemList::reverse_iterator iter = items->rbegin(); iter != items->rend(); iter = items->rbegin()) {
-					if (--count < 0) return;
-					this->RemoveItem(*iter);
-					/* When the last item is removed from the bucket, the bucket itself is removed.
-					 * This means that the iterators can be invalid after a call to RemoveItem.
-					 */
-					if (--size == 0) break;
-				}
+			while (!this->buckets.empty()) {
+				if (--count < 0) return;
+				this->RemoveItem((*--this->buckets.end()).second);
 			}
 			break;
 
 		case SORT_BY_ITEM:
-			for (ScriptListMap::reverse_iterator iter = this->items.rbegin(); iter != this->items.rend(); iter = this->items.rbegin()) {
+			while (!this->items.empty()) {
 				if (--count < 0) return;
-				this->RemoveItem((*iter).first);
+				this->RemoveItem((*--this->items.end()).first);
 			}
 			break;
 	}
@@ -713,40 +564,28 @@ void ScriptList::KeepAboveValue(int64 value)
 {
 	this->modifications++;
 
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second <= value) this->RemoveItem((*iter).first);
-	}
+	RemoveValuesIf(this, [value](int64 v) { return v <= value; });
 }
 
 void ScriptList::KeepBelowValue(int64 value)
 {
 	this->modifications++;
 
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second >= value) this->RemoveItem((*iter).first);
-	}
+	RemoveValuesIf(this, [value](int64 v) { return v >= value; });
 }
 
 void ScriptList::KeepBetweenValue(int64 start, int64 end)
 {
 	this->modifications++;
 
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second <= start || (*iter).second >= end) this->RemoveItem((*iter).first);
-	}
+	RemoveValuesIf(this, [start, end](int64 v) { return v <= start || v >= end; });
 }
 
 void ScriptList::KeepValue(int64 value)
 {
 	this->modifications++;
 
-	for (ScriptListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second != value) this->RemoveItem((*iter).first);
-	}
+	RemoveValuesIf(this, [value](int64 v) { return v != value; });
 }
 
 void ScriptList::KeepTop(int32 count)
@@ -782,7 +621,7 @@ SQInteger ScriptList::_get(HSQUIRRELVM vm)
 	SQInteger idx;
 	sq_getinteger(vm, 2, &idx);
 
-	ScriptListMap::const_iterator item_iter = this->items.find(idx);
+	ScriptListMap::iterator item_iter = FindItem(this->items, idx);
 	if (item_iter == this->items.end()) return SQ_ERROR;
 
 	sq_pushinteger(vm, item_iter->second);
@@ -837,6 +676,215 @@ SQInteger ScriptList::_nexti(HSQUIRRELVM vm)
 	return 1;
 }
 
+/** Type to store the script API functions of the native valuators in. */
+typedef void (*ScriptListValuatorFunc)();
+
+/**
+ * Valuate the items of a list with a script API function.
+ * @param function The script API function.
+ * @param params The parameters for the function besides the item.
+ * @param items The items to valuate.
+ * @param values Where to store the values, in the order of the items.
+ */
+typedef void ScriptListValuatorProc(ScriptListValuatorFunc function, const SQInteger *params, const ScriptList::ScriptListMap &items, int64 *values);
+
+static const int SCRIPT_LIST_NATIVE_VALUATOR_MAX_PARAMS = 4; ///< Maximum number of parameters of a native valuator besides the item.
+
+/** A script API function that ScriptList::Valuate runs over the whole list without calling it through Squirrel for every item. */
+struct ScriptListNativeValuator {
+	ScriptListValuatorFunc function; ///< The script API function.
+	int nparam;                      ///< Number of parameters of the function besides the item.
+	int ops;                         ///< Number of opcodes charged per item.
+	ScriptListValuatorProc *proc;    ///< Procedure to valuate the items with the function.
+};
+
+template <typename Tretval, typename Targ1>
+static void ValuateNative(ScriptListValuatorFunc function, const SQInteger *params, const ScriptList::ScriptListMap &items, int64 *values)
+{
+	Tretval (*valuator)(Targ1) = reinterpret_cast<Tretval (*)(Targ1)>(function);
+	for (ScriptList::ScriptListMap::const_iterator iter = items.begin(); iter != items.end(); iter++) {
+		*values++ = (int64)valuator((Targ1)iter->first);
+	}
+}
+
+template <typename Tretval, typename Targ1, typename Targ2>
+static void ValuateNative(ScriptListValuatorFunc function, const SQInteger *params, const ScriptList::ScriptListMap &items, int64 *values)
+{
+	Tretval (*valuator)(Targ1, Targ2) = reinterpret_cast<Tretval (*)(Targ1, Targ2)>(function);
+	Targ2 arg2 = (Targ2)params[0];
+	for (ScriptList::ScriptListMap::const_iterator iter = items.begin(); iter != items.end(); iter++) {
+		*values++ = (int64)valuator((Targ1)iter->first, arg2);
+	}
+}
+
+template <typename Tretval, typename Targ1, typename Targ2, typename Targ3>
+static void ValuateNative(ScriptListValuatorFunc function, const SQInteger *params, const ScriptList::ScriptListMap &items, int64 *values)
+{
+	Tretval (*valuator)(Targ1, Targ2, Targ3) = reinterpret_cast<Tretval (*)(Targ1, Targ2, Targ3)>(function);
+	Targ2 arg2 = (Targ2)params[0];
+	Targ3 arg3 = (Targ3)params[1];
+	for (ScriptList::ScriptListMap::const_iterator iter = items.begin(); iter != items.end(); iter++) {
+		*values++ = (int64)valuator((Targ1)iter->first, arg2, arg3);
+	}
+}
+
+template <typename Tretval, typename Targ1, typename Targ2, typename Targ3, typename Targ4, typename Targ5>
+static void ValuateNative(ScriptListValuatorFunc function, const SQInteger *params, const ScriptList::ScriptListMap &items, int64 *values)
+{
+	Tretval (*valuator)(Targ1, Targ2, Targ3, Targ4, Targ5) = reinterpret_cast<Tretval (*)(Targ1, Targ2, Targ3, Targ4, Targ5)>(function);
+	Targ2 arg2 = (Targ2)params[0];
+	Targ3 arg3 = (Targ3)params[1];
+	Targ4 arg4 = (Targ4)params[2];
+	Targ5 arg5 = (Targ5)params[3];
+	for (ScriptList::ScriptListMap::const_iterator iter = items.begin(); iter != items.end(); iter++) {
+		*values++ = (int64)valuator((Targ1)iter->first, arg2, arg3, arg4, arg5);
+	}
+}
+
+template <typename Tretval, typename Targ1>
+static ScriptListNativeValuator NativeValuator(Tretval (*function)(Targ1), int ops)
+{
+	ScriptListNativeValuator valuator = { reinterpret_cast<ScriptListValuatorFunc>(function), 0, ops, &ValuateNative<Tretval, Targ1> };
+	return valuator;
+}
+
+template <typename Tretval, typename Targ1, typename Targ2>
+static ScriptListNativeValuator NativeValuator(Tretval (*function)(Targ1, Targ2), int ops)
+{
+	ScriptListNativeValuator valuator = { reinterpret_cast<ScriptListValuatorFunc>(function), 1, ops, &ValuateNative<Tretval, Targ1, Targ2> };
+	return valuator;
+}
+
+template <typename Tretval, typename Targ1, typename Targ2, typename Targ3>
+static ScriptListNativeValuator NativeValuator(Tretval (*function)(Targ1, Targ2, Targ3), int ops)
+{
+	ScriptListNativeValuator valuator = { reinterpret_cast<ScriptListValuatorFunc>(function), 2, ops, &ValuateNative<Tretval, Targ1, Targ2, Targ3> };
+	return valuator;
+}
+
+template <typename Tretval, typename Targ1, typename Targ2, typename Targ3, typename Targ4, typename Targ5>
+static ScriptListNativeValuator NativeValuator(Tretval (*function)(Targ1, Targ2, Targ3, Targ4, Targ5), int ops)
+{
+	ScriptListNativeValuator valuator = { reinterpret_cast<ScriptListValuatorFunc>(function), 4, ops, &ValuateNative<Tretval, Targ1, Targ2, Targ3, Targ4, Targ5> };
+	return valuator;
+}
+
+/**
+ * The script API functions that are valuated natively. Functions that look at
+ * a single object cost one opcode per item; functions that look at an area of
+ * tiles or at all towns cost as much as calling a valuator through Squirrel.
+ * Functions returning unsigned 32 bits values are left out, as Squirrel would
+ * return those as signed values.
+ */
+static const ScriptListNativeValuator _native_valuators[] = {
+	NativeValuator(&ScriptTile::IsBuildable, 1),
+	NativeValuator(&ScriptTile::IsBuildableRectangle, 5),
+	NativeValuator(&ScriptTile::IsWaterTile, 1),
+	NativeValuator(&ScriptTile::IsCoastTile, 1),
+	NativeValuator(&ScriptTile::IsStationTile, 1),
+	NativeValuator(&ScriptTile::HasTreeOnTile, 1),
+	NativeValuator(&ScriptTile::IsFarmTile, 1),
+	NativeValuator(&ScriptTile::IsRockTile, 1),
+	NativeValuator(&ScriptTile::IsRoughTile, 1),
+	NativeValuator(&ScriptTile::IsSnowTile, 1),
+	NativeValuator(&ScriptTile::IsDesertTile, 1),
+	NativeValuator(&ScriptTile::GetTerrainType, 1),
+	NativeValuator(&ScriptTile::GetSlope, 1),
+	NativeValuator(&ScriptTile::GetMinHeight, 1),
+	NativeValuator(&ScriptTile::GetMaxHeight, 1),
+	NativeValuator(&ScriptTile::GetCornerHeight, 1),
+	NativeValuator(&ScriptTile::GetOwner, 1),
+	NativeValuator(&ScriptTile::HasTransportType, 1),
+	NativeValuator(&ScriptTile::GetCargoAcceptance, 5),
+	NativeValuator(&ScriptTile::GetCargoProduction, 5),
+	NativeValuator(&ScriptTile::GetDistanceManhattanToTile, 1),
+	NativeValuator(&ScriptTile::GetDistanceSquareToTile, 1),
+	NativeValuator(&ScriptTile::IsWithinTownInfluence, 1),
+	NativeValuator(&ScriptTile::GetTownAuthority, 1),
+	NativeValuator(&ScriptTile::GetClosestTown, 5),
+
+	NativeValuator(&ScriptIndustry::IsValidIndustry, 1),
+	NativeValuator(&ScriptIndustry::IsCargoAccepted, 1),
+	NativeValuator(&ScriptIndustry::GetStockpiledCargo, 1),
+	NativeValuator(&ScriptIndustry::GetLastMonthProduction, 1),
+	NativeValuator(&ScriptIndustry::GetLastMonthTransported, 1),
+	NativeValuator(&ScriptIndustry::GetLastMonthTransportedPercentage, 1),
+	NativeValuator(&ScriptIndustry::GetAmountOfStationsAround, 5),
+	NativeValuator(&ScriptIndustry::GetDistanceManhattanToTile, 1),
+	NativeValuator(&ScriptIndustry::GetDistanceSquareToTile, 1),
+	NativeValuator(&ScriptIndustry::IsBuiltOnWater, 1),
+	NativeValuator(&ScriptIndustry::HasHeliport, 1),
+	NativeValuator(&ScriptIndustry::HasDock, 1),
+	NativeValuator(&ScriptIndustry::GetIndustryType, 1),
+
+	NativeValuator(&ScriptBaseStation::IsValidBaseStation, 1),
+	NativeValuator(&ScriptBaseStation::GetConstructionDate, 1),
+	NativeValuator(&ScriptStation::IsValidStation, 1),
+	NativeValuator(&ScriptStation::GetOwner, 1),
+	NativeValuator(&ScriptStation::GetCargoWaiting, 1),
+	NativeValuator(&ScriptStation::GetCargoPlanned, 1),
+	NativeValuator(&ScriptStation::HasCargoRating, 1),
+	NativeValuator(&ScriptStation::GetCargoRating, 1),
+	NativeValuator(&ScriptStation::GetStationCoverageRadius, 1),
+	NativeValuator(&ScriptStation::GetDistanceManhattanToTile, 1),
+	NativeValuator(&ScriptStation::GetDistanceSquareToTile, 1),
+	NativeValuator(&ScriptStation::IsWithinTownInfluence, 1),
+	NativeValuator(&ScriptStation::HasStationType, 1),
+	NativeValuator(&ScriptStation::GetNearestTown, 1),
+
+	NativeValuator(&ScriptEngine::IsValidEngine, 1),
+	NativeValuator(&ScriptEngine::GetCargoType, 1),
+	NativeValuator(&ScriptEngine::CanRefitCargo, 1),
+	NativeValuator(&ScriptEngine::CanPullCargo, 1),
+	NativeValuator(&ScriptEngine::GetCapacity, 1),
+	NativeValuator(&ScriptEngine::GetReliability, 1),
+	NativeValuator(&ScriptEngine::GetMaxSpeed, 1),
+	NativeValuator(&ScriptEngine::GetPrice, 1),
+	NativeValuator(&ScriptEngine::GetMaxAge, 1),
+	NativeValuator(&ScriptEngine::GetRunningCost, 1),
+	NativeValuator(&ScriptEngine::GetPower, 1),
+	NativeValuator(&ScriptEngine::GetWeight, 1),
+	NativeValuator(&ScriptEngine::GetMaxTractiveEffort, 1),
+	NativeValuator(&ScriptEngine::GetDesignDate, 1),
+	NativeValuator(&ScriptEngine::GetVehicleType, 1),
+	NativeValuator(&ScriptEngine::IsWagon, 1),
+	NativeValuator(&ScriptEngine::CanRunOnRail, 1),
+	NativeValuator(&ScriptEngine::HasPowerOnRail, 1),
+	NativeValuator(&ScriptEngine::GetRoadType, 1),
+	NativeValuator(&ScriptEngine::GetRailType, 1),
+	NativeValuator(&ScriptEngine::IsArticulated, 1),
+	NativeValuator(&ScriptEngine::GetPlaneType, 1),
+};
+
+/**
+ * Find the native valuator for the valuator function given to ScriptList::Valuate.
+ * @param vm The VM with the valuator function at position 2 and its parameters after it.
+ * @param nparam The number of parameters given to ScriptList::Valuate.
+ * @param[out] params The parameters for the native valuator.
+ * @return The native valuator, or NULL when the valuator has to be called through Squirrel.
+ */
+static const ScriptListNativeValuator *FindNativeValuator(HSQUIRRELVM vm, int nparam, SQInteger *params)
+{
+	const void *data = Squirrel::GetNativeFunctionData(vm, 2, sizeof(ScriptListValuatorFunc));
+	if (data == NULL) return NULL;
+
+	ScriptListValuatorFunc function;
+	memcpy(&function, data, sizeof(function));
+
+	for (const ScriptListNativeValuator *valuator = _native_valuators; valuator != endof(_native_valuators); valuator++) {
+		if (valuator->function != function) continue;
+
+		/* Leave reporting wrong parameters to Squirrel. */
+		if (valuator->nparam != nparam - 1) return NULL;
+		for (int i = 0; i < valuator->nparam; i++) {
+			if (sq_gettype(vm, i + 3) != OT_INTEGER) return NULL;
+			sq_getinteger(vm, i + 3, &params[i]);
+		}
+		return valuator;
+	}
+	return NULL;
+}
+
 SQInteger ScriptList::Valuate(HSQUIRRELVM vm)
 {
 	this->modifications++;
@@ -861,6 +909,27 @@ SQInteger ScriptList::Valuate(HSQUIRRELVM vm)
 	bool backup_allow = ScriptObject::GetAllowDoCommand();
 	ScriptObject::SetAllowDoCommand(false);
 
+	/* Valuators of the script API run over the whole list at once, instead
+	 * of being called through Squirrel for every item. */
+	SQInteger params[SCRIPT_LIST_NATIVE_VALUATOR_MAX_PARAMS];
+	const ScriptListNativeValuator *native = FindNativeValuator(vm, nparam, params);
+	if (native != NULL) {
+		std::vector<int64> values(this->items.size());
+		native->proc(native->function, params, this->items, values.data());
+
+		std::vector<int64>::const_iterator value = values.begin();
+		for (ScriptListMap::iterator iter = this->items.begin(); iter != this->items.end(); iter++) {
+			this->SetValue((*iter).first, *value++);
+		}
+		Squirrel::DecreaseOps(vm, native->ops * (int)values.size());
+
+		/* Pop the parameters given to this function and the ScriptList instance object. */
+		sq_pop(vm, nparam + 1);
+
+		ScriptObject::SetAllowDoCommand(backup_allow);
+		return 0;
+	}
+
 	/* Push the function to call */
 	sq_push(vm, 2);
 
@@ -876,8 +945,14 @@ SQInteger ScriptList::Valuate(HSQUIRRELVM vm)
 			sq_push(vm, i + 3);
 		}
 
-		/* Call the function. Squirrel pops all parameters and pushes the return value. */
-		if (SQ_FAILED(sq_call(vm, nparam + 1, SQTrue, SQTrue))) {
+		/* Call the function. Squirrel pops all parameters and pushes the return value.
+		 * Other scripts may run in the mean time; the valuator takes the game lock for each of its calls into the game. */
+		SQRESULT result;
+		{
+			ScriptGameUnlock unlock;
+			result = sq_call(vm, nparam + 1, SQTrue, SQTrue);
+		}
+		if (SQ_FAILED(result)) {
 			ScriptObject::SetAllowDoCommand(backup_allow);
 			return SQ_ERROR;
 		}
@@ -14,8 +14,7 @@
 #define SCRIPT_LIST_HPP
 
 #include "script_object.hpp"
-#include <map>
-#include <set>
+#include "../../core/sortedvec_type.hpp"
 
 class ScriptListSorter;
 
@@ -44,9 +43,8 @@ private:
 	int modifications;            ///< Number of modification that has been done. To prevent changing data while valuating.
 
 public:
-	typedef std::set<int64> ScriptItemList;                   ///< The list of items inside the bucket
-	typedef std::map<int64, ScriptItemList> ScriptListBucket; ///< The bucket list per value
-	typedef std::map<int64, int64> ScriptListMap;             ///< List per item
+	typedef SortedBlockVector<std::pair<int64, int64> > ScriptListMap;    ///< Pairs of an item and its value, sorted by item
+	typedef SortedBlockVector<std::pair<int64, int64> > ScriptListBucket; ///< Pairs of a value and its item, sorted by value and then by item
 
 	ScriptListMap items;           ///< The items in the list
 	ScriptListBucket buckets;      ///< The items in the list, sorted by value
@@ -277,6 +275,9 @@ public:
 	 * @note You can write your own valuators and use them. Just remember that
 	 *  the first parameter should be the index-value, and it should return
 	 *  an integer.
+	 * @note Most getters of ScriptTile, ScriptIndustry, ScriptStation and
+	 *  ScriptEngine are run over the whole list at once, which is a lot
+	 *  faster and mostly costs fewer opcodes than calling your own valuator.
 	 * @note Example:
 	 *  list.Valuate(ScriptBridge.GetPrice, 5);
 	 *  list.Valuate(ScriptBridge.GetMaxLength);
@@ -22,6 +22,7 @@
 #include "../script_storage.hpp"
 #include "../script_instance.hpp"
 #include "../script_fatalerror.hpp"
+#include "../script_thread.hpp"
 #include "script_error.hpp"
 
 #include "../../safeguards.h"
@@ -36,7 +37,7 @@ static ScriptStorage *GetStorage()
 }
 
 
-/* static */ ScriptInstance *ScriptObject::ActiveInstance::active = NULL;
+/* static */ thread_local ScriptInstance *ScriptObject::ActiveInstance::active = NULL;
 
 ScriptObject::ActiveInstance::ActiveInstance(ScriptInstance *instance)
 {
@@ -304,8 +305,14 @@ ScriptObject::ActiveInstance::~ActiveInstance()
 	/* Only set p2 when the command does not come from the network. */
 	if (GetCommandFlags(cmd) & CMD_CLIENT_ID && p2 == 0) p2 = UINT32_MAX;
 
+	/* Scripts running on the worker threads may not change the game; only
+	 * test their commands and queue them for the main thread. */
+	bool queue = !estimate_only && ScriptGameLock::IsThreaded();
+
 	/* Try to perform the command. */
-	CommandCost res = ::DoCommandPInternal(tile, p1, p2, cmd, (_networking && !_generating_world) ? ScriptObject::GetActiveInstance()->GetDoCommandCallback() : NULL, text, false, estimate_only);
+	CommandCost res = ::DoCommandPInternal(tile, p1, p2, cmd, (_networking && !_generating_world) ? ScriptObject::GetActiveInstance()->GetDoCommandCallback() : NULL, text, false, estimate_only || queue);
+	/* Testing only skips the check for money the execution does. */
+	if (queue && res.Succeeded() && (GetCommandFlags(cmd) & (CMD_NO_TEST | CMD_SPECTATOR | CMD_SERVER)) == 0) CheckCompanyHasMoney(res);
 
 	/* We failed; set the error and bail out */
 	if (res.Failed()) {
@@ -335,6 +342,13 @@ ScriptObject::ActiveInstance::~ActiveInstance()
 			throw SQInteger(1);
 		}
 		return true;
+	} else if (queue) {
+		ScriptObject::GetActiveInstance()->QueueCommand(tile, p1, p2, cmd, text);
+
+		/* Suspend the script till the command is executed by the main thread.
+		 * In single player that happens during this tick, so wait one tick
+		 * longer to get the same delay as when the command is executed now. */
+		throw Script_Suspend(-(int)GetDoCommandDelay() - (_networking ? 0 : 1), callback);
 	} else if (_networking) {
 		/* Suspend the script till the command is really executed. */
 		throw Script_Suspend(-(int)GetDoCommandDelay(), callback);
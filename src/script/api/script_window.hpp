@@ -1301,6 +1301,8 @@ public:
 		WID_FRW_RATE_GAMELOOP                        = ::WID_FRW_RATE_GAMELOOP,
 		WID_FRW_RATE_DRAWING                         = ::WID_FRW_RATE_DRAWING,
 		WID_FRW_RATE_FACTOR                          = ::WID_FRW_RATE_FACTOR,
+		WID_FRW_RATE_RAIL_PF_CACHE                   = ::WID_FRW_RATE_RAIL_PF_CACHE,
+		WID_FRW_RATE_TEXT_CACHE                      = ::WID_FRW_RATE_TEXT_CACHE,
 		WID_FRW_INFO_DATA_POINTS                     = ::WID_FRW_INFO_DATA_POINTS,
 		WID_FRW_TIMES_NAMES                          = ::WID_FRW_TIMES_NAMES,
 		WID_FRW_TIMES_CURRENT                        = ::WID_FRW_TIMES_CURRENT,
@@ -19,6 +19,7 @@
 #include "script_storage.hpp"
 #include "script_info.hpp"
 #include "script_instance.hpp"
+#include "script_thread.hpp"
 
 #include "api/script_controller.hpp"
 #include "api/script_error.hpp"
@@ -27,7 +28,11 @@
 
 #include "../company_base.h"
 #include "../company_func.h"
+#include "../command_func.h"
 #include "../fileio_func.h"
+#include "../string_func.h"
+#include "../core/backup_type.hpp"
+#include "../network/network.h"
 
 #include "../safeguards.h"
 
@@ -60,7 +65,9 @@ ScriptInstance::ScriptInstance(const char *APIName) :
 	is_save_data_on_stack(false),
 	suspend(0),
 	is_paused(false),
-	callback(NULL)
+	callback(NULL),
+	has_queued_command(false),
+	died_windows_postponed(false)
 {
 	this->storage = new ScriptStorage();
 	this->engine  = new Squirrel(APIName);
@@ -157,6 +164,13 @@ void ScriptInstance::Died()
 	delete this->engine;
 	this->instance = NULL;
 	this->engine = NULL;
+
+	/* Windows can only be opened by the main thread; it does so after the game loops of the scripts on the worker threads. */
+	if (ScriptGameLock::IsThreaded()) {
+		this->died_windows_postponed = true;
+	} else {
+		this->ShowDiedWindows();
+	}
 }
 
 void ScriptInstance::GameLoop()
@@ -692,6 +706,50 @@ void ScriptInstance::DoCommandCallback(const CommandCost &result, TileIndex tile
 	}
 }
 
+void ScriptInstance::QueueCommand(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd, const char *text)
+{
+	assert(!this->has_queued_command);
+	this->has_queued_command = true;
+
+	this->queued_command.tile = tile;
+	this->queued_command.p1 = p1;
+	this->queued_command.p2 = p2;
+	this->queued_command.cmd = cmd;
+	this->queued_command.callback = NULL;
+	strecpy(this->queued_command.text, text == NULL ? "" : text, lastof(this->queued_command.text));
+}
+
+void ScriptInstance::ExecuteQueuedCommand()
+{
+	if (!this->has_queued_command) return;
+	this->has_queued_command = false;
+
+	ScriptObject::ActiveInstance active(this);
+	Backup<CompanyByte> cur_company(_current_company, ScriptObject::GetCompany(), FILE_LINE);
+
+	const CommandContainer &cc = this->queued_command;
+	CommandCost res = ::DoCommandPInternal(cc.tile, cc.p1, cc.p2, cc.cmd, _networking ? this->GetDoCommandCallback() : NULL, cc.text, false, false);
+
+	/* In multiplayer the callback follows once the command has really been executed. */
+	if (!_networking || res.Failed()) {
+		this->DoCommandCallback(res, cc.tile, cc.p1, cc.p2);
+		this->Continue();
+	}
+
+	cur_company.Restore();
+}
+
+void ScriptInstance::ShowPostponedDiedWindows()
+{
+	if (!this->died_windows_postponed) return;
+	this->died_windows_postponed = false;
+
+	ScriptObject::ActiveInstance active(this);
+	Backup<CompanyByte> cur_company(_current_company, ScriptObject::GetCompany(), FILE_LINE);
+	this->ShowDiedWindows();
+	cur_company.Restore();
+}
+
 void ScriptInstance::InsertEvent(class ScriptEvent *event)
 {
 	ScriptObject::ActiveInstance active(this);
@@ -185,6 +185,18 @@ public:
 	 */
 	void DoCommandCallback(const CommandCost &result, TileIndex tile, uint32 p1, uint32 p2);
 
+	/**
+	 * Execute the command the script queued while running on a worker thread,
+	 *  if there is any. The result is handled like that of any other command.
+	 */
+	void ExecuteQueuedCommand();
+
+	/**
+	 * Open the windows telling the user the script died, if that was
+	 *  postponed because the script died on a worker thread.
+	 */
+	void ShowPostponedDiedWindows();
+
 	/**
 	 * Insert an event for this script.
 	 * @param event The event to insert.
@@ -220,6 +232,12 @@ protected:
 	 */
 	virtual void Died();
 
+	/**
+	 * Open the windows telling the user the script died.
+	 *  Windows can only be opened by the main thread, see #ShowPostponedDiedWindows.
+	 */
+	virtual void ShowDiedWindows() {}
+
 	/**
 	 * Get the callback handling DoCommands in case of networking.
 	 */
@@ -241,6 +259,19 @@ private:
 	int suspend;                          ///< The amount of ticks to suspend this script before it's allowed to continue.
 	bool is_paused;                       ///< Is the script paused? (a paused script will not be executed until unpaused)
 	Script_SuspendCallbackProc *callback; ///< Callback that should be called in the next tick the script runs.
+	bool has_queued_command;              ///< Is there a command in queued_command?
+	CommandContainer queued_command;      ///< Command issued while running on a worker thread, to be executed on the main thread.
+	bool died_windows_postponed;          ///< Did the script die on a worker thread, so ShowDiedWindows still has to be called?
+
+	/**
+	 * Queue a command to be executed by ExecuteQueuedCommand.
+	 * @param tile The tile to execute the command on.
+	 * @param p1 Additional data for the command.
+	 * @param p2 Additional data for the command.
+	 * @param cmd The command to execute.
+	 * @param text The text for the command, or NULL.
+	 */
+	void QueueCommand(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd, const char *text);
 
 	/**
 	 * Call the script Load function if it exists and data was loaded
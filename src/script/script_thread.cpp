@@ -0,0 +1,119 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file script_thread.cpp Implementation of running the game loops of scripts on the worker threads. */
+
+#include "../stdafx.h"
+#include "../company_func.h"
+#include "../genworld.h"
+#include "../settings_type.h"
+#include "../thread/worker_pool.h"
+#include "script_instance.hpp"
+#include "script_thread.hpp"
+
+#include "../safeguards.h"
+
+ThreadMutex *ScriptGameLock::mutex = NULL;
+bool ScriptGameLock::threaded = false;
+thread_local uint ScriptGameLock::depth = 0;
+thread_local CompanyID ScriptGameLock::company = INVALID_COMPANY;
+
+/** Take the lock, unless this thread already has it. */
+/* static */ void ScriptGameLock::Lock()
+{
+	if (ScriptGameLock::depth++ != 0) return;
+
+	ScriptGameLock::mutex->BeginCritical();
+	_current_company = ScriptGameLock::company;
+}
+
+/** Release the lock, unless this thread took it more than once. */
+/* static */ void ScriptGameLock::Unlock()
+{
+	assert(ScriptGameLock::depth > 0);
+	if (--ScriptGameLock::depth != 0) return;
+
+	ScriptGameLock::company = _current_company;
+	ScriptGameLock::mutex->EndCritical();
+}
+
+ScriptGameUnlock::ScriptGameUnlock() : depth(ScriptGameLock::depth)
+{
+	if (this->depth == 0) return;
+
+	ScriptGameLock::depth = 1;
+	ScriptGameLock::Unlock();
+}
+
+ScriptGameUnlock::~ScriptGameUnlock()
+{
+	if (this->depth == 0) return;
+
+	ScriptGameLock::Lock();
+	ScriptGameLock::depth = this->depth;
+}
+
+/**
+ * Check whether the game loops of scripts may run on the worker threads.
+ * @return True if scripts should be run with a #ScriptThreadedGameLoop.
+ */
+/* static */ bool ScriptThreadedGameLoop::IsEnabled()
+{
+	/* While generating the world the commands of scripts are executed right away. */
+	return _settings_client.gui.parallel_scripts && _worker_pool.GetWorkerCount() > 0 && !_generating_world;
+}
+
+/**
+ * Add a script to run the game loop of.
+ * @param instance The script.
+ * @param company The company the script runs for.
+ * @param element The element to measure the time the script takes with.
+ */
+void ScriptThreadedGameLoop::Add(ScriptInstance *instance, CompanyID company, PerformanceElement element)
+{
+	Job job = { instance, company, element };
+	this->jobs.push_back(job);
+}
+
+/**
+ * Run the game loop of a single script on a worker thread.
+ * @param job The #Job to run.
+ */
+/* static */ void ScriptThreadedGameLoop::RunJob(void *job)
+{
+	const Job *j = (const Job *)job;
+
+	PerformanceMeasurer framerate(j->element);
+	ScriptGameLock lock;
+	_current_company = j->company;
+	j->instance->GameLoop();
+}
+
+/**
+ * Run the game loops of all added scripts, and then open the windows of the
+ * scripts that died and execute the commands the scripts issued, in the order
+ * the scripts have been added.
+ */
+void ScriptThreadedGameLoop::Run()
+{
+	if (ScriptGameLock::mutex == NULL) ScriptGameLock::mutex = ThreadMutex::New();
+
+	ScriptGameLock::threaded = true;
+	WorkerJobTicket ticket;
+	for (std::vector<Job>::iterator it = this->jobs.begin(); it != this->jobs.end(); ++it) {
+		_worker_pool.Submit(&ScriptThreadedGameLoop::RunJob, &*it, &ticket);
+	}
+	_worker_pool.Wait(&ticket);
+	ScriptGameLock::threaded = false;
+
+	for (std::vector<Job>::iterator it = this->jobs.begin(); it != this->jobs.end(); ++it) {
+		it->instance->ShowPostponedDiedWindows();
+		it->instance->ExecuteQueuedCommand();
+	}
+}
@@ -0,0 +1,103 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file script_thread.hpp Running the game loops of scripts on the worker threads. */
+
+#ifndef SCRIPT_THREAD_HPP
+#define SCRIPT_THREAD_HPP
+
+#include "../company_type.h"
+#include "../framerate_type.h"
+#include <vector>
+
+class ThreadMutex;
+
+/**
+ * Lock serialising the access to the game of scripts running on the worker
+ * threads. The Squirrel code of those scripts runs in parallel, but every
+ * call of a script into the game holds this lock. As the other scripts
+ * change the current company in the mean time, taking the lock makes the
+ * company this thread had when it released the lock current again.
+ * When no scripts are running on the worker threads the lock does nothing.
+ */
+class ScriptGameLock {
+	friend class ScriptGameUnlock;
+	friend class ScriptThreadedGameLoop;
+
+	static ThreadMutex *mutex;              ///< The actual lock.
+	static bool threaded;                   ///< Whether scripts are running on the worker threads right now.
+	static thread_local uint depth;         ///< How often this thread has taken the lock.
+	static thread_local CompanyID company;  ///< The current company of this thread when it released the lock.
+
+	bool locked;                            ///< Whether this instance took the lock.
+
+	static void Lock();
+	static void Unlock();
+
+public:
+	/** Take the lock, if scripts are running on the worker threads. */
+	inline ScriptGameLock() : locked(ScriptGameLock::threaded)
+	{
+		if (this->locked) ScriptGameLock::Lock();
+	}
+
+	/** Release the lock again. */
+	inline ~ScriptGameLock()
+	{
+		if (this->locked) ScriptGameLock::Unlock();
+	}
+
+	/**
+	 * Check whether scripts are running on the worker threads right now.
+	 * @return True when the commands of scripts have to be queued.
+	 */
+	static inline bool IsThreaded()
+	{
+		return ScriptGameLock::threaded;
+	}
+};
+
+/**
+ * Release the #ScriptGameLock while running Squirrel code, no matter how
+ * often the current thread has taken it, and take it back afterwards.
+ */
+class ScriptGameUnlock {
+	uint depth; ///< How often the lock was taken before releasing it.
+
+public:
+	ScriptGameUnlock();
+	~ScriptGameUnlock();
+};
+
+/**
+ * The game loops of several scripts, run in parallel on the worker threads.
+ * The main thread waits for them, so the scripts see the game as it was at
+ * the start of the loops. The commands the scripts issue are queued and
+ * executed afterwards, in the order the scripts have been added.
+ */
+class ScriptThreadedGameLoop {
+	/** The game loop of a single script. */
+	struct Job {
+		class ScriptInstance *instance; ///< The script to run.
+		CompanyID company;              ///< The company the script runs for.
+		PerformanceElement element;     ///< The element to measure the time of the script with.
+	};
+
+	std::vector<Job> jobs; ///< The scripts to run.
+
+	static void RunJob(void *job);
+
+public:
+	static bool IsEnabled();
+
+	void Add(class ScriptInstance *instance, CompanyID company, PerformanceElement element);
+	void Run();
+};
+
+#endif /* SCRIPT_THREAD_HPP */
@@ -13,16 +13,21 @@
 #include "../stdafx.h"
 #include "../debug.h"
 #include "squirrel_std.hpp"
+#include "script_thread.hpp"
 #include "../fileio_func.h"
 #include "../string_func.h"
 #include <sqstdaux.h>
 #include <../squirrel/sqpcheader.h>
 #include <../squirrel/sqvm.h>
+#include <../squirrel/sqclosure.h>
+#include <../squirrel/squserdata.h>
 
 #include "../safeguards.h"
 
 void Squirrel::CompileError(HSQUIRRELVM vm, const SQChar *desc, const SQChar *source, SQInteger line, SQInteger column)
 {
+	ScriptGameLock lock;
+
 	SQChar buf[1024];
 
 	seprintf(buf, lastof(buf), "Error %s:" OTTD_PRINTF64 "/" OTTD_PRINTF64 ": %s", source, line, column, desc);
@@ -40,6 +45,8 @@ void Squirrel::CompileError(HSQUIRRELVM vm, const SQChar *desc, const SQChar *so
 
 void Squirrel::ErrorPrintFunc(HSQUIRRELVM vm, const SQChar *s, ...)
 {
+	ScriptGameLock lock;
+
 	va_list arglist;
 	SQChar buf[1024];
 
@@ -58,6 +65,8 @@ void Squirrel::ErrorPrintFunc(HSQUIRRELVM vm, const SQChar *s, ...)
 
 void Squirrel::RunError(HSQUIRRELVM vm, const SQChar *error)
 {
+	ScriptGameLock lock;
+
 	/* Set the print function to something that prints to stderr */
 	SQPRINTFUNCTION pf = sq_getprintfunc(vm);
 	sq_setprintfunc(vm, &Squirrel::ErrorPrintFunc);
@@ -96,6 +105,8 @@ SQInteger Squirrel::_RunError(HSQUIRRELVM vm)
 
 void Squirrel::PrintFunc(HSQUIRRELVM vm, const SQChar *s, ...)
 {
+	ScriptGameLock lock;
+
 	va_list arglist;
 	SQChar buf[1024];
 
@@ -198,7 +209,10 @@ bool Squirrel::Resume(int suspend)
 		suspend = -this->overdrawn_ops;
 	}
 
-	this->crashed = !sq_resumecatch(this->vm, suspend);
+	{
+		ScriptGameUnlock unlock;
+		this->crashed = !sq_resumecatch(this->vm, suspend);
+	}
 	this->overdrawn_ops = -this->vm->_ops_till_suspend;
 	return this->vm->_suspended != 0;
 }
@@ -234,7 +248,10 @@ bool Squirrel::CallMethod(HSQOBJECT instance, const char *method_name, HSQOBJECT
 	}
 	/* Call the method */
 	sq_pushobject(this->vm, instance);
-	if (SQ_FAILED(sq_call(this->vm, 1, ret == NULL ? SQFalse : SQTrue, SQTrue, suspend))) return false;
+	{
+		ScriptGameUnlock unlock;
+		if (SQ_FAILED(sq_call(this->vm, 1, ret == NULL ? SQFalse : SQTrue, SQTrue, suspend))) return false;
+	}
 	if (ret != NULL) sq_getstackobj(vm, -1, ret);
 	/* Reset the top, but don't do so for the script main function, as we need
 	 *  a correct stack when resuming. */
@@ -583,6 +600,20 @@ void Squirrel::InsertResult(int result)
 	vm->DecreaseOps(ops);
 }
 
+/* static */ const void *Squirrel::GetNativeFunctionData(HSQUIRRELVM vm, int index, size_t size)
+{
+	HSQOBJECT obj;
+	if (SQ_FAILED(sq_getstackobj(vm, index, &obj)) || !sq_isnativeclosure(obj)) return NULL;
+
+	/* The data is stored as the only free variable of the native closure, see AddMethod(). */
+	SQNativeClosure *closure = _nativeclosure(obj);
+	if (closure->_outervalues.size() != 1 || !sq_isuserdata(closure->_outervalues[0])) return NULL;
+
+	SQUserData *data = _userdata(closure->_outervalues[0]);
+	if (data->_size != (SQInteger)size) return NULL;
+	return data->_val;
+}
+
 bool Squirrel::IsSuspended()
 {
 	return this->vm->_suspended != 0;
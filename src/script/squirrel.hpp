@@ -242,6 +242,15 @@ public:
 	 */
 	static void DecreaseOps(HSQUIRRELVM vm, int amount);
 
+	/**
+	 * Get the data a native function was added with, which for the script API is the function it calls.
+	 * @param vm The VM to get the function from.
+	 * @param index The position of the function on the stack.
+	 * @param size The size the data must have.
+	 * @return The data, or NULL when the object is not a native function with data of that size.
+	 */
+	static const void *GetNativeFunctionData(HSQUIRRELVM vm, int index, size_t size);
+
 	/**
 	 * Did the squirrel code suspend or return normally.
 	 * @return True if the function suspended.
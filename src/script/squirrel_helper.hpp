@@ -17,6 +17,7 @@
 #include "../economy_type.h"
 #include "../string_func.h"
 #include "squirrel_helper_type.hpp"
+#include "script_thread.hpp"
 
 template <class CL, ScriptType ST> const char *GetClassName();
 
@@ -737,6 +738,9 @@ namespace SQConvert {
 	template <typename Tcls, typename Tmethod, ScriptType Ttype>
 	inline SQInteger DefSQNonStaticCallback(HSQUIRRELVM vm)
 	{
+		/* Scripts running on the worker threads may only access the game with the lock. */
+		ScriptGameLock lock;
+
 		/* Find the amount of params we got */
 		int nparam = sq_gettop(vm);
 		SQUserPointer ptr = NULL;
@@ -779,6 +783,8 @@ namespace SQConvert {
 	template <typename Tcls, typename Tmethod, ScriptType Ttype>
 	inline SQInteger DefSQAdvancedNonStaticCallback(HSQUIRRELVM vm)
 	{
+		ScriptGameLock lock;
+
 		/* Find the amount of params we got */
 		int nparam = sq_gettop(vm);
 		SQUserPointer ptr = NULL;
@@ -817,6 +823,8 @@ namespace SQConvert {
 	template <typename Tcls, typename Tmethod>
 	inline SQInteger DefSQStaticCallback(HSQUIRRELVM vm)
 	{
+		ScriptGameLock lock;
+
 		/* Find the amount of params we got */
 		int nparam = sq_gettop(vm);
 		SQUserPointer ptr = NULL;
@@ -841,6 +849,8 @@ namespace SQConvert {
 	template <typename Tcls, typename Tmethod>
 	inline SQInteger DefSQAdvancedStaticCallback(HSQUIRRELVM vm)
 	{
+		ScriptGameLock lock;
+
 		/* Find the amount of params we got */
 		int nparam = sq_gettop(vm);
 		SQUserPointer ptr = NULL;
@@ -861,6 +871,8 @@ namespace SQConvert {
 	template <typename Tcls>
 	static SQInteger DefSQDestructorCallback(SQUserPointer p, SQInteger size)
 	{
+		ScriptGameLock lock;
+
 		/* Remove the real instance too */
 		if (p != NULL) ((Tcls *)p)->Release();
 		return 0;
@@ -874,6 +886,8 @@ namespace SQConvert {
 	template <typename Tcls, typename Tmethod, int Tnparam>
 	inline SQInteger DefSQConstructorCallback(HSQUIRRELVM vm)
 	{
+		ScriptGameLock lock;
+
 		try {
 			/* Create the real instance */
 			Tcls *instance = HelperT<Tmethod>::SQConstruct((Tcls *)NULL, (Tmethod)NULL, vm);
@@ -893,6 +907,8 @@ namespace SQConvert {
 	template <typename Tcls>
 	inline SQInteger DefSQAdvancedConstructorCallback(HSQUIRRELVM vm)
 	{
+		ScriptGameLock lock;
+
 		try {
 			/* Find the amount of params we got */
 			int nparam = sq_gettop(vm);
@@ -14,6 +14,7 @@
 #include <sqstdmath.h>
 #include "../debug.h"
 #include "squirrel_std.hpp"
+#include "script_thread.hpp"
 #include "../core/alloc_func.hpp"
 #include "../core/math_func.hpp"
 #include "../string_func.h"
@@ -43,6 +44,8 @@ SQInteger SquirrelStd::max(HSQUIRRELVM vm)
 
 SQInteger SquirrelStd::require(HSQUIRRELVM vm)
 {
+	ScriptGameLock lock;
+
 	SQInteger top = sq_gettop(vm);
 	const SQChar *filename;
 
@@ -832,6 +832,18 @@ static bool RedrawScreen(int32 p1)
 	return true;
 }
 
+/**
+ * Start tracking the dirty parts of the screen with blocks of the new size.
+ * @param p1 Callback parameter.
+ * @return Always true.
+ */
+static bool DirtyBlockSizeChanged(int32 p1)
+{
+	ScreenSizeChanged();
+	MarkWholeScreenDirty();
+	return true;
+}
+
 /**
  * Redraw the smallmap after a colour scheme change.
  * @param p1 Callback parameter.
@@ -112,6 +112,15 @@ struct GUISettings {
 	bool   disable_unsuitable_building;      ///< disable infrastructure building when no suitable vehicles are available
 	byte   autosave;                         ///< how often should we do autosaves?
 	bool   threaded_saves;                   ///< should we do threaded saves?
+	uint8  worker_threads;                   ///< number of worker threads for parallel and background processing, 0 = one less than the number of cores
+	bool   parallel_scripts;                 ///< run the AIs on the worker threads and execute their commands afterwards
+	bool   async_sprite_decoding;            ///< decode the sprites of the viewports on the worker threads instead of while drawing
+	bool   parallel_viewport_drawing;        ///< sort and draw the sprites of the parts of a viewport on the worker threads
+	uint8  dirty_block_width;                ///< width of the blocks the screen is divided in to track what has to be repainted
+	uint8  dirty_block_height;               ///< height of the blocks the screen is divided in to track what has to be repainted
+	uint16 dirty_merge_cost;                 ///< number of pixels repainting an extra rectangle is considered to cost, for merging the dirty blocks
+	bool   newgrf_compile_varaction2;        ///< resolve NewGRF variational action 2 through the compiled adjusts instead of the reference interpreter
+	bool   newgrf_callback_cache;            ///< cache NewGRF callback results for drawing and the GUI while the game state cannot change
 	bool   keep_all_autosave;                ///< name the autosave in a different way
 	bool   autosave_on_exit;                 ///< save an autosave when you quit the game, but do not ask "Do you really want to quit?"
 	bool   autosave_on_network_disconnect;   ///< save an autosave when you get disconnected from a network game with an error?
@@ -244,6 +253,7 @@ struct NetworkSettings {
 	uint16 max_init_time;                                 ///< maximum amount of time, in game ticks, a client may take to initiate joining
 	uint16 max_join_time;                                 ///< maximum amount of time, in game ticks, a client may take to sync up during joining
 	uint16 max_download_time;                             ///< maximum amount of time, in game ticks, a client may take to download the map
+	uint16 max_map_buffer;                                ///< maximum amount of compressed map data, in MiB, kept for the clients downloading the map
 	uint16 max_password_time;                             ///< maximum amount of time, in game ticks, a client may take to enter the password
 	uint16 max_lag_time;                                  ///< maximum amount of time, in game ticks, a client may be lagging behind the server
 	bool   pause_on_join;                                 ///< pause the game when people join
@@ -409,6 +419,8 @@ struct YAPFSettings {
 	uint32 rail_shorter_platform_per_tile_penalty; ///< penalty for shorter station platform than train (per tile)
 	uint32 ship_curve45_penalty;                   ///< penalty for 45-deg curve for ships
 	uint32 ship_curve90_penalty;                   ///< penalty for 90-deg curve for ships
+	uint8  ship_water_regions;                     ///< guide ships over long distances with water regions, 2 = also check them against a search over all water
+	uint16 road_route_cache_age;                   ///< number of ticks road vehicles share the routes they searched, 0 = do not share them
 };
 
 /** Settings related to all pathfinders. */
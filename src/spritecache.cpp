@@ -19,6 +19,10 @@
 #include "blitter/factory.hpp"
 #include "core/math_func.hpp"
 #include "core/mem_func.hpp"
+#include "console_func.h"
+#include "console_type.h"
+#include "progress.h"
+#include "thread/worker_pool.h"
 
 #include "table/sprites.h"
 #include "table/strings.h"
@@ -36,9 +40,16 @@ struct SpriteCache {
 	size_t file_pos;
 	uint32 id;
 	uint16 file_slot;
-	int16 lru;
+	SpriteID lru_prev;   ///< Previous (more recently used) sprite in the LRU list.
+	SpriteID lru_next;   ///< Next (less recently used) sprite in the LRU list.
+	SpriteID slab_prev;  ///< Previous sprite in the list of sprites of the slab of #ptr.
+	SpriteID slab_next;  ///< Next sprite in the list of sprites of the slab of #ptr.
 	SpriteTypeByte type; ///< In some cases a single sprite is misused by two NewGRFs. Once as real sprite and once as recolour sprite. If the recolour sprite gets into the cache it might be drawn as real sprite which causes enormous trouble.
 	bool warned;         ///< True iff the user has been warned about incorrect use of this sprite
+	bool decoding;       ///< True while the sprite is queued for decoding in the background.
+	bool no_prefetch;    ///< Decoding in the background failed, so the sprite is always loaded by the main thread.
+	bool load_failed;    ///< The sprite could not be loaded, so its fallback is used without reading it again.
+	bool preloaded;      ///< The sprite is loaded to be drawn while the sprite cache is read-only, see #PreloadSprite.
 	byte container_ver;  ///< Container version of the GRF the sprite is from.
 };
 
@@ -76,18 +87,60 @@ static SpriteCache *AllocateSpriteCache(uint index)
 }
 
 
-struct MemBlock {
-	size_t size;
-	byte data[];
+/**
+ * Size of a slab of the sprite cache. Each slab holds blocks of a single size
+ * class; sprites larger than a slab get a run of consecutive slabs.
+ */
+static const size_t SPRITE_SLAB_SIZE = 256 * 1024;
+/** Number of size classes; the largest class is exactly #SPRITE_SLAB_SIZE. */
+static const uint SPRITE_SIZE_CLASSES = 52;
+
+static const byte SLAB_FREE       = 0xFF; ///< Slab is not in use.
+static const byte SLAB_LARGE      = 0xFE; ///< First slab of a run holding a single large block.
+static const byte SLAB_LARGE_TAIL = 0xFD; ///< Other slabs of a run holding a single large block.
+
+static const uint INVALID_SLAB = UINT32_MAX;      ///< End of a list of slabs.
+static const SpriteID INVALID_LRU = UINT32_MAX;  ///< End of the LRU list and the slab lists of sprites.
+
+/** Bookkeeping of a single slab of the sprite cache. */
+struct SpriteSlab {
+	void *free_list;  ///< Freed blocks of the slab, linked through their first bytes.
+	uint prev;        ///< Previous slab in the list of partially used slabs of the size class.
+	uint next;        ///< Next slab in the list of partially used slabs of the size class.
+	uint bump;        ///< Offset of the first never used block, or the number of slabs of a #SLAB_LARGE run.
+	uint used;        ///< Number of blocks in use.
+	SpriteID sprites; ///< First of the sprites in the LRU list with their block in this slab.
+	byte size_class;  ///< Size class of the blocks, or one of the SLAB_* states.
 };
 
-static uint _sprite_lru_counter;
-static MemBlock *_spritecache_ptr;
-static uint _allocated_sprite_cache_size = 0;
-static int _compact_cache_counter;
+static byte *_spritecache_ptr;                                ///< Memory of the sprite cache.
+static uint _allocated_sprite_cache_size = 0;                 ///< Size of #_spritecache_ptr in bytes.
+static SpriteSlab *_sprite_slabs;                             ///< Bookkeeping of the slabs of the sprite cache.
+static uint _sprite_slab_count;                               ///< Number of slabs in the sprite cache.
+static uint _sprite_free_slabs;                               ///< Number of slabs that are not in use.
+static uint _sprite_partial_slabs[SPRITE_SIZE_CLASSES];       ///< Per size class the slabs with room for another block.
+
+static SpriteID _sprite_lru_head = INVALID_LRU; ///< Most recently used sprite.
+static SpriteID _sprite_lru_tail = INVALID_LRU; ///< Least recently used sprite, the next to be evicted.
+
+static std::vector<SpriteID> _sprite_preloaded;  ///< Sprites marked as #SpriteCache::preloaded.
+static bool _sprite_preload_evicted = false;     ///< A preloaded sprite was evicted from the cache again.
+static bool _sprite_cache_read_only = false;     ///< Only the preloaded sprites may be requested, by any thread.
+
+/** Statistics of the sprite cache. */
+static struct {
+	uint64 hits;            ///< Requests served from the cache.
+	uint64 misses;          ///< Requests that had to load the sprite.
+	uint64 evictions;       ///< Sprites removed to make room for others.
+	uint64 requested_total; ///< Bytes requested over all allocations.
+	uint64 allocated_total; ///< Bytes handed out over all allocations, after rounding to the size class.
+	size_t in_use;          ///< Bytes in blocks that are currently in use.
+	uint64 prefetched;      ///< Sprites decoded in the background and stored in the cache.
+	uint64 prefetch_unused; ///< Sprites decoded in the background that were loaded by the main thread in the mean time.
+} _sprite_cache_stats;
 
-static void CompactSpriteCache();
 static void *AllocSprite(size_t mem_req);
+static void DeleteEntryFromSpriteCache(uint item);
 
 /**
  * Skip the given amount of sprite graphics data.
@@ -392,24 +445,19 @@ static void *ReadRecolourSprite(uint16 file_slot, uint num)
 }
 
 /**
- * Read a sprite from disk.
+ * Read a sprite from disk and encode it for the current blitter.
+ * This does not touch the sprite cache, so it can run on any thread that has
+ * private access to the files (see #FioBeginPrivateAccess).
  * @param sc          Location of sprite.
- * @param id          Sprite number.
  * @param sprite_type Type of sprite.
  * @param allocator   Allocator function to use.
- * @return Read sprite data.
+ * @return Read sprite data, or NULL if the sprite could not be loaded.
  */
-static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator)
+static void *DecodeSprite(const SpriteCache *sc, SpriteType sprite_type, AllocatorProc *allocator)
 {
 	uint8 file_slot = sc->file_slot;
 	size_t file_pos = sc->file_pos;
 
-	assert(sprite_type != ST_RECOLOUR);
-	assert(IsMapgenSpriteID(id) == (sprite_type == ST_MAPGEN));
-	assert(sc->type == sprite_type);
-
-	DEBUG(sprite, 9, "Load sprite %d", id);
-
 	SpriteLoader::Sprite sprite[ZOOM_LVL_COUNT];
 	uint8 sprite_avail = 0;
 	sprite[ZOOM_LVL_NORMAL].type = sprite_type;
@@ -423,11 +471,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 		sprite_avail = sprite_loader.LoadSprite(sprite, file_slot, file_pos, sprite_type, false);
 	}
 
-	if (sprite_avail == 0) {
-		if (sprite_type == ST_MAPGEN) return NULL;
-		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't load the fallback sprite. What should I do?");
-		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
-	}
+	if (sprite_avail == 0) return NULL;
 
 	if (sprite_type == ST_MAPGEN) {
 		/* Ugly hack to work around the problem that the old landscape
@@ -457,10 +501,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 		return s;
 	}
 
-	if (!ResizeSprites(sprite, sprite_avail, file_slot, sc->id)) {
-		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't resize the fallback sprite. What should I do?");
-		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
-	}
+	if (!ResizeSprites(sprite, sprite_avail, file_slot, sc->id)) return NULL;
 
 	if (sprite->type == ST_FONT && ZOOM_LVL_FONT != ZOOM_LVL_NORMAL) {
 		/* Make ZOOM_LVL_NORMAL be ZOOM_LVL_FONT */
@@ -474,6 +515,29 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 	return BlitterFactory::GetCurrentBlitter()->Encode(sprite, allocator);
 }
 
+/**
+ * Read a sprite from disk, falling back to the 'query' sprite when it cannot be loaded.
+ * @param sc          Location of sprite.
+ * @param id          Sprite number.
+ * @param sprite_type Type of sprite.
+ * @param allocator   Allocator function to use.
+ * @return Read sprite data.
+ */
+static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator)
+{
+	assert(sprite_type != ST_RECOLOUR);
+	assert(IsMapgenSpriteID(id) == (sprite_type == ST_MAPGEN));
+	assert(sc->type == sprite_type);
+
+	DEBUG(sprite, 9, "Load sprite %d", id);
+
+	void *s = DecodeSprite(sc, sprite_type, allocator);
+	if (s != NULL || sprite_type == ST_MAPGEN) return s;
+
+	if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't load the fallback sprite. What should I do?");
+	return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
+}
+
 
 /** Map from sprite numbers to position in the GRF file. */
 static std::map<uint32, size_t> _grf_sprite_offsets;
@@ -575,13 +639,17 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id, byte co
 	}
 
 	SpriteCache *sc = AllocateSpriteCache(load_index);
+	/* Release the cached data of a sprite that gets replaced. */
+	if (sc->decoding) CancelSpritePrefetch();
+	if (sc->ptr != NULL) DeleteEntryFromSpriteCache(load_index);
 	sc->file_slot = file_slot;
 	sc->file_pos = file_pos;
 	sc->ptr = data;
-	sc->lru = 0;
 	sc->id = file_sprite_id;
 	sc->type = type;
 	sc->warned = false;
+	sc->no_prefetch = false;
+	sc->load_failed = false;
 	sc->container_ver = container_version;
 
 	return true;
@@ -591,6 +659,8 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id, byte co
 void DupSprite(SpriteID old_spr, SpriteID new_spr)
 {
 	SpriteCache *scnew = AllocateSpriteCache(new_spr); // may reallocate: so put it first
+	if (scnew->decoding) CancelSpritePrefetch();
+	if (scnew->ptr != NULL) DeleteEntryFromSpriteCache(new_spr);
 	SpriteCache *scold = GetSpriteCache(old_spr);
 
 	scnew->file_slot = scold->file_slot;
@@ -599,192 +669,616 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 	scnew->id = scold->id;
 	scnew->type = scold->type;
 	scnew->warned = false;
+	scnew->no_prefetch = scold->no_prefetch;
+	scnew->load_failed = scold->load_failed;
 	scnew->container_ver = scold->container_ver;
 }
 
 /**
- * S_FREE_MASK is used to mask-out lower bits of MemBlock::size
- * If they are non-zero, the block is free.
- * S_FREE_MASK has to ensure MemBlock is correctly aligned -
- * it means 8B (S_FREE_MASK == 7) on 64bit systems!
+ * Get the size class for a block of memory.
+ * Up to 64 bytes the classes are 16 bytes apart, beyond that there are four
+ * classes per power of two, so at most a fifth of a block is wasted.
+ * @param size Requested size in bytes, at most #SPRITE_SLAB_SIZE.
+ * @return The size class.
  */
-static const size_t S_FREE_MASK = sizeof(size_t) - 1;
+static inline uint GetSizeClass(size_t size)
+{
+	if (size <= 64) return (uint)((max<size_t>(size, 1) - 1) / 16);
+	uint log = FindLastBit(size - 1);
+	return 4 + (log - 6) * 4 + (uint)(((size - 1) >> (log - 2)) & 3);
+}
 
-/* to make sure nobody adds things to MemBlock without checking S_FREE_MASK first */
-assert_compile(sizeof(MemBlock) == sizeof(size_t));
-/* make sure it's a power of two */
-assert_compile((sizeof(size_t) & (sizeof(size_t) - 1)) == 0);
+/**
+ * Get the size of the blocks of a size class.
+ * @param size_class The size class.
+ * @return Size of the blocks in bytes.
+ */
+static inline size_t GetSizeClassSize(uint size_class)
+{
+	if (size_class < 4) return (size_class + 1) * 16;
+	uint log = 6 + (size_class - 4) / 4;
+	return ((size_t)1 << log) + ((size_t)((size_class - 4) % 4 + 1) << (log - 2));
+}
 
-static inline MemBlock *NextBlock(MemBlock *block)
+/**
+ * Check whether a slab has no room for another block.
+ * @param slab The slab to check.
+ * @param block_size Size of the blocks of the slab.
+ * @return True if all blocks of the slab are in use.
+ */
+static inline bool IsSlabFull(const SpriteSlab *slab, size_t block_size)
 {
-	return (MemBlock*)((byte*)block + (block->size & ~S_FREE_MASK));
+	return slab->free_list == NULL && slab->bump + block_size > SPRITE_SLAB_SIZE;
 }
 
-static size_t GetSpriteCacheUsage()
+/**
+ * Add a slab to the front of the list of partially used slabs of its size class.
+ * @param index The slab to add.
+ */
+static void LinkPartialSlab(uint index)
 {
-	size_t tot_size = 0;
-	MemBlock *s;
+	SpriteSlab *slab = &_sprite_slabs[index];
+	uint *head = &_sprite_partial_slabs[slab->size_class];
+	slab->prev = INVALID_SLAB;
+	slab->next = *head;
+	if (*head != INVALID_SLAB) _sprite_slabs[*head].prev = index;
+	*head = index;
+}
 
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (!(s->size & S_FREE_MASK)) tot_size += s->size;
+/**
+ * Remove a slab from the list of partially used slabs of its size class.
+ * @param index The slab to remove.
+ */
+static void UnlinkPartialSlab(uint index)
+{
+	SpriteSlab *slab = &_sprite_slabs[index];
+	if (slab->prev != INVALID_SLAB) {
+		_sprite_slabs[slab->prev].next = slab->next;
+	} else {
+		_sprite_partial_slabs[slab->size_class] = slab->next;
 	}
-
-	return tot_size;
+	if (slab->next != INVALID_SLAB) _sprite_slabs[slab->next].prev = slab->prev;
 }
 
+/**
+ * Allocate a run of consecutive slabs for a block larger than a slab.
+ * Runs are taken first-fit from the start of the cache, while single slabs
+ * are taken from the end, so small blocks do not break up the large runs.
+ * @param size Requested size in bytes.
+ * @return The block, or NULL if there is no run of free slabs that is long enough.
+ */
+static void *AllocLargeBlock(size_t size)
+{
+	uint count = (uint)CeilDiv(size, SPRITE_SLAB_SIZE);
+	if (count > _sprite_free_slabs) return NULL;
+
+	uint run = 0;
+	for (uint i = 0; i < _sprite_slab_count; i++) {
+		if (_sprite_slabs[i].size_class != SLAB_FREE) {
+			run = 0;
+			continue;
+		}
+		if (++run < count) continue;
+
+		uint first = i + 1 - count;
+		for (uint j = first; j <= i; j++) _sprite_slabs[j].size_class = SLAB_LARGE_TAIL;
+		_sprite_slabs[first].size_class = SLAB_LARGE;
+		_sprite_slabs[first].bump = count;
+		_sprite_slabs[first].sprites = INVALID_LRU;
+		_sprite_free_slabs -= count;
+		_sprite_cache_stats.in_use += count * SPRITE_SLAB_SIZE;
+		_sprite_cache_stats.allocated_total += count * SPRITE_SLAB_SIZE;
+		return _spritecache_ptr + first * SPRITE_SLAB_SIZE;
+	}
+	return NULL;
+}
 
-void IncreaseSpriteLRU()
+/**
+ * Allocate a block from the slabs of the sprite cache without evicting anything.
+ * @param size Requested size in bytes.
+ * @return The block, or NULL if there is no room for it.
+ */
+static void *AllocSpriteBlock(size_t size)
 {
-	/* Increase all LRU values */
-	if (_sprite_lru_counter > 16384) {
-		SpriteID i;
+	if (size > SPRITE_SLAB_SIZE) return AllocLargeBlock(size);
 
-		DEBUG(sprite, 3, "Fixing lru %u, inuse=" PRINTF_SIZE, _sprite_lru_counter, GetSpriteCacheUsage());
+	uint size_class = GetSizeClass(size);
+	size_t block_size = GetSizeClassSize(size_class);
 
-		for (i = 0; i != _spritecache_items; i++) {
-			SpriteCache *sc = GetSpriteCache(i);
-			if (sc->ptr != NULL) {
-				if (sc->lru >= 0) {
-					sc->lru = -1;
-				} else if (sc->lru != -32768) {
-					sc->lru--;
-				}
-			}
-		}
-		_sprite_lru_counter = 0;
+	uint index = _sprite_partial_slabs[size_class];
+	if (index == INVALID_SLAB) {
+		if (_sprite_free_slabs == 0) return NULL;
+
+		index = _sprite_slab_count;
+		do {
+			assert(index > 0);
+			index--;
+		} while (_sprite_slabs[index].size_class != SLAB_FREE);
+
+		SpriteSlab *slab = &_sprite_slabs[index];
+		slab->free_list = NULL;
+		slab->bump = 0;
+		slab->used = 0;
+		slab->sprites = INVALID_LRU;
+		slab->size_class = size_class;
+		_sprite_free_slabs--;
+		LinkPartialSlab(index);
 	}
 
-	/* Compact sprite cache every now and then. */
-	if (++_compact_cache_counter >= 740) {
-		CompactSpriteCache();
-		_compact_cache_counter = 0;
+	SpriteSlab *slab = &_sprite_slabs[index];
+	void *block;
+	if (slab->free_list != NULL) {
+		block = slab->free_list;
+		slab->free_list = *(void **)block;
+	} else {
+		block = _spritecache_ptr + index * SPRITE_SLAB_SIZE + slab->bump;
+		slab->bump += (uint)block_size;
 	}
+	slab->used++;
+	if (IsSlabFull(slab, block_size)) UnlinkPartialSlab(index);
+
+	_sprite_cache_stats.in_use += block_size;
+	_sprite_cache_stats.allocated_total += block_size;
+	return block;
 }
 
 /**
- * Called when holes in the sprite cache should be removed.
- * That is accomplished by moving the cached data.
+ * Get the slab a block of the sprite cache is in.
+ * @param block The block.
+ * @return Index of the slab, or of the first slab of a run of slabs.
  */
-static void CompactSpriteCache()
+static inline uint GetSpriteSlab(const void *block)
 {
-	MemBlock *s;
-
-	DEBUG(sprite, 3, "Compacting sprite cache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
+	return (uint)(((const byte *)block - _spritecache_ptr) / SPRITE_SLAB_SIZE);
+}
 
-	for (s = _spritecache_ptr; s->size != 0;) {
-		if (s->size & S_FREE_MASK) {
-			MemBlock *next = NextBlock(s);
-			MemBlock temp;
-			SpriteID i;
+/**
+ * Return a block to the slabs of the sprite cache.
+ * @param block The block to free.
+ */
+static void FreeSpriteBlock(void *block)
+{
+	uint index = GetSpriteSlab(block);
+	assert(index < _sprite_slab_count);
+	SpriteSlab *slab = &_sprite_slabs[index];
+
+	if (slab->size_class == SLAB_LARGE) {
+		uint count = slab->bump;
+		for (uint i = index; i < index + count; i++) _sprite_slabs[i].size_class = SLAB_FREE;
+		_sprite_free_slabs += count;
+		_sprite_cache_stats.in_use -= count * SPRITE_SLAB_SIZE;
+		return;
+	}
 
-			/* Since free blocks are automatically coalesced, this should hold true. */
-			assert(!(next->size & S_FREE_MASK));
+	assert(slab->size_class < SPRITE_SIZE_CLASSES && slab->used > 0);
+	size_t block_size = GetSizeClassSize(slab->size_class);
+	bool was_full = IsSlabFull(slab, block_size);
+
+	*(void **)block = slab->free_list;
+	slab->free_list = block;
+	slab->used--;
+	_sprite_cache_stats.in_use -= block_size;
+
+	if (slab->used == 0) {
+		if (!was_full) UnlinkPartialSlab(index);
+		slab->size_class = SLAB_FREE;
+		_sprite_free_slabs++;
+	} else if (was_full) {
+		LinkPartialSlab(index);
+	}
+}
 
-			/* If the next block is the sentinel block, we can safely return */
-			if (next->size == 0) break;
+/**
+ * Mark a sprite as the most recently used one.
+ * @param item The sprite, which must not be in the LRU list.
+ */
+static void LinkSpriteLRU(SpriteID item)
+{
+	SpriteCache *sc = GetSpriteCache(item);
+	sc->lru_prev = INVALID_LRU;
+	sc->lru_next = _sprite_lru_head;
+	if (_sprite_lru_head != INVALID_LRU) {
+		GetSpriteCache(_sprite_lru_head)->lru_prev = item;
+	} else {
+		_sprite_lru_tail = item;
+	}
+	_sprite_lru_head = item;
+}
 
-			/* Locate the sprite belonging to the next pointer. */
-			for (i = 0; GetSpriteCache(i)->ptr != next->data; i++) {
-				assert(i != _spritecache_items);
-			}
+/**
+ * Remove a sprite from the LRU list.
+ * @param item The sprite, which must be in the LRU list.
+ */
+static void UnlinkSpriteLRU(SpriteID item)
+{
+	SpriteCache *sc = GetSpriteCache(item);
+	if (sc->lru_prev != INVALID_LRU) {
+		GetSpriteCache(sc->lru_prev)->lru_next = sc->lru_next;
+	} else {
+		_sprite_lru_head = sc->lru_next;
+	}
+	if (sc->lru_next != INVALID_LRU) {
+		GetSpriteCache(sc->lru_next)->lru_prev = sc->lru_prev;
+	} else {
+		_sprite_lru_tail = sc->lru_prev;
+	}
+}
 
-			GetSpriteCache(i)->ptr = s->data; // Adjust sprite array entry
-			/* Swap this and the next block */
-			temp = *s;
-			memmove(s, next, next->size);
-			s = NextBlock(s);
-			*s = temp;
+/**
+ * Add a sprite to the list of sprites of the slab its block is in, so
+ * #MakeRoomForSpriteBlock can empty a slab without searching the LRU list.
+ * @param item The sprite, which must be in the LRU list.
+ */
+static void LinkSpriteSlab(SpriteID item)
+{
+	SpriteCache *sc = GetSpriteCache(item);
+	SpriteSlab *slab = &_sprite_slabs[GetSpriteSlab(sc->ptr)];
+	sc->slab_prev = INVALID_LRU;
+	sc->slab_next = slab->sprites;
+	if (slab->sprites != INVALID_LRU) GetSpriteCache(slab->sprites)->slab_prev = item;
+	slab->sprites = item;
+}
 
-			/* Coalesce free blocks */
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
-			}
-		} else {
-			s = NextBlock(s);
-		}
+/**
+ * Remove a sprite from the list of sprites of the slab its block is in.
+ * @param item The sprite, which must be in the list of its slab.
+ */
+static void UnlinkSpriteSlab(SpriteID item)
+{
+	SpriteCache *sc = GetSpriteCache(item);
+	if (sc->slab_prev != INVALID_LRU) {
+		GetSpriteCache(sc->slab_prev)->slab_next = sc->slab_next;
+	} else {
+		_sprite_slabs[GetSpriteSlab(sc->ptr)].sprites = sc->slab_next;
 	}
+	if (sc->slab_next != INVALID_LRU) GetSpriteCache(sc->slab_next)->slab_prev = sc->slab_prev;
 }
 
 /**
  * Delete a single entry from the sprite cache.
+ * Recolour sprites are never evicted, so they are not part of the LRU list.
  * @param item Entry to delete.
  */
 static void DeleteEntryFromSpriteCache(uint item)
 {
-	/* Mark the block as free (the block must be in use) */
-	MemBlock *s = (MemBlock*)GetSpriteCache(item)->ptr - 1;
-	assert(!(s->size & S_FREE_MASK));
-	s->size |= S_FREE_MASK;
-	GetSpriteCache(item)->ptr = NULL;
-
-	/* And coalesce adjacent free blocks */
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (s->size & S_FREE_MASK) {
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
+	SpriteCache *sc = GetSpriteCache(item);
+	assert(sc->ptr != NULL);
+	assert(!_sprite_cache_read_only);
+	if (sc->preloaded) _sprite_preload_evicted = true;
+	if (sc->type != ST_RECOLOUR) {
+		UnlinkSpriteLRU(item);
+		UnlinkSpriteSlab(item);
+	}
+	FreeSpriteBlock(sc->ptr);
+	sc->ptr = NULL;
+}
+
+/**
+ * Evict a sprite from the sprite cache to make room for another one.
+ * @param item The sprite to evict.
+ */
+static void EvictSprite(SpriteID item)
+{
+	DEBUG(sprite, 4, "Evicting sprite %u, inuse=" PRINTF_SIZE, item, _sprite_cache_stats.in_use);
+	_sprite_cache_stats.evictions++;
+	DeleteEntryFromSpriteCache(item);
+}
+
+/** Number of least recently used sprites searched for a block of the requested size class. */
+static const uint SPRITE_EVICT_SEARCH_LENGTH = 64;
+
+/**
+ * Evict sprites to make room for a block. When one of the least recently used
+ * sprites has a block of the same size class, only that sprite is evicted.
+ * Otherwise the slab of the least recently used sprite is emptied, so sprites
+ * of other size classes are only evicted when that actually frees a slab.
+ * @param size Requested size in bytes.
+ */
+static void MakeRoomForSpriteBlock(size_t size)
+{
+	/* Display an error message and die, in case we found no sprite at all.
+	 * This shouldn't really happen, unless all sprites are locked. */
+	if (_sprite_lru_tail == INVALID_LRU) error("Out of sprite memory");
+
+	if (size <= SPRITE_SLAB_SIZE) {
+		uint size_class = GetSizeClass(size);
+		SpriteID item = _sprite_lru_tail;
+		for (uint i = 0; i < SPRITE_EVICT_SEARCH_LENGTH && item != INVALID_LRU; i++) {
+			const SpriteCache *sc = GetSpriteCache(item);
+			if (_sprite_slabs[GetSpriteSlab(sc->ptr)].size_class == size_class) {
+				EvictSprite(item);
+				return;
 			}
+			item = sc->lru_prev;
 		}
 	}
+
+	const SpriteSlab *slab = &_sprite_slabs[GetSpriteSlab(GetSpriteCache(_sprite_lru_tail)->ptr)];
+	while (slab->sprites != INVALID_LRU) EvictSprite(slab->sprites);
+}
+
+static void *AllocSprite(size_t mem_req)
+{
+	_sprite_cache_stats.requested_total += mem_req;
+
+	for (;;) {
+		void *block = AllocSpriteBlock(mem_req);
+		if (block != NULL) return block;
+
+		MakeRoomForSpriteBlock(mem_req);
+	}
+}
+
+/** Number of sprites decoded by a single worker job. */
+static const uint SPRITE_DECODE_BATCH_SIZE = 32;
+/** Maximum number of sprites queued for decoding in the background. */
+static const uint SPRITE_DECODE_MAX_QUEUED = 4096;
+
+/** A sprite decoded in the background. */
+struct DecodedSprite {
+	SpriteID id;       ///< The sprite.
+	SpriteCache entry; ///< Copy of the cache entry at the time the sprite was queued.
+	void *data;        ///< The encoded sprite, or NULL if it could not be decoded.
+	size_t size;       ///< Size of #data in bytes.
+};
+
+/** A group of sprites decoded by a single worker job. */
+struct SpriteDecodeBatch {
+	std::vector<DecodedSprite> sprites; ///< The sprites to decode.
+	WorkerJobTicket ticket;             ///< Ticket of the job.
+};
+
+static std::vector<SpriteID> _sprite_decode_queue;          ///< Sprites waiting for a batch.
+static std::vector<SpriteDecodeBatch *> _sprite_decode_jobs; ///< Batches submitted to the worker pool.
+
+/** Size of the last sprite allocated by #AllocDecodedSprite on this thread. */
+static thread_local size_t _decoded_sprite_size;
+
+/**
+ * Allocator for sprites decoded in the background; their final place in the
+ * sprite cache is only known when they are handed to the main thread.
+ * @param size Size of the sprite.
+ * @return The memory for the sprite.
+ */
+static void *AllocDecodedSprite(size_t size)
+{
+	_decoded_sprite_size = size;
+	return MallocT<byte>(size);
 }
 
-static void DeleteEntryFromSpriteCache()
+/**
+ * Worker job decoding a batch of sprites.
+ * @param param The SpriteDecodeBatch.
+ */
+static void DecodeSpriteBatch(void *param)
 {
-	uint best = UINT_MAX;
-	int cur_lru;
+	SpriteDecodeBatch *batch = (SpriteDecodeBatch *)param;
 
-	DEBUG(sprite, 3, "DeleteEntryFromSpriteCache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
+	FioBeginPrivateAccess();
+	for (DecodedSprite &ds : batch->sprites) {
+		ds.data = DecodeSprite(&ds.entry, ST_NORMAL, AllocDecodedSprite);
+		ds.size = ds.data != NULL ? _decoded_sprite_size : 0;
+	}
+	FioEndPrivateAccess();
+}
 
-	cur_lru = 0xffff;
-	for (SpriteID i = 0; i != _spritecache_items; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->type != ST_RECOLOUR && sc->ptr != NULL && sc->lru < cur_lru) {
-			cur_lru = sc->lru;
-			best = i;
+/**
+ * Check whether sprites can be decoded in the background.
+ * @return True if sprites are decoded by the worker threads.
+ */
+bool IsSpritePrefetchEnabled()
+{
+	/* While loading in the background the slotted files of the main thread change. */
+	if (HasModalProgress()) return false;
+	return _settings_client.gui.async_sprite_decoding && _worker_pool.GetWorkerCount() > 0;
+}
+
+/**
+ * Submit the queued sprites to the worker pool. To leave room for other
+ * jobs, at most two batches per worker are decoded at the same time.
+ * @param partial Whether to submit a batch that is not full.
+ */
+static void SubmitSpriteDecodeJobs(bool partial)
+{
+	uint max_jobs = _worker_pool.GetWorkerCount() * 2;
+	while (_sprite_decode_jobs.size() < max_jobs && (_sprite_decode_queue.size() >= SPRITE_DECODE_BATCH_SIZE || (partial && !_sprite_decode_queue.empty()))) {
+		uint count = min<uint>((uint)_sprite_decode_queue.size(), SPRITE_DECODE_BATCH_SIZE);
+
+		SpriteDecodeBatch *batch = new SpriteDecodeBatch();
+		batch->sprites.resize(count);
+		for (uint i = 0; i < count; i++) {
+			DecodedSprite &ds = batch->sprites[i];
+			ds.id = _sprite_decode_queue[i];
+			ds.entry = *GetSpriteCache(ds.id);
+			ds.data = NULL;
+			ds.size = 0;
 		}
+		_sprite_decode_queue.erase(_sprite_decode_queue.begin(), _sprite_decode_queue.begin() + count);
+
+		_sprite_decode_jobs.push_back(batch);
+		_worker_pool.Submit(&DecodeSpriteBatch, batch, &batch->ticket);
 	}
+}
 
-	/* Display an error message and die, in case we found no sprite at all.
-	 * This shouldn't really happen, unless all sprites are locked. */
-	if (best == UINT_MAX) error("Out of sprite memory");
+/**
+ * Make sure a sprite gets into the sprite cache, without waiting for it to be decoded.
+ * Only normal sprites are decoded in the background; for other sprites and
+ * when background decoding is disabled nothing is done.
+ * @param sprite The sprite.
+ * @return False if the sprite is not in the cache yet but is being decoded in the background.
+ */
+bool PrefetchSprite(SpriteID sprite)
+{
+	if (!IsSpritePrefetchEnabled() || !SpriteExists(sprite)) return true;
+
+	SpriteCache *sc = GetSpriteCache(sprite);
+	if (sc->ptr != NULL || sc->type != ST_NORMAL || sc->no_prefetch || sc->load_failed) return true;
 
-	DeleteEntryFromSpriteCache(best);
+	if (!sc->decoding) {
+		/* Sprites that do not fit in the queue are requested again when they are drawn. */
+		if (_sprite_decode_queue.size() >= SPRITE_DECODE_MAX_QUEUED) return false;
+
+		sc->decoding = true;
+		_sprite_decode_queue.push_back(sprite);
+		SubmitSpriteDecodeJobs(false);
+	}
+	return false;
 }
 
-static void *AllocSprite(size_t mem_req)
+/**
+ * Move a sprite decoded in the background into the sprite cache.
+ * @param ds The decoded sprite.
+ * @return True if the sprite was stored in the cache.
+ */
+static bool StoreDecodedSprite(DecodedSprite &ds)
 {
-	mem_req += sizeof(MemBlock);
+	SpriteCache *sc = GetSpriteCache(ds.id);
+	sc->decoding = false;
 
-	/* Align this to correct boundary. This also makes sure at least one
-	 * bit is not used, so we can use it for other things. */
-	mem_req = Align(mem_req, S_FREE_MASK + 1);
+	if (ds.data == NULL) {
+		/* Let the main thread load it, so the usual warnings and fallbacks apply. */
+		sc->no_prefetch = true;
+		return true;
+	}
 
-	for (;;) {
-		MemBlock *s;
-
-		for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-			if (s->size & S_FREE_MASK) {
-				size_t cur_size = s->size & ~S_FREE_MASK;
-
-				/* Is the block exactly the size we need or
-				 * big enough for an additional free block? */
-				if (cur_size == mem_req ||
-						cur_size >= mem_req + sizeof(MemBlock)) {
-					/* Set size and in use */
-					s->size = mem_req;
-
-					/* Do we need to inject a free block too? */
-					if (cur_size != mem_req) {
-						NextBlock(s)->size = (cur_size - mem_req) | S_FREE_MASK;
-					}
-
-					return s->data;
-				}
-			}
+	bool stored = false;
+	if (sc->ptr == NULL) {
+		sc->ptr = AllocSprite(ds.size);
+		memcpy(sc->ptr, ds.data, ds.size);
+		LinkSpriteLRU(ds.id);
+		LinkSpriteSlab(ds.id);
+		_sprite_cache_stats.prefetched++;
+		stored = true;
+	} else {
+		_sprite_cache_stats.prefetch_unused++;
+	}
+	free(ds.data);
+	return stored;
+}
+
+/**
+ * Move the sprites that are decoded in the background into the sprite cache,
+ * and hand the queued sprites to the worker threads. Call once per frame.
+ * @return True if any sprite that was being decoded is available now.
+ */
+bool ProcessPrefetchedSprites()
+{
+	/* The loading thread owns the sprite cache while it is busy. */
+	if (HasModalProgress()) return false;
+
+	bool changed = false;
+	for (std::vector<SpriteDecodeBatch *>::iterator it = _sprite_decode_jobs.begin(); it != _sprite_decode_jobs.end();) {
+		SpriteDecodeBatch *batch = *it;
+		if (!batch->ticket.IsDone()) {
+			++it;
+			continue;
+		}
+
+		for (DecodedSprite &ds : batch->sprites) {
+			if (StoreDecodedSprite(ds)) changed = true;
+		}
+		delete batch;
+		it = _sprite_decode_jobs.erase(it);
+	}
+
+	SubmitSpriteDecodeJobs(true);
+	return changed;
+}
+
+/**
+ * Wait for the sprites that are being decoded in the background and throw
+ * them away. Needed before the sprite cache or the blitter changes.
+ */
+void CancelSpritePrefetch()
+{
+	for (SpriteDecodeBatch *batch : _sprite_decode_jobs) {
+		_worker_pool.Wait(&batch->ticket);
+		for (DecodedSprite &ds : batch->sprites) {
+			free(ds.data);
+			if (ds.id < _spritecache_items) GetSpriteCache(ds.id)->decoding = false;
 		}
+		delete batch;
+	}
+	_sprite_decode_jobs.clear();
+
+	for (SpriteID id : _sprite_decode_queue) {
+		if (id < _spritecache_items) GetSpriteCache(id)->decoding = false;
+	}
+	_sprite_decode_queue.clear();
+}
+
+/**
+ * Load a sprite into the sprite cache, so it can be drawn while the sprite
+ * cache is read-only. The sprite stays marked until #UnlockSpriteCache.
+ * @param sprite The sprite.
+ * @param type The type of the sprite.
+ * @return False if the sprite cannot be drawn from the cache alone, e.g. because it does not exist or failed to load.
+ */
+bool PreloadSprite(SpriteID sprite, SpriteType type)
+{
+	assert(!_sprite_cache_read_only);
+	if (!SpriteExists(sprite)) return false;
+
+	SpriteCache *sc = GetSpriteCache(sprite);
+	if (sc->type != type) return false;
+	if (sc->preloaded && sc->ptr != NULL) return true;
+
+	GetRawSprite(sprite, type);
+	if (sc->ptr == NULL) return false;
 
-		/* Reached sentinel, but no block found yet. Delete some old entry. */
-		DeleteEntryFromSpriteCache();
+	if (!sc->preloaded) {
+		sc->preloaded = true;
+		_sprite_preloaded.push_back(sprite);
 	}
+	return true;
+}
+
+/**
+ * Make the sprite cache read-only, so the preloaded sprites can be drawn by
+ * several threads at once. No other sprites may be requested until the cache
+ * is unlocked again.
+ * @return False if preloaded sprites were evicted again to make room for others; the cache is not locked then.
+ */
+bool LockSpriteCache()
+{
+	assert(!_sprite_cache_read_only);
+	if (_sprite_preload_evicted) return false;
+
+	_sprite_cache_read_only = true;
+	return true;
+}
+
+/**
+ * Make the sprite cache writable again and forget which sprites were preloaded.
+ * Also needed when #LockSpriteCache failed or was not called.
+ */
+void UnlockSpriteCache()
+{
+	_sprite_cache_read_only = false;
+	for (SpriteID sprite : _sprite_preloaded) GetSpriteCache(sprite)->preloaded = false;
+	_sprite_preloaded.clear();
+	_sprite_preload_evicted = false;
+}
+
+/**
+ * Print the statistics of the sprite cache to the console.
+ */
+void ConPrintSpriteCacheStats()
+{
+	uint64 requests = _sprite_cache_stats.hits + _sprite_cache_stats.misses;
+	size_t slab_bytes = (size_t)(_sprite_slab_count - _sprite_free_slabs) * SPRITE_SLAB_SIZE;
+
+	IConsolePrintF(CC_DEFAULT, "Sprite cache: %u KiB in %u slabs of %u KiB, %u slabs free",
+			_allocated_sprite_cache_size / 1024, _sprite_slab_count, (uint)(SPRITE_SLAB_SIZE / 1024), _sprite_free_slabs);
+	IConsolePrintF(CC_DEFAULT, "Requests: " OTTD_PRINTF64 ", hits: " OTTD_PRINTF64 " (%u%%), misses: " OTTD_PRINTF64 ", evictions: " OTTD_PRINTF64,
+			requests, _sprite_cache_stats.hits, requests == 0 ? 0 : (uint)(_sprite_cache_stats.hits * 100 / requests),
+			_sprite_cache_stats.misses, _sprite_cache_stats.evictions);
+	IConsolePrintF(CC_DEFAULT, "In use: " PRINTF_SIZE " KiB in blocks, " PRINTF_SIZE " KiB in slabs (%u%% of the slabs used)",
+			_sprite_cache_stats.in_use / 1024, slab_bytes / 1024, slab_bytes == 0 ? 0 : (uint)((uint64)_sprite_cache_stats.in_use * 100 / slab_bytes));
+	IConsolePrintF(CC_DEFAULT, "Size class rounding: %u%% of the allocated bytes were requested",
+			_sprite_cache_stats.allocated_total == 0 ? 100 : (uint)(_sprite_cache_stats.requested_total * 100 / _sprite_cache_stats.allocated_total));
+	IConsolePrintF(CC_DEFAULT, "Background decoding: %s, " OTTD_PRINTF64 " sprites stored, " OTTD_PRINTF64 " unused, " PRINTF_SIZE " queued",
+			IsSpritePrefetchEnabled() ? "on" : "off", _sprite_cache_stats.prefetched, _sprite_cache_stats.prefetch_unused, _sprite_decode_queue.size());
 }
 
 /**
@@ -845,6 +1339,13 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 	assert(type != ST_MAPGEN || IsMapgenSpriteID(sprite));
 	assert(type < ST_INVALID);
 
+	if (_sprite_cache_read_only) {
+		/* Several threads are drawing; the cache, its LRU list and its statistics must not change. */
+		const SpriteCache *sc = GetSpriteCache(sprite);
+		assert(allocator == NULL && sc->preloaded && sc->type == type && sc->ptr != NULL);
+		return sc->ptr;
+	}
+
 	if (!SpriteExists(sprite)) {
 		DEBUG(sprite, 1, "Tried to load non-existing sprite #%d. Probable cause: Wrong/missing NewGRFs", sprite);
 
@@ -859,13 +1360,38 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 	if (allocator == NULL) {
 		/* Load sprite into/from spritecache */
 
-		/* Update LRU */
-		sc->lru = ++_sprite_lru_counter;
+		if (sc->ptr != NULL) {
+			_sprite_cache_stats.hits++;
+			/* Move the sprite to the front of the LRU list. */
+			if (type != ST_RECOLOUR && _sprite_lru_head != sprite) {
+				UnlinkSpriteLRU(sprite);
+				LinkSpriteLRU(sprite);
+			}
+			return sc->ptr;
+		}
 
-		/* Load the sprite, if it is not loaded, yet */
-		if (sc->ptr == NULL) sc->ptr = ReadSprite(sc, sprite, type, AllocSprite);
+		if (sc->load_failed) {
+			/* The sprite failed to load before, so do not read it again. */
+			_sprite_cache_stats.hits++;
+			return type == ST_MAPGEN ? NULL : GetRawSprite(SPR_IMG_QUERY, ST_NORMAL);
+		}
 
-		return sc->ptr;
+		/* Load the sprite, it is not loaded yet. */
+		_sprite_cache_stats.misses++;
+		void *ptr = ReadSprite(sc, sprite, type, AllocSprite);
+
+		/* Do not store the fallback sprite of a sprite that failed to load; it belongs to another entry. */
+		if (ptr == NULL || (sprite != SPR_IMG_QUERY && ptr == GetSpriteCache(SPR_IMG_QUERY)->ptr)) {
+			sc->load_failed = true;
+			return ptr;
+		}
+
+		sc->ptr = ptr;
+		if (type != ST_RECOLOUR) {
+			LinkSpriteLRU(sprite);
+			LinkSpriteSlab(sprite);
+		}
+		return ptr;
 	} else {
 		/* Do not use the spritecache, but a different allocator. */
 		return ReadSprite(sc, sprite, type, allocator);
@@ -883,7 +1409,7 @@ static void GfxInitSpriteCache()
 	static uint last_alloc_attempt = 0;
 
 	if (_spritecache_ptr == NULL || (_allocated_sprite_cache_size != target_size && target_size != last_alloc_attempt)) {
-		delete[] reinterpret_cast<byte *>(_spritecache_ptr);
+		delete[] _spritecache_ptr;
 
 		last_alloc_attempt = target_size;
 		_allocated_sprite_cache_size = target_size;
@@ -891,15 +1417,15 @@ static void GfxInitSpriteCache()
 		do {
 			try {
 				/* Try to allocate 50% more to make sure we do not allocate almost all available. */
-				_spritecache_ptr = reinterpret_cast<MemBlock *>(new byte[_allocated_sprite_cache_size + _allocated_sprite_cache_size / 2]);
+				_spritecache_ptr = new byte[_allocated_sprite_cache_size + _allocated_sprite_cache_size / 2];
 			} catch (std::bad_alloc &) {
 				_spritecache_ptr = NULL;
 			}
 
 			if (_spritecache_ptr != NULL) {
 				/* Allocation succeeded, but we wanted less. */
-				delete[] reinterpret_cast<byte *>(_spritecache_ptr);
-				_spritecache_ptr = reinterpret_cast<MemBlock *>(new byte[_allocated_sprite_cache_size]);
+				delete[] _spritecache_ptr;
+				_spritecache_ptr = new byte[_allocated_sprite_cache_size];
 			} else if (_allocated_sprite_cache_size < 2 * 1024 * 1024) {
 				usererror("Cannot allocate spritecache");
 			} else {
@@ -918,22 +1444,29 @@ static void GfxInitSpriteCache()
 		}
 	}
 
-	/* A big free block */
-	_spritecache_ptr->size = (_allocated_sprite_cache_size - sizeof(MemBlock)) | S_FREE_MASK;
-	/* Sentinel block (identified by size == 0) */
-	NextBlock(_spritecache_ptr)->size = 0;
+	/* All slabs are free and all size classes are empty. */
+	assert(GetSizeClass(SPRITE_SLAB_SIZE) == SPRITE_SIZE_CLASSES - 1);
+	_sprite_slab_count = (uint)(_allocated_sprite_cache_size / SPRITE_SLAB_SIZE);
+	_sprite_free_slabs = _sprite_slab_count;
+	free(_sprite_slabs);
+	_sprite_slabs = MallocT<SpriteSlab>(_sprite_slab_count);
+	for (uint i = 0; i < _sprite_slab_count; i++) _sprite_slabs[i].size_class = SLAB_FREE;
+	for (uint i = 0; i < SPRITE_SIZE_CLASSES; i++) _sprite_partial_slabs[i] = INVALID_SLAB;
+
+	_sprite_lru_head = INVALID_LRU;
+	_sprite_lru_tail = INVALID_LRU;
+	_sprite_cache_stats.in_use = 0;
 }
 
 void GfxInitSpriteMem()
 {
+	CancelSpritePrefetch();
 	GfxInitSpriteCache();
 
 	/* Reset the spritecache 'pool' */
 	free(_spritecache);
 	_spritecache_items = 0;
 	_spritecache = NULL;
-
-	_compact_cache_counter = 0;
 }
 
 /**
@@ -942,11 +1475,10 @@ void GfxInitSpriteMem()
  */
 void GfxClearSpriteCache()
 {
-	/* Clear sprite ptr for all cached items */
-	for (uint i = 0; i != _spritecache_items; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->type != ST_RECOLOUR && sc->ptr != NULL) DeleteEntryFromSpriteCache(i);
-	}
+	CancelSpritePrefetch();
+
+	/* All cached items except the recolour sprites are in the LRU list. */
+	while (_sprite_lru_head != INVALID_LRU) DeleteEntryFromSpriteCache(_sprite_lru_head);
 }
 
-/* static */ ReusableBuffer<SpriteLoader::CommonPixel> SpriteLoader::Sprite::buffer[ZOOM_LVL_COUNT];
+/* static */ thread_local ReusableBuffer<SpriteLoader::CommonPixel> SpriteLoader::Sprite::buffer[ZOOM_LVL_COUNT];
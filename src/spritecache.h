@@ -50,7 +50,15 @@ static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
 
 void GfxInitSpriteMem();
 void GfxClearSpriteCache();
-void IncreaseSpriteLRU();
+
+bool IsSpritePrefetchEnabled();
+bool PrefetchSprite(SpriteID sprite);
+bool ProcessPrefetchedSprites();
+void CancelSpritePrefetch();
+
+bool PreloadSprite(SpriteID sprite, SpriteType type);
+bool LockSpriteCache();
+void UnlockSpriteCache();
 
 void ReadGRFSpriteOffsets(byte container_version);
 size_t GetGRFSpriteOffset(uint32 id);
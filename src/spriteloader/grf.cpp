@@ -44,6 +44,9 @@ DECLARE_ENUM_AS_BIT_SET(SpriteColourComponent)
  */
 static bool WarnCorruptSprite(uint8 file_slot, size_t file_pos, int line)
 {
+	/* Sprites decoded in the background are loaded again by the main thread when they fail. */
+	if (FioHasPrivateAccess()) return false;
+
 	static byte warning_level = 0;
 	if (warning_level == 0) {
 		SetDParamStr(0, FioGetFilename(file_slot));
@@ -182,7 +185,7 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 			return WarnCorruptSprite(file_slot, file_pos, __LINE__);
 		}
 
-		if (dest_size > sprite->width * sprite->height * bpp) {
+		if (dest_size > sprite->width * sprite->height * bpp && !FioHasPrivateAccess()) {
 			static byte warning_level = 0;
 			DEBUG(sprite, warning_level, "Ignoring " OTTD_PRINTF64 " unused extra bytes from the sprite from %s at position %i", dest_size - sprite->width * sprite->height * bpp, FioGetFilename(file_slot), (int)file_pos);
 			warning_level = 6;
@@ -280,7 +283,7 @@ uint8 LoadSpriteV2(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_po
 
 			if (HasBit(loaded_sprites, zoom_lvl)) {
 				/* We already have this zoom level, skip sprite. */
-				DEBUG(sprite, 1, "Ignoring duplicate zoom level sprite %u from %s", id, FioGetFilename(file_slot));
+				if (!FioHasPrivateAccess()) DEBUG(sprite, 1, "Ignoring duplicate zoom level sprite %u from %s", id, FioGetFilename(file_slot));
 				FioSkipBytes(num - 2);
 				continue;
 			}
@@ -41,6 +41,63 @@ INSTANTIATE_POOL_METHODS(Station)
 
 StationKdtree _station_kdtree(Kdtree_StationXYFunc);
 
+/** Number of bits of a tile coordinate that select the tile within a bucket of the catchment index. */
+static const uint CATCHMENT_BUCKET_BITS = 4;
+
+/**
+ * Catchment index: the map divided in buckets of 16x16 tiles, with for each
+ * bucket the stations whose catchment rectangle overlaps it.
+ */
+static std::vector<std::vector<StationID> > _catchment_buckets;
+
+/**
+ * Call a function for all buckets of the catchment index overlapping an area.
+ * @param area The area, must be within the map.
+ * @param func The function to call, must take a single parameter which is std::vector<StationID>&.
+ */
+template <typename Func>
+static void ForAllCatchmentBuckets(const TileArea &area, Func func)
+{
+	uint row = MapSizeX() >> CATCHMENT_BUCKET_BITS;
+	uint x1 = TileX(area.tile) >> CATCHMENT_BUCKET_BITS;
+	uint y1 = TileY(area.tile) >> CATCHMENT_BUCKET_BITS;
+	uint x2 = (TileX(area.tile) + area.w - 1) >> CATCHMENT_BUCKET_BITS;
+	uint y2 = (TileY(area.tile) + area.h - 1) >> CATCHMENT_BUCKET_BITS;
+
+	for (uint y = y1; y <= y2; y++) {
+		for (uint x = x1; x <= x2; x++) {
+			func(_catchment_buckets[y * row + x]);
+		}
+	}
+}
+
+/**
+ * Add a station to the buckets its catchment overlaps.
+ * @param st The station.
+ */
+static void AddToCatchmentIndex(const Station *st)
+{
+	if (st->catchment_tiles.tile == INVALID_TILE) return;
+	ForAllCatchmentBuckets(st->catchment_tiles, [&](std::vector<StationID> &bucket) {
+		bucket.push_back(st->index);
+	});
+}
+
+/**
+ * Remove a station from the buckets its catchment overlaps.
+ * @param st The station.
+ */
+static void RemoveFromCatchmentIndex(const Station *st)
+{
+	if (st->catchment_tiles.tile == INVALID_TILE) return;
+	ForAllCatchmentBuckets(st->catchment_tiles, [&](std::vector<StationID> &bucket) {
+		std::vector<StationID>::iterator it = std::find(bucket.begin(), bucket.end(), st->index);
+		assert(it != bucket.end());
+		*it = bucket.back();
+		bucket.pop_back();
+	});
+}
+
 void RebuildStationKdtree()
 {
 	std::vector<StationID> stids;
@@ -49,6 +106,29 @@ void RebuildStationKdtree()
 		stids.push_back(st->index);
 	}
 	_station_kdtree.Build(stids.begin(), stids.end());
+
+	/* The map might have changed size, so rebuild the catchment index as well. */
+	_catchment_buckets.clear();
+	_catchment_buckets.resize((MapSizeX() >> CATCHMENT_BUCKET_BITS) * (MapSizeY() >> CATCHMENT_BUCKET_BITS));
+	Station *station;
+	FOR_ALL_STATIONS(station) AddToCatchmentIndex(station);
+}
+
+/**
+ * Find the stations whose catchment rectangle overlaps an area. Finding them
+ * only costs the number of stations near the area, instead of the area in
+ * which stations covering it could be.
+ * @param area The area to look for.
+ * @param[out] stations The stations, without duplicates. These still need to
+ *                      be tested against the actual catchment tiles.
+ */
+void FindStationsByCatchmentIndex(const TileArea &area, std::vector<Station *> *stations)
+{
+	ForAllCatchmentBuckets(area, [&](std::vector<StationID> &bucket) {
+		for (StationID id : bucket) stations->push_back(Station::Get(id));
+	});
+	std::sort(stations->begin(), stations->end());
+	stations->erase(std::unique(stations->begin(), stations->end()), stations->end());
 }
 
 
@@ -113,7 +193,7 @@ Station::~Station()
 		for (NodeID node = 0; node < lg->Size(); ++node) {
 			Station *st = Station::Get((*lg)[node].Station());
 			st->goods[c].flows.erase(this->index);
-			if ((*lg)[node][this->goods[c].node].LastUpdate() != INVALID_DATE) {
+			if ((*lg)[node].HasEdgeTo(this->goods[c].node)) {
 				st->goods[c].flows.DeleteFlows(this->index);
 				RerouteCargo(st, c, this->index, st->index);
 			}
@@ -165,6 +245,7 @@ Station::~Station()
 
 	_station_kdtree.Remove(this->index);
 	_viewport_sign_kdtree.Remove(ViewportSignKdtreeItem::MakeStation(this->index));
+	RemoveFromCatchmentIndex(this);
 }
 
 
@@ -416,12 +497,14 @@ void Station::RecomputeCatchment()
 {
 	this->industries_near.clear();
 	this->RemoveFromAllNearbyLists();
+	RemoveFromCatchmentIndex(this);
 
 	if (this->rect.IsEmpty()) {
 		this->catchment_tiles.Reset();
 		return;
 	}
 	this->catchment_tiles.Initialize(GetCatchmentRect());
+	AddToCatchmentIndex(this);
 
 	if (!_settings_game.station.serve_neutral_industries && this->industry != NULL) {
 		/* Station is associated with an industry, so we only need to deliver to that industry. */
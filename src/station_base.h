@@ -559,5 +559,6 @@ public:
 };
 
 void RebuildStationKdtree();
+void FindStationsByCatchmentIndex(const TileArea &area, std::vector<Station *> *stations);
 
 #endif /* STATION_BASE_H */
@@ -1938,7 +1938,9 @@ CommandCost CmdBuildRoadStop(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 			Company::Get(st->owner)->infrastructure.station++;
 
 			MarkTileDirtyByTile(cur_tile);
+			YapfNotifyRoadLayoutChange(cur_tile);
 		}
+		YapfNotifyRoadStopChange(st->index);
 	}
 
 	if (st != NULL) {
@@ -2038,6 +2040,7 @@ static CommandCost RemoveRoadStop(TileIndex tile, DoCommandFlag flags)
 		}
 
 		delete cur_stop;
+		YapfNotifyRoadStopChange(st->index);
 
 		/* Make sure no vehicle is going to the old roadstop */
 		RoadVehicle *v;
@@ -2126,6 +2129,7 @@ CommandCost CmdRemoveRoadStop(TileIndex tile, DoCommandFlag flags, uint32 p1, ui
 		if ((flags & DC_EXEC) && rts != ROADTYPES_NONE) {
 			MakeRoadNormal(cur_tile, road_bits, rts, ClosestTownFromTile(cur_tile, UINT_MAX)->index,
 					road_owner[ROADTYPE_ROAD], road_owner[ROADTYPE_TRAM]);
+			YapfNotifyRoadLayoutChange(cur_tile);
 
 			/* Update company infrastructure counts. */
 			RoadType rt;
@@ -3508,12 +3512,17 @@ void DeleteStaleLinks(Station *from)
 		GoodsEntry &ge = from->goods[c];
 		LinkGraph *lg = LinkGraph::GetIfValid(ge.link_graph);
 		if (lg == NULL) continue;
+		/* Refreshing the vehicles below may add edges and nodes, which moves the
+		 * edges around in memory. So collect the destinations first and look up
+		 * the edges again when needed. */
+		std::vector<NodeID> dests;
 		Node node = (*lg)[ge.node];
-		for (EdgeIterator it(node.Begin()); it != node.End();) {
-			Edge edge = it->second;
-			Station *to = Station::Get((*lg)[it->first].Station());
-			assert(to->goods[c].node == it->first);
-			++it; // Do that before removing the edge. Anything else may crash.
+		for (EdgeIterator it(node.Begin()); it != node.End(); ++it) dests.push_back(it->first);
+
+		for (std::vector<NodeID>::const_iterator dest = dests.begin(); dest != dests.end(); ++dest) {
+			Edge edge = (*lg)[ge.node][*dest];
+			Station *to = Station::Get((*lg)[*dest].Station());
+			assert(to->goods[c].node == *dest);
 			assert(_date >= edge.LastUpdate());
 			uint timeout = LinkGraph::MIN_TIMEOUT_DISTANCE + (DistanceManhattan(from->xy, to->xy) >> 3);
 			if ((uint)(_date - edge.LastUpdate()) > timeout) {
@@ -3546,7 +3555,7 @@ void DeleteStaleLinks(Station *from)
 						Vehicle *v = *iter;
 
 						LinkRefresher::Run(v, false); // Don't allow merging. Otherwise lg might get deleted.
-						if (edge.LastUpdate() == _date) {
+						if ((*lg)[ge.node][*dest].LastUpdate() == _date) {
 							updated = true;
 							break;
 						}
@@ -3565,7 +3574,7 @@ void DeleteStaleLinks(Station *from)
 
 				if (!updated) {
 					/* If it's still considered dead remove it. */
-					node.RemoveEdge(to->goods[c].node);
+					(*lg)[ge.node].RemoveEdge(to->goods[c].node);
 					ge.flows.DeleteFlows(to->index);
 					RerouteCargo(from, c, to->index, from->index);
 				}
@@ -3849,24 +3858,12 @@ void FindStationsAroundTiles(const TileArea &location, StationList * const stati
 		}
 	}
 
-	/* Not using, or don't have a nearby stations list, so we need to scan. */
-	uint x = TileX(location.tile);
-	uint y = TileY(location.tile);
-
-	std::set<StationID> seen_stations;
-
-	/* Scan an area around the building covering the maximum possible station
-	 * to find the possible nearby stations. */
-	uint max_c = _settings_game.station.modified_catchment ? MAX_CATCHMENT : CA_UNMODIFIED;
-	TileArea ta(TileXY(max<int>(0, x - max_c), max<int>(0, y - max_c)), TileXY(min<int>(MapMaxX(), x + location.w + max_c), min<int>(MapMaxY(), y + location.h + max_c)));
-	TILE_AREA_LOOP(tile, ta) {
-		if (IsTileType(tile, MP_STATION)) seen_stations.insert(GetStationIndex(tile));
-	}
-
-	for (StationID stationid : seen_stations) {
-		Station *st = Station::GetIfValid(stationid);
-		if (st == NULL) continue; /* Waypoint */
+	/* Not using, or don't have a nearby stations list, so we need to look for
+	 * the stations whose catchment overlaps the area. */
+	std::vector<Station *> candidates;
+	FindStationsByCatchmentIndex(location, &candidates);
 
+	for (Station *st : candidates) {
 		/* Check if station is attached to an industry */
 		if (!_settings_game.station.serve_neutral_industries && st->industry != NULL) continue;
 
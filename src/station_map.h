@@ -17,6 +17,7 @@
 #include "water_map.h"
 #include "station_func.h"
 #include "rail.h"
+#include "pathfinder/water_regions.h"
 
 typedef byte StationGfx; ///< Index of station graphics. @see _station_display_datas
 
@@ -532,6 +533,7 @@ static inline byte GetStationTileRandomBits(TileIndex t)
  */
 static inline void MakeStation(TileIndex t, Owner o, StationID sid, StationType st, byte section, WaterClass wc = WATER_CLASS_INVALID)
 {
+	InvalidateWaterRegion(t);
 	SetTileType(t, MP_STATION);
 	SetTileOwner(t, o);
 	SetWaterClass(t, wc);
@@ -0,0 +1,258 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file worker_pool.cpp Implementation of the pool of worker threads. */
+
+#include "../stdafx.h"
+#include "../debug.h"
+#include "../settings_type.h"
+#include "../core/math_func.hpp"
+#include "worker_pool.h"
+
+#include "../safeguards.h"
+
+/** The pool used for all parallel work of the game. */
+WorkerPool _worker_pool;
+
+/**
+ * Check whether all jobs of this ticket have finished.
+ * @return True if no job of this ticket is queued or running.
+ */
+bool WorkerJobTicket::IsDone() const
+{
+	ThreadMutexLocker lock(this->mutex);
+	return this->pending == 0;
+}
+
+WorkerPool::WorkerPool() : mutex(ThreadMutex::New()), exit(false)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+	this->Stop();
+	delete this->mutex;
+}
+
+/**
+ * Run a job and notify its ticket.
+ * @param job The job to run.
+ */
+/* static */ void WorkerPool::RunJob(const Job &job)
+{
+	job.proc(job.param);
+
+	ThreadMutexLocker lock(job.ticket->mutex);
+	assert(job.ticket->pending > 0);
+	if (--job.ticket->pending == 0) job.ticket->mutex->SendSignal();
+}
+
+/**
+ * Entry point of the worker threads.
+ * @param pool The pool the thread belongs to.
+ */
+/* static */ void WorkerPool::WorkerThread(void *pool)
+{
+	WorkerPool *self = (WorkerPool *)pool;
+
+	self->mutex->BeginCritical();
+	for (;;) {
+		while (self->queue.empty() && !self->exit) self->mutex->WaitForSignal();
+		if (self->exit) {
+			/* Pass the signal on, so the other workers see it as well. */
+			self->mutex->SendSignal();
+			break;
+		}
+
+		Job job = self->queue.front();
+		self->queue.pop_front();
+		/* Signals might have been merged; wake another worker for the remaining jobs. */
+		if (!self->queue.empty()) self->mutex->SendSignal();
+		self->mutex->EndCritical();
+
+		RunJob(job);
+
+		self->mutex->BeginCritical();
+	}
+	self->mutex->EndCritical();
+}
+
+/**
+ * Start the worker threads.
+ * @param workers Number of threads to start, not counting the threads that submit jobs.
+ */
+void WorkerPool::Start(uint workers)
+{
+	this->Stop();
+
+	for (uint i = 0; i < workers; i++) {
+		ThreadObject *thread;
+		if (!ThreadObject::New(&WorkerPool::WorkerThread, this, &thread, "ottd:worker")) break;
+		this->threads.push_back(thread);
+	}
+
+	DEBUG(misc, 1, "Started %u worker threads", this->GetWorkerCount());
+}
+
+/**
+ * Stop all worker threads. Jobs that are still queued are run by the calling thread.
+ */
+void WorkerPool::Stop()
+{
+	this->mutex->BeginCritical();
+	this->exit = true;
+	this->mutex->SendSignal();
+	this->mutex->EndCritical();
+
+	for (std::vector<ThreadObject *>::iterator it = this->threads.begin(); it != this->threads.end(); ++it) {
+		(*it)->Join();
+		delete *it;
+	}
+	this->threads.clear();
+	this->exit = false;
+
+	while (!this->queue.empty()) {
+		Job job = this->queue.front();
+		this->queue.pop_front();
+		RunJob(job);
+	}
+}
+
+/**
+ * Queue a job for execution by one of the workers. If there are no workers the
+ * job is executed immediately.
+ * @param proc The procedure to call.
+ * @param param Parameter for the procedure.
+ * @param ticket Ticket to track the completion of the job with.
+ */
+void WorkerPool::Submit(WorkerJobProc proc, void *param, WorkerJobTicket *ticket)
+{
+	Job job = { proc, param, ticket };
+	{
+		ThreadMutexLocker lock(ticket->mutex);
+		ticket->pending++;
+	}
+
+	if (this->threads.empty()) {
+		RunJob(job);
+		return;
+	}
+
+	ThreadMutexLocker lock(this->mutex);
+	this->queue.push_back(job);
+	this->mutex->SendSignal();
+}
+
+/**
+ * Take a job of the given ticket from the queue and run it.
+ * @param ticket Ticket of the job to look for.
+ * @return True if a job was run.
+ */
+bool WorkerPool::RunQueuedJob(WorkerJobTicket *ticket)
+{
+	Job job;
+	{
+		ThreadMutexLocker lock(this->mutex);
+		std::deque<Job>::iterator it = this->queue.begin();
+		while (it != this->queue.end() && it->ticket != ticket) ++it;
+		if (it == this->queue.end()) return false;
+		job = *it;
+		this->queue.erase(it);
+	}
+
+	RunJob(job);
+	return true;
+}
+
+/**
+ * Wait until all jobs of a ticket have finished. Jobs of the ticket that are
+ * still queued are run by the calling thread in the mean time.
+ * Only jobs of the same ticket are taken over, so waiting for a short job is
+ * never delayed by a long-running one.
+ * @param ticket Ticket to wait for.
+ */
+void WorkerPool::Wait(WorkerJobTicket *ticket)
+{
+	while (this->RunQueuedJob(ticket)) {}
+
+	ThreadMutexLocker lock(ticket->mutex);
+	while (ticket->pending != 0) ticket->mutex->WaitForSignal();
+}
+
+/** A chunk of a WorkerPool::ParallelFor call. */
+struct WorkerRange {
+	WorkerRangeProc proc; ///< Procedure to call.
+	void *param;          ///< Parameter for the procedure.
+	uint begin;           ///< First index of the range.
+	uint end;             ///< One past the last index of the range.
+};
+
+/**
+ * Job procedure running a single chunk of a WorkerPool::ParallelFor call.
+ * @param range The WorkerRange to run.
+ */
+static void RunWorkerRange(void *range)
+{
+	const WorkerRange *r = (const WorkerRange *)range;
+	r->proc(r->param, r->begin, r->end);
+}
+
+/**
+ * Call a procedure for the range [0, count), split in chunks that are divided
+ * over the workers and the calling thread. Returns when all chunks are done.
+ * @param count Number of indices to process.
+ * @param min_chunk Minimum number of indices per chunk, to keep the overhead in check.
+ * @param proc Procedure to call per chunk.
+ * @param param Parameter for the procedure.
+ */
+void WorkerPool::ParallelFor(uint count, uint min_chunk, WorkerRangeProc proc, void *param)
+{
+	if (count == 0) return;
+
+	/* A few chunks per thread, so a slow chunk does not stall everybody else. */
+	uint chunks = min<uint>(CeilDiv(count, max<uint>(min_chunk, 1)), (this->GetWorkerCount() + 1) * 4);
+	if (chunks <= 1 || this->threads.empty()) {
+		proc(param, 0, count);
+		return;
+	}
+
+	std::vector<WorkerRange> ranges(chunks);
+	for (uint i = 0; i < chunks; i++) {
+		ranges[i].proc = proc;
+		ranges[i].param = param;
+		ranges[i].begin = (uint)((uint64)count * i / chunks);
+		ranges[i].end = (uint)((uint64)count * (i + 1) / chunks);
+	}
+
+	WorkerJobTicket ticket;
+	for (uint i = 1; i < chunks; i++) this->Submit(&RunWorkerRange, &ranges[i], &ticket);
+	RunWorkerRange(&ranges[0]);
+	this->Wait(&ticket);
+}
+
+/**
+ * Start the worker threads of the game according to the settings.
+ */
+void InitializeWorkerPool()
+{
+	uint workers = _settings_client.gui.worker_threads;
+	/* By default start one worker less than there are cores, as the thread
+	 * submitting the work runs part of it itself. Background jobs like the
+	 * link graph need at least one worker though. */
+	if (workers == 0) workers = max<uint>(GetCPUCoreCount(), 2) - 1;
+	_worker_pool.Start(workers);
+}
+
+/**
+ * Stop the worker threads of the game.
+ */
+void ShutdownWorkerPool()
+{
+	_worker_pool.Stop();
+}
@@ -0,0 +1,97 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file worker_pool.h Pool of persistent worker threads for running independent jobs in parallel. */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "thread.h"
+#include <deque>
+#include <vector>
+
+/** Definition of a job executed by the worker pool. */
+typedef void (*WorkerJobProc)(void *param);
+
+/** Definition of a job executed for a range of indices by WorkerPool::ParallelFor. */
+typedef void (*WorkerRangeProc)(void *param, uint begin, uint end);
+
+/**
+ * Completion tracker for a group of jobs submitted to the worker pool.
+ * Each ticket has its own mutex, so the (single) thread waiting for it can
+ * be woken up without disturbing the workers waiting for new jobs.
+ */
+class WorkerJobTicket {
+	friend class WorkerPool;
+
+	ThreadMutex *mutex; ///< Mutex protecting #pending and signalling its completion.
+	uint pending;       ///< Number of submitted jobs that have not finished yet.
+
+	WorkerJobTicket(const WorkerJobTicket &) { NOT_REACHED(); }
+	WorkerJobTicket &operator=(const WorkerJobTicket &) { NOT_REACHED(); return *this; }
+
+public:
+	WorkerJobTicket() : mutex(ThreadMutex::New()), pending(0) {}
+	~WorkerJobTicket() { delete this->mutex; }
+
+	bool IsDone() const;
+};
+
+/**
+ * A fixed set of worker threads taking jobs from a shared queue. Threads that
+ * wait for a ticket help executing the queued jobs of that ticket, so jobs may
+ * safely submit and wait for jobs of their own. If no threads could be started
+ * all jobs are run immediately in the submitting thread.
+ * @note The pool does not make anything deterministic by itself; jobs that
+ *       run in parallel must only write to data no other job accesses.
+ */
+class WorkerPool {
+	/** A job in the queue. */
+	struct Job {
+		WorkerJobProc proc;      ///< Procedure to call.
+		void *param;             ///< Parameter for the procedure.
+		WorkerJobTicket *ticket; ///< Ticket to notify on completion.
+	};
+
+	ThreadMutex *mutex;                  ///< Mutex protecting the queue and signalling new jobs.
+	std::deque<Job> queue;               ///< Jobs waiting for a worker.
+	std::vector<ThreadObject *> threads; ///< The worker threads.
+	bool exit;                           ///< Whether the workers should stop.
+
+	static void WorkerThread(void *pool);
+	bool RunQueuedJob(WorkerJobTicket *ticket);
+	static void RunJob(const Job &job);
+
+public:
+	WorkerPool();
+	~WorkerPool();
+
+	void Start(uint workers);
+	void Stop();
+
+	/**
+	 * Get the number of worker threads, not counting threads waiting for tickets.
+	 * @return Number of running worker threads.
+	 */
+	inline uint GetWorkerCount() const
+	{
+		return (uint)this->threads.size();
+	}
+
+	void Submit(WorkerJobProc proc, void *param, WorkerJobTicket *ticket);
+	void Wait(WorkerJobTicket *ticket);
+	void ParallelFor(uint count, uint min_chunk, WorkerRangeProc proc, void *param);
+};
+
+extern WorkerPool _worker_pool;
+
+void InitializeWorkerPool();
+void ShutdownWorkerPool();
+
+#endif /* WORKER_POOL_H */
@@ -14,6 +14,7 @@
 
 #include "tile_map.h"
 #include "water_map.h"
+#include "pathfinder/water_regions.h"
 
 /**
  * List of tree types along all landscape types.
@@ -275,6 +276,7 @@ static inline void SetTreeCounter(TileIndex t, uint c)
  */
 static inline void MakeTree(TileIndex t, TreeType type, uint count, uint growth, TreeGround ground, uint density)
 {
+	InvalidateWaterRegion(t);
 	SetTileType(t, MP_TREES);
 	SetTileOwner(t, OWNER_NONE);
 	SetWaterClass(t, ground == TREE_GROUND_SHORE ? WATER_CLASS_SEA : WATER_CLASS_INVALID);
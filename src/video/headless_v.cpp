@@ -0,0 +1,240 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file headless_v.cpp The video driver that draws to memory for benchmarking.
+ *
+ * Start it with <tt>-v headless:frames=500,warmup=20,camera=path.txt,output=times.csv</tt>
+ * and load a savegame with \c -g. The blitter is selected with \c -b and the
+ * size of the screen with \c -r as usual. Each line of the camera path file
+ * holds a point of the path: <tt>x y zoom</tt>, with the coordinates in tiles
+ * and the zoom level from 0 (normal) to 5 (zoomed out 32 times). The frames
+ * are spread evenly over the path. Without a camera path the view moves
+ * diagonally over the middle of the map.
+ *
+ * The game itself does not run while drawing, so every run draws exactly the
+ * same frames. The timings of each measured frame are written as CSV.
+ */
+
+#include "../stdafx.h"
+#include "../gfx_func.h"
+#include "../map_func.h"
+#include "../window_func.h"
+#include "../window_gui.h"
+#include "../viewport_func.h"
+#include "../fileio_func.h"
+#include "../core/mem_func.hpp"
+#include "../string_func.h"
+#include "../blitter/factory.hpp"
+#include "headless_v.h"
+#include <chrono>
+
+#include "../safeguards.h"
+
+/** Factory for the headless video driver. */
+static FVideoDriver_Headless iFVideoDriver_Headless;
+
+/**
+ * Get the time to measure the frames with.
+ * @return The time in nanoseconds.
+ */
+static uint64 GetHeadlessTime()
+{
+	using namespace std::chrono;
+	return (uint64)duration_cast<nanoseconds>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+const char *VideoDriver_Headless::Start(const char * const *parm)
+{
+#ifdef _MSC_VER
+	/* Disable the MSVC assertion message box. */
+	_set_error_mode(_OUT_TO_STDERR);
+#endif
+
+	if (BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 0) return "a blitter that draws is needed";
+
+	this->frames = max(GetDriverParamInt(parm, "frames", 100), 1);
+	this->warmup = max(GetDriverParamInt(parm, "warmup", 10), 0);
+	/* The parameters do not outlive this call. */
+	const char *output = GetDriverParam(parm, "output");
+	this->output = output == NULL ? NULL : stredup(output);
+
+	const char *camera = GetDriverParam(parm, "camera");
+	if (camera != NULL && !this->LoadCameraPath(camera)) return "cannot read the camera path";
+
+	this->AllocateScreen();
+	return NULL;
+}
+
+void VideoDriver_Headless::Stop()
+{
+	free(this->video_mem);
+	this->video_mem = NULL;
+	free(this->output);
+	this->output = NULL;
+}
+
+void VideoDriver_Headless::MakeDirty(int left, int top, int width, int height) {}
+bool VideoDriver_Headless::ChangeResolution(int w, int h) { return false; }
+bool VideoDriver_Headless::ToggleFullscreen(bool fs) { return false; }
+
+bool VideoDriver_Headless::AfterBlitterChange()
+{
+	if (BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 0) return false;
+
+	this->AllocateScreen();
+	return true;
+}
+
+/** (Re)allocate the buffer that is drawn to for the current resolution and blitter. */
+void VideoDriver_Headless::AllocateScreen()
+{
+	Blitter *blitter = BlitterFactory::GetCurrentBlitter();
+
+	free(this->video_mem);
+	this->video_mem = CallocT<byte>(_cur_resolution.width * _cur_resolution.height * (blitter->GetScreenDepth() / 8));
+
+	_screen.width  = _screen.pitch = _cur_resolution.width;
+	_screen.height = _cur_resolution.height;
+	_screen.dst_ptr = this->video_mem;
+	ScreenSizeChanged();
+	blitter->PostResize();
+}
+
+/**
+ * Read the points of the camera path.
+ * @param filename The file with the camera path.
+ * @return True if the file contained at least one point and nothing else but comments.
+ */
+bool VideoDriver_Headless::LoadCameraPath(const char *filename)
+{
+	FILE *f = FioFOpenFile(filename, "r", NO_DIRECTORY);
+	if (f == NULL) return false;
+
+	bool ok = true;
+	char line[256];
+	while (ok && fgets(line, lengthof(line), f) != NULL) {
+		const char *p = line;
+		while (*p == ' ' || *p == '\t') p++;
+		if (*p == '#' || *p == '\r' || *p == '\n' || *p == '\0') continue;
+
+		int x, y, zoom;
+		if (sscanf(p, "%d %d %d", &x, &y, &zoom) != 3 || !IsInsideMM(zoom, ZOOM_LVL_BEGIN, ZOOM_LVL_END)) {
+			DEBUG(driver, 0, "Invalid camera path point: %s", line);
+			ok = false;
+			break;
+		}
+
+		HeadlessCameraPoint point = { x, y, (ZoomLevel)zoom };
+		this->camera.push_back(point);
+	}
+	fclose(f);
+
+	return ok && !this->camera.empty();
+}
+
+/**
+ * Move the main viewport to the position of a frame on the camera path.
+ * @param frame The frame.
+ * @return The tile in the centre of the view.
+ */
+Point VideoDriver_Headless::SetCamera(uint frame)
+{
+	Window *w = FindWindowById(WC_MAIN_WINDOW, 0);
+
+	/* Find the part of the path the frame is on, and how far along. */
+	uint last = max(this->frames, 2U) - 1;
+	uint segments = (uint)this->camera.size() - 1;
+	uint64 pos = (uint64)min(frame, last) * segments;
+	uint segment = min<uint>((uint)(pos / last), segments - 1);
+	int64 progress = (int64)(pos - (uint64)segment * last);
+
+	const HeadlessCameraPoint &from = this->camera[segment];
+	const HeadlessCameraPoint &to = this->camera[segment + 1];
+	int x = from.x * TILE_SIZE + (int)((to.x - from.x) * (int64)TILE_SIZE * progress / last);
+	int y = from.y * TILE_SIZE + (int)((to.y - from.y) * (int64)TILE_SIZE * progress / last);
+	ZoomLevel zoom = progress == last ? to.zoom : from.zoom;
+
+	Point tile = { x / (int)TILE_SIZE, y / (int)TILE_SIZE };
+	if (w == NULL || w->viewport == NULL) return tile;
+
+	/* The zoom level is limited by the settings. */
+	while (w->viewport->zoom < zoom && DoZoomInOutWindow(ZOOM_OUT, w)) {}
+	while (w->viewport->zoom > zoom && DoZoomInOutWindow(ZOOM_IN, w)) {}
+
+	ScrollWindowTo(x + TILE_SIZE / 2, y + TILE_SIZE / 2, -1, w, true);
+	UpdateViewportPosition(w);
+	return tile;
+}
+
+void VideoDriver_Headless::MainLoop()
+{
+	/* Load the game given with -g; without one the intro game is drawn. */
+	GameLoop();
+
+	if (this->camera.empty()) {
+		Window *w = FindWindowById(WC_MAIN_WINDOW, 0);
+		ZoomLevel zoom = (w != NULL && w->viewport != NULL) ? w->viewport->zoom : ZOOM_LVL_VIEWPORT;
+		HeadlessCameraPoint from = { (int)MapSizeX() / 4, (int)MapSizeY() / 4, zoom };
+		HeadlessCameraPoint to = { (int)MapSizeX() * 3 / 4, (int)MapSizeY() * 3 / 4, zoom };
+		this->camera.push_back(from);
+		this->camera.push_back(to);
+	} else if (this->camera.size() == 1) {
+		this->camera.push_back(this->camera.front());
+	}
+
+	FILE *f = this->output == NULL ? stdout : FioFOpenFile(this->output, "w", NO_DIRECTORY);
+	if (f == NULL) {
+		DEBUG(driver, 0, "Cannot open '%s' for writing", this->output);
+		return;
+	}
+
+	fprintf(f, "frame,x,y,zoom,total_ns,collect_ns,sort_ns,blit_ns,text_ns\n");
+
+	uint64 total = 0;
+	ViewportDrawTimings sum;
+	MemSetT(&sum, 0);
+	for (uint i = 0; i < this->warmup + this->frames; i++) {
+		bool measure = i >= this->warmup;
+		uint frame = measure ? i - this->warmup : 0;
+		Point tile = this->SetCamera(frame);
+		MarkWholeScreenDirty();
+
+		ViewportDrawTimings timings;
+		MemSetT(&timings, 0);
+		SetViewportDrawTimings(&timings);
+		/* Windows are only drawn when time has passed. */
+		_realtime_tick += MILLISECONDS_PER_TICK;
+		uint64 start = GetHeadlessTime();
+		UpdateWindows();
+		uint64 time = GetHeadlessTime() - start;
+		SetViewportDrawTimings(NULL);
+
+		if (!measure) continue;
+
+		const Window *w = FindWindowById(WC_MAIN_WINDOW, 0);
+		int zoom = (w != NULL && w->viewport != NULL) ? (int)w->viewport->zoom : 0;
+		fprintf(f, "%u,%d,%d,%d," OTTD_PRINTF64 "," OTTD_PRINTF64 "," OTTD_PRINTF64 "," OTTD_PRINTF64 "," OTTD_PRINTF64 "\n",
+				frame, tile.x, tile.y, zoom,
+				(int64)time, (int64)timings.collect, (int64)timings.sort, (int64)timings.blit, (int64)timings.text);
+
+		total += time;
+		sum.collect += timings.collect;
+		sum.sort += timings.sort;
+		sum.blit += timings.blit;
+		sum.text += timings.text;
+	}
+
+	if (f != stdout) fclose(f);
+
+	DEBUG(driver, 0, "Drew %u frames of %dx%d with blitter '%s'; average per frame in microseconds:", this->frames, _screen.width, _screen.height, BlitterFactory::GetCurrentBlitter()->GetName());
+	DEBUG(driver, 0, "  total %.1f, collect %.1f, sort %.1f, blit %.1f, text %.1f",
+			total / 1000.0 / this->frames, sum.collect / 1000.0 / this->frames, sum.sort / 1000.0 / this->frames,
+			sum.blit / 1000.0 / this->frames, sum.text / 1000.0 / this->frames);
+}
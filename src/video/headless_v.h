@@ -0,0 +1,70 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file headless_v.h Base of the video driver that draws to memory for benchmarking. */
+
+#ifndef VIDEO_HEADLESS_H
+#define VIDEO_HEADLESS_H
+
+#include "video_driver.hpp"
+#include "../zoom_type.h"
+#include <vector>
+
+/** A point on the camera path of the headless video driver. */
+struct HeadlessCameraPoint {
+	int x;          ///< X coordinate of the centre of the view, in tiles.
+	int y;          ///< Y coordinate of the centre of the view, in tiles.
+	ZoomLevel zoom; ///< Zoom level of the view.
+};
+
+/**
+ * The headless video driver. It draws the main viewport along a camera
+ * path into memory for a fixed number of frames, and reports how long
+ * each phase of drawing the frames took.
+ */
+class VideoDriver_Headless : public VideoDriver {
+private:
+	byte *video_mem;                         ///< The buffer that is drawn to.
+	uint frames;                             ///< Number of frames to measure.
+	uint warmup;                             ///< Number of frames to draw before measuring.
+	char *output;                            ///< File to write the timings to, or \c NULL for the standard output.
+	std::vector<HeadlessCameraPoint> camera; ///< The camera path; empty for the default path.
+
+	bool LoadCameraPath(const char *filename);
+	void AllocateScreen();
+	Point SetCamera(uint frame);
+
+public:
+	VideoDriver_Headless() : video_mem(NULL), output(NULL) {}
+
+	const char *Start(const char * const *param) override;
+
+	void Stop() override;
+
+	void MakeDirty(int left, int top, int width, int height) override;
+
+	void MainLoop() override;
+
+	bool ChangeResolution(int w, int h) override;
+
+	bool ToggleFullscreen(bool fullscreen) override;
+
+	bool AfterBlitterChange() override;
+	const char *GetName() const override { return "headless"; }
+	bool HasGUI() const override { return false; }
+};
+
+/** Factory for the headless video driver. */
+class FVideoDriver_Headless : public DriverFactoryBase {
+public:
+	FVideoDriver_Headless() : DriverFactoryBase(Driver::DT_VIDEO, 0, "headless", "Headless Rendering Benchmark Video Driver") {}
+	Driver *CreateInstance() const override { return new VideoDriver_Headless(); }
+};
+
+#endif /* VIDEO_HEADLESS_H */
@@ -89,8 +89,14 @@
 #include "command_func.h"
 #include "network/network_func.h"
 #include "framerate_type.h"
+#include "fileio_func.h"
+#include "console_func.h"
+#include "newgrf_debug.h"
+#include "thread/worker_pool.h"
 
 #include <map>
+#include <forward_list>
+#include <chrono>
 
 #include "table/strings.h"
 #include "table/string_colours.h"
@@ -176,11 +182,21 @@ struct ViewportDrawer {
 	FoundationPart foundation_part;                  ///< Currently active foundation for ground sprite drawing.
 	int *last_foundation_child[FOUNDATION_PART_END]; ///< Tail of ChildSprite list of the foundations. (index into child_screen_sprites_to_draw)
 	Point foundation_offset[FOUNDATION_PART_END];    ///< Pixel offset for ground sprites on the foundations.
+
+	bool placeholders;                               ///< Leave out sprites that are still being decoded instead of waiting for them.
+	bool prefetch;                                   ///< Only queue the sprites for decoding, do not draw anything.
+	bool incomplete;                                 ///< Sprites were left out because they were still being decoded.
+	Point screen;                                    ///< Position of the top left corner of #dpi on the screen.
+
+	uint64 sort_time;                                ///< Nanoseconds spent sorting the sprites, while measuring #_vp_draw_timings.
+	uint64 blit_time;                                ///< Nanoseconds spent drawing the sprites, while measuring #_vp_draw_timings.
 };
 
 static void MarkViewportDirty(const ViewPort *vp, int left, int top, int right, int bottom);
 
 static ViewportDrawer _vd;
+static std::vector<Rect> _vp_incomplete_areas; ///< Screen areas drawn without some of their sprites.
+static std::vector<ViewportDrawer> _vp_draw_areas; ///< Collected sprites of the areas drawn by the worker threads, see ViewportDrawAreas.
 
 TileHighlightData _thd;
 static TileInfo *_cur_ti;
@@ -188,6 +204,20 @@ bool _draw_bounding_boxes = false;
 bool _draw_dirty_blocks = false;
 uint _dirty_block_colour = 0;
 static VpSpriteSorter _vp_sprite_sorter = NULL;
+static FILE *_vp_sprite_record = NULL; ///< File the parent sprites to sort are recorded to, see ViewportRecordParentSprites.
+static uint _vp_sprite_record_frames;  ///< Number of viewport draws still to record.
+static ViewportDrawTimings *_vp_draw_timings = NULL; ///< Where to add the time spent drawing the viewports to, if anywhere.
+
+/**
+ * Get the time to measure the phases of drawing the viewports with.
+ * @return The time in nanoseconds, or 0 when not measuring.
+ */
+static inline uint64 GetViewportDrawTime()
+{
+	if (_vp_draw_timings == NULL) return 0;
+	using namespace std::chrono;
+	return (uint64)duration_cast<nanoseconds>(high_resolution_clock::now().time_since_epoch()).count();
+}
 
 static Point MapXYZToViewport(const ViewPort *vp, int x, int y, int z)
 {
@@ -257,6 +287,7 @@ void InitializeWindowViewport(Window *w, int x, int y,
 	vp->dest_scrollpos_y = pt.y;
 
 	vp->overlay = NULL;
+	vp->prefetch_zoom = ZOOM_LVL_END;
 
 	w->viewport = vp;
 	vp->virtual_left = 0; // pt.x;
@@ -483,6 +514,22 @@ void HandleZoomMessage(Window *w, const ViewPort *vp, byte widget_zoom_in, byte
 	w->SetWidgetDirty(widget_zoom_out);
 }
 
+/**
+ * Check whether a sprite can be drawn without decoding it first.
+ * When drawing with placeholders, sprites that are not in the sprite cache are
+ * decoded in the background and left out; the area is drawn again once they are ready.
+ * @param image The sprite to draw.
+ * @return True if the sprite can be added to the viewport.
+ */
+static bool IsViewportSpriteReady(SpriteID image)
+{
+	if (!_vd.placeholders && !_vd.prefetch) return true;
+	if (PrefetchSprite(image & SPRITE_MASK) && !_vd.prefetch) return true;
+
+	_vd.incomplete = true;
+	return false;
+}
+
 /**
  * Schedules a tile sprite for drawing.
  *
@@ -499,6 +546,8 @@ static void AddTileSpriteToDraw(SpriteID image, PaletteID pal, int32 x, int32 y,
 {
 	assert((image & SPRITE_MASK) < MAX_SPRITES);
 
+	if (!IsViewportSpriteReady(image)) return;
+
 	/*C++17: TileSpriteToDraw &ts = */ _vd.tile_sprites_to_draw.emplace_back();
 	TileSpriteToDraw &ts = _vd.tile_sprites_to_draw.back();
 	ts.image = image;
@@ -619,6 +668,8 @@ void OffsetGroundSprite(int x, int y)
  */
 static void AddCombinedSprite(SpriteID image, PaletteID pal, int x, int y, int z, const SubSprite *sub)
 {
+	if (!IsViewportSpriteReady(image)) return;
+
 	Point pt = RemapCoords(x, y, z);
 	const Sprite *spr = GetSprite(image & SPRITE_MASK, ST_NORMAL);
 
@@ -676,6 +727,8 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 
 	_vd.last_child = NULL;
 
+	if (image != SPR_EMPTY_BOUNDING_BOX && !IsViewportSpriteReady(image)) return;
+
 	Point pt = RemapCoords(x, y, z);
 	int tmp_left, tmp_top, tmp_x = pt.x, tmp_y = pt.y;
 
@@ -818,7 +871,8 @@ void AddChildSpriteScreen(SpriteID image, PaletteID pal, int x, int y, bool tran
 	assert((image & SPRITE_MASK) < MAX_SPRITES);
 
 	/* If the ParentSprite was clipped by the viewport bounds, do not draw the ChildSprites either */
-	if (_vd.last_child == NULL) return;
+	if (_vd.last_child == NULL && !_vd.prefetch) return;
+	if (!IsViewportSpriteReady(image)) return;
 
 	/* make the sprites transparent with the right palette */
 	if (transparent) {
@@ -1462,6 +1516,132 @@ static void ViewportSortParentSprites(ParentSpriteToSortVector *psdv)
 	}
 }
 
+/**
+ * Sort parent sprites pointer array, with the same result as #ViewportSortParentSprites.
+ *
+ * That sorter goes through the sprites from the front and moves every sprite
+ * that has to be drawn before the current one in front of it, after which
+ * those sprites are compared in turn. Instead of comparing every pair of
+ * sprites, this keeps the sprites that still have to be output in a list
+ * sorted on xmin + ymin, i.e. in diagonal bands across the screen. A sprite
+ * can only have to be drawn after sprites with xmin <= its xmax and
+ * ymin <= its ymax, so only the start of the list up to its xmax + ymax needs
+ * to be searched. The sprites that are found are then handled in the order
+ * the original sorter would have moved them in, using a stack.
+ * @param psdv The sprites to sort.
+ */
+static void ViewportSortParentSpritesSpatial(ParentSpriteToSortVector *psdv)
+{
+	/* For a handful of sprites setting up the list costs more than it saves. */
+	if (psdv->size() < 100) {
+		ViewportSortParentSprites(psdv);
+		return;
+	}
+
+	/* Special values of ParentSpriteToDraw::order. */
+	static const uint32 ORDER_COMPARED = UINT32_MAX;     ///< The sprites in front of it are handled, but the sprite itself is not output yet.
+	static const uint32 ORDER_RETURNED = UINT32_MAX - 1; ///< The sprite is output; ignore other occurrences in the stack.
+
+	/* The sprites that have not been compared yet, sorted by xmin + ymin. */
+	std::forward_list<std::pair<int64, ParentSpriteToDraw *>> sprites;
+	/* Order of the sprites to compare; the top of the stack is the front of the sprites. */
+	std::vector<ParentSpriteToDraw *> stack;
+	stack.reserve(psdv->size());
+	uint32 next_order = 0;
+
+	for (auto it = psdv->rbegin(); it != psdv->rend(); ++it) {
+		ParentSpriteToDraw *ps = *it;
+		sprites.emplace_front((int64)ps->xmin + ps->ymin, ps);
+		stack.push_back(ps);
+		ps->order = next_order++;
+	}
+	sprites.sort([](const std::pair<int64, ParentSpriteToDraw *> &a, const std::pair<int64, ParentSpriteToDraw *> &b) {
+		return a.first < b.first;
+	});
+
+	std::vector<ParentSpriteToDraw *> preceding;
+	auto out = psdv->begin();
+
+	while (!stack.empty()) {
+		ParentSpriteToDraw *s = stack.back();
+		stack.pop_back();
+
+		if (s->order == ORDER_RETURNED) continue;
+		if (s->order == ORDER_COMPARED) {
+			*out++ = s;
+			s->order = ORDER_RETURNED;
+			continue;
+		}
+
+		/* Find the sprites that have to be drawn before this one, and remove
+		 * this one from the list as it will not be moved anymore. The bounding
+		 * box might be empty, i.e. max < min, so search at least up to itself. */
+		preceding.clear();
+		int64 ssum = (int64)max(s->xmax, s->xmin) + max(s->ymax, s->ymin);
+		auto prev = sprites.before_begin();
+		for (auto it = sprites.begin(); it != sprites.end() && it->first <= ssum;) {
+			ParentSpriteToDraw *p = it->second;
+			if (p == s) {
+				it = sprites.erase_after(prev);
+				continue;
+			}
+			prev = it++;
+
+			if (s->xmax < p->xmin || s->ymax < p->ymin || s->zmax < p->zmin) continue;
+			if (s->xmin <= p->xmax && // overlap in X?
+					s->ymin <= p->ymax && // overlap in Y?
+					s->zmin <= p->zmax) { // overlap in Z?
+				if (s->xmin + s->xmax + s->ymin + s->ymax + s->zmin + s->zmax <=
+						p->xmin + p->xmax + p->ymin + p->ymax + p->zmin + p->zmax) {
+					continue;
+				}
+			}
+			preceding.push_back(p);
+		}
+
+		if (preceding.empty()) {
+			*out++ = s;
+			s->order = ORDER_RETURNED;
+			continue;
+		}
+
+		/* The original sorter moves the preceding sprites to the front one by one
+		 * in their current order, so the last one ends up in front. */
+		std::sort(preceding.begin(), preceding.end(), [](const ParentSpriteToDraw *a, const ParentSpriteToDraw *b) {
+			return a->order > b->order;
+		});
+
+		s->order = ORDER_COMPARED;
+		stack.push_back(s);
+		for (ParentSpriteToDraw *p : preceding) {
+			p->order = next_order++;
+			stack.push_back(p);
+		}
+	}
+}
+
+/**
+ * Record the bounding boxes of the parent sprites to sort, for benchmarking the sorters.
+ * The file holds, for every viewport draw, the number of sprites followed by
+ * xmin, ymin, zmin, xmax, ymax and zmax of every sprite as int32 in native byte order.
+ * @param psdv The sprites as passed to the sorter.
+ */
+static void ViewportRecordParentSprites(const ParentSpriteToSortVector *psdv)
+{
+	uint32 count = (uint32)psdv->size();
+	bool ok = fwrite(&count, sizeof(count), 1, _vp_sprite_record) == 1;
+	for (const ParentSpriteToDraw *ps : *psdv) {
+		int32 box[6] = { ps->xmin, ps->ymin, ps->zmin, ps->xmax, ps->ymax, ps->zmax };
+		if (ok) ok = fwrite(box, sizeof(box), 1, _vp_sprite_record) == 1;
+	}
+
+	if (!ok || --_vp_sprite_record_frames == 0) {
+		fclose(_vp_sprite_record);
+		_vp_sprite_record = NULL;
+		if (!ok) IConsoleError("Writing the sprite sorter recording failed");
+	}
+}
+
 static void ViewportDrawParentSprites(const ParentSpriteToSortVector *psd, const ChildScreenSpriteToDrawVector *csstdv)
 {
 	for (const ParentSpriteToDraw *ps : *psd) {
@@ -1553,7 +1733,16 @@ static void ViewportDrawStrings(ZoomLevel zoom, const StringSpriteToDrawVector *
 	}
 }
 
-void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+/**
+ * Collect the sprites of an area of a viewport into #_vd.
+ * This calls the tile drawing procedures, so it must be done by the main thread.
+ * @param vp The viewport.
+ * @param left Left edge of the area, in virtual coordinates.
+ * @param top Top edge of the area, in virtual coordinates.
+ * @param right Right edge of the area, in virtual coordinates.
+ * @param bottom Bottom edge of the area, in virtual coordinates.
+ */
+static void ViewportCollectSprites(const ViewPort *vp, int left, int top, int right, int bottom)
 {
 	DrawPixelInfo *old_dpi = _cur_dpi;
 	_cur_dpi = &_vd.dpi;
@@ -1569,12 +1758,14 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 	_vd.dpi.top = top & mask;
 	_vd.dpi.pitch = old_dpi->pitch;
 	_vd.last_child = NULL;
+	_vd.incomplete = false;
 
-	int x = UnScaleByZoom(_vd.dpi.left - (vp->virtual_left & mask), vp->zoom) + vp->left;
-	int y = UnScaleByZoom(_vd.dpi.top - (vp->virtual_top & mask), vp->zoom) + vp->top;
+	_vd.screen.x = UnScaleByZoom(_vd.dpi.left - (vp->virtual_left & mask), vp->zoom) + vp->left;
+	_vd.screen.y = UnScaleByZoom(_vd.dpi.top - (vp->virtual_top & mask), vp->zoom) + vp->top;
 
-	_vd.dpi.dst_ptr = BlitterFactory::GetCurrentBlitter()->MoveTo(old_dpi->dst_ptr, x - old_dpi->left, y - old_dpi->top);
+	_vd.dpi.dst_ptr = BlitterFactory::GetCurrentBlitter()->MoveTo(old_dpi->dst_ptr, _vd.screen.x - old_dpi->left, _vd.screen.y - old_dpi->top);
 
+	uint64 start = GetViewportDrawTime();
 	ViewportAddLandscape();
 	ViewportAddVehicles(&_vd.dpi);
 
@@ -1582,20 +1773,71 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 
 	DrawTextEffects(&_vd.dpi);
 
-	if (_vd.tile_sprites_to_draw.size() != 0) ViewportDrawTileSprites(&_vd.tile_sprites_to_draw);
-
 	for (auto &psd : _vd.parent_sprites_to_draw) {
 		_vd.parent_sprites_to_sort.push_back(&psd);
 	}
 
-	_vp_sprite_sorter(&_vd.parent_sprites_to_sort);
-	ViewportDrawParentSprites(&_vd.parent_sprites_to_sort, &_vd.child_screen_sprites_to_draw);
+	if (_vp_sprite_record != NULL) ViewportRecordParentSprites(&_vd.parent_sprites_to_sort);
+	if (_vp_draw_timings != NULL) _vp_draw_timings->collect += GetViewportDrawTime() - start;
+
+	_cur_dpi = old_dpi;
+}
+
+/**
+ * Forget the sprites collected for an area of a viewport.
+ * @param vd The collected sprites.
+ */
+static void ClearViewportSprites(ViewportDrawer *vd)
+{
+	vd->string_sprites_to_draw.clear();
+	vd->tile_sprites_to_draw.clear();
+	vd->parent_sprites_to_draw.clear();
+	vd->parent_sprites_to_sort.clear();
+	vd->child_screen_sprites_to_draw.clear();
+}
 
-	if (_draw_bounding_boxes) ViewportDrawBoundingBoxes(&_vd.parent_sprites_to_sort);
+/**
+ * Sort and draw the collected sprites of an area of a viewport.
+ * Only the blitter is used, so when the sprite cache is locked this can be done by any thread.
+ * The time spent is stored in the area, as several areas may be drawn at the same time.
+ * @param vd The collected sprites.
+ */
+static void ViewportDrawSprites(ViewportDrawer *vd)
+{
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	_cur_dpi = &vd->dpi;
+
+	uint64 start = GetViewportDrawTime();
+	if (vd->tile_sprites_to_draw.size() != 0) ViewportDrawTileSprites(&vd->tile_sprites_to_draw);
+
+	uint64 sort_start = GetViewportDrawTime();
+	_vp_sprite_sorter(&vd->parent_sprites_to_sort);
+	uint64 sort_end = GetViewportDrawTime();
+	ViewportDrawParentSprites(&vd->parent_sprites_to_sort, &vd->child_screen_sprites_to_draw);
+
+	vd->sort_time = sort_end - sort_start;
+	vd->blit_time = (sort_start - start) + (GetViewportDrawTime() - sort_end);
+
+	if (_draw_bounding_boxes) ViewportDrawBoundingBoxes(&vd->parent_sprites_to_sort);
 	if (_draw_dirty_blocks) ViewportDrawDirtyBlocks();
 
-	DrawPixelInfo dp = _vd.dpi;
-	ZoomLevel zoom = _vd.dpi.zoom;
+	_cur_dpi = old_dpi;
+}
+
+/**
+ * Draw the link graph overlay and the strings on top of the sprites of an
+ * area of a viewport, and clear the collected sprites of the area.
+ * Text is drawn through the layout and font caches, so this must be done by the main thread.
+ * @param vp The viewport.
+ * @param vd The collected sprites.
+ */
+static void ViewportDrawOverlay(const ViewPort *vp, ViewportDrawer *vd)
+{
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	uint64 start = GetViewportDrawTime();
+
+	DrawPixelInfo dp = vd->dpi;
+	ZoomLevel zoom = vd->dpi.zoom;
 	dp.zoom = ZOOM_LVL_NORMAL;
 	dp.width = UnScaleByZoom(dp.width, zoom);
 	dp.height = UnScaleByZoom(dp.height, zoom);
@@ -1603,50 +1845,256 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 
 	if (vp->overlay != NULL && vp->overlay->GetCargoMask() != 0 && vp->overlay->GetCompanyMask() != 0) {
 		/* translate to window coordinates */
-		dp.left = x;
-		dp.top = y;
+		dp.left = vd->screen.x;
+		dp.top = vd->screen.y;
 		vp->overlay->Draw(&dp);
 	}
 
-	if (_vd.string_sprites_to_draw.size() != 0) {
+	if (vd->string_sprites_to_draw.size() != 0) {
 		/* translate to world coordinates */
-		dp.left = UnScaleByZoom(_vd.dpi.left, zoom);
-		dp.top = UnScaleByZoom(_vd.dpi.top, zoom);
-		ViewportDrawStrings(zoom, &_vd.string_sprites_to_draw);
+		dp.left = UnScaleByZoom(vd->dpi.left, zoom);
+		dp.top = UnScaleByZoom(vd->dpi.top, zoom);
+		ViewportDrawStrings(zoom, &vd->string_sprites_to_draw);
+	}
+
+	_cur_dpi = old_dpi;
+
+	if (_vp_draw_timings != NULL) {
+		_vp_draw_timings->sort += vd->sort_time;
+		_vp_draw_timings->blit += vd->blit_time;
+		_vp_draw_timings->text += GetViewportDrawTime() - start;
+	}
+
+	if (vd->incomplete) {
+		/* Draw this area again when the missing sprites are decoded. */
+		Rect r = { vd->screen.x, vd->screen.y, vd->screen.x + dp.width, vd->screen.y + dp.height };
+		_vp_incomplete_areas.push_back(r);
+	}
+
+	ClearViewportSprites(vd);
+}
+
+void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+{
+	ViewportCollectSprites(vp, left, top, right, bottom);
+	ViewportDrawSprites(&_vd);
+	ViewportDrawOverlay(vp, &_vd);
+}
+
+/**
+ * Load the sprite and recolour sprite a viewport sprite is drawn with into the
+ * sprite cache, like #DrawSpriteViewport would.
+ * @param image The sprite.
+ * @param pal The palette.
+ * @return False if the sprite cannot be drawn while the sprite cache is locked.
+ */
+static bool PreloadViewportSprite(SpriteID image, PaletteID pal)
+{
+	if (!PreloadSprite(GB(image, 0, SPRITE_WIDTH), ST_NORMAL)) return false;
+
+	if (HasBit(image, PALETTE_MODIFIER_TRANSPARENT) || (pal != PAL_NONE && !HasBit(pal, PALETTE_TEXT_RECOLOUR))) {
+		return PreloadSprite(GB(pal, 0, PALETTE_WIDTH), ST_RECOLOUR);
+	}
+	return true;
+}
+
+/**
+ * Load all sprites of an area of a viewport into the sprite cache.
+ * @param vd The collected sprites.
+ * @return False if the sprites cannot be drawn while the sprite cache is locked.
+ */
+static bool PreloadViewportSprites(const ViewportDrawer *vd)
+{
+	for (const TileSpriteToDraw &ts : vd->tile_sprites_to_draw) {
+		if (!PreloadViewportSprite(ts.image, ts.pal)) return false;
+	}
+	for (const ParentSpriteToDraw &ps : vd->parent_sprites_to_draw) {
+		if (ps.image != SPR_EMPTY_BOUNDING_BOX && !PreloadViewportSprite(ps.image, ps.pal)) return false;
+	}
+	for (const ChildScreenSpriteToDraw &cs : vd->child_screen_sprites_to_draw) {
+		if (!PreloadViewportSprite(cs.image, cs.pal)) return false;
+	}
+	return true;
+}
+
+/**
+ * Exchange the collected sprites of two areas. The sprites themselves are not
+ * moved, so the pointers of ViewportDrawer::parent_sprites_to_sort stay valid.
+ * @param a The first area.
+ * @param b The second area.
+ */
+static void SwapViewportSprites(ViewportDrawer &a, ViewportDrawer &b)
+{
+	std::swap(a.dpi, b.dpi);
+	std::swap(a.screen, b.screen);
+	std::swap(a.incomplete, b.incomplete);
+	std::swap(a.sort_time, b.sort_time);
+	std::swap(a.blit_time, b.blit_time);
+	a.string_sprites_to_draw.swap(b.string_sprites_to_draw);
+	a.tile_sprites_to_draw.swap(b.tile_sprites_to_draw);
+	a.parent_sprites_to_draw.swap(b.parent_sprites_to_draw);
+	a.parent_sprites_to_sort.swap(b.parent_sprites_to_sort);
+	a.child_screen_sprites_to_draw.swap(b.child_screen_sprites_to_draw);
+}
+
+/**
+ * Job drawing the sprites of a range of #_vp_draw_areas.
+ * @param param Unused.
+ * @param begin First area to draw.
+ * @param end One past the last area to draw.
+ */
+static void ViewportDrawAreaSprites(void *param, uint begin, uint end)
+{
+	for (uint i = begin; i < end; i++) ViewportDrawSprites(&_vp_draw_areas[i]);
+}
+
+/**
+ * Draw several areas of a viewport. The main thread collects the sprites of
+ * all areas, after which the sprites of the areas are sorted and drawn by the
+ * worker threads while the sprite cache is locked. The areas must not overlap.
+ * When the sprites of the areas do not fit in the sprite cache together they
+ * are drawn by the main thread, with the sprite cache unlocked.
+ * @param vp The viewport.
+ * @param areas The areas, in virtual coordinates.
+ */
+static void ViewportDrawAreas(const ViewPort *vp, const std::vector<Rect> &areas)
+{
+	uint count = (uint)areas.size();
+	if (_vp_draw_areas.size() < count) _vp_draw_areas.resize(count);
+
+	for (uint i = 0; i < count; i++) {
+		const Rect &r = areas[i];
+		ViewportCollectSprites(vp, r.left, r.top, r.right, r.bottom);
+		SwapViewportSprites(_vd, _vp_draw_areas[i]);
 	}
 
+	/* The sprite picker of the NewGRF debug window collects the sprites that are drawn. */
+	bool locked = _newgrf_debug_sprite_picker.mode != SPM_REDRAW;
+	for (uint i = 0; locked && i < count; i++) {
+		locked = PreloadViewportSprites(&_vp_draw_areas[i]);
+	}
+	if (locked) locked = LockSpriteCache();
+
+	if (locked) {
+		_worker_pool.ParallelFor(count, 1, &ViewportDrawAreaSprites, NULL);
+		UnlockSpriteCache();
+	} else {
+		UnlockSpriteCache();
+		ViewportDrawAreaSprites(NULL, 0, count);
+	}
+
+	for (uint i = 0; i < count; i++) ViewportDrawOverlay(vp, &_vp_draw_areas[i]);
+}
+
+/**
+ * Queue the sprites of a part of the world for decoding in the background.
+ * @param vp The viewport to take the zoom level from.
+ * @param left Left edge of the area, in virtual coordinates.
+ * @param top Top edge of the area, in virtual coordinates.
+ * @param right Right edge of the area, in virtual coordinates.
+ * @param bottom Bottom edge of the area, in virtual coordinates.
+ */
+static void ViewportPrefetchArea(const ViewPort *vp, int left, int top, int right, int bottom)
+{
+	int mask = ScaleByZoom(-1, vp->zoom);
+
+	_vd.dpi.zoom = vp->zoom;
+	_vd.dpi.width = (right - left) & mask;
+	_vd.dpi.height = (bottom - top) & mask;
+	_vd.dpi.left = left & mask;
+	_vd.dpi.top = top & mask;
+	_vd.combine_sprites = SPRITE_COMBINE_NONE;
+	_vd.last_child = NULL;
+
+	ViewportAddLandscape();
+	ViewportAddVehicles(&_vd.dpi);
+
+	/* Strings, child sprites and the like are still collected while prefetching; none of them are drawn. */
+	ClearViewportSprites(&_vd);
+}
+
+/**
+ * Queue the sprites just outside the visible part of a viewport for decoding
+ * in the background, so they are ready when the viewport is scrolled there.
+ * The border around the viewport is a quarter of its size; it is only
+ * prefetched again when the viewport moved by half the border or zoomed.
+ * @param vp The viewport.
+ */
+static void PrefetchViewportSprites(ViewportData *vp)
+{
+	if (!IsSpritePrefetchEnabled()) return;
+
+	int margin_x = vp->virtual_width / 4;
+	int margin_y = vp->virtual_height / 4;
+	if (vp->prefetch_zoom == vp->zoom &&
+			abs(vp->virtual_left - vp->prefetch_left) < margin_x / 2 &&
+			abs(vp->virtual_top - vp->prefetch_top) < margin_y / 2) {
+		return;
+	}
+
+	vp->prefetch_left = vp->virtual_left;
+	vp->prefetch_top = vp->virtual_top;
+	vp->prefetch_zoom = vp->zoom;
+
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	_cur_dpi = &_vd.dpi;
+	_vd.prefetch = true;
+
+	int left = vp->virtual_left;
+	int top = vp->virtual_top;
+	int right = left + vp->virtual_width;
+	int bottom = top + vp->virtual_height;
+	ViewportPrefetchArea(vp, left - margin_x, top - margin_y, right + margin_x, top);
+	ViewportPrefetchArea(vp, left - margin_x, bottom, right + margin_x, bottom + margin_y);
+	ViewportPrefetchArea(vp, left - margin_x, top, left, bottom);
+	ViewportPrefetchArea(vp, right, top, right + margin_x, bottom);
+
+	_vd.prefetch = false;
 	_cur_dpi = old_dpi;
+}
 
-	_vd.string_sprites_to_draw.clear();
-	_vd.tile_sprites_to_draw.clear();
-	_vd.parent_sprites_to_draw.clear();
-	_vd.parent_sprites_to_sort.clear();
-	_vd.child_screen_sprites_to_draw.clear();
+/**
+ * Move the sprites that were decoded in the background into the sprite cache,
+ * and draw the areas of the viewports again that were drawn without them.
+ */
+void UpdateViewportSprites()
+{
+	if (!ProcessPrefetchedSprites()) return;
+
+	for (const Rect &r : _vp_incomplete_areas) SetDirtyBlocks(r.left, r.top, r.right, r.bottom);
+	_vp_incomplete_areas.clear();
 }
 
 /**
  * Make sure we don't draw a too big area at a time.
  * If we do, the sprite memory will overflow.
+ * @param vp The viewport.
+ * @param left Left edge of the area, in screen coordinates.
+ * @param top Top edge of the area, in screen coordinates.
+ * @param right Right edge of the area, in screen coordinates.
+ * @param bottom Bottom edge of the area, in screen coordinates.
+ * @param[out] areas The parts of the area to draw one at a time, in virtual coordinates.
  */
-static void ViewportDrawChk(const ViewPort *vp, int left, int top, int right, int bottom)
+static void ViewportDrawChk(const ViewPort *vp, int left, int top, int right, int bottom, std::vector<Rect> &areas)
 {
 	if (ScaleByZoom(bottom - top, vp->zoom) * ScaleByZoom(right - left, vp->zoom) > 180000 * ZOOM_LVL_BASE * ZOOM_LVL_BASE) {
 		if ((bottom - top) > (right - left)) {
 			int t = (top + bottom) >> 1;
-			ViewportDrawChk(vp, left, top, right, t);
-			ViewportDrawChk(vp, left, t, right, bottom);
+			ViewportDrawChk(vp, left, top, right, t, areas);
+			ViewportDrawChk(vp, left, t, right, bottom, areas);
 		} else {
 			int t = (left + right) >> 1;
-			ViewportDrawChk(vp, left, top, t, bottom);
-			ViewportDrawChk(vp, t, top, right, bottom);
+			ViewportDrawChk(vp, left, top, t, bottom, areas);
+			ViewportDrawChk(vp, t, top, right, bottom, areas);
 		}
 	} else {
-		ViewportDoDraw(vp,
+		Rect r = {
 			ScaleByZoom(left - vp->left, vp->zoom) + vp->virtual_left,
 			ScaleByZoom(top - vp->top, vp->zoom) + vp->virtual_top,
 			ScaleByZoom(right - vp->left, vp->zoom) + vp->virtual_left,
 			ScaleByZoom(bottom - vp->top, vp->zoom) + vp->virtual_top
-		);
+		};
+		areas.push_back(r);
 	}
 }
 
@@ -1664,7 +2112,15 @@ static inline void ViewportDraw(const ViewPort *vp, int left, int top, int right
 	if (top < vp->top) top = vp->top;
 	if (bottom > vp->top + vp->height) bottom = vp->top + vp->height;
 
-	ViewportDrawChk(vp, left, top, right, bottom);
+	static std::vector<Rect> areas;
+	areas.clear();
+	ViewportDrawChk(vp, left, top, right, bottom, areas);
+
+	if (areas.size() > 1 && _settings_client.gui.parallel_viewport_drawing && _worker_pool.GetWorkerCount() > 0) {
+		ViewportDrawAreas(vp, areas);
+	} else {
+		for (const Rect &r : areas) ViewportDoDraw(vp, r.left, r.top, r.right, r.bottom);
+	}
 }
 
 /**
@@ -1679,7 +2135,10 @@ void Window::DrawViewport() const
 	dpi->left += this->left;
 	dpi->top += this->top;
 
+	/* Do not let the screen wait for sprites to be decoded. */
+	_vd.placeholders = IsSpritePrefetchEnabled();
 	ViewportDraw(this->viewport, dpi->left, dpi->top, dpi->left + dpi->width, dpi->top + dpi->height);
+	_vd.placeholders = false;
 
 	dpi->left -= this->left;
 	dpi->top -= this->top;
@@ -1730,6 +2189,7 @@ void UpdateViewportPosition(Window *w)
 		w->viewport->scrollpos_x = pt.x;
 		w->viewport->scrollpos_y = pt.y;
 		SetViewportPosition(w, pt.x, pt.y);
+		PrefetchViewportSprites(w->viewport);
 	} else {
 		/* Ensure the destination location is within the map */
 		ClampViewportToMap(vp, &w->viewport->dest_scrollpos_x, &w->viewport->dest_scrollpos_y);
@@ -1756,6 +2216,7 @@ void UpdateViewportPosition(Window *w)
 
 		SetViewportPosition(w, w->viewport->scrollpos_x, w->viewport->scrollpos_y);
 		if (update_overlay) RebuildViewportOverlay(w);
+		PrefetchViewportSprites(w->viewport);
 	}
 }
 
@@ -3286,14 +3747,16 @@ Point GetViewportStationMiddle(const ViewPort *vp, const Station *st)
 struct ViewportSSCSS {
 	VpSorterChecker fct_checker; ///< The check function.
 	VpSpriteSorter fct_sorter;   ///< The sorting function.
+	const char *name;            ///< Name of the sorter, for the benchmark.
 };
 
-/** List of sorters ordered from best to worst. */
+/** List of sorters ordered from best to worst. The last one is the reference for the others. */
 static ViewportSSCSS _vp_sprite_sorters[] = {
+	{ &ViewportSortParentSpritesChecker, &ViewportSortParentSpritesSpatial, "spatial" },
 #ifdef WITH_SSE
-	{ &ViewportSortParentSpritesSSE41Checker, &ViewportSortParentSpritesSSE41 },
+	{ &ViewportSortParentSpritesSSE41Checker, &ViewportSortParentSpritesSSE41, "sse4.1" },
 #endif
-	{ &ViewportSortParentSpritesChecker, &ViewportSortParentSprites }
+	{ &ViewportSortParentSpritesChecker, &ViewportSortParentSprites, "plain" }
 };
 
 /** Choose the "best" sprite sorter and set _vp_sprite_sorter. */
@@ -3308,6 +3771,112 @@ void InitializeSpriteSorter()
 	assert(_vp_sprite_sorter != NULL);
 }
 
+/**
+ * Start or stop measuring the time spent in the phases of drawing the viewports.
+ * Sorting and drawing the sprites may be done by several threads at the same
+ * time; their times are summed, so they can add up to more than the elapsed time.
+ * @param timings The timings to add the measured times to, or \c NULL to stop measuring.
+ */
+void SetViewportDrawTimings(ViewportDrawTimings *timings)
+{
+	_vp_draw_timings = timings;
+}
+
+/**
+ * Start recording the parent sprites sorted by the next viewport draws.
+ * @param filename The file to record to.
+ * @param frames The number of viewport draws to record.
+ */
+void ConStartSpriteSorterRecording(const char *filename, uint frames)
+{
+	if (_vp_sprite_record != NULL) fclose(_vp_sprite_record);
+
+	_vp_sprite_record = FioFOpenFile(filename, "wb", NO_DIRECTORY);
+	_vp_sprite_record_frames = frames;
+	if (_vp_sprite_record == NULL) {
+		IConsolePrintF(CC_ERROR, "Cannot open '%s' for writing", filename);
+		return;
+	}
+
+	/* Make sure something gets drawn. */
+	MarkWholeScreenDirty();
+	IConsolePrintF(CC_DEFAULT, "Recording the next %u viewport draws to '%s'", frames, filename);
+}
+
+/**
+ * Run all available sprite sorters on recorded parent sprites, and report
+ * their speed and whether they sort the same way as the reference sorter.
+ * @param filename The file with the recording, see ViewportRecordParentSprites.
+ */
+void ConBenchmarkSpriteSorters(const char *filename)
+{
+	FILE *f = FioFOpenFile(filename, "rb", NO_DIRECTORY);
+	if (f == NULL) {
+		IConsolePrintF(CC_ERROR, "Cannot open '%s'", filename);
+		return;
+	}
+
+	std::vector<std::vector<ParentSpriteToDraw>> frames;
+	size_t total = 0;
+	uint32 count;
+	while (fread(&count, sizeof(count), 1, f) == 1) {
+		frames.emplace_back(count);
+		for (ParentSpriteToDraw &ps : frames.back()) {
+			int32 box[6];
+			if (fread(box, sizeof(box), 1, f) != 1) {
+				IConsolePrintF(CC_ERROR, "'%s' is truncated", filename);
+				fclose(f);
+				return;
+			}
+			MemSetT(&ps, 0);
+			ps.xmin = box[0];
+			ps.ymin = box[1];
+			ps.zmin = box[2];
+			ps.xmax = box[3];
+			ps.ymax = box[4];
+			ps.zmax = box[5];
+		}
+		total += count;
+	}
+	fclose(f);
+
+	IConsolePrintF(CC_DEFAULT, "%u viewport draws with %u parent sprites", (uint)frames.size(), (uint)total);
+
+	/* The order the reference sorter gives, as indices into the recorded sprites. */
+	std::vector<std::vector<uint>> reference(frames.size());
+
+	for (int i = lengthof(_vp_sprite_sorters) - 1; i >= 0; i--) {
+		const ViewportSSCSS &sorter = _vp_sprite_sorters[i];
+		if (!sorter.fct_checker()) continue;
+
+		uint64 time = 0;
+		uint64 slowest = 0;
+		uint mismatches = 0;
+		for (size_t j = 0; j < frames.size(); j++) {
+			std::vector<ParentSpriteToDraw> sprites = frames[j];
+			ParentSpriteToSortVector psdv;
+			for (ParentSpriteToDraw &ps : sprites) psdv.push_back(&ps);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			sorter.fct_sorter(&psdv);
+			uint64 duration = (uint64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+			time += duration;
+			slowest = max(slowest, duration);
+
+			std::vector<uint> order;
+			for (const ParentSpriteToDraw *ps : psdv) order.push_back((uint)(ps - sprites.data()));
+			if (reference[j].empty()) {
+				reference[j] = order;
+			} else if (order != reference[j]) {
+				mismatches++;
+			}
+		}
+
+		IConsolePrintF(CC_DEFAULT, "%-8s %8u us total, %6u us slowest draw, %u draws sorted differently",
+				sorter.name, (uint)time, (uint)slowest, mismatches);
+	}
+}
+
 /**
  * Scroll players main viewport.
  * @param tile tile to center viewport on
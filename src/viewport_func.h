@@ -28,6 +28,7 @@ ViewPort *IsPtInWindowViewport(const Window *w, int x, int y);
 Point TranslateXYToTileCoord(const ViewPort *vp, int x, int y, bool clamp_to_map = true);
 Point GetTileBelowCursor();
 void UpdateViewportPosition(Window *w);
+void UpdateViewportSprites();
 
 void MarkAllViewportsDirty(int left, int top, int right, int bottom);
 
@@ -66,6 +67,16 @@ void SetTileSelectBigSize(int ox, int oy, int sx, int sy);
 
 void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom);
 
+/** Time spent in the phases of drawing the viewports, in nanoseconds. */
+struct ViewportDrawTimings {
+	uint64 collect; ///< Collecting the sprites of the landscape, vehicles and signs.
+	uint64 sort;    ///< Sorting the parent sprites.
+	uint64 blit;    ///< Drawing the sprites.
+	uint64 text;    ///< Drawing the strings and the link graph overlay.
+};
+
+void SetViewportDrawTimings(ViewportDrawTimings *timings);
+
 bool ScrollWindowToTile(TileIndex tile, Window *w, bool instant = false);
 bool ScrollWindowTo(int x, int y, int z, Window *w, bool instant = false);
 
@@ -38,7 +38,11 @@ struct ParentSpriteToDraw {
 	int32 top;                      ///< minimal screen Y coordinate of sprite (= y + sprite->y_offs), reference point for child sprites
 
 	int32 first_child;              ///< the first child to draw.
-	bool comparison_done;           ///< Used during sprite sorting: true if sprite has been compared with all other sprites
+	/* Different sorters keep different state, and the size has to stay a multiple of 16B. */
+	union {
+		bool comparison_done;       ///< Used during sprite sorting: true if sprite has been compared with all other sprites
+		uint32 order;               ///< Used during spatial sprite sorting: position in the sorting order, or a state of the sprite
+	};
 };
 
 typedef std::vector<ParentSpriteToDraw*> ParentSpriteToSortVector;
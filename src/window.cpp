@@ -40,6 +40,7 @@
 #include "network/network_func.h"
 #include "guitimer_func.h"
 #include "news_func.h"
+#include "gfx_layout.h"
 
 #include "safeguards.h"
 
@@ -3119,6 +3120,7 @@ void UpdateWindows()
 
 	PerformanceMeasurer framerate(PFE_DRAWING);
 	PerformanceAccumulator::Reset(PFE_DRAWWORLD);
+	Layouter::UpdateLineCacheStats();
 
 	CallWindowRealtimeTickEvent(delta_ms);
 
@@ -3180,6 +3182,7 @@ void UpdateWindows()
 		}
 	}
 
+	UpdateViewportSprites();
 	DrawDirtyBlocks();
 
 	FOR_ALL_WINDOWS_FROM_BACK(w) {
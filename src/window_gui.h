@@ -261,6 +261,9 @@ struct ViewportData : ViewPort {
 	int32 scrollpos_y;        ///< Currently shown y coordinate (virtual screen coordinate of topleft corner of the viewport).
 	int32 dest_scrollpos_x;   ///< Current destination x coordinate to display (virtual screen coordinate of topleft corner of the viewport).
 	int32 dest_scrollpos_y;   ///< Current destination y coordinate to display (virtual screen coordinate of topleft corner of the viewport).
+	int prefetch_left;        ///< Virtual left coordinate of the viewport when its surroundings were last prefetched.
+	int prefetch_top;         ///< Virtual top coordinate of the viewport when its surroundings were last prefetched.
+	ZoomLevel prefetch_zoom;  ///< Zoom level of the viewport when its surroundings were last prefetched.
 };
 
 struct QueryString;